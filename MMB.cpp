@@ -0,0 +1,571 @@
+// Banco de pruebas de los kernels de multiplicacion (microbenchmark)
+//
+// Compilar con CMake:  cmake --build build --target MMB
+// Compilar en Linux:   g++ -O2 -std=c++17 -pthread -o MMB MMB.cpp matmul.cpp
+//
+// Uso: MMB [--sizes=S1,S2,...] [--cases=c1,c2,...] [--threads=T]
+//          [--pin=compact|scatter|physical-only|cache-group]
+//          [--type=int16|int32|int64|float|double] [--acc=int32|int64|float|double]
+//          [--warmup=W] [--reps=R] [--density=D] [--seed=S] [--peak=GOPS]
+//          [--json=ruta] [--out-dir=DIR] [--quiet]
+//
+// Casos (por defecto todos, en este orden):
+//   naive             gemm_naive en un hilo (hasta NAIVE_MAX_MADDS)
+//   blocked-<isa>     gemm_blocked en un hilo con el micro-kernel de cada ISA
+//                     soportado (scalar, sse41, avx2, avx512; sin repetidos)
+//   mms               multiply() de matmul.h en el hilo que llama, como MMS
+//                     (incluye plan, conteo de no ceros y empaquetado)
+//   mmp               Multiplier con T hilos fijados: worker_func con robo
+//                     de teselas, como MMP (empaquetado + multiplicacion)
+//   strassen          Multiplier con --kernel=strassen y T hilos
+//   sparse-dense, dense-sparse, sparse-sparse
+//                     Multiplier con el camino forzado y A y B con densidad D
+//   batched           lote de productos independientes (batched.h) en T
+//                     hilos; solo tamanos de lado <= 64
+//
+// Los casos de un hilo corren en el worker de un pool de un hilo, fijado al
+// primer CPU de --pin; los de T hilos en un Multiplier fijado igual que MMP.
+// Por caso y tamano se hacen W calentamientos sin medir y R repeticiones; se
+// informa mediana, p95 (rango mas cercano), minimo, GOP/s = 2*M*K*N /
+// mediana (en los caminos dispersos, las operaciones hechas / mediana; el
+// equivalente denso va aparte) y % del pico nominal. Tras medir, C se comprueba con Freivalds
+// (verify.h, fuera del tiempo).
+//
+// Pico nominal por hilo = frecuencia maxima x 2 operaciones por
+// multiplicacion-suma x carriles del mejor ISA para Acc x 2 unidades
+// vectoriales. Es una cota (con enteros no hay FMA); --peak=GOPS fija el
+// pico de un hilo cuando se conoce el real.
+//
+// Salida: una tabla (o con --quiet una linea por resultado) y un JSON con un
+// objeto por (caso, tamano) en orden fijo, pensado para comparar entre
+// commits con diff o jq. Por defecto <out-dir>/bench_<T>_<Acc>.json.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "platform.h"
+#include "element.h"
+#include "matrix.h"
+#include "counter_rng.h"
+#include "gemm.h"
+#include "batched.h"
+#include "verify.h"
+#include "matmul.h"
+#include "cli.h"
+#include "report_json.h"
+
+static constexpr double NAIVE_MAX_MADDS = 1 << 26;      // ~ 400x400x400
+static constexpr int BATCH_MAX_SIDE = 64;
+static constexpr double BATCH_MADDS = 1 << 22;          // por repeticion
+static constexpr int BENCH_VERIFY_ROUNDS = 4;
+
+static const char* const ALL_CASES[] = {
+    "naive", "blocked", "mms", "mmp", "strassen", "sparse-dense", "dense-sparse", "sparse-sparse", "batched",
+};
+
+struct BenchOptions {
+    std::vector<Dims> sizes;
+    std::vector<std::string> cases;         // vacio = todos
+    int threads = 0;                        // 0 = uno por CPU logico
+    PinPolicy pin = PinPolicy::Scatter;
+    ElemType type = ElemType::Int32;
+    ElemType acc = ElemType::Int64;
+    int warmup = 2;
+    int reps = 10;
+    double density = 0.05;
+    unsigned seed = 42;
+    double peak = 0.0;                      // GOP/s por hilo; 0 = nominal
+    std::string json_path;
+    std::string out_dir = "resultados";
+    bool quiet = false;
+
+    // "blocked" selecciona todas las blocked-<isa>
+    bool wants(const std::string& c) const {
+        if (cases.empty()) return true;
+        for (const std::string& s : cases)
+            if (s == c || (s == "blocked" && c.rfind("blocked-", 0) == 0)) return true;
+        return false;
+    }
+};
+
+struct BenchResult {
+    std::string name;
+    std::string detail;                     // micro-kernel, camino o lote
+    Dims dims = { 0, 0, 0 };
+    int threads = 1;
+    std::vector<double> times;
+    double median = 0.0, p95 = 0.0, min = 0.0, mean = 0.0;
+    double ops = 0.0;                       // por ejecucion; 0 = 2*M*K*N (denso)
+    double gops = 0.0;
+    double dense_gops = 0.0;                // 2*M*K*N / mediana
+    double peak_pct = -1.0;                 // < 0: pico desconocido
+    int verified = -1;                      // -1 sin comprobar, 0 error, 1 correcta
+};
+
+static double seconds_since(std::chrono::steady_clock::time_point t0) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+// once() hace una ejecucion y devuelve su tiempo en segundos.
+static void measure(const BenchOptions& o, BenchResult& r, const std::function<double()>& once) {
+    for (int i = 0; i < o.warmup; ++i) once();
+    r.times.clear();
+    for (int i = 0; i < o.reps; ++i) r.times.push_back(once());
+    std::vector<double> s = r.times;
+    std::sort(s.begin(), s.end());
+    const size_t n = s.size();
+    r.median = n % 2 ? s[n / 2] : 0.5 * (s[n / 2 - 1] + s[n / 2]);
+    r.p95 = s[(size_t)std::ceil(0.95 * n) - 1];
+    r.min = s[0];
+    double sum = 0.0;
+    for (double t : s) sum += t;
+    r.mean = sum / n;
+}
+
+// Carriles de un registro del mejor ISA para Acc (1 sin SIMD).
+template <class Acc>
+static int simd_lanes() {
+    const MicroKernelT<Acc>& uk = microkernel_for<Acc>(best_supported_isa());
+    int bits = 0;
+    switch (uk.isa) {
+        case SimdIsa::Avx512: bits = 512; break;
+        case SimdIsa::Avx2:   bits = 256; break;
+        case SimdIsa::Sse41:  bits = 128; break;
+        default:              return 1;
+    }
+    return bits / (8 * (int)sizeof(Acc));
+}
+
+template <class T>
+static MatrixT<T> bench_matrix(int rows, int cols, unsigned seed, std::uint32_t stream, double density) {
+    MatrixT<T> m = MatrixT<T>::uninitialized(rows, cols);
+    fill_random_sparse_digits(m.view(), 0, rows, seed, stream, density);
+    return m;
+}
+
+// ===================== Informe =====================
+
+static void print_header(const BenchOptions& o) {
+    if (o.quiet) return;
+    std::cout << "\n  " << std::left << std::setw(15) << "Caso" << std::setw(16) << "Tamano" << std::right
+              << std::setw(6) << "Hilos" << "  " << std::left << std::setw(26) << "Detalle" << std::right
+              << std::setw(13) << "Mediana (s)" << std::setw(13) << "p95 (s)" << std::setw(10) << "GOP/s"
+              << std::setw(9) << "% pico" << "  C\n";
+}
+
+static void print_result(const BenchOptions& o, const BenchResult& r) {
+    const char* check = r.verified < 0 ? "-" : r.verified ? "ok" : "ERROR";
+    if (o.quiet) {
+        std::cout << std::fixed << std::setprecision(6) << "MMB caso=" << r.name << " " << dims_label(r.dims)
+                  << " hilos=" << r.threads << " mediana=" << r.median << " s p95=" << r.p95 << " s"
+                  << std::setprecision(2) << " GOP/s=" << r.gops;
+        if (r.peak_pct >= 0) std::cout << " pico=" << r.peak_pct << "%";
+        std::cout << " C=" << check << "\n";
+        return;
+    }
+    std::cout << "  " << std::left << std::setw(15) << r.name << std::setw(16) << dims_label(r.dims) << std::right
+              << std::setw(6) << r.threads << "  " << std::left << std::setw(26) << r.detail << std::right
+              << std::fixed << std::setprecision(6) << std::setw(13) << r.median << std::setw(13) << r.p95
+              << std::setprecision(2) << std::setw(10) << r.gops;
+    if (r.peak_pct >= 0) std::cout << std::setprecision(1) << std::setw(8) << r.peak_pct << "%";
+    else                 std::cout << std::setw(9) << "-";
+    std::cout << "  " << check << "\n";
+}
+
+// ===================== Casos =====================
+
+template <class T, class Acc>
+int run_bench(const BenchOptions& o) {
+    const CpuTopology cpu_topo = read_cpu_topology();
+    const int threads = o.threads > 0 ? o.threads : default_threads(cpu_topo, o.pin);
+    const double mhz = cpu_max_mhz();
+    const int lanes = simd_lanes<Acc>();
+    const double peak_thread = o.peak > 0 ? o.peak : mhz / 1000.0 * 2.0 * lanes * 2.0;
+    const SimdIsa best = best_supported_isa();
+
+    // Un worker fijado para los casos de un hilo
+    MultiplyOptions single_opt;
+    single_opt.threads = 1;
+    single_opt.pin = o.pin;
+    single_opt.simd = best;
+    Multiplier single(single_opt);
+
+    // blocked-<isa> por cada micro-kernel distinto soportado
+    std::vector<SimdIsa> isas;
+    std::vector<std::string> uk_names;
+    for (SimdIsa isa : { SimdIsa::Scalar, SimdIsa::Sse41, SimdIsa::Avx2, SimdIsa::Avx512 }) {
+        if (!isa_supported(isa)) continue;
+        const std::string name = microkernel_for<Acc>(isa).name;
+        if (std::find(uk_names.begin(), uk_names.end(), name) != uk_names.end()) continue;
+        isas.push_back(isa);
+        uk_names.push_back(name);
+    }
+    auto isa_label = [](SimdIsa isa) {
+        switch (isa) {
+            case SimdIsa::Sse41:  return "sse41";
+            case SimdIsa::Avx2:   return "avx2";
+            case SimdIsa::Avx512: return "avx512";
+            default:              return "scalar";
+        }
+    };
+
+    if (!o.quiet) {
+        std::cout << "=== BANCO DE PRUEBAS DE KERNELS ===\n\n"
+                  << "CPU:                 " << cpu_brand_string() << "\n"
+                  << "Topologia:           " << topology_summary(cpu_topo) << "\n"
+                  << "Tipo (entrada -> acum.): " << elem_name<T>() << " -> " << elem_name<Acc>() << "\n"
+                  << "Hilos (casos paralelos): " << threads << " (afinidad " << pin_policy_name(o.pin) << ")\n"
+                  << "Calentamientos / repeticiones: " << o.warmup << " / " << o.reps << "\n"
+                  << std::fixed << std::setprecision(1) << "Pico por hilo:       ";
+        if (peak_thread > 0)
+            std::cout << peak_thread << " GOP/s"
+                      << (o.peak > 0 ? " (--peak)" : " (" + std::to_string((int)mhz) + " MHz x 4 x " +
+                                                         std::to_string(lanes) + " carriles)") << "\n";
+        else
+            std::cout << "desconocido (sin frecuencia; usar --peak)\n";
+    }
+    print_header(o);
+
+    std::vector<BenchResult> results;
+    auto finish = [&](BenchResult& r) {
+        const double madds = (double)r.dims[0] * r.dims[1] * r.dims[2];
+        r.dense_gops = r.median > 0 ? 2.0 * madds / r.median / 1e9 : 0.0;
+        r.gops = r.ops > 0 && r.median > 0 ? r.ops / r.median / 1e9 : r.dense_gops;
+        if (peak_thread > 0) r.peak_pct = 100.0 * r.gops / (peak_thread * r.threads);
+        print_result(o, r);
+        results.push_back(r);
+    };
+    // Freivalds sobre C ya calculada, en el hilo principal
+    auto check = [&](ConstMatrixViewT<T> A, ConstMatrixViewT<T> B, ConstMatrixViewT<Acc> C) {
+        FreivaldsCheck<T, Acc> chk(A, B, C, BENCH_VERIFY_ROUNDS, o.seed);
+        chk.project_b(0, B.rows);
+        chk.check_rows(0, C.rows);
+        return chk.result().ok ? 1 : 0;
+    };
+    // Multiplier de T hilos: plan y route una vez, se mide run()
+    auto run_engine = [&](BenchResult& r, MultiplyOptions mo, const MatrixT<T>& A, const MatrixT<T>& B,
+                          MatrixT<Acc>& C) {
+        mo.threads = threads;
+        mo.pin = o.pin;
+        mo.simd = best;
+        Multiplier mult(mo);
+        MultiplyPlan<T, Acc> plan;
+        mult.plan(plan, A.rows(), A.cols(), B.cols());
+        mult.route(plan, A.cview(), B.cview());
+        r.threads = mult.threads();
+        std::string err;
+        measure(o, r, [&] {
+            MultiplyMetrics mm = mult.run(plan, A.cview(), B.cview(), C.view());
+            if (!mm.error.empty()) err = mm.error;
+            if (plan.route.path != ProductPath::Dense) r.ops = mm.ops;
+            return mm.total_s;
+        });
+        if (!err.empty()) { std::cerr << r.name << ": " << err << "\n"; return false; }
+        r.detail = r.name == "strassen" ? "cutoff " + std::to_string(plan.ws.plan().cutoff)
+                                        : std::string(product_path_name(plan.route.path)) +
+                                              (plan.route.path == ProductPath::Dense ? std::string(" ") +
+                                                   active_microkernel<Acc>().name : std::string());
+        r.verified = check(A.cview(), B.cview(), C.cview());
+        return true;
+    };
+
+    for (const Dims& d : o.sizes) {
+        const int m = d[0], k = d[1], n = d[2];
+        const double madds = (double)m * k * n;
+        const MatrixT<T> A = bench_matrix<T>(m, k, o.seed, RNG_STREAM_A, 1.0);
+        const MatrixT<T> B = bench_matrix<T>(k, n, o.seed, RNG_STREAM_B, 1.0);
+        MatrixT<Acc> C(m, n);
+        auto base = [&](const std::string& name) {
+            BenchResult r;
+            r.name = name;
+            r.dims = d;
+            return r;
+        };
+        // Tiempo de f() medido dentro del worker fijado
+        auto on_single = [&](const std::function<void()>& f) {
+            double t = 0.0;
+            single.for_each_worker([&](int) {
+                auto t0 = std::chrono::steady_clock::now();
+                f();
+                t = seconds_since(t0);
+            });
+            return t;
+        };
+
+        if (o.wants("naive")) {
+            BenchResult r = base("naive");
+            if (madds <= NAIVE_MAX_MADDS) {
+                r.detail = "i-j-k";
+                measure(o, r, [&] { return on_single([&] { gemm_naive(A.cview(), B.cview(), C.view()); }); });
+                r.verified = check(A.cview(), B.cview(), C.cview());
+                finish(r);
+            } else if (!o.quiet) {
+                std::cout << "  " << std::left << std::setw(15) << "naive" << std::setw(16) << dims_label(d)
+                          << std::right << "  omitido (mas de " << (long long)NAIVE_MAX_MADDS
+                          << " multiplicaciones-suma)\n";
+            }
+        }
+        for (size_t i = 0; i < isas.size(); ++i) {
+            const std::string name = std::string("blocked-") + isa_label(isas[i]);
+            if (!o.wants(name)) continue;
+            BenchResult r = base(name);
+            r.detail = uk_names[i];
+            const MicroKernelT<Acc>& uk = microkernel_for<Acc>(isas[i]);
+            measure(o, r, [&] { return on_single([&] { gemm_blocked(A.cview(), B.cview(), C.view(), uk); }); });
+            r.verified = check(A.cview(), B.cview(), C.cview());
+            finish(r);
+        }
+        if (o.wants("mms")) {
+            BenchResult r = base("mms");
+            MultiplyOptions mo;
+            mo.threads = 1;
+            mo.caller_runs = true;
+            mo.simd = best;
+            r.detail = std::string("multiply() ") + active_microkernel<Acc>().name;
+            std::string err;
+            measure(o, r, [&] {
+                return on_single([&] {
+                    MultiplyMetrics mm = multiply(A.cview(), B.cview(), C.view(), mo);
+                    if (!mm.error.empty()) err = mm.error;
+                });
+            });
+            if (!err.empty()) { std::cerr << "mms: " << err << "\n"; return 1; }
+            r.verified = check(A.cview(), B.cview(), C.cview());
+            finish(r);
+        }
+        if (o.wants("mmp")) {
+            BenchResult r = base("mmp");
+            MultiplyOptions mo;
+            mo.product = ProductPath::Dense;
+            if (!run_engine(r, mo, A, B, C)) return 1;
+            finish(r);
+        }
+        if (o.wants("strassen")) {
+            BenchResult r = base("strassen");
+            MultiplyOptions mo;
+            mo.kernel = GemmKernel::Strassen;
+            if (!run_engine(r, mo, A, B, C)) return 1;
+            finish(r);
+        }
+
+        // Caminos dispersos: A y B propias con densidad D
+        const bool any_sparse = o.wants("sparse-dense") || o.wants("dense-sparse") || o.wants("sparse-sparse");
+        if (any_sparse) {
+            const MatrixT<T> As = bench_matrix<T>(m, k, o.seed, RNG_STREAM_A, o.density);
+            const MatrixT<T> Bs = bench_matrix<T>(k, n, o.seed, RNG_STREAM_B, o.density);
+            for (ProductPath path : { ProductPath::SparseDense, ProductPath::DenseSparse, ProductPath::SparseSparse }) {
+                if (!o.wants(product_path_name(path))) continue;
+                BenchResult r = base(product_path_name(path));
+                MultiplyOptions mo;
+                mo.product = path;
+                if (!run_engine(r, mo, As, Bs, C)) return 1;
+                finish(r);
+            }
+        }
+
+        // Lote: tantos productos de MxKxN como quepan en BATCH_MADDS, por
+        // trozos de un contador compartido (como --batch en MMP)
+        if (o.wants("batched") && std::max({ m, k, n }) <= BATCH_MAX_SIDE) {
+            const int count = (int)std::max(1.0, BATCH_MADDS / madds);
+            BatchT<T> bA = BatchT<T>::uninitialized(count, m, k), bB = BatchT<T>::uninitialized(count, k, n);
+            BatchT<Acc> bC = BatchT<Acc>::uninitialized(count, m, n);
+            fill_random_digits(bA.as_rows(), 0, count * m, o.seed, RNG_STREAM_A);
+            fill_random_digits(bB.as_rows(), 0, count * k, o.seed, RNG_STREAM_B);
+            const SmallGemmKernel<T, Acc> kr = small_gemm_kernel<T, Acc>(m, k, n);
+
+            MultiplyOptions mo;
+            mo.threads = threads;
+            mo.pin = o.pin;
+            mo.simd = best;
+            Multiplier mult(mo);
+            const int chunk = batch_chunk(count, mult.threads(), m, k, n);
+            const int chunks = (count + chunk - 1) / chunk;
+
+            BenchResult r = base("batched");
+            r.threads = mult.threads();
+            r.detail = std::to_string(count) + " productos" + (kr.fixed ? " fijo" : " generico");
+            measure(o, r, [&] {
+                std::atomic<int> next{ 0 };
+                auto t0 = std::chrono::steady_clock::now();
+                mult.for_each_worker([&](int) {
+                    for (int c; (c = next.fetch_add(1, std::memory_order_relaxed)) < chunks;)
+                        gemm_batch_range(bA, bB, bC, kr, c * chunk, std::min(count, (c + 1) * chunk));
+                });
+                return seconds_since(t0);
+            });
+            // Tiempos por producto del lote, para comparar con los demas casos
+            r.median /= count;
+            r.p95 /= count;
+            r.min /= count;
+            r.mean /= count;
+            for (double& t : r.times) t /= count;
+            r.verified = check(bA.matrix_view(0), bB.matrix_view(0),
+                               ConstMatrixViewT<Acc>{ bC.matrix(0), m, n, n });
+            finish(r);
+        }
+    }
+
+    // ===================== JSON de resultados =====================
+    std::string path = o.json_path;
+    if (path.empty()) {
+        ensure_dir(o.out_dir);
+        path = o.out_dir + "/bench_" + std::string(elem_name<T>()) + "_" + elem_name<Acc>() + ".json";
+    }
+    std::ofstream f;
+    if (!open_json_file(path, f)) return 1;
+    JsonWriter w(f);
+    w.begin_object();
+    w.field("programa", "MMB.cpp");
+    w.field("tipo", "Banco de pruebas de kernels");
+    w.field("fecha_ejecucion", current_datetime_iso());
+    json_sistema(w, read_system_info());
+
+    w.begin_object("configuracion");
+    w.field("tipo_elemento", elem_name<T>());
+    w.field("acumulador", elem_name<Acc>());
+    w.field("hilos", threads);
+    w.field("afinidad", pin_policy_name(o.pin));
+    w.field("topologia", topology_summary(cpu_topo));
+    w.field("micro_kernel", microkernel_for<Acc>(best).name);
+    w.field("calentamientos", o.warmup);
+    w.field("repeticiones", o.reps);
+    w.field("densidad_dispersos", o.density);
+    w.field("semilla", o.seed);
+    w.field("frecuencia_mhz", mhz);
+    w.field("pico_gop_s_por_hilo", peak_thread);
+    w.field("pico_forzado", o.peak > 0);
+    w.end_object();
+
+    bool all_ok = true;
+    w.begin_array("resultados");
+    for (const BenchResult& r : results) {
+        w.begin_object();
+        w.field("caso", r.name);
+        w.field("dimensiones", dims_label(r.dims));
+        w.field("hilos", r.threads);
+        w.field("detalle", r.detail);
+        w.field("mediana_s", r.median);
+        w.field("p95_s", r.p95);
+        w.field("minimo_s", r.min);
+        w.field("media_s", r.mean);
+        w.field("gop_s", r.gops);
+        if (r.ops > 0) {
+            w.field("operaciones", r.ops);
+            w.field("gop_s_equivalente_denso", r.dense_gops);
+        }
+        if (r.peak_pct >= 0) w.field("pico_pct", r.peak_pct);
+        if (r.verified >= 0) w.field("c_correcta", r.verified == 1);
+        w.inline_array("tiempos_s", r.times);
+        w.end_object();
+        all_ok &= r.verified != 0;
+    }
+    w.end_array();
+    w.finish();
+    if (!o.quiet) std::cout << "\nResultados guardados en " << path << "\n";
+    if (!all_ok) std::cerr << "Algun caso dio una C incorrecta (ver c_correcta)\n";
+    return all_ok ? 0 : 1;
+}
+
+// ===================== Linea de comandos =====================
+
+static void print_bench_usage() {
+    std::cerr << "Uso: MMB [--sizes=S1,S2,...] [--cases=c1,c2,...] [--threads=T]\n"
+              << "       [--pin=compact|scatter|physical-only|cache-group]\n"
+              << "       [--type=int16|int32|int64|float|double] [--acc=int32|int64|float|double]\n"
+              << "       [--warmup=W] [--reps=R] [--density=D] [--seed=S] [--peak=GOPS]\n"
+              << "       [--json=ruta] [--out-dir=DIR] [--quiet]\n"
+              << "Casos: naive, blocked (o blocked-scalar|sse41|avx2|avx512), mms, mmp, strassen,\n"
+              << "       sparse-dense, dense-sparse, sparse-sparse, batched\n";
+}
+
+static bool parse_bench_cli(int argc, char** argv, BenchOptions& o, std::string& bad) {
+    bool acc_given = false;
+    auto value = [](const std::string& arg, const char* name, std::string& v) {
+        std::string p = std::string(name) + "=";
+        if (arg.rfind(p, 0) != 0) return false;
+        v = arg.substr(p.size());
+        return true;
+    };
+    auto known_case = [](const std::string& c) {
+        for (const char* k : ALL_CASES)
+            if (c == k) return true;
+        return c == "blocked-scalar" || c == "blocked-sse41" || c == "blocked-avx2" || c == "blocked-avx512";
+    };
+    for (int a = 1; a < argc; ++a) {
+        std::string arg = argv[a], v;
+        bool ok = true;
+        if (value(arg, "--sizes", v))
+            ok = parse_list(v, [&](const std::string& s) {
+                Dims d;
+                if (!parse_dims(s, d)) return false;
+                o.sizes.push_back(d);
+                return true;
+            });
+        else if (value(arg, "--cases", v))
+            ok = parse_list(v, [&](const std::string& s) {
+                if (!known_case(s)) return false;
+                o.cases.push_back(s);
+                return true;
+            });
+        else if (value(arg, "--threads", v)) ok = parse_positive(v, o.threads);
+        else if (value(arg, "--pin", v))     ok = parse_pin_policy(v, o.pin);
+        else if (value(arg, "--type", v))    ok = parse_elem_type(v, o.type);
+        else if (value(arg, "--acc", v))     ok = acc_given = parse_elem_type(v, o.acc);
+        else if (value(arg, "--warmup", v))  ok = parse_int(v, 0, o.warmup);
+        else if (value(arg, "--reps", v))    ok = parse_positive(v, o.reps);
+        else if (value(arg, "--seed", v))    ok = parse_unsigned(v, o.seed);
+        else if (value(arg, "--density", v)) {
+            char* end = nullptr;
+            o.density = std::strtod(v.c_str(), &end);
+            ok = !v.empty() && *end == '\0' && o.density > 0.0 && o.density <= 1.0;
+        }
+        else if (value(arg, "--peak", v)) {
+            char* end = nullptr;
+            o.peak = std::strtod(v.c_str(), &end);
+            ok = !v.empty() && *end == '\0' && o.peak > 0.0;
+        }
+        else if (value(arg, "--json", v))    { o.json_path = v; ok = !v.empty(); }
+        else if (value(arg, "--out-dir", v)) { o.out_dir = v; ok = !v.empty(); }
+        else if (arg == "--quiet")           o.quiet = true;
+        else ok = false;
+        if (!ok) { bad = arg; return false; }
+    }
+    if (!acc_given) o.acc = default_acc_type(o.type);
+    if (!elem_types_supported(o.type, o.acc)) { bad = "--acc (combinacion de tipos no soportada)"; return false; }
+    if (o.sizes.empty())
+        for (const char* s : { "32", "64", "128", "256", "512", "1024", "1024x64x1024", "64x1024x64", "4096x256x256" }) {
+            Dims d;
+            parse_dims(s, d);
+            o.sizes.push_back(d);
+        }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    std::cout << std::unitbuf;
+
+    BenchOptions opt;
+    std::string bad;
+    if (!parse_bench_cli(argc, argv, opt, bad)) {
+        std::cerr << "Argumento no reconocido o no soportado por esta CPU: " << bad << "\n";
+        print_bench_usage();
+        return 1;
+    }
+
+    int rc = 1;
+    dispatch_elem_types(opt.type, opt.acc, [&](auto t, auto a) {
+        using T = typename decltype(t)::type;
+        using Acc = typename decltype(a)::type;
+        rc = run_bench<T, Acc>(opt);
+    });
+    return rc;
+}
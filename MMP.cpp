@@ -1,11 +1,25 @@
 // Multiplicacion de matrices PARALELO (multiples hilos, multiples cores) en C++
 //
-// Compilar con MSVC:  cl /O2 /EHsc MMP.cpp /link psapi.lib
-// Compilar con g++:   g++ -O2 -std=c++17 -o MMP.exe MMP.cpp -lpsapi
+// Compilar con CMake: cmake --build build --target MMP
+// Compilar con MSVC:  cl /O2 /EHsc MMP.cpp matmul.cpp /link psapi.lib
+// Compilar con g++:   g++ -O2 -std=c++17 -o MMP.exe MMP.cpp matmul.cpp -lpsapi
+// Compilar en Linux:  g++ -O2 -std=c++17 -pthread -o MMP MMP.cpp matmul.cpp
+//
+// Uso: MMP.exe [M K N | --dims=MxKxN] [--threads=T] [--kernel=naive|blocked|strassen]
+//              [--strassen-cutoff=N]
+//              [--simd=auto|scalar|sse41|avx2|avx512]
+//              [--park=spin|block|hybrid] [--monitor=on|off]
+//              [--type=int16|int32|int64|float|double] [--acc=int32|int64|float|double]
+//              [--seed=S] [--reps=R] [--json[=ruta]] [--out-dir=DIR] [--quiet]
+//              [--sweep=N1,N2,...] [--sweep-threads=T1,T2,...]
+//
+// Sin dimensiones ni barrido las pide por consola. Ver cli.h.
+//
+// Ejemplo de barrido (un JSON por punto en resultados/):
+//   MMP --sweep=256,512,1024 --sweep-threads=1,2,4,8 --reps=5 --quiet
 
 #include <iostream>
 #include <vector>
-#include <random>
 #include <chrono>
 #include <thread>
 #include <mutex>
@@ -14,140 +28,66 @@
 #include <string>
 #include <memory>
 #include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <functional>
 
 #ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
 #include <windows.h>
 #include <psapi.h>
 #include <tlhelp32.h>
 #pragma comment(lib, "psapi.lib")
 #endif
 
-using Matrix = std::vector<std::vector<int>>;
-static constexpr int SEED = 42;
+#include "platform.h"
+#include "element.h"
+#include "matrix.h"
+#include "counter_rng.h"
+#include "matrix_file.h"
+#include "out_of_core.h"
+#include "numa.h"
+#include "topology.h"
+#include "perf_counters.h"
+#include "gemm.h"
+#include "strassen.h"
+#include "sparse.h"
+#include "batched.h"
+#include "pipeline.h"
+#include "verify.h"
+#include "trace.h"
+#include "scheduler.h"
+#include "thread_pool.h"
+#include "metrics.h"
+#include "matmul.h"
+#include "cli.h"
+#include "report_json.h"
 
 // ===================== Funciones comunes =====================
 
-Matrix generate_matrix(int rows, int cols, std::mt19937& rng) {
-    std::uniform_int_distribution<int> dist(0, 9);
-    Matrix m(rows, std::vector<int>(cols));
-    for (int i = 0; i < rows; ++i)
-        for (int j = 0; j < cols; ++j)
-            m[i][j] = dist(rng);
-    return m;
-}
-
-void print_matrix(const Matrix& m, const std::string& name) {
+template <class T>
+void print_matrix(const MatrixT<T>& m, const std::string& name) {
+    std::ios_base::fmtflags flags = std::cout.flags();
+    std::streamsize prec = std::cout.precision();
+    std::cout << std::defaultfloat << std::setprecision(6);
     std::cout << "\nMatriz " << name << ":\n";
-    for (const auto& row : m) {
+    for (int i = 0; i < m.rows(); ++i) {
+        const T* r = m.row(i);
         std::cout << "  ";
-        for (int v : row)
-            std::cout << std::setw(4) << v << "  ";
+        for (int j = 0; j < m.cols(); ++j)
+            std::cout << std::setw(4) << r[j] << "  ";
         std::cout << "\n";
     }
+    std::cout.flags(flags);
+    std::cout.precision(prec);
 }
 
-double get_memory_mb() {
-#ifdef _WIN32
-    PROCESS_MEMORY_COUNTERS pmc;
-    if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
-        return pmc.WorkingSetSize / (1024.0 * 1024.0);
-#endif
-    return 0.0;
-}
-
-double get_thread_cpu_time() {
-#ifdef _WIN32
-    FILETIME c, e, k, u;
-    if (GetThreadTimes(GetCurrentThread(), &c, &e, &k, &u)) {
-        ULARGE_INTEGER ki, ui;
-        ki.LowPart = k.dwLowDateTime; ki.HighPart = k.dwHighDateTime;
-        ui.LowPart = u.dwLowDateTime; ui.HighPart = u.dwHighDateTime;
-        return (ki.QuadPart + ui.QuadPart) / 10000000.0;
-    }
-#endif
-    return 0.0;
-}
-
-// ===================== Metricas por hilo =====================
-
-struct ThreadMetrics {
-    int thread_id = 0;
-    int core_id = 0;
-    int row_start = 0;
-    int row_end = 0;
-    unsigned long native_tid = 0;
-    int rows_done = 0;
-    int total_rows = 0;
-    double progress = 0.0;
-    double cpu_pct = 0.0;
-    double elapsed = 0.0;
-    double total_time = 0.0;
-    bool started = false;
-    bool done = false;
-    std::vector<double> cpu_samples;
-    std::mutex mtx;
-};
-
-// ===================== Funcion del hilo worker =====================
-
-void worker_func(const Matrix& A, const Matrix& B, Matrix& C, ThreadMetrics& info) {
-    // Fijar hilo a un core especifico
-#ifdef _WIN32
-    SetThreadAffinityMask(GetCurrentThread(), 1ULL << info.core_id);
-    info.native_tid = GetCurrentThreadId();
-#endif
-
-    int row_start = info.row_start;
-    int row_end = info.row_end;
-    int total = row_end - row_start;
-    int cols_b = (int)B[0].size();
-    int cols_a = (int)A[0].size();
-    int report_interval = std::max(1, total / 20);
-
-    double prev_cpu = get_thread_cpu_time();
-    auto prev_wall = std::chrono::steady_clock::now();
-    auto start_wall = prev_wall;
-
-    {
-        std::lock_guard<std::mutex> lk(info.mtx);
-        info.total_rows = total;
-        info.started = true;
-    }
-
-    for (int idx = 0; idx < total; ++idx) {
-        int i = row_start + idx;
-        for (int j = 0; j < cols_b; ++j) {
-            int sum = 0;
-            for (int k = 0; k < cols_a; ++k)
-                sum += A[i][k] * B[k][j];
-            C[i][j] = sum;
-        }
-
-        if ((idx + 1) % report_interval == 0 || idx == total - 1) {
-            auto now = std::chrono::steady_clock::now();
-            double cur_cpu = get_thread_cpu_time();
-            double dwall = std::chrono::duration<double>(now - prev_wall).count();
-            double dcpu = cur_cpu - prev_cpu;
-            double pct = (dwall > 0.001) ? (dcpu / dwall) * 100.0 : 0.0;
-            double el = std::chrono::duration<double>(now - start_wall).count();
-
-            {
-                std::lock_guard<std::mutex> lk(info.mtx);
-                info.rows_done = idx + 1;
-                info.progress = (idx + 1) * 100.0 / total;
-                info.cpu_pct = pct;
-                info.elapsed = el;
-                info.cpu_samples.push_back(pct);
-                if (idx == total - 1) {
-                    info.done = true;
-                    info.total_time = el;
-                }
-            }
-
-            prev_cpu = cur_cpu;
-            prev_wall = now;
-        }
-    }
+// Filas propias de un hilo ("30 - 63"), o "-" si no tiene ninguna.
+static std::string rows_label(const ThreadMetrics& m) {
+    if (m.row_end <= m.row_start) return "-";
+    return std::to_string(m.row_start) + " - " + std::to_string(m.row_end - 1);
 }
 
 // ===================== FUNCIONES DE INFORMACION DEL PROCESO =====================
@@ -182,12 +122,16 @@ void mostrar_info_ipc(int num_threads) {
 
     // Informacion especifica de IPC para multihilo
     std::cout << "\n  -- IPC entre Hilos (Sincronizacion) --\n";
-    std::cout << "  Hilos worker creados:       " << num_threads << "\n";
+    std::cout << "  Hilos worker (pool):        " << num_threads << "\n";
     std::cout << "  Hilo monitor:               1\n";
-    std::cout << "  Total hilos del proceso:    " << (num_threads + 2) << " (incluye main)\n";
+    std::cout << "  Hilo despachador:           1\n";
+    std::cout << "  Total hilos del proceso:    " << (num_threads + 3) << " (incluye main)\n";
     std::cout << "  Mecanismos IPC usados:\n";
-    std::cout << "    - std::mutex              (exclusion mutua para metricas)\n";
+    std::cout << "    - std::condition_variable (aparcar/despertar hilos del pool)\n";
+    std::cout << "    - std::mutex              (exclusion mutua en las colas de teselas)\n";
     std::cout << "    - std::atomic<bool>       (senalizacion de finalizacion)\n";
+    std::cout << "    - Seqlock por hilo        (metricas vivas, lectura sin locks)\n";
+    std::cout << "    - Cola SPSC por hilo      (muestras de CPU worker -> monitor)\n";
     std::cout << "    - std::lock_guard         (RAII para locks)\n";
     std::cout << "    - Memoria compartida      (matrices A, B, C)\n";
 
@@ -234,12 +178,11 @@ void mostrar_info_pila(const std::vector<std::unique_ptr<ThreadMetrics>>& metric
     std::cout << "  " << std::string(47, '-') << "\n";
 
     for (size_t i = 0; i < metrics.size(); ++i) {
-        std::lock_guard<std::mutex> lk(metrics[i]->mtx);
         auto& m = *metrics[i];
         std::cout << "  " << std::left << std::setw(10) << ("Worker " + std::to_string(i))
-                  << std::setw(12) << m.native_tid
+                  << std::setw(12) << m.live.load().native_tid
                   << std::setw(10) << m.core_id
-                  << m.row_start << " - " << (m.row_end - 1) << "\n";
+                  << rows_label(m) << "\n";
     }
 
     std::cout << "\n  Nota: Cada hilo tiene su propia pila independiente\n";
@@ -407,12 +350,11 @@ void mostrar_acceso_nucleo(int num_threads, const std::vector<std::unique_ptr<Th
     std::cout << "  " << std::string(52, '-') << "\n";
 
     for (size_t i = 0; i < metrics.size(); ++i) {
-        std::lock_guard<std::mutex> lk(metrics[i]->mtx);
-        auto& m = *metrics[i];
+        ThreadSnapshot s = metrics[i]->live.load();
         std::cout << "  " << std::left << std::setw(12) << ("Worker " + std::to_string(i))
-                  << std::setw(10) << m.native_tid
-                  << std::setw(15) << ("Core " + std::to_string(m.core_id))
-                  << std::fixed << std::setprecision(4) << m.total_time << "\n";
+                  << std::setw(10) << s.native_tid
+                  << std::setw(15) << ("Core " + std::to_string(metrics[i]->core_id))
+                  << std::fixed << std::setprecision(4) << s.total_time << "\n";
     }
 
     // ---- PRIORIDAD DEL PROCESO ----
@@ -490,8 +432,10 @@ void mostrar_acceso_nucleo(int num_threads, const std::vector<std::unique_ptr<Th
     std::cout << "    - Afinidad fijada a un core especifico\n";
     std::cout << "  Recursos compartidos:\n";
     std::cout << "    - Matrices A, B (solo lectura)\n";
-    std::cout << "    - Matriz C (escritura en regiones disjuntas)\n";
-    std::cout << "    - Metricas (protegidas por mutex)\n";
+    std::cout << "    - B empaquetada en paneles (una copia, solo lectura)\n";
+    std::cout << "    - Matriz C (escritura en teselas disjuntas)\n";
+    std::cout << "    - Colas de teselas (robo de trabajo entre hilos)\n";
+    std::cout << "    - Metricas (seqlock por hilo, sin mutex)\n";
 
     std::cout << "===========================================================\n";
 }
@@ -577,7 +521,7 @@ void mostrar_llamadas_sistema(int num_threads) {
     std::cout << "  | HILOS            | GetCurrentThread()    | Handle del hilo |\n";
     std::cout << "  | (IMPORTANTE!)    | GetCurrentThreadId()  | TID del hilo    |\n";
     std::cout << "  |                  | GetThreadTimes()      | Tiempos por hilo|\n";
-    std::cout << "  |                  | SetThreadAffinityMask | Fijar a un core |\n";
+    std::cout << "  |                  | SetThreadGroupAffinity| Fijar a un core |\n";
     std::cout << "  +------------------------------------------------------------+\n";
 
     // Memoria
@@ -628,6 +572,7 @@ void mostrar_llamadas_sistema(int num_threads) {
     std::cout << "    - std::mutex          : Exclusion mutua\n";
     std::cout << "    - std::lock_guard     : RAII para locks seguros\n";
     std::cout << "    - std::atomic<bool>   : Operaciones atomicas\n";
+    std::cout << "    - seqlock / cola SPSC : Metricas sin bloquear a los workers\n";
     std::cout << "  \n";
     std::cout << "  Cada hilo puede ejecutarse en un CORE diferente,\n";
     std::cout << "  logrando PARALELISMO REAL en CPUs multicore.\n";
@@ -637,224 +582,960 @@ void mostrar_llamadas_sistema(int num_threads) {
 
 #endif
 
-// ===================== Main =====================
+// ===================== Ejecucion para un tipo =====================
 
-int main() {
-    std::cout << std::unitbuf;
+// Un punto de ejecucion: dimensiones e hilos ya resueltos (en un barrido hay
+// uno por tamano x hilos); el resto de opciones sale de la linea de comandos.
+struct RunPoint {
+    Dims dims = { 0, 0, 0 };
+    int threads = 0;            // 0 = uno por core logico
+    std::string json_path;      // vacio = no escribir JSON
+};
 
-    int rows_a, cols_a, cols_b;
+// Contadores hardware de un hilo o del total: IPC y, si se conocen las
+// operaciones (ops > 0), GOP/s y fallos por cada 1000 operaciones.
+static void print_perf(std::ostream& out, const std::string& indent, const PerfCounts& c,
+                       double ops, double seconds) {
+    auto num = [&](double v, int prec) {
+        if (v < 0) { out << "n/d"; return; }
+        out << std::fixed << std::setprecision(prec) << v;
+    };
+    out << indent << "IPC ";
+    num(c.ipc(), 2);
+    if (ops > 0 && seconds > 0) {
+        out << "  |  ";
+        num(ops / seconds / 1e9, 2);
+        out << " GOP/s";
+    }
+    out << "\n";
+    if (ops <= 0) return;
+    const char* names[] = { "L1D", "LLC", "dTLB", "saltos" };
+    out << indent << "Fallos por 1k ops: ";
+    for (int e = PERF_L1D_MISSES; e < PERF_EVENT_COUNT; ++e) {
+        if (e > PERF_L1D_MISSES) out << " | ";
+        out << names[e - PERF_L1D_MISSES] << " ";
+        num(c.per_kop(e, ops), 3);
+    }
+    out << "\n";
+}
 
-    std::cout << "=== MULTIPLICACION DE MATRICES - PARALELO (C++) ===\n\n";
-    std::cout << "Filas de A: " << std::flush;                    std::cin >> rows_a;
-    std::cout << "Columnas de A (= Filas de B): " << std::flush;  std::cin >> cols_a;
-    std::cout << "Columnas de B: " << std::flush;                  std::cin >> cols_b;
+static double median_of(std::vector<double> v) {
+    if (v.empty()) return 0.0;
+    std::sort(v.begin(), v.end());
+    size_t h = v.size() / 2;
+    return v.size() % 2 ? v[h] : 0.5 * (v[h - 1] + v[h]);
+}
 
-    std::cout << "\nSemilla aleatoria: " << SEED << "\n";
-    std::mt19937 rng(SEED);
+// Estado de run_parallel que comparten sus fases: lo prepara parallel_setup,
+// parallel_reps deja el de la ultima repeticion (el que se informa por hilo)
+// y parallel_report / parallel_json lo leen.
+template <class T, class Acc>
+struct ParallelRun {
+    bool strassen = false;      // plan.kernel: sin niveles Strassen multiplica por teselas
+    bool tracing = false;       // con --trace el monitor escribe en la traza y no imprime
+    bool monitor_on = false;
+    CpuTopology cpu_topo;
+    int num_threads = 0;
+
+    std::unique_ptr<Multiplier> mult;
+    MultiplyPlan<T, Acc> plan;
+    std::vector<PerfCounters> perf;
+    bool perf_on = false;
+
+    // NUMA y matrices
+    bool multi_node = false, replicate_b = false, b_interleaved = false;
+    int b_replicas = 1;
+    bool a_from_file = false, b_from_file = false;
+    MatrixT<T> A;
+    std::vector<MatrixT<T>> B_rep;      // B es B_rep[0]
+    MatrixFileOut<Acc> c_out;           // C es c_out.matrix
+    double gen_elapsed = 0.0;
+    std::vector<double> pages_local_pct;
+
+    std::unique_ptr<Tracer> tracer;
+    int trace_main = -1, trace_monitor = -1;
+
+    // Ultima repeticion
+    std::vector<std::unique_ptr<ThreadMetrics>> metrics;
+    std::vector<double> rep_times;
+    double global_elapsed = 0.0, compute_elapsed = 0.0, pack_elapsed = 0.0;
+    int monitor_refreshes = 0;
+    double monitor_cpu = 0.0;
+    VerifyResult verify;
+
+    const MatrixT<T>& B() const { return B_rep[0]; }
+    MatrixT<Acc>& C() { return c_out.matrix; }
+    TraceBuffer* trace_of(int i) { return tracing ? tracer->thread(i) : nullptr; }
+};
 
-    std::cout << "Generando matrices...\n";
-    Matrix A = generate_matrix(rows_a, cols_a, rng);
-    Matrix B = generate_matrix(cols_a, cols_b, rng);
+// Por nodo NUMA: trafico estimado de A, B y C (bytes que recorre el kernel
+// por tesela, sin contar reutilizacion en cache) y parte remota.
+struct NodeTotals {
+    int threads = 0, tiles = 0, tiles_remote = 0;
+    double local = 0.0, remote = 0.0;
 
-    if (rows_a <= 10 && cols_b <= 10) {
-        print_matrix(A, "A");
-        print_matrix(B, "B");
-    }
+    double gb_s(double seconds) const { return seconds > 0 ? (local + remote) / seconds / 1e9 : 0.0; }
+    double remote_pct() const { return local + remote > 0 ? 100.0 * remote / (local + remote) : 0.0; }
+};
 
-    // --- Configuracion de hilos ---
-    unsigned int num_cores = std::thread::hardware_concurrency();
-    if (num_cores == 0) num_cores = 4;
-    int num_threads = std::min((int)num_cores, rows_a);
-
-    // --- Distribuir filas entre hilos ---
-    std::vector<std::pair<int, int>> distribution;
-    int base = rows_a / num_threads;
-    int remainder = rows_a % num_threads;
-    int start = 0;
-    for (int i = 0; i < num_threads; ++i) {
-        int count = base + (i < remainder ? 1 : 0);
-        if (count > 0) {
-            distribution.push_back({start, start + count});
-            start += count;
-        }
-    }
-    num_threads = (int)distribution.size();
+// Totales que calcula parallel_report y reutiliza parallel_json.
+struct ParallelSummary {
+    double median_time = 0.0, min_time = 0.0, gops = 0.0;
+    double final_mem = 0.0;
+    double useful_ops = 0.0;            // operaciones hechas (2 por multiplicacion-suma)
+    long long nnz_c = 0;
+    double total_cpu_time = 0.0;
+    int total_stolen = 0;
+    PerfCounts hw_total;
+    double nominal_ops = 0.0;
+    std::vector<NodeTotals> per_node;
+    std::uint64_t dropped_samples = 0;
+    double cpu_parallelism = 0.0, cpu_utilization = 0.0;
+};
 
-    std::cout << "\nCores logicos disponibles: " << num_cores << "\n";
-    std::cout << "Hilos a utilizar:          " << num_threads << "\n";
+// Configuracion de hilos, motor, plan, contadores hardware, NUMA, generacion
+// (o carga) de A y B, camino del producto y traza. Devuelve false si falla
+// algun fichero (ya informado).
+template <class T, class Acc>
+static bool parallel_setup(const CliOptions& opt, const RunPoint& pt, std::ostream& out, ParallelRun<T, Acc>& r) {
+    const GemmKernel kernel = opt.kernel;
+    const int rows_a = pt.dims[0], cols_a = pt.dims[1], cols_b = pt.dims[2];
+    r.tracing = !opt.trace_path.empty();
+    r.monitor_on = opt.monitor_on && (!opt.quiet || r.tracing);
 
-    // --- Tabla de distribucion ---
-    std::cout << "\n" << std::string(70, '=') << "\n";
-    std::cout << "  DISTRIBUCION DEL TRABAJO\n";
-    std::cout << std::string(70, '=') << "\n";
+    // --- Configuracion de hilos ---
+    // Por defecto un hilo por CPU logico permitido (por core fisico con
+    // --pin=physical-only); el CPU de cada hilo lo decide la politica.
+    r.cpu_topo = read_cpu_topology();
+    const CpuTopology& cpu_topo = r.cpu_topo;
+    r.num_threads = std::min(pt.threads > 0 ? pt.threads : default_threads(cpu_topo, opt.pin), rows_a);
+    const int num_threads = r.num_threads;
+
+    out << "\nCores logicos disponibles: " << cpu_topo.cpus.size() << "\n";
+    out << "Topologia:                 " << topology_summary(cpu_topo) << "\n";
+    out << "Hilos a utilizar:          " << num_threads << " (afinidad " << pin_policy_name(opt.pin) << ")\n";
+    out << "Tipo (entrada -> acum.):   " << elem_name<T>() << " -> " << elem_name<Acc>() << "\n";
+    out << "Kernel:                    " << kernel_name(kernel) << "\n";
+    if (kernel != GemmKernel::Naive)
+        out << "Micro-kernel:              " << active_microkernel<Acc>().name << "\n";
+    if (opt.reps > 1)
+        out << "Repeticiones:              " << opt.reps << "\n";
+
+    // --- Motor (matmul.h): pool persistente, hilo i fijado al CPU cores[i]
+    //     segun --pin ---
+    // Se crea una vez; generacion, empaquetado y multiplicacion de todas las
+    // repeticiones son trabajos sobre los mismos hilos.
+    MultiplyOptions mo;
+    mo.threads = num_threads;
+    mo.kernel = kernel;
+    mo.pin = opt.pin;
+    mo.park = opt.park;
+    mo.simd = opt.simd;
+    mo.product = opt.product;
+    mo.strassen_cutoff = opt.strassen_cutoff;
+    r.mult = std::make_unique<Multiplier>(mo);
+    Multiplier& mult = *r.mult;
+    const std::vector<int>& cores = mult.cores();
+
+    // --- Teselas de C y reparto inicial; Strassen: cutoff (medido o fijado)
+    //     y buffers, una vez para todas las repeticiones ---
+    // Cada hilo empieza con un tramo contiguo de teselas; los que terminan
+    // antes roban teselas pendientes de los demas. (Strassen reparte tareas
+    // propias y no usa teselas.)
+    // Por debajo del cruce Strassen no tiene niveles y el plan multiplica
+    // por teselas como blocked: a partir de aqui manda plan.kernel.
+    if (kernel == GemmKernel::Strassen && opt.strassen_cutoff <= 0) out << "Calibrando cutoff de Strassen...\n";
+    MultiplyPlan<T, Acc>& plan = r.plan;
+    mult.plan(plan, rows_a, cols_a, cols_b);
+    if (kernel == GemmKernel::Strassen)
+        out << "Strassen:                  " << strassen_plan_summary(plan.ws.plan()) << "\n";
+    r.strassen = (plan.kernel == GemmKernel::Strassen);
+    const bool strassen = r.strassen;
+    NumaPlacement& place = plan.place;
+
+    // --- Contadores hardware: cada hilo abre los suyos ---
+    // Se activan y leen desde este hilo alrededor de la multiplicacion; si no
+    // hay ninguno disponible el informe lo indica y sigue sin ellos.
+    std::vector<PerfCounters> perf(num_threads);
+    r.perf.swap(perf);
+    mult.for_each_worker([&](int w) { r.perf[w].open_for_current_thread(); });
+    r.perf_on = std::any_of(r.perf.begin(), r.perf.end(), [](const PerfCounters& p) { return p.is_open(); });
+
+    // --- Nodos NUMA ---
+    // B la leen todos los hilos: una replica por nodo con hilos (replicate)
+    // o una sola copia intercalada entre nodos (interleave). Con Strassen las
+    // tareas no tienen dueno fijo, asi que A, B y C se intercalan. Con un
+    // solo nodo queda una copia de B sin mbind.
+    const NumaTopology& topo = mult.numa_topology();
+    const std::vector<int>& worker_node = mult.worker_nodes();
+    std::vector<int> used_nodes = worker_node;
+    std::sort(used_nodes.begin(), used_nodes.end());
+    used_nodes.erase(std::unique(used_nodes.begin(), used_nodes.end()), used_nodes.end());
+    r.multi_node = used_nodes.size() > 1;
+    r.replicate_b = r.multi_node && !strassen && opt.numa == NumaPolicy::Replicate;
+    r.b_replicas = r.replicate_b ? (int)used_nodes.size() : 1;
+    const int b_replicas = r.b_replicas;
+
+    // Replica de B de cada hilo y su puesto entre los hilos de esa replica
+    // (que se reparten generarla y empaquetarla).
+    std::vector<int>& replica_of = plan.replica_of;
+    std::vector<int>& replica_rank = plan.replica_rank;
+    std::vector<int>& replica_size = plan.replica_size;
+    replica_size.assign(b_replicas, 0);
     for (int i = 0; i < num_threads; ++i) {
-        auto [s, e] = distribution[i];
-        std::cout << "  Hilo " << std::setw(2) << i
-                  << "  |  Core " << std::setw(2) << i
-                  << "  |  Filas " << std::setw(5) << s
-                  << " - " << std::setw(5) << e - 1
-                  << "  (" << e - s << " filas)\n";
+        replica_of[i] = 0;
+        if (r.replicate_b)
+            replica_of[i] = (int)(std::lower_bound(used_nodes.begin(), used_nodes.end(), worker_node[i]) - used_nodes.begin());
+        replica_rank[i] = replica_size[replica_of[i]]++;
     }
-    std::cout << std::string(70, '=') << "\n";
 
-    // --- Pre-asignar matriz resultado ---
-    Matrix C(rows_a, std::vector<int>(cols_b, 0));
-
-    // --- Crear metricas por hilo (unique_ptr porque mutex no es movible) ---
-    std::vector<std::unique_ptr<ThreadMetrics>> metrics;
-    for (int i = 0; i < num_threads; ++i) {
-        auto m = std::make_unique<ThreadMetrics>();
-        m->thread_id = i;
-        m->core_id = i;
-        m->row_start = distribution[i].first;
-        m->row_end = distribution[i].second;
-        metrics.push_back(std::move(m));
+    // --- Generar (o cargar) A y B en el pool ---
+    // Las matrices se reservan sin escribir y cada pagina la toca primero el
+    // hilo que la genera: las filas de A (y las mismas de C, a cero) las
+    // escribe el hilo cuyo tramo inicial de teselas las usa (con Strassen,
+    // tramos iguales); cada replica de B la generan los hilos de su nodo.
+    // Las que vienen de fichero (--a, --b) se proyectan sin copiar; C con
+    // --c es el propio fichero de salida.
+    r.a_from_file = !opt.a_file.empty();
+    r.b_from_file = !opt.b_file.empty();
+    const bool a_from_file = r.a_from_file, b_from_file = r.b_from_file;
+    std::string file_err;
+    if (!a_from_file || !b_from_file) out << "\nSemilla aleatoria: " << opt.seed << "\n";
+    out << (a_from_file && b_from_file ? "Cargando" : "Generando") << " matrices en " << num_threads << " hilos...\n";
+    auto gen_start = std::chrono::steady_clock::now();
+    MatrixT<T>& A = r.A;
+    if (!a_from_file) A = MatrixT<T>::uninitialized(rows_a, cols_a);
+    else if (!load_matrix_file(opt.a_file, A, file_err)) { std::cerr << file_err << "\n"; return false; }
+    if (opt.c_file.empty()) r.c_out.matrix = MatrixT<Acc>::uninitialized(rows_a, cols_b);
+    else if (!create_matrix_file(opt.c_file, rows_a, cols_b, r.c_out, file_err)) { std::cerr << file_err << "\n"; return false; }
+    MatrixT<Acc>& C = r.C();
+    std::vector<MatrixT<T>>& B_rep = r.B_rep;
+    B_rep.resize(b_replicas);
+    for (int i = 0; i < b_replicas; ++i) {
+        if (i > 0 || !b_from_file) B_rep[i] = MatrixT<T>::uninitialized(cols_a, cols_b);
+        else if (!load_matrix_file(opt.b_file, B_rep[0], file_err)) { std::cerr << file_err << "\n"; return false; }
+    }
+    if (r.multi_node && !r.replicate_b) {
+        if (!b_from_file) r.b_interleaved = numa_interleave(B_rep[0].data(), B_rep[0].size_bytes(), topo.nodes);
+        if (strassen) {
+            if (!a_from_file) numa_interleave(A.data(), A.size_bytes(), topo.nodes);
+            if (opt.c_file.empty()) numa_interleave(C.data(), C.size_bytes(), topo.nodes);
+        }
+    }
+    place.b_remote_fraction = r.b_interleaved ? 1.0 - 1.0 / topo.nodes : 0.0;
+    plan.interleave_packed_b = r.b_interleaved;
+    if (b_replicas > 1)
+        for (const MatrixT<T>& b : B_rep) plan.b_replicas.push_back(b.cview());
+
+    mult.for_each_worker([&](int w) {
+        const int r0 = place.split[w], r1 = place.split[w + 1];
+        if (!a_from_file) fill_random_sparse_digits(A.view(), r0, r1, opt.seed, RNG_STREAM_A, opt.density);
+        if (!strassen)
+            for (int i = r0; i < r1; ++i) std::memset(C.row(i), 0, (std::size_t)C.stride() * sizeof(Acc));
+        // B de fichero: la replica 0 es el fichero y las demas se copian de ella
+        const int rep_idx = replica_of[w];
+        const std::vector<int> b_split = even_row_split(cols_a, replica_size[rep_idx]);
+        const int b0 = b_split[replica_rank[w]], b1 = b_split[replica_rank[w] + 1];
+        if (!b_from_file)
+            fill_random_sparse_digits(B_rep[rep_idx].view(), b0, b1, opt.seed, RNG_STREAM_B, opt.density);
+        else if (rep_idx > 0 && b1 > b0)
+            std::memcpy(B_rep[rep_idx].row(b0), B_rep[0].row(b0), (std::size_t)(b1 - b0) * B_rep[0].stride() * sizeof(T));
+    });
+    r.gen_elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - gen_start).count();
+    out << std::fixed << std::setprecision(6) << "Matrices " << (a_from_file || b_from_file ? "listas" : "generadas")
+        << " en " << r.gen_elapsed << " s";
+    if (a_from_file || b_from_file)
+        out << " (A " << (a_from_file ? opt.a_file : std::string("generada"))
+            << ", B " << (b_from_file ? opt.b_file : std::string("generada")) << ")";
+    out << "\n";
+    const MatrixT<T>& B = r.B();
+
+    if (!opt.save_inputs.empty()) {
+        if (!save_matrix_file(opt.save_inputs + "_A.mmx", A, file_err) ||
+            !save_matrix_file(opt.save_inputs + "_B.mmx", B, file_err)) {
+            std::cerr << file_err << "\n";
+            return false;
+        }
+        out << "A y B guardadas en " << opt.save_inputs << "_A.mmx y " << opt.save_inputs << "_B.mmx\n";
     }
 
-    std::cout << "\nIniciando multiplicacion paralela con monitoreo...\n\n";
+    // Paginas de A y C de cada hilo que quedaron en su nodo (move_pages);
+    // -1 si no se puede consultar.
+    r.pages_local_pct.assign(num_threads, -1.0);
+    for (int w = 0; w < num_threads && !strassen; ++w) {
+        const int r0 = place.split[w], r1 = place.split[w + 1];
+        if (r0 >= r1) continue;
+        auto pa = numa_pages_per_node(A.row(r0), (std::size_t)(r1 - r0) * A.stride() * sizeof(T), topo.nodes);
+        auto pc = numa_pages_per_node(C.row(r0), (std::size_t)(r1 - r0) * C.stride() * sizeof(Acc), topo.nodes);
+        if (pa.empty() || pc.empty()) continue;
+        std::size_t total = 0;
+        for (size_t n = 0; n < pa.size(); ++n) total += pa[n] + pc[n];
+        const int nd = worker_node[w];
+        if (total > 0 && nd < (int)pa.size()) r.pages_local_pct[w] = 100.0 * (pa[nd] + pc[nd]) / total;
+    }
 
-    // --- Lanzar hilos worker ---
-    auto global_start = std::chrono::steady_clock::now();
+    out << "Nodos NUMA:                " << topo.nodes;
+    if (r.multi_node)
+        out << " (B " << (r.replicate_b ? std::to_string(b_replicas) + " replicas"
+                                        : std::string(r.b_interleaved ? "intercalada" : "sin intercalar"))
+            << (strassen ? ", A y C intercaladas" : "") << ")";
+    out << "\n";
+
+    // --- Densidad de A y B y camino del producto (sparse.h) ---
+    // El motor cuenta los no ceros en paralelo y convierte los operandos
+    // dispersos una sola vez para todas las repeticiones.
+    mult.route(plan, A.cview(), B.cview());
+    const ProductRoute& route = plan.route;
+    out << std::setprecision(2)
+        << "No ceros:                  A " << route.nnz_a << " (" << 100.0 * route.density_a << "%), B "
+        << route.nnz_b << " (" << 100.0 * route.density_b << "%)\n"
+        << "Producto:                  " << product_path_label(route.path)
+        << (opt.product == ProductPath::Auto && !strassen ? " (auto)" : "") << "\n";
+    if (route.path != ProductPath::Dense)
+        out << std::setprecision(6) << "Conversion a CSR/CSC:      " << plan.route_s << " s\n";
+
+    if (!opt.quiet && rows_a <= 10 && cols_b <= 10) {
+        print_matrix(A, "A");
+        print_matrix(B, "B");
+    }
 
-    std::vector<std::thread> workers;
-    for (int i = 0; i < num_threads; ++i) {
-        workers.emplace_back(
-            worker_func,
-            std::cref(A), std::cref(B), std::ref(C),
-            std::ref(*metrics[i])
-        );
+    // --- Traza (trace.h): un buffer por worker, uno para main (y el hilo
+    //     que llama a run(), que se turna con el) y otro para el monitor.
+    //     En fine cada worker puede llegar a hacer todas las teselas ---
+    if (r.tracing) {
+        const bool fine = opt.trace_level == TraceLevel::Fine;
+        r.tracer = std::make_unique<Tracer>(opt.trace_level,
+                                            4096 + (fine ? (std::size_t)3 * plan.units * opt.reps : 0));
+        for (int i = 0; i < num_threads; ++i)
+            r.tracer->add_thread("hilo " + std::to_string(i) + " (CPU " + std::to_string(cores[i]) + ")");
+        r.trace_main = r.tracer->add_thread("principal");
+        // Unos 200 s de muestras cada 50 ms (progreso, RAM y CPU por hilo)
+        if (r.monitor_on) r.trace_monitor = r.tracer->add_thread("monitor", (std::size_t)4096 * (num_threads + 2));
     }
+    return true;
+}
 
-    // --- Hilo monitor: muestra metricas en tiempo real ---
-    std::atomic<bool> all_done{false};
+// Cabecera de la primera repeticion: tareas y afinidad con Strassen, o
+// teselas y tabla de distribucion inicial.
+template <class T, class Acc>
+static void print_distribution(const CliOptions& opt, std::ostream& out, const ParallelRun<T, Acc>& r) {
+    const int total_units = r.plan.units;
+    const std::vector<int>& cores = r.mult->cores();
+    if (r.strassen) {
+        out << "Tareas por multiplicacion: " << total_units
+            << " (copias, sumas por franjas de " << STRASSEN_BAND_ROWS << " filas, "
+            << r.plan.ws.plan().leaf_tasks() << " productos hoja a la vez)\n";
+        out << "Afinidad (" << pin_policy_name(opt.pin) << "):\n";
+        for (int i = 0; i < r.num_threads; ++i)
+            out << "  Hilo " << std::setw(2) << i << "  |  CPU " << std::setw(3) << cores[i]
+                << " (" << describe_cpu(r.cpu_topo, cores[i]) << ")\n";
+        out << "\nIniciando multiplicacion Strassen paralela"
+            << (r.monitor_on ? " con monitoreo" : "") << "...\n\n";
+        return;
+    }
+    out << "Teselas de C:              " << total_units << " de hasta "
+        << r.plan.tile_rows << "x" << r.plan.tile_cols << "\n";
+
+    // --- Tabla de distribucion (asignacion inicial) ---
+    out << "\n" << std::string(70, '=') << "\n";
+    out << "  DISTRIBUCION INICIAL DEL TRABAJO (afinidad " << pin_policy_name(opt.pin)
+        << ", con robo de teselas)\n";
+    out << std::string(70, '=') << "\n";
+    for (int i = 0; i < r.num_threads; ++i) {
+        const auto& m = *r.metrics[i];
+        out << "  Hilo " << std::setw(2) << i
+            << "  |  CPU " << std::setw(3) << m.core_id
+            << " (" << describe_cpu(r.cpu_topo, m.core_id) << ")"
+            << "  |  Teselas " << std::setw(4) << m.initial_tiles
+            << "  |  Filas " << std::setw(13) << rows_label(m);
+        if (r.multi_node) out << "  |  Nodo " << m.node;
+        out << "\n";
+    }
+    out << std::string(70, '=') << "\n";
+    out << "\nIniciando multiplicacion paralela"
+        << (r.monitor_on ? " con monitoreo" : "") << "...\n\n";
+}
 
-    std::thread monitor([&]() {
-        // Esperar activamente a que al menos un hilo arranque
-        while (!all_done.load()) {
-            bool any_started = false;
+// Las --reps repeticiones de empaquetado + multiplicacion sobre el mismo
+// pool, con el monitor en vivo, y Freivalds sobre la C final.
+template <class T, class Acc>
+static void parallel_reps(const CliOptions& opt, std::ostream& out, ParallelRun<T, Acc>& r) {
+    const int num_threads = r.num_threads;
+    const bool strassen = r.strassen;
+    Multiplier& mult = *r.mult;
+    const std::vector<int>& cores = mult.cores();
+    const std::vector<int>& worker_node = mult.worker_nodes();
+    const MultiplyPlan<T, Acc>& plan = r.plan;
+    std::vector<std::unique_ptr<ThreadMetrics>>& metrics = r.metrics;
+    const MatrixT<T>& A = r.A;
+    const MatrixT<T>& B = r.B();
+    MatrixT<Acc>& C = r.C();
+    TraceBuffer* main_trace = r.trace_of(r.trace_main);
+
+    for (int rep = 0; rep < opt.reps; ++rep) {
+        const bool first_rep = (rep == 0);
+
+        // --- Crear metricas por hilo (unique_ptr: atomicos no movibles, y
+        //     cada objeto en sus propias lineas de cache) ---
+        metrics.clear();
+        for (int i = 0; i < num_threads; ++i) {
+            auto m = std::make_unique<ThreadMetrics>();
+            m->thread_id = i;
+            m->core_id = cores[i];
+            m->node = worker_node[i];
+            m->initial_tiles = plan.initial_tiles[i];
+            m->row_start = plan.row_start[i];
+            m->row_end = plan.row_end[i];
+            metrics.push_back(std::move(m));
+        }
+        if (first_rep) print_distribution(opt, out, r);
+
+        // --- Empaquetar B y multiplicar en el motor ---
+        // run() bloquea hasta que terminan todos los hilos, asi que se
+        // ejecuta en un hilo aparte mientras el monitor imprime metricas. Los
+        // contadores hardware solo cubren la multiplicacion.
+        MultiplyHooks hooks;
+        hooks.live = &metrics;
+        hooks.trace = r.tracer.get();
+        hooks.trace_caller = r.trace_main;
+        hooks.before_compute = [&](double pack_s) {
+            if (first_rep && plan.kernel == GemmKernel::Blocked && plan.route.path == ProductPath::Dense)
+                out << std::fixed << std::setprecision(6)
+                    << "B empaquetada en " << plan.packed_b[0].panels << " paneles de "
+                    << plan.packed_b[0].uk->nr << " columnas"
+                    << (r.b_replicas > 1 ? " x " + std::to_string(r.b_replicas) + " replicas" : std::string())
+                    << " (" << pack_s << " s)\n\n";
+            for (auto& p : r.perf) p.start();
+        };
+        hooks.after_compute = [&]() {
             for (int i = 0; i < num_threads; ++i) {
-                std::lock_guard<std::mutex> lk(metrics[i]->mtx);
-                if (metrics[i]->started) { any_started = true; break; }
+                r.perf[i].stop();
+                metrics[i]->hw = r.perf[i].read();
             }
-            if (any_started) break;
-            std::this_thread::yield();
-        }
-        // Imprimir metricas: primero inmediatamente, luego cada 50ms
-        bool first_print = true;
-        while (!all_done.load()) {
-            if (!first_print) {
-                std::this_thread::sleep_for(std::chrono::milliseconds(50));
-                if (all_done.load()) break;
+        };
+        MultiplyMetrics mm;
+        if (main_trace) main_trace->begin(TraceKind::Rep, rep + 1);
+        std::thread dispatcher([&]() { mm = mult.run(r.plan, A.cview(), B.cview(), C.view(), hooks); });
+
+        // --- Hilo monitor: muestra metricas en tiempo real ---
+        // Lee las instantaneas publicadas por seqlock y vacia las colas de
+        // muestras; nunca bloquea a un worker. Mide su propio tiempo de CPU
+        // para estimar cuanto resta al computo (comparar con --monitor=off).
+        std::atomic<bool> all_done{false};
+        r.monitor_refreshes = 0;
+        r.monitor_cpu = 0.0;
+
+        std::thread monitor;
+        if (r.monitor_on) monitor = std::thread([&]() {
+            TraceBuffer* tb = r.trace_of(r.trace_monitor);
+            double cpu0 = get_thread_cpu_time();
+            // Esperar activamente a que al menos un hilo arranque
+            while (!all_done.load()) {
+                bool any_started = false;
+                for (int i = 0; i < num_threads; ++i)
+                    if (metrics[i]->live.load().started) { any_started = true; break; }
+                if (any_started) break;
+                std::this_thread::yield();
             }
-            first_print = false;
+            // Imprimir metricas: primero inmediatamente, luego cada 50ms
+            bool first_print = true;
+            while (!all_done.load()) {
+                if (!first_print) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                    if (all_done.load()) break;
+                }
+                first_print = false;
+                ++r.monitor_refreshes;
+
+                double mem = get_memory_mb();
+                bool any_active = false;
+
+                if (tb) {
+                    double progress = 0.0;
+                    for (int i = 0; i < num_threads; ++i) {
+                        metrics[i]->drain_samples();
+                        const ThreadSnapshot m = metrics[i]->live.load();
+                        progress = std::max(progress, m.progress);
+                        tb->counter(TraceKind::SampleCpu, m.cpu_pct, i);
+                    }
+                    tb->counter(TraceKind::SampleProgress, progress);
+                    tb->counter(TraceKind::SampleRam, mem);
+                    continue;
+                }
 
-            double mem = get_memory_mb();
-            bool any_active = false;
+                for (int i = 0; i < num_threads; ++i) {
+                    metrics[i]->drain_samples();
+                    ThreadSnapshot m = metrics[i]->live.load();
+                    if (!m.started) continue;
+                    any_active = true;
+
+                    std::cout << "  [Hilo " << std::setw(2) << metrics[i]->thread_id
+                              << " | TID " << std::setw(6) << m.native_tid
+                              << " | Core " << std::setw(2) << metrics[i]->core_id << "]  "
+                              << std::fixed << std::setprecision(1)
+                              << "Progreso: " << std::setw(5) << m.progress << "%  |  "
+                              << "CPU: " << std::setw(5) << m.cpu_pct << "%  |  "
+                              << "RAM: " << std::setw(7) << mem << " MB  |  "
+                              << (strassen ? "Tareas: " : "Teselas: ") << std::setw(4) << m.tiles_executed;
+                    if (!strassen) std::cout << " (robadas " << m.tiles_stolen << ")";
+                    if (m.done) std::cout << "  [LISTO]";
+                    std::cout << "\n";
+                }
 
-            for (int i = 0; i < num_threads; ++i) {
-                std::lock_guard<std::mutex> lk(metrics[i]->mtx);
-                auto& m = *metrics[i];
-                if (!m.started) continue;
-                any_active = true;
-
-                std::cout << "  [Hilo " << std::setw(2) << m.thread_id
-                          << " | TID " << std::setw(6) << m.native_tid
-                          << " | Core " << std::setw(2) << m.core_id << "]  "
-                          << std::fixed << std::setprecision(1)
-                          << "Progreso: " << std::setw(5) << m.progress << "%  |  "
-                          << "CPU: " << std::setw(5) << m.cpu_pct << "%  |  "
-                          << "RAM: " << std::setw(7) << mem << " MB  |  "
-                          << "Filas: " << std::setw(5) << m.rows_done << "/"
-                          << std::setw(5) << m.total_rows;
-                if (m.done) std::cout << "  [LISTO]";
-                std::cout << "\n";
+                if (any_active) std::cout << "\n" << std::flush;
             }
+            r.monitor_cpu = get_thread_cpu_time() - cpu0;
+        });
+
+        // --- Esperar a que terminen todos los workers ---
+        dispatcher.join();
+        if (main_trace) main_trace->end(TraceKind::Rep);
+        r.global_elapsed = mm.total_s;
+        r.compute_elapsed = mm.compute_s;
+        r.pack_elapsed = mm.pack_s;
+        r.rep_times.push_back(r.global_elapsed);
+
+        all_done.store(true);
+        if (monitor.joinable()) monitor.join();
+
+        if (opt.reps > 1)
+            out << std::fixed << std::setprecision(6) << "  Repeticion " << rep + 1 << "/"
+                << opt.reps << ": " << r.global_elapsed << " s\n";
+    }
 
-            if (any_active) std::cout << "\n" << std::flush;
-        }
-    });
-
-    // --- Esperar a que terminen todos los workers ---
-    for (auto& w : workers)
-        w.join();
+    // --- Freivalds en los mismos workers (verify.h): cada hilo proyecta sus
+    //     filas de B y luego comprueba sus bloques de filas de C ---
+    if (opt.verify_rounds > 0) {
+        auto v_start = std::chrono::steady_clock::now();
+        FreivaldsCheck<T, Acc> chk(A.cview(), B.cview(), C.cview(), opt.verify_rounds, opt.seed);
+        const std::vector<int> v_b = chk.b_split(num_threads), v_rows = chk.row_split(num_threads);
+        mult.for_each_worker([&](int w) {
+            TraceBuffer* tb = r.trace_of(w);
+            if (tb) tb->begin(TraceKind::Verify);
+            chk.project_b(v_b[w], v_b[w + 1]);
+            if (tb) tb->end(TraceKind::Verify);
+        });
+        mult.for_each_worker([&](int w) {
+            TraceBuffer* tb = r.trace_of(w);
+            if (tb) tb->begin(TraceKind::Verify);
+            chk.check_rows(v_rows[w], v_rows[w + 1]);
+            if (tb) tb->end(TraceKind::Verify);
+        });
+        r.verify = chk.result();
+        r.verify.time_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - v_start).count();
+    }
+}
 
-    auto global_end = std::chrono::steady_clock::now();
-    double global_elapsed = std::chrono::duration<double>(global_end - global_start).count();
+// Resultado, metricas por hilo, resumen de paralelismo y, con --quiet, la
+// linea del punto. Rellena s con los totales para parallel_json.
+template <class T, class Acc>
+static void parallel_report(const CliOptions& opt, const RunPoint& pt, std::ostream& out,
+                            ParallelRun<T, Acc>& r, ParallelSummary& s) {
+    const GemmKernel kernel = opt.kernel;
+    const bool strassen = r.strassen;
+    const int rows_a = pt.dims[0], cols_a = pt.dims[1], cols_b = pt.dims[2];
+    const int num_threads = r.num_threads;
+    const ProductRoute& route = r.plan.route;
+    const NumaTopology& topo = r.mult->numa_topology();
+    const int total_units = r.plan.units;
+    const std::vector<std::unique_ptr<ThreadMetrics>>& metrics = r.metrics;
+
+    // Muestras que el monitor no llego a recoger (o todas, si esta apagado)
+    for (auto& m : metrics) {
+        m->drain_samples();
+        s.dropped_samples += m->cpu_samples.dropped();
+    }
 
-    all_done.store(true);
-    monitor.join();
+    s.median_time = median_of(r.rep_times);
+    s.min_time = *std::min_element(r.rep_times.begin(), r.rep_times.end());
+    s.gops = s.median_time > 0 ? 2.0 * rows_a * cols_a * cols_b / s.median_time / 1e9 : 0.0;
 
     // --- Resultado ---
-    double final_mem = get_memory_mb();
-
-    if (rows_a <= 10 && cols_b <= 10)
-        print_matrix(C, "C = A x B");
-
-    std::cout << "\n" << std::string(70, '=') << "\n";
-    std::cout << "  RESULTADO\n";
-    std::cout << std::string(70, '=') << "\n";
-    std::cout << "  Dimensiones: A(" << rows_a << "x" << cols_a << ") x B("
-              << cols_a << "x" << cols_b << ") = C(" << rows_a << "x" << cols_b << ")\n";
-    std::cout << std::fixed << std::setprecision(6)
-              << "  Tiempo total (wall clock): " << global_elapsed << " segundos\n";
-    std::cout << "  Hilos utilizados:          " << num_threads << "\n";
-    std::cout << std::setprecision(2)
-              << "  Memoria del proceso:       " << final_mem << " MB\n";
-    std::cout << std::string(70, '=') << "\n";
+    s.final_mem = get_memory_mb();
+    for (const auto& m : metrics) {
+        const ThreadSnapshot ts = m->live.load();
+        s.useful_ops += ts.ops;
+        s.nnz_c += ts.nonzeros_c;
+    }
 
-    // --- Metricas detalladas por hilo ---
-    std::cout << "\n" << std::string(70, '=') << "\n";
-    std::cout << "  METRICAS POR HILO\n";
-    std::cout << std::string(70, '=') << "\n";
+    if (!opt.quiet && rows_a <= 10 && cols_b <= 10)
+        print_matrix(r.C(), "C = A x B");
+
+    out << "\n" << std::string(70, '=') << "\n";
+    out << "  RESULTADO\n";
+    out << std::string(70, '=') << "\n";
+    out << "  Dimensiones: A(" << rows_a << "x" << cols_a << ") x B("
+        << cols_a << "x" << cols_b << ") = C(" << rows_a << "x" << cols_b << ")\n";
+    out << std::fixed << std::setprecision(6)
+        << "  Tiempo total (wall clock): " << r.global_elapsed << " segundos\n";
+    if (opt.reps > 1)
+        out << "  Mediana de " << opt.reps << " reps:     " << s.median_time
+            << " segundos (minimo " << s.min_time << ")\n";
+    out << "  Generacion de A y B:       " << r.gen_elapsed << " segundos\n";
+    if (r.plan.kernel == GemmKernel::Blocked && route.path == ProductPath::Dense)
+        out << "  Empaquetado de B:          " << r.pack_elapsed << " segundos\n";
+    if (route.path != ProductPath::Dense)
+        out << "  Conversion a CSR/CSC:      " << r.plan.route_s << " segundos\n";
+    out << std::setprecision(2)
+        << "  Rendimiento:               " << s.gops << " GOP/s"
+        << (route.path != ProductPath::Dense ? " (equivalente denso, 2*M*K*N)" : "") << "\n";
+    out << "  Hilos utilizados:          " << num_threads
+        << " (pool persistente, park " << park_policy_name(opt.park) << ")\n";
+    out << "  Tipo:                      " << elem_name<T>() << " (acumulador " << elem_name<Acc>() << ")\n";
+    out << "  Kernel:                    " << kernel_name(kernel);
+    if (kernel != GemmKernel::Naive) out << " (" << r.plan.uk->name << ")";
+    out << "\n";
+    out << "  Producto:                  " << product_path_label(route.path) << "\n";
+    out << std::setprecision(2)
+        << "  No ceros de A / B:         " << route.nnz_a << " (" << 100.0 * route.density_a << "%) / "
+        << route.nnz_b << " (" << 100.0 * route.density_b << "%)\n";
+    if (route.path != ProductPath::Dense) {
+        out << "  Multiplicaciones-suma:     " << std::setprecision(0) << s.useful_ops / 2.0 << std::setprecision(2)
+            << " (" << 100.0 * s.useful_ops / (2.0 * rows_a * cols_a * cols_b) << "% de las densas)\n";
+        if (route.path == ProductPath::SparseSparse)
+            out << "  No ceros de C:             " << s.nnz_c << " ("
+                << 100.0 * s.nnz_c / ((double)rows_a * cols_b) << "%)\n";
+    }
+    out << std::setprecision(2)
+        << "  Memoria del proceso:       " << s.final_mem << " MB\n"
+        << "  Pico de memoria:           " << get_peak_memory_mb() << " MB\n";
+    if (opt.verify_rounds > 0) print_verify(out, r.verify, 27);
+    out << std::string(70, '=') << "\n";
 
-    double total_cpu_time = 0;
+    // --- Metricas detalladas por hilo ---
+    out << "\n" << std::string(70, '=') << "\n";
+    out << "  METRICAS POR HILO\n";
+    out << std::string(70, '=') << "\n";
+
+    // CPU real de cada worker (no su wall, que con mas hilos que CPUs cuenta
+    // tambien el tiempo en cola) y wall sumado, para el desbalance
+    double total_busy_time = 0;
+    double max_time = 0.0;
     for (int i = 0; i < num_threads; ++i) {
-        std::lock_guard<std::mutex> lk(metrics[i]->mtx);
-        auto& m = *metrics[i];
-        auto [s, e] = distribution[i];
+        const auto& m = *metrics[i];
+        ThreadSnapshot ts = m.live.load();
+
+        s.total_cpu_time += ts.cpu_time;
+        total_busy_time += ts.total_time;
+        s.total_stolen += ts.tiles_stolen;
+        max_time = std::max(max_time, ts.total_time);
+
+        out << "\n  --- Hilo " << i << " (Core " << m.core_id
+            << ", TID " << ts.native_tid << ") ---\n";
+        if (strassen)
+            out << "  Tareas hechas:    " << ts.tiles_executed << "\n";
+        else
+            out << "  Filas propias:    " << rows_label(m) << "\n"
+                << "  Teselas:          " << m.initial_tiles << " asignadas, " << ts.tiles_executed
+                << " hechas (robadas: " << ts.tiles_stolen << ")\n";
+        if (!strassen) {
+            out << "  Nodo NUMA:        " << m.node << " (teselas remotas: " << ts.tiles_remote;
+            if (r.pages_local_pct[i] >= 0)
+                out << std::setprecision(1) << ", paginas A/C locales: " << r.pages_local_pct[i] << "%";
+            out << ")\n";
+        }
+        out << std::setprecision(4)
+            << "  Tiempo ejecucion: " << ts.total_time << " s (CPU " << ts.cpu_time << " s)\n"
+            << std::setprecision(1)
+            << "  CPU promedio:     " << m.cpu_stats.avg() << "%\n"
+            << "  CPU maximo:       " << m.cpu_stats.max << "%\n";
+        // Con Strassen las tareas no tienen un numero de operaciones comparable
+        if (m.hw.any()) {
+            out << "  Contadores HW:\n";
+            print_perf(out, "    ", m.hw, strassen ? 0.0 : ts.ops, ts.total_time);
+        }
+    }
 
-        double avg_cpu = 0.0, max_cpu = 0.0;
-        if (!m.cpu_samples.empty()) {
-            for (double c : m.cpu_samples) {
-                avg_cpu += c;
-                if (c > max_cpu) max_cpu = c;
-            }
-            avg_cpu /= m.cpu_samples.size();
+    // --- Resumen de paralelismo (se muestra salvo con --quiet) ---
+    const double compute_elapsed = r.compute_elapsed;
+    out << "\n" << std::string(70, '=') << "\n";
+    out << "  RESUMEN DE PARALELISMO\n";
+    out << std::string(70, '=') << "\n";
+    out << std::setprecision(6)
+        << "  Tiempo real (wall clock):               " << r.global_elapsed << " s\n"
+        << "  Tiempo real de la multiplicacion:       " << compute_elapsed << " s\n"
+        << std::setprecision(4)
+        << "  Tiempo CPU de los workers:              " << s.total_cpu_time << " s\n"
+        << std::setprecision(2)
+        << "  Memoria del proceso:                    " << s.final_mem << " MB\n";
+    if (strassen)
+        out << "  Tareas Strassen por multiplicacion:     " << total_units << "\n";
+    else
+        out << "  Teselas totales / robadas:              " << total_units
+            << " / " << s.total_stolen << "\n";
+    if (num_threads > 0 && total_busy_time > 0)
+        out << "  Desbalance (hilo mas lento / media):    "
+            << max_time / (total_busy_time / num_threads) << "\n";
+
+    // Contadores de todos los hilos frente a las 2*M*K*N operaciones
+    // nominales (con Strassen las reales son menos).
+    for (auto& m : metrics) s.hw_total += m->hw;
+    s.nominal_ops = 2.0 * rows_a * cols_a * cols_b;
+    if (s.hw_total.any()) {
+        out << "  Contadores HW (todos los hilos):\n";
+        print_perf(out, "    ", s.hw_total, s.nominal_ops, compute_elapsed);
+    } else {
+        out << "  Contadores HW:                          no disponibles ("
+            << (r.perf.empty() ? std::string("sin hilos") : r.perf[0].error()) << ")\n";
+    }
+
+    s.per_node.assign(topo.nodes, NodeTotals());
+    for (int i = 0; i < num_threads; ++i) {
+        ThreadSnapshot ts = metrics[i]->live.load();
+        NodeTotals& nt = s.per_node[std::min(metrics[i]->node, topo.nodes - 1)];
+        ++nt.threads;
+        nt.tiles += ts.tiles_executed;
+        nt.tiles_remote += ts.tiles_remote;
+        nt.local += ts.bytes_local;
+        nt.remote += ts.bytes_remote;
+    }
+    if (!strassen)
+        for (int n = 0; n < topo.nodes; ++n) {
+            const NodeTotals& nt = s.per_node[n];
+            if (nt.threads == 0) continue;
+            out << "  Nodo NUMA " << n << ": " << nt.threads << " hilos, " << nt.tiles << " teselas ("
+                << nt.tiles_remote << " remotas), " << std::setprecision(2) << nt.gb_s(compute_elapsed)
+                << " GB/s estimados, " << std::setprecision(1) << nt.remote_pct() << "% remoto\n";
         }
-        total_cpu_time += m.total_time;
-
-        std::cout << "\n  --- Hilo " << i << " (Core " << m.core_id
-                  << ", TID " << m.native_tid << ") ---\n"
-                  << "  Filas asignadas:  " << s << " - " << e - 1
-                  << " (" << e - s << " filas)\n"
-                  << std::setprecision(4)
-                  << "  Tiempo ejecucion: " << m.total_time << " s\n"
-                  << std::setprecision(1)
-                  << "  CPU promedio:     " << avg_cpu << "%\n"
-                  << "  CPU maximo:       " << max_cpu << "%\n";
-    }
-
-    // --- Resumen de paralelismo (SIEMPRE se muestra) ---
-    std::cout << "\n" << std::string(70, '=') << "\n";
-    std::cout << "  RESUMEN DE PARALELISMO\n";
-    std::cout << std::string(70, '=') << "\n";
-    std::cout << std::setprecision(6)
-              << "  Tiempo real (wall clock):               " << global_elapsed << " s\n"
-              << std::setprecision(4)
-              << "  Tiempo CPU acumulado (todos los hilos): " << total_cpu_time << " s\n"
-              << std::setprecision(2)
-              << "  Memoria del proceso:                    " << final_mem << " MB\n";
-
-    if (global_elapsed > 0 && total_cpu_time > 0) {
-        double speedup = total_cpu_time / global_elapsed;
-        std::cout << "  Speedup aproximado:                     " << speedup << "x\n";
-        std::cout << "\n  Si el speedup es cercano a " << num_threads
-                  << ", los hilos trabajaron\n  en paralelo de forma efectiva.\n";
+
+    const PoolStats ps = r.mult->pool_stats();
+    out << "  Trabajos despachados por el pool:       " << ps.jobs << "\n"
+        << std::setprecision(1)
+        << "  Overhead de despacho por trabajo:       " << ps.avg_overhead_s() * 1e6 << " us"
+        << " (despertar " << (ps.jobs ? ps.total_wake_s / ps.jobs * 1e6 : 0.0) << " us"
+        << " + join " << (ps.jobs ? ps.total_join_s / ps.jobs * 1e6 : 0.0) << " us)\n";
+
+    // Coste del monitor: CPU que consumio mientras los workers computaban.
+    // Para medir el efecto en el wall clock, repetir con --monitor=off.
+    out << std::setprecision(6)
+        << "  Multiplicacion (sin empaquetado):       " << compute_elapsed << " s\n";
+    if (r.monitor_on) {
+        out << "  Monitor:                                " << r.monitor_refreshes
+            << " refrescos, CPU " << std::setprecision(3) << r.monitor_cpu * 1e3 << " ms";
+        if (compute_elapsed > 0)
+            out << std::setprecision(2) << " (" << r.monitor_cpu / compute_elapsed * 100.0
+                << "% de un core durante el computo)";
+        out << "\n";
+    } else {
+        out << "  Monitor:                                desactivado\n";
+    }
+    out << "  Muestras de CPU descartadas:            " << s.dropped_samples
+        << " (cola de " << SampleRing<double, 1024>::capacity() << " por hilo)\n"
+        << std::setprecision(2);
+
+    // CPU de los workers / wall de la multiplicacion (sin empaquetar B): los
+    // cores ocupados de media. No es un speedup: con mas hilos que CPUs no
+    // pasa del numero de CPUs, y para el speedup real hay que comparar con
+    // MMS o con --threads=1 (T_sec / T_par).
+    s.cpu_parallelism = (compute_elapsed > 0 && s.total_cpu_time > 0) ? s.total_cpu_time / compute_elapsed : 0.0;
+    s.cpu_utilization = num_threads > 0 ? s.cpu_parallelism / num_threads * 100.0 : 0.0;
+    if (s.cpu_parallelism > 0) {
+        out << "  Paralelismo efectivo (CPU / wall):      " << s.cpu_parallelism << " cores\n"
+            << "  Utilizacion de CPU de los hilos:        " << s.cpu_utilization << "%\n";
+        out << "\n  Si la utilizacion es cercana al 100%, los " << num_threads
+            << " hilos estuvieron\n  ocupados a la vez; el speedup real es T(MMS) / T(MMP).\n";
     } else {
-        std::cout << "\n  (La multiplicacion termino muy rapido para medir speedup.\n"
-                  << "   Use matrices mas grandes como 300x300 para ver resultados.)\n";
+        out << "\n  (La multiplicacion termino muy rapido para medir la utilizacion.\n"
+            << "   Use matrices mas grandes como 300x300 para ver resultados.)\n";
+    }
+    out << std::string(70, '=') << "\n";
+
+    // Una linea por punto en --quiet (la que se lee en un barrido)
+    if (opt.quiet)
+        std::cout << std::fixed << std::setprecision(6)
+                  << "MMP " << dims_label(pt.dims) << " hilos=" << num_threads
+                  << " tipo=" << elem_name<T>() << "->" << elem_name<Acc>()
+                  << " kernel=" << kernel_name(kernel)
+                  << (kernel == GemmKernel::Strassen ? " cutoff=" + std::to_string(r.plan.ws.plan().cutoff) : std::string())
+                  << (route.path != ProductPath::Dense ? std::string(" producto=") + product_path_name(route.path) : std::string())
+                  << " mediana=" << s.median_time << " s"
+                  << std::setprecision(2) << " GOP/s=" << s.gops
+                  << " cpu_util=" << s.cpu_utilization << "%"
+                  << (opt.verify_rounds > 0 ? std::string(" freivalds=") + (r.verify.ok ? "ok" : "ERROR") +
+                                                  " suma=" + checksum_hex(r.verify.combined)
+                                            : std::string())
+                  << "\n";
+}
+
+// JSON de resultados en pt.json_path. Devuelve false si no se pudo abrir.
+template <class T, class Acc>
+static bool parallel_json(const CliOptions& opt, const RunPoint& pt, std::ostream& out,
+                          const ParallelRun<T, Acc>& r, const ParallelSummary& s) {
+    const GemmKernel kernel = opt.kernel;
+    const bool strassen = r.strassen;
+    const ProductRoute& route = r.plan.route;
+    const NumaTopology& topo = r.mult->numa_topology();
+
+    std::ofstream f;
+    if (!open_json_file(pt.json_path, f)) return false;
+    ProcessCounters pc = read_process_counters();
+    JsonWriter w(f);
+    w.begin_object();
+    w.field("programa", "MMP.cpp");
+    w.field("tipo", "Paralelo (multiples hilos, multiples cores)");
+    w.field("fecha_ejecucion", current_datetime_iso());
+    json_sistema(w, read_system_info());
+
+    w.begin_object("configuracion");
+    w.field("filas_a", pt.dims[0]);
+    w.field("columnas_a", pt.dims[1]);
+    w.field("columnas_b", pt.dims[2]);
+    w.field("semilla", opt.seed);
+    if (r.a_from_file) w.field("fichero_a", opt.a_file);
+    if (r.b_from_file) w.field("fichero_b", opt.b_file);
+    if (!opt.c_file.empty()) w.field("fichero_c", opt.c_file);
+    w.field("hilos_utilizados", r.num_threads);
+    w.field("tipo_elemento", elem_name<T>());
+    w.field("acumulador", elem_name<Acc>());
+    w.field("kernel", kernel_name(kernel));
+    if (kernel != GemmKernel::Naive) w.field("micro_kernel", r.plan.uk->name);
+    w.field("producto", product_path_name(route.path));
+    w.field("producto_forzado", opt.product != ProductPath::Auto);
+    if (opt.density < 1.0) w.field("densidad_generada", opt.density);
+    w.field("afinidad", pin_policy_name(opt.pin));
+    w.field("topologia", topology_summary(r.cpu_topo));
+    w.field("park", park_policy_name(opt.park));
+    w.field("monitor", r.monitor_on);
+    w.field("repeticiones", opt.reps);
+    w.end_object();
+    if (kernel == GemmKernel::Strassen) json_strassen(w, r.plan.ws.plan());
+    json_sparse(w, route, route.path == ProductPath::SparseSparse ? s.nnz_c : -1, s.useful_ops,
+                route.path != ProductPath::Dense ? r.plan.route_s : 0.0);
+
+    w.begin_object("numa");
+    w.field("nodos", topo.nodes);
+    w.field("politica_b", numa_policy_name(opt.numa));
+    w.field("replicas_b", r.b_replicas);
+    w.field("b_intercalada", r.b_interleaved);
+    if (!strassen) {
+        w.begin_array("por_nodo");
+        for (int n = 0; n < topo.nodes; ++n) {
+            const NodeTotals& nt = s.per_node[n];
+            if (nt.threads == 0) continue;
+            w.begin_object();
+            w.field("nodo", n);
+            w.field("hilos", nt.threads);
+            w.field("teselas", nt.tiles);
+            w.field("teselas_remotas", nt.tiles_remote);
+            w.field("gb_s_estimado", nt.gb_s(r.compute_elapsed));
+            w.field("trafico_remoto_pct", nt.remote_pct());
+            w.end_object();
+        }
+        w.end_array();
+    }
+    w.end_object();
+
+    w.begin_object("resultados");
+    w.field("tiempo_total_wall_clock_s", s.median_time);
+    w.field("tiempo_cpu_workers_s", s.total_cpu_time);
+    w.field("paralelismo_efectivo", s.cpu_parallelism);
+    w.field("utilizacion_cpu_pct", s.cpu_utilization);
+    w.inline_array("tiempos_s", r.rep_times);
+    w.field("tiempo_minimo_s", s.min_time);
+    w.field("tiempo_generacion_s", r.gen_elapsed);
+    w.field("tiempo_empaquetado_s", r.pack_elapsed);
+    w.field("tiempo_multiplicacion_s", r.compute_elapsed);
+    w.field("gop_s", s.gops);
+    w.field(strassen ? "tareas_strassen" : "teselas_totales", r.plan.units);
+    if (!strassen) w.field("teselas_robadas", s.total_stolen);
+    w.field("muestras_cpu_descartadas", s.dropped_samples);
+    w.field("contadores_hw_disponibles", r.perf_on);
+    if (!r.perf_on && !r.perf.empty()) w.field("contadores_hw_motivo", r.perf[0].error());
+    json_perf(w, "contadores_hw", s.hw_total, s.nominal_ops, r.compute_elapsed);
+    w.end_object();
+    if (opt.verify_rounds > 0) json_verify(w, r.verify);
+    if (r.tracing) json_trace(w, *r.tracer, opt.trace_path);
+
+    w.begin_object("memoria");
+    w.field("ram_final_mb", s.final_mem);
+    json_memoria_contadores(w, pc);
+    w.end_object();
+
+    json_kernel(w, pc);
+    json_io(w, pc);
+    json_proceso(w, pc, false);
+
+    w.begin_array("hilos");
+    for (int i = 0; i < r.num_threads; ++i) {
+        const auto& m = *r.metrics[i];
+        ThreadSnapshot ts = m.live.load();
+        w.begin_object();
+        w.field("id", i);
+        w.field("tid", ts.native_tid);
+        w.field("core_asignado", m.core_id);
+        w.field("cpu_topologia", describe_cpu(r.cpu_topo, m.core_id));
+        if (strassen) {
+            w.field("tareas_ejecutadas", ts.tiles_executed);
+        } else {
+            w.field("filas_inicio", m.row_start);
+            w.field("filas_fin", m.row_end - 1);
+            w.field("teselas_ejecutadas", ts.tiles_executed);
+            w.field("teselas_robadas", ts.tiles_stolen);
+            w.field("nodo", m.node);
+            w.field("teselas_remotas", ts.tiles_remote);
+            if (r.pages_local_pct[i] >= 0) w.field("paginas_locales_pct", r.pages_local_pct[i]);
+        }
+        w.field("tiempo_ejecucion_s", ts.total_time);
+        w.field("cpu_promedio_pct", m.cpu_stats.avg());
+        w.field("cpu_maximo_pct", m.cpu_stats.max);
+        json_perf(w, "contadores_hw", m.hw, strassen ? 0.0 : ts.ops, ts.total_time);
+        w.end_object();
+    }
+    w.end_array();
+
+    w.begin_object("sincronizacion");
+    w.inline_array("mecanismos", std::vector<std::string>{
+        "std::mutex (cola de teselas por hilo)", "std::atomic (teselas completadas, fin del pool)",
+        "seqlock (instantanea por hilo)", "cola SPSC (muestras de CPU)",
+        "std::condition_variable (espera del pool)" });
+    w.inline_array("recursos_compartidos", std::vector<std::string>{
+        "Matriz A (solo lectura)", "B empaquetada (solo lectura)",
+        "Matriz C (escritura por teselas disjuntas)", "colas de teselas (robo)" });
+    w.end_object();
+    w.finish();
+    out << "\nMetricas guardadas en " << pt.json_path << "\n";
+    return true;
+}
+
+// Todo el flujo (generar, empaquetar, multiplicar, informar) instanciado
+// para el tipo de entrada T y el acumulador Acc elegidos. Con --reps se
+// repite empaquetado + multiplicacion sobre el mismo pool y se informa la
+// mediana; las metricas por hilo son las de la ultima repeticion.
+template <class T, class Acc>
+int run_parallel(const CliOptions& opt, const RunPoint& pt) {
+    // Con --quiet el informe va a un stream sin buffer, que descarta todo
+    std::ostream null_out(nullptr);
+    std::ostream& out = opt.quiet ? null_out : std::cout;
+
+    ParallelRun<T, Acc> r;
+    if (!parallel_setup(opt, pt, out, r)) return 1;
+    parallel_reps(opt, out, r);
+
+    // --- C al fichero de salida (el calculo ya escribio en la proyeccion) ---
+    std::string file_err;
+    if (!opt.c_file.empty()) {
+        if (!r.c_out.finish(file_err)) { std::cerr << opt.c_file << ": " << file_err << "\n"; return 1; }
+        out << "C guardada en " << opt.c_file << "\n";
+    }
+
+    // --- Traza al fichero (todos los hilos que escriben ya terminaron) ---
+    if (r.tracing) {
+        std::string trace_err;
+        if (!r.tracer->write_chrome_json(opt.trace_path, trace_err)) {
+            std::cerr << opt.trace_path << ": " << trace_err << "\n";
+            return 1;
+        }
+        out << "Traza (" << trace_level_name(opt.trace_level) << ") guardada en " << opt.trace_path << ": "
+            << r.tracer->events() << " eventos de " << r.tracer->threads() << " hilos";
+        if (r.tracer->dropped() > 0) out << ", " << r.tracer->dropped() << " descartados por buffer lleno";
+        out << "\n";
     }
-    std::cout << std::string(70, '=') << "\n";
+
+    ParallelSummary s;
+    parallel_report(opt, pt, out, r, s);
+    if (!pt.json_path.empty() && !parallel_json(opt, pt, out, r, s)) return 1;
+
+    if (opt.quiet) return r.verify.ok ? 0 : 1;
 
     // ===================== INFORMACION ADICIONAL DEL PROCESO =====================
 #ifdef _WIN32
@@ -866,14 +1547,789 @@ int main() {
     std::cout << "#                                                                    #\n";
     std::cout << "######################################################################\n";
 
-    mostrar_info_programa();                      // SEGMENTO DE PROGRAMA (codigo)
-    mostrar_info_pila(metrics);                   // PILA (Stack) - cada hilo tiene la suya
-    mostrar_info_datos();                         // DATOS (variables, heap)
-    mostrar_info_ipc(num_threads);                // IPC (comunicacion entre procesos/hilos)
-    mostrar_acceso_nucleo(num_threads, metrics);  // ACCESO AL NUCLEO (kernel)
-    mostrar_llamadas_sistema(num_threads);        // LLAMADAS AL SISTEMA (syscalls)
-    mostrar_modulos_proceso();                    // MODULOS/DLLs cargados
+    mostrar_info_programa();                        // SEGMENTO DE PROGRAMA (codigo)
+    mostrar_info_pila(r.metrics);                   // PILA (Stack) - cada hilo tiene la suya
+    mostrar_info_datos();                           // DATOS (variables, heap)
+    mostrar_info_ipc(r.num_threads);                // IPC (comunicacion entre procesos/hilos)
+    mostrar_acceso_nucleo(r.num_threads, r.metrics); // ACCESO AL NUCLEO (kernel)
+    mostrar_llamadas_sistema(r.num_threads);        // LLAMADAS AL SISTEMA (syscalls)
+    mostrar_modulos_proceso();                      // MODULOS/DLLs cargados
+#elif defined(__linux__)
+    mostrar_recursos_proceso();                     // kernel/usuario, RSS, afinidad
 #endif
 
+    return r.verify.ok ? 0 : 1;
+}
+
+// ===================== Fuera de memoria =====================
+
+// --out-of-core: A, B y C se quedan en disco (out_of_core.h). Cada producto
+// de teselas se reparte por filas entre los hilos del pool; con blocked la
+// tesela de B se empaqueta una vez, tambien en paralelo, y la comparten.
+template <class T, class Acc>
+int run_out_of_core(const CliOptions& opt, const RunPoint& pt) {
+    const GemmKernel kernel = opt.kernel;
+    const int rows_a = pt.dims[0], cols_a = pt.dims[1], cols_b = pt.dims[2];
+    std::ostream null_out(nullptr);
+    std::ostream& out = opt.quiet ? null_out : std::cout;
+
+    const CpuTopology cpu_topo = read_cpu_topology();
+    const int num_threads = pt.threads > 0 ? pt.threads : default_threads(cpu_topo, opt.pin);
+    ThreadPool pool(num_threads, opt.park, pin_map(cpu_topo, opt.pin, num_threads));
+    const std::size_t budget = (std::size_t)opt.mem_budget_mb * 1024 * 1024;
+
+    out << "\n=== MULTIPLICACION FUERA DE MEMORIA - PARALELO ===\n";
+    out << "A:                         " << opt.a_file << " (" << rows_a << " x " << cols_a << ")\n";
+    out << "B:                         " << opt.b_file << " (" << cols_a << " x " << cols_b << ")\n";
+    out << "C:                         " << opt.c_file << "\n";
+    out << "Hilos a utilizar:          " << num_threads << " (afinidad " << pin_policy_name(opt.pin) << ")\n";
+    out << "Tipo (entrada -> acum.):   " << elem_name<T>() << " -> " << elem_name<Acc>() << "\n";
+    out << "Kernel:                    " << kernel_name(kernel) << "\n";
+    out << "Presupuesto de memoria:    " << opt.mem_budget_mb << " MB\n";
+
+    PackedBT<Acc> pb;
+    std::vector<APackBufferT<Acc>> a_pack(num_threads);     // uno por hilo para todas las teselas
+    if (kernel == GemmKernel::Blocked)
+        for (auto& ap : a_pack) ap = make_a_pack<Acc>();
+    const TileMultiply<T, Acc> multiply = [&](ConstMatrixViewT<T> a, ConstMatrixViewT<T> b, MatrixViewT<Acc> c) {
+        if (kernel == GemmKernel::Blocked) {
+            if (pb.k != b.rows || pb.n != b.cols) pb = make_packed_b<Acc>(b.rows, b.cols);
+            pool.run([&](int w) { pack_b_panels(b, pb, w, num_threads); });
+        }
+        const std::vector<int> split = even_row_split(a.rows, num_threads);
+        pool.run([&](int w) {
+            const int r0 = split[w], nr = split[w + 1] - split[w];
+            if (nr <= 0) return;
+            if (kernel == GemmKernel::Blocked) gemm_blocked_packed(a.view(r0, 0, nr, a.cols), pb, a_pack[w], c.view(r0, 0, nr, c.cols));
+            else                               gemm_naive(a.view(r0, 0, nr, a.cols), b, c.view(r0, 0, nr, c.cols));
+        });
+    };
+
+    OutOfCoreStats st;
+    std::string err;
+    if (!gemm_out_of_core<T, Acc>(opt.a_file, opt.b_file, opt.c_file, budget, multiply, st, err)) {
+        std::cerr << err << "\n";
+        return 1;
+    }
+    const double ops = 2.0 * rows_a * cols_a * cols_b;
+    out << "\n--- Resultado ---\n";
+    print_out_of_core(out, st, ops);
+    out << "C guardada en " << opt.c_file << "\n";
+
+    if (opt.quiet)
+        std::cout << std::fixed << std::setprecision(6)
+                  << "MMP " << dims_label(pt.dims) << " hilos=" << num_threads
+                  << " tipo=" << elem_name<T>() << "->" << elem_name<Acc>()
+                  << " kernel=" << kernel_name(kernel) << " fuera_de_memoria"
+                  << " total=" << st.total_s << " s espera_es=" << st.wait_s << " s"
+                  << std::setprecision(2) << " GOP/s=" << (st.compute_s > 0 ? ops / st.compute_s / 1e9 : 0.0) << "\n";
+
+    if (!pt.json_path.empty()) {
+        std::ofstream f;
+        if (!open_json_file(pt.json_path, f)) return 1;
+        ProcessCounters pc = read_process_counters();
+        JsonWriter w(f);
+        w.begin_object();
+        w.field("programa", "MMP.cpp");
+        w.field("tipo", "Paralelo fuera de memoria (teselas desde disco)");
+        w.field("fecha_ejecucion", current_datetime_iso());
+        json_sistema(w, read_system_info());
+
+        w.begin_object("configuracion");
+        w.field("filas_a", rows_a);
+        w.field("columnas_a", cols_a);
+        w.field("columnas_b", cols_b);
+        w.field("fichero_a", opt.a_file);
+        w.field("fichero_b", opt.b_file);
+        w.field("fichero_c", opt.c_file);
+        w.field("hilos_utilizados", num_threads);
+        w.field("tipo_elemento", elem_name<T>());
+        w.field("acumulador", elem_name<Acc>());
+        w.field("kernel", kernel_name(kernel));
+        if (kernel != GemmKernel::Naive) w.field("micro_kernel", active_microkernel<Acc>().name);
+        w.field("afinidad", pin_policy_name(opt.pin));
+        w.field("presupuesto_memoria_mb", opt.mem_budget_mb);
+        w.end_object();
+
+        json_out_of_core(w, st, ops);
+
+        w.begin_object("memoria");
+        w.field("ram_final_mb", get_memory_mb());
+        json_memoria_contadores(w, pc);
+        w.end_object();
+
+        json_io(w, pc);
+        json_proceso(w, pc, false);
+        w.finish();
+        out << "\nMetricas guardadas en " << pt.json_path << "\n";
+    }
     return 0;
 }
+
+// ===================== Lotes de productos pequenos =====================
+
+// Productos hechos por un hilo en la ultima repeticion (cada uno en su linea
+// de cache: los escribe solo su worker).
+struct alignas(CACHE_LINE) BatchThreadStats {
+    long long products = 0;
+    double time = 0.0;
+};
+
+// --batch: L productos independientes de MxKxN (batched.h). Cada hilo hace
+// productos enteros, tomados por trozos de un contador atomico; los hilos no
+// se limitan a las filas de un producto como en run_parallel.
+template <class T, class Acc>
+int run_batched(const CliOptions& opt, const RunPoint& pt) {
+    const int count = opt.batch;
+    const int m = pt.dims[0], k = pt.dims[1], n = pt.dims[2];
+    std::ostream null_out(nullptr);
+    std::ostream& out = opt.quiet ? null_out : std::cout;
+
+    const CpuTopology cpu_topo = read_cpu_topology();
+    const int chunk = batch_chunk(count, pt.threads > 0 ? pt.threads : default_threads(cpu_topo, opt.pin), m, k, n);
+    const int chunks = (count + chunk - 1) / chunk;
+    const int num_threads = std::min(pt.threads > 0 ? pt.threads : default_threads(cpu_topo, opt.pin), chunks);
+    const std::vector<int> cores = pin_map(cpu_topo, opt.pin, num_threads);
+    ThreadPool pool(num_threads, opt.park, cores);
+    const SmallGemmKernel<T, Acc> kr = small_gemm_kernel<T, Acc>(m, k, n);
+    const std::string kernel_desc = kr.fixed
+        ? "desenrollado " + std::to_string(kr.size) + "x" + std::to_string(kr.size) + "x" + std::to_string(kr.size)
+        : std::string("generico");
+
+    out << "\n=== LOTE DE PRODUCTOS PEQUENOS - PARALELO ===\n";
+    out << "Productos:                 " << count << " de " << m << "x" << k << " x " << k << "x" << n << "\n";
+    out << "Hilos a utilizar:          " << num_threads << " (afinidad " << pin_policy_name(opt.pin) << ")\n";
+    out << "Tipo (entrada -> acum.):   " << elem_name<T>() << " -> " << elem_name<Acc>() << "\n";
+    out << "Kernel:                    " << kernel_desc << "\n";
+    out << "Productos por trozo:       " << chunk << " (" << chunks << " trozos)\n";
+    if (opt.reps > 1)
+        out << "Repeticiones:              " << opt.reps << "\n";
+
+    // --- Generar A y B: cada hilo los productos que luego calcula primero ---
+    auto gen_start = std::chrono::steady_clock::now();
+    BatchT<T> A = BatchT<T>::uninitialized(count, m, k), B = BatchT<T>::uninitialized(count, k, n);
+    BatchT<Acc> C = BatchT<Acc>::uninitialized(count, m, n);
+    const std::vector<int> split = even_row_split(count, num_threads);
+    pool.run([&](int w) {
+        const int p0 = split[w], p1 = split[w + 1];
+        fill_random_sparse_digits(A.as_rows(), p0 * m, p1 * m, opt.seed, RNG_STREAM_A, opt.density);
+        fill_random_sparse_digits(B.as_rows(), p0 * k, p1 * k, opt.seed, RNG_STREAM_B, opt.density);
+        std::memset(C.matrix(p0), 0, (std::size_t)(p1 - p0) * C.stride() * sizeof(Acc));
+    });
+    const double gen_elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - gen_start).count();
+    out << std::fixed << std::setprecision(6) << "Semilla aleatoria:         " << opt.seed << "\n"
+        << "Lotes generados en " << gen_elapsed << " s ("
+        << std::setprecision(2) << (A.size_bytes() + B.size_bytes() + C.size_bytes()) / (1024.0 * 1024.0) << " MB)\n";
+
+    // --- Multiplicar: trozos de productos de un contador compartido ---
+    std::vector<BatchThreadStats> stats(num_threads);
+    std::vector<double> rep_times;
+    for (int rep = 0; rep < opt.reps; ++rep) {
+        std::atomic<int> next{0};
+        auto t0 = std::chrono::steady_clock::now();
+        pool.run([&](int w) {
+            BatchThreadStats& st = stats[w];
+            st = BatchThreadStats();
+            const auto start = std::chrono::steady_clock::now();
+            for (int c; (c = next.fetch_add(1, std::memory_order_relaxed)) < chunks;) {
+                const int first = c * chunk, last = std::min(count, first + chunk);
+                gemm_batch_range(A, B, C, kr, first, last);
+                st.products += last - first;
+            }
+            st.time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        });
+        rep_times.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count());
+        if (opt.reps > 1)
+            out << std::setprecision(6) << "  Repeticion " << rep + 1 << "/" << opt.reps << ": "
+                << rep_times.back() << " s\n";
+    }
+    const double median_time = median_of(rep_times);
+    const double products_per_s = median_time > 0 ? count / median_time : 0.0;
+    const double gops = median_time > 0 ? 2.0 * m * k * n * (double)count / median_time / 1e9 : 0.0;
+
+    // --- Comprobar unos productos con el triple bucle de referencia ---
+    bool verified = true;
+    for (int i : { 0, count / 2, count - 1 }) {
+        MatrixT<Acc> ref(m, n);
+        gemm_naive(A.matrix_view(i), B.matrix_view(i), ref.view());
+        for (int r = 0; r < m && verified; ++r)
+            verified = std::memcmp(ref.row(r), C.matrix(i) + (std::size_t)r * n, (std::size_t)n * sizeof(Acc)) == 0;
+    }
+
+    out << "\n" << std::string(70, '=') << "\n";
+    out << "  RESULTADO\n";
+    out << std::string(70, '=') << "\n";
+    out << std::fixed << std::setprecision(6)
+        << "  Tiempo del lote:           " << median_time << " s";
+    if (opt.reps > 1) out << " (mediana de " << opt.reps << ")";
+    out << "\n" << std::setprecision(0)
+        << "  Productos por segundo:     " << products_per_s << "\n"
+        << std::setprecision(3)
+        << "  Tiempo por producto:       " << (count > 0 ? median_time / count * 1e9 : 0.0) << " ns\n"
+        << std::setprecision(2)
+        << "  Rendimiento:               " << gops << " GOP/s\n"
+        << "  Comprobacion (3 productos): " << (verified ? "correcta" : "ERROR") << "\n";
+    out << "\n  Hilo  CPU   Productos    Tiempo (s)\n";
+    for (int i = 0; i < num_threads; ++i)
+        out << "  " << std::setw(4) << i << "  " << std::setw(3) << cores[i] << "  " << std::setw(10)
+            << stats[i].products << "  " << std::setw(12) << std::setprecision(6) << stats[i].time << "\n";
+    out << std::string(70, '=') << "\n";
+
+    if (opt.quiet)
+        std::cout << std::fixed << std::setprecision(6)
+                  << "MMP lote=" << count << "x" << dims_label(pt.dims) << " hilos=" << num_threads
+                  << " tipo=" << elem_name<T>() << "->" << elem_name<Acc>()
+                  << " kernel=" << (kr.fixed ? "desenrollado" : "generico")
+                  << " mediana=" << median_time << " s"
+                  << std::setprecision(0) << " productos/s=" << products_per_s
+                  << std::setprecision(2) << " GOP/s=" << gops << "\n";
+
+    if (!pt.json_path.empty()) {
+        std::ofstream f;
+        if (!open_json_file(pt.json_path, f)) return 1;
+        ProcessCounters pc = read_process_counters();
+        JsonWriter w(f);
+        w.begin_object();
+        w.field("programa", "MMP.cpp");
+        w.field("tipo", "Paralelo por lotes (productos pequenos independientes)");
+        w.field("fecha_ejecucion", current_datetime_iso());
+        json_sistema(w, read_system_info());
+
+        w.begin_object("configuracion");
+        w.field("productos", count);
+        w.field("filas_a", m);
+        w.field("columnas_a", k);
+        w.field("columnas_b", n);
+        w.field("semilla", opt.seed);
+        if (opt.density < 1.0) w.field("densidad_generada", opt.density);
+        w.field("hilos_utilizados", num_threads);
+        w.field("tipo_elemento", elem_name<T>());
+        w.field("acumulador", elem_name<Acc>());
+        w.field("kernel", kernel_desc);
+        w.field("productos_por_trozo", chunk);
+        w.field("afinidad", pin_policy_name(opt.pin));
+        w.field("repeticiones", opt.reps);
+        w.end_object();
+
+        w.begin_object("resultados");
+        w.field("tiempo_lote_s", median_time);
+        w.inline_array("tiempos_s", rep_times);
+        w.field("productos_por_s", products_per_s);
+        w.field("gop_s", gops);
+        w.field("tiempo_generacion_s", gen_elapsed);
+        w.field("comprobacion_correcta", verified);
+        w.end_object();
+
+        w.begin_object("memoria");
+        w.field("ram_final_mb", get_memory_mb());
+        json_memoria_contadores(w, pc);
+        w.end_object();
+        json_proceso(w, pc, false);
+
+        w.begin_array("hilos");
+        for (int i = 0; i < num_threads; ++i) {
+            w.begin_object();
+            w.field("id", i);
+            w.field("core_asignado", cores[i]);
+            w.field("cpu_topologia", describe_cpu(cpu_topo, cores[i]));
+            w.field("productos", stats[i].products);
+            w.field("tiempo_s", stats[i].time);
+            w.end_object();
+        }
+        w.end_array();
+        w.finish();
+        out << "\nMetricas guardadas en " << pt.json_path << "\n";
+    }
+    return verified ? 0 : 1;
+}
+
+// ===================== Tuberia por paneles =====================
+
+// --pipeline: A y C se recorren por paneles de filas (pipeline.h). Mientras
+// el pool multiplica el panel k, un hilo ya genera (o trae de --a) el k+1 y
+// otro calcula la suma de comprobacion del k-1 y lo vuelca a --c. B la
+// necesitan todos los paneles: se genera (o carga) y se empaqueta entera en
+// el pool antes de arrancar la tuberia.
+template <class T, class Acc>
+int run_pipelined(const CliOptions& opt, const RunPoint& pt) {
+    const GemmKernel kernel = opt.kernel;
+    const int rows_a = pt.dims[0], cols_a = pt.dims[1], cols_b = pt.dims[2];
+    std::ostream null_out(nullptr);
+    std::ostream& out = opt.quiet ? null_out : std::cout;
+
+    const CpuTopology cpu_topo = read_cpu_topology();
+    const int num_threads = std::min(pt.threads > 0 ? pt.threads : default_threads(cpu_topo, opt.pin), rows_a);
+    const std::vector<int> cores = pin_map(cpu_topo, opt.pin, num_threads);
+    ThreadPool pool(num_threads, opt.park, cores);
+
+    // Unos 16 paneles y al menos 8 filas por hilo en cada uno
+    const int panel_rows = std::min(rows_a, opt.panel_rows > 0 ? opt.panel_rows
+                                                               : std::max(8 * num_threads, (rows_a + 15) / 16));
+    const int panels = (rows_a + panel_rows - 1) / panel_rows;
+    const bool a_from_file = !opt.a_file.empty(), b_from_file = !opt.b_file.empty();
+    const bool write_c = !opt.c_file.empty();
+    const int depth = opt.pipeline_depth > 0 ? opt.pipeline_depth : (write_c ? 4 : 3);
+
+    out << "\n=== TUBERIA POR PANELES - PARALELO ===\n";
+    out << "Hilos a utilizar:          " << num_threads << " (afinidad " << pin_policy_name(opt.pin) << ")\n";
+    out << "Tipo (entrada -> acum.):   " << elem_name<T>() << " -> " << elem_name<Acc>() << "\n";
+    out << "Kernel:                    " << kernel_name(kernel) << "\n";
+    if (kernel != GemmKernel::Naive)
+        out << "Micro-kernel:              " << active_microkernel<Acc>().name << "\n";
+    out << "Paneles:                   " << panels << " de " << panel_rows << " filas (profundidad " << depth << ")\n";
+    if (!a_from_file || !b_from_file) out << "Semilla aleatoria:         " << opt.seed << "\n";
+
+    // La suma de A de --a no se comprueba: habria que leer el fichero entero
+    // antes de la tuberia, que es justo lo que la etapa de carga reparte.
+    std::string file_err;
+    MatrixT<T> A, B;
+    if (!a_from_file) A = MatrixT<T>::uninitialized(rows_a, cols_a);
+    else if (!load_matrix_file(opt.a_file, A, file_err, false)) { std::cerr << file_err << "\n"; return 1; }
+    if (!b_from_file) B = MatrixT<T>::uninitialized(cols_a, cols_b);
+    else if (!load_matrix_file(opt.b_file, B, file_err)) { std::cerr << file_err << "\n"; return 1; }
+    MatrixFileOut<Acc> c_out;
+    if (!write_c) c_out.matrix = MatrixT<Acc>::uninitialized(rows_a, cols_b);
+    else if (!create_matrix_file(opt.c_file, rows_a, cols_b, c_out, file_err)) { std::cerr << file_err << "\n"; return 1; }
+    MatrixT<Acc>& C = c_out.matrix;
+
+    // --- B entera: generar (o cargar) y empaquetar en el pool ---
+    auto b_start = std::chrono::steady_clock::now();
+    PackedBT<Acc> pb;
+    std::vector<APackBufferT<Acc>> a_pack(num_threads);     // uno por hilo para todos los paneles
+    if (kernel == GemmKernel::Blocked) {
+        pb = make_packed_b<Acc>(cols_a, cols_b);
+        for (auto& ap : a_pack) ap = make_a_pack<Acc>();
+    }
+    const std::vector<int> b_split = even_row_split(cols_a, num_threads);
+    pool.run([&](int w) {
+        if (!b_from_file) fill_random_sparse_digits(B.view(), b_split[w], b_split[w + 1], opt.seed, RNG_STREAM_B, opt.density);
+    });
+    if (kernel == GemmKernel::Blocked) pool.run([&](int w) { pack_b_panels(B.cview(), pb, w, num_threads); });
+    // Con --verify, Br de Freivalds tambien ahora; cada panel se comprueba
+    // en la etapa de verificar
+    std::unique_ptr<FreivaldsCheck<T, Acc>> chk;
+    if (opt.verify_rounds > 0) {
+        chk = std::make_unique<FreivaldsCheck<T, Acc>>(A.cview(), B.cview(), C.cview(), opt.verify_rounds, opt.seed);
+        const std::vector<int> v_b = chk->b_split(num_threads);
+        pool.run([&](int w) { chk->project_b(v_b[w], v_b[w + 1]); });
+    }
+    const double b_elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - b_start).count();
+    out << std::fixed << std::setprecision(6) << "B " << (b_from_file ? "cargada" : "generada")
+        << (kernel == GemmKernel::Blocked ? " y empaquetada" : "") << (chk ? " (con Br de Freivalds)" : "")
+        << " en " << b_elapsed << " s\n";
+
+    // --- Etapas ---
+    // Las filas [r0, r1) del panel p; el relleno de cada fila de C se pone a
+    // cero al preparar el panel, porque entra en la suma de comprobacion.
+    auto rows_of = [&](int p, int& r0, int& r1) {
+        r0 = p * panel_rows;
+        r1 = std::min(rows_a, r0 + panel_rows);
+    };
+    const std::size_t page = 4096;
+    volatile unsigned char a_sink = 0;
+    std::uint64_t c_checksum = MATRIX_CHECKSUM_SEED;
+    bool write_ok = true;
+
+    PanelPipeline pl(panels, depth);
+    pl.add_stage(a_from_file ? "cargar A" : "generar A", [&](int p) {
+        int r0, r1;
+        rows_of(p, r0, r1);
+        if (a_from_file) {
+            // Una lectura por pagina: el fallo de pagina (y la lectura del
+            // disco) lo paga este hilo, no los del pool
+            const unsigned char* base = reinterpret_cast<const unsigned char*>(A.row(r0));
+            const std::size_t bytes = (std::size_t)(r1 - r0) * A.stride() * sizeof(T);
+            unsigned char acc = 0;
+            for (std::size_t off = 0; off < bytes; off += page) acc ^= base[off];
+            a_sink = acc;
+        } else {
+            fill_random_sparse_digits(A.view(), r0, r1, opt.seed, RNG_STREAM_A, opt.density);
+        }
+        std::memset(C.row(r0), 0, (std::size_t)(r1 - r0) * C.stride() * sizeof(Acc));
+    });
+    pl.add_stage("multiplicar", [&](int p) {
+        int r0, r1;
+        rows_of(p, r0, r1);
+        const std::vector<int> split = even_row_split(r1 - r0, num_threads);
+        pool.run([&](int w) {
+            const int i0 = r0 + split[w], nr = split[w + 1] - split[w];
+            if (nr <= 0) return;
+            if (kernel == GemmKernel::Blocked) gemm_blocked_packed(A.cview().view(i0, 0, nr, cols_a), pb, a_pack[w], C.view(i0, 0, nr, cols_b));
+            else                               gemm_naive(A.cview().view(i0, 0, nr, cols_a), B.cview(), C.view(i0, 0, nr, cols_b));
+        });
+    });
+    // La suma de C (FNV-1a de matrix_file.h) se encadena panel a panel en
+    // orden, asi que al terminar ya es la de la cabecera de --c. Los paneles
+    // llegan en orden, asi que Freivalds puede partir bloques entre paneles.
+    pl.add_stage("verificar", [&](int p) {
+        int r0, r1;
+        rows_of(p, r0, r1);
+        c_checksum = matrix_checksum(C.row(r0), (std::size_t)(r1 - r0) * C.stride() * sizeof(Acc), c_checksum);
+        if (chk) chk->check_rows(r0, r1);
+    });
+    if (write_c)
+        pl.add_stage("escribir C", [&](int p) {
+            int r0, r1;
+            rows_of(p, r0, r1);
+            const std::size_t row_bytes = (std::size_t)C.stride() * sizeof(Acc);
+            if (!c_out.file->flush_range(MATRIX_FILE_DATA_OFFSET + r0 * row_bytes, (r1 - r0) * row_bytes))
+                write_ok = false;
+        });
+
+    out << "Ejecutando la tuberia...\n";
+    pl.run();
+    if (write_c && (!write_ok || !c_out.finish(file_err, c_checksum))) {
+        std::cerr << (file_err.empty() ? "no se pudo volcar C a disco" : file_err) << "\n";
+        return 1;
+    }
+
+    const double ops = 2.0 * rows_a * cols_a * cols_b;
+    const double total_s = b_elapsed + pl.total_s();
+    double serial = b_elapsed;
+    for (const PipelineStageStats& st : pl.stats()) serial += st.busy_s;
+    const double gops = total_s > 0 ? ops / total_s / 1e9 : 0.0;
+    const PipelineStageStats& mul = pl.stats()[1];
+    const std::string c_sum_hex = checksum_hex(c_checksum);
+    VerifyResult verify;
+    if (chk) {
+        verify = chk->result();
+        verify.time_s = pl.stats()[2].busy_s;
+    }
+
+    out << "\n" << std::string(70, '=') << "\n";
+    out << "  RESULTADO\n";
+    out << std::string(70, '=') << "\n";
+    print_pipeline(out, pl);
+    out << std::fixed << std::setprecision(6)
+        << "\n  Tiempo total (B + tuberia):  " << total_s << " s\n"
+        << "  En serie (suma de etapas):   " << serial << " s\n"
+        << "  Ahorro por solapamiento:     " << serial - total_s << " s\n"
+        << std::setprecision(2)
+        << "  Rendimiento:                 " << gops << " GOP/s (solo multiplicar: "
+        << (mul.busy_s > 0 ? ops / mul.busy_s / 1e9 : 0.0) << ")\n"
+        << "  Suma de comprobacion de C:   " << c_sum_hex << "\n";
+    if (chk) print_verify(out, verify, 29);
+    if (write_c) out << "  C guardada en " << opt.c_file << "\n";
+    out << std::string(70, '=') << "\n";
+
+    if (opt.quiet)
+        std::cout << std::fixed << std::setprecision(6)
+                  << "MMP " << dims_label(pt.dims) << " hilos=" << num_threads
+                  << " tipo=" << elem_name<T>() << "->" << elem_name<Acc>()
+                  << " kernel=" << kernel_name(kernel) << " tuberia=" << panels << "x" << panel_rows
+                  << " total=" << total_s << " s serie=" << serial << " s"
+                  << " cuello=" << pl.stats()[pl.bottleneck()].name
+                  << std::setprecision(2) << " GOP/s=" << gops
+                  << (chk ? std::string(" freivalds=") + (verify.ok ? "ok" : "ERROR") +
+                                " suma=" + checksum_hex(verify.combined)
+                          : std::string())
+                  << "\n";
+
+    if (!pt.json_path.empty()) {
+        std::ofstream f;
+        if (!open_json_file(pt.json_path, f)) return 1;
+        ProcessCounters pc = read_process_counters();
+        JsonWriter w(f);
+        w.begin_object();
+        w.field("programa", "MMP.cpp");
+        w.field("tipo", "Paralelo en tuberia por paneles de filas");
+        w.field("fecha_ejecucion", current_datetime_iso());
+        json_sistema(w, read_system_info());
+
+        w.begin_object("configuracion");
+        w.field("filas_a", rows_a);
+        w.field("columnas_a", cols_a);
+        w.field("columnas_b", cols_b);
+        if (a_from_file) w.field("fichero_a", opt.a_file);
+        if (b_from_file) w.field("fichero_b", opt.b_file);
+        if (write_c) w.field("fichero_c", opt.c_file);
+        if (!a_from_file || !b_from_file) w.field("semilla", opt.seed);
+        if (opt.density < 1.0) w.field("densidad_generada", opt.density);
+        w.field("hilos_utilizados", num_threads);
+        w.field("tipo_elemento", elem_name<T>());
+        w.field("acumulador", elem_name<Acc>());
+        w.field("kernel", kernel_name(kernel));
+        if (kernel != GemmKernel::Naive) w.field("micro_kernel", active_microkernel<Acc>().name);
+        w.field("afinidad", pin_policy_name(opt.pin));
+        w.field("filas_por_panel", panel_rows);
+        w.end_object();
+
+        w.begin_object("resultados");
+        w.field("tiempo_total_s", total_s);
+        w.field("tiempo_b_s", b_elapsed);
+        w.field("tiempo_en_serie_s", serial);
+        w.field("ahorro_solapamiento_s", serial - total_s);
+        w.field("gop_s", gops);
+        w.field("suma_c", c_sum_hex);
+        w.end_object();
+
+        json_pipeline(w, pl);
+        if (chk) json_verify(w, verify);
+
+        w.begin_object("memoria");
+        w.field("ram_final_mb", get_memory_mb());
+        json_memoria_contadores(w, pc);
+        w.end_object();
+        json_proceso(w, pc, false);
+        w.finish();
+        out << "\nMetricas guardadas en " << pt.json_path << "\n";
+    }
+    return verify.ok ? 0 : 1;
+}
+
+// ===================== Trabajos asincronos =====================
+
+// --jobs: J multiplicaciones de MxKxN enviadas a la cola de matmul.h. Cada
+// trabajo genera su A y su B (semilla + j) en el hilo de preparacion de la
+// cola mientras el pool multiplica el anterior; main solo envia y espera los
+// futures. Se informa por trabajo la espera en cola, la preparacion, el
+// calculo y la latencia, y lo que se ahorra frente a hacerlo en serie.
+template <class T, class Acc>
+int run_async_jobs(const CliOptions& opt, const RunPoint& pt) {
+    const int jobs = opt.jobs;
+    const int m = pt.dims[0], k = pt.dims[1], n = pt.dims[2];
+    std::ostream null_out(nullptr);
+    std::ostream& out = opt.quiet ? null_out : std::cout;
+
+    const CpuTopology cpu_topo = read_cpu_topology();
+    MultiplyOptions mo;
+    mo.threads = std::min(pt.threads > 0 ? pt.threads : default_threads(cpu_topo, opt.pin), m);
+    mo.kernel = opt.kernel;
+    mo.pin = opt.pin;
+    mo.park = opt.park;
+    mo.simd = opt.simd;
+    mo.product = opt.product;
+    mo.strassen_cutoff = opt.strassen_cutoff;
+    MultiplyQueue queue(mo);
+    const int num_threads = queue.threads();
+
+    out << "\n=== TRABAJOS ASINCRONOS - PARALELO ===\n";
+    out << "Trabajos:                  " << jobs << " de " << m << "x" << k << " x " << k << "x" << n << "\n";
+    out << "Hilos a utilizar:          " << num_threads << " (afinidad " << pin_policy_name(opt.pin) << ")\n";
+    out << "Tipo (entrada -> acum.):   " << elem_name<T>() << " -> " << elem_name<Acc>() << "\n";
+    out << "Kernel:                    " << kernel_name(opt.kernel) << "\n";
+    out << "Semillas:                  " << opt.seed << ".." << opt.seed + (unsigned)(jobs - 1) << "\n";
+
+    // Se reserva sin escribir: las paginas las toca el prepare() de cada
+    // trabajo justo antes de su turno.
+    std::vector<MatrixT<T>> A(jobs), B(jobs);
+    std::vector<MatrixT<Acc>> C(jobs);
+    for (int j = 0; j < jobs; ++j) {
+        A[j] = MatrixT<T>::uninitialized(m, k);
+        B[j] = MatrixT<T>::uninitialized(k, n);
+        C[j] = MatrixT<Acc>::uninitialized(m, n);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::future<MultiplyMetrics>> futures;
+    for (int j = 0; j < jobs; ++j) {
+        const unsigned seed = opt.seed + (unsigned)j;
+        MatrixT<T>* a = &A[j];
+        MatrixT<T>* b = &B[j];
+        MatrixT<Acc>* c = &C[j];
+        futures.push_back(queue.submit<T, Acc>(A[j].cview(), B[j].cview(), C[j].view(), [=, &opt] {
+            fill_random_sparse_digits(a->view(), 0, m, seed, RNG_STREAM_A, opt.density);
+            fill_random_sparse_digits(b->view(), 0, k, seed, RNG_STREAM_B, opt.density);
+            std::memset(c->data(), 0, c->size_bytes());
+        }));
+    }
+    std::vector<MultiplyMetrics> results;
+    for (auto& f : futures) results.push_back(f.get());
+    const double makespan = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    bool ok = true;
+    double serial = 0.0, ops = 0.0;
+    std::vector<double> latencies, queue_times;
+    for (const MultiplyMetrics& mm : results) {
+        if (!mm.error.empty()) {
+            std::cerr << "Error: " << mm.error << "\n";
+            ok = false;
+        }
+        serial += mm.prepare_s + mm.total_s;
+        ops += mm.ops;
+        latencies.push_back(mm.latency_s);
+        queue_times.push_back(mm.queue_s);
+    }
+    const double jobs_per_s = makespan > 0 ? jobs / makespan : 0.0;
+    const double gops = makespan > 0 ? 2.0 * m * k * n * (double)jobs / makespan / 1e9 : 0.0;
+    const double overlap_saved = serial - makespan;
+
+    out << "\n" << std::string(70, '=') << "\n";
+    out << "  RESULTADO\n";
+    out << std::string(70, '=') << "\n";
+    out << "  Trabajo  Cola (s)    Preparacion (s)  Calculo (s)  Latencia (s)  GOP/s\n";
+    for (int j = 0; j < jobs; ++j) {
+        const MultiplyMetrics& mm = results[j];
+        out << std::fixed << std::setprecision(6) << "  " << std::setw(7) << j << "  " << std::setw(10) << mm.queue_s
+            << "  " << std::setw(15) << mm.prepare_s << "  " << std::setw(11) << mm.total_s
+            << "  " << std::setw(12) << mm.latency_s << "  " << std::setprecision(2) << mm.gops << "\n";
+    }
+    out << std::setprecision(6)
+        << "\n  Tiempo total (envio -> ultimo):  " << makespan << " s\n"
+        << "  En serie (preparar + calcular):  " << serial << " s\n"
+        << "  Ahorro por solapamiento:         " << overlap_saved << " s\n"
+        << "  Latencia mediana:                " << median_of(latencies) << " s\n"
+        << "  Cola mediana:                    " << median_of(queue_times) << " s\n"
+        << std::setprecision(2)
+        << "  Trabajos por segundo:            " << jobs_per_s << "\n"
+        << "  Rendimiento:                     " << gops << " GOP/s\n";
+    out << std::string(70, '=') << "\n";
+
+    if (opt.quiet)
+        std::cout << std::fixed << std::setprecision(6)
+                  << "MMP trabajos=" << jobs << "x" << dims_label(pt.dims) << " hilos=" << num_threads
+                  << " tipo=" << elem_name<T>() << "->" << elem_name<Acc>()
+                  << " kernel=" << kernel_name(opt.kernel)
+                  << " total=" << makespan << " s serie=" << serial << " s"
+                  << " latencia_mediana=" << median_of(latencies) << " s"
+                  << std::setprecision(2) << " trabajos/s=" << jobs_per_s << " GOP/s=" << gops << "\n";
+
+    if (!pt.json_path.empty()) {
+        std::ofstream f;
+        if (!open_json_file(pt.json_path, f)) return 1;
+        ProcessCounters pc = read_process_counters();
+        JsonWriter w(f);
+        w.begin_object();
+        w.field("programa", "MMP.cpp");
+        w.field("tipo", "Paralelo con trabajos asincronos (cola de matmul.h)");
+        w.field("fecha_ejecucion", current_datetime_iso());
+        json_sistema(w, read_system_info());
+
+        w.begin_object("configuracion");
+        w.field("trabajos", jobs);
+        w.field("filas_a", m);
+        w.field("columnas_a", k);
+        w.field("columnas_b", n);
+        w.field("semilla", opt.seed);
+        if (opt.density < 1.0) w.field("densidad_generada", opt.density);
+        w.field("hilos_utilizados", num_threads);
+        w.field("tipo_elemento", elem_name<T>());
+        w.field("acumulador", elem_name<Acc>());
+        w.field("kernel", kernel_name(opt.kernel));
+        w.field("afinidad", pin_policy_name(opt.pin));
+        w.end_object();
+
+        w.begin_object("resultados");
+        w.field("tiempo_total_s", makespan);
+        w.field("tiempo_en_serie_s", serial);
+        w.field("ahorro_solapamiento_s", overlap_saved);
+        w.field("trabajos_por_s", jobs_per_s);
+        w.field("gop_s", gops);
+        w.field("latencia_mediana_s", median_of(latencies));
+        w.field("cola_mediana_s", median_of(queue_times));
+        w.end_object();
+
+        w.begin_array("trabajos");
+        for (int j = 0; j < jobs; ++j) {
+            const MultiplyMetrics& mm = results[j];
+            w.begin_object();
+            w.field("id", j);
+            w.field("semilla", opt.seed + (unsigned)j);
+            w.field("producto", product_path_name(mm.path));
+            w.field("cola_s", mm.queue_s);
+            w.field("preparacion_s", mm.prepare_s);
+            w.field("empaquetado_s", mm.pack_s);
+            w.field("calculo_s", mm.total_s);
+            w.field("latencia_s", mm.latency_s);
+            w.field("gop_s", mm.gops);
+            if (!mm.error.empty()) w.field("error", mm.error);
+            w.end_object();
+        }
+        w.end_array();
+
+        w.begin_object("memoria");
+        w.field("ram_final_mb", get_memory_mb());
+        json_memoria_contadores(w, pc);
+        w.end_object();
+        json_proceso(w, pc, false);
+        w.finish();
+        out << "\nMetricas guardadas en " << pt.json_path << "\n";
+    }
+    return ok ? 0 : 1;
+}
+
+// ===================== Main =====================
+
+int main(int argc, char** argv) {
+    std::cout << std::unitbuf;
+
+    CliOptions opt;
+    std::string bad;
+    if (!parse_cli(argc, argv, true, opt, bad)) {
+        std::cerr << "Argumento no reconocido o no soportado por esta CPU: " << bad << "\n";
+        print_usage("MMP", true);
+        return CLI_EXIT_USAGE;
+    }
+    std::string file_err;
+    if (!load_input_headers(opt, file_err)) {
+        std::cerr << "Error: " << file_err << "\n";
+        return CLI_EXIT_INPUT;
+    }
+    set_active_isa(opt.simd);
+
+    auto run = [&](const RunPoint& pt) {
+        int rc = 1;
+        dispatch_elem_types(opt.type, opt.acc, [&](auto t, auto a) {
+            using T = typename decltype(t)::type;
+            using Acc = typename decltype(a)::type;
+            if (opt.jobs > 0)         rc = run_async_jobs<T, Acc>(opt, pt);
+            else if (opt.batch > 0)   rc = run_batched<T, Acc>(opt, pt);
+            else if (opt.pipeline)    rc = run_pipelined<T, Acc>(opt, pt);
+            else if (opt.out_of_core) rc = run_out_of_core<T, Acc>(opt, pt);
+            else                      rc = run_parallel<T, Acc>(opt, pt);
+        });
+        return rc;
+    };
+
+    // --- Barrido: tamanos x hilos, un JSON por punto ---
+    if (opt.sweep()) {
+        std::vector<Dims> sizes = opt.sweep_sizes;
+        if (sizes.empty()) {
+            if (!opt.dims_given) { std::cerr << "--sweep-threads necesita --dims o --sweep\n"; return 1; }
+            sizes.push_back(opt.dims);
+        }
+        std::vector<int> threads = opt.sweep_threads;
+        if (threads.empty()) threads.push_back(opt.threads);
+        ensure_dir(opt.out_dir);
+
+        int rc = 0;
+        for (const Dims& d : sizes) {
+            for (int t : threads) {
+                RunPoint pt;
+                pt.dims = d;
+                pt.threads = t;
+                // Hilos efectivos en el nombre, como en hilos_utilizados
+                int eff = t > 0 ? t : default_threads(read_cpu_topology(), opt.pin);
+                eff = std::min(eff, d[0]);
+                pt.json_path = opt.out_dir + "/metricas_paralelo_" + dims_label(d) +
+                               "_t" + std::to_string(eff) + ".json";
+                rc |= run(pt);
+            }
+        }
+        return rc;
+    }
+
+    RunPoint pt;
+    pt.threads = opt.threads;
+    if (opt.dims_given) {
+        pt.dims = opt.dims;
+    } else {
+        std::cout << "=== MULTIPLICACION DE MATRICES - PARALELO (C++) ===\n\n";
+        std::cout << "Filas de A: " << std::flush;                    std::cin >> pt.dims[0];
+        std::cout << "Columnas de A (= Filas de B): " << std::flush;  std::cin >> pt.dims[1];
+        std::cout << "Columnas de B: " << std::flush;                  std::cin >> pt.dims[2];
+        if (!std::cin || pt.dims[0] <= 0 || pt.dims[1] <= 0 || pt.dims[2] <= 0) {
+            std::cerr << "Dimensiones invalidas\n";
+            return 1;
+        }
+    }
+    if (opt.json) {
+        if (opt.json_path.empty()) {
+            ensure_dir(opt.out_dir);
+            pt.json_path = opt.out_dir + "/metricas_paralelo.json";
+        } else {
+            pt.json_path = opt.json_path;
+        }
+    }
+    return run(pt);
+}
@@ -1,20 +1,36 @@
 // Multiplicacion de matrices SECUENCIAL (1 hilo, 1 core) en C++
 // VERSION CON INTERFAZ GRAFICA (Win32 API)
 //
-// Compilar con MSVC:  cl /O2 /EHsc MMS.cpp /link psapi.lib user32.lib gdi32.lib
-// Compilar con g++:   g++ -O2 -std=c++17 -o MMS.exe MMS.cpp -lpsapi -lgdi32 -luser32 -mwindows
+// Compilar con CMake: cmake --build build --target MMS
+// Compilar con MSVC:  cl /O2 /EHsc MMS.cpp matmul.cpp /link psapi.lib user32.lib gdi32.lib
+// Compilar con g++:   g++ -O2 -std=c++17 -o MMS.exe MMS.cpp matmul.cpp -lpsapi -lgdi32 -luser32 -mwindows
+// Compilar en Linux:  g++ -O2 -std=c++17 -pthread -o MMS MMS.cpp matmul.cpp   (sin GUI, por consola)
+//
+// Uso: MMS [M K N | --dims=MxKxN] [--kernel=naive|blocked|strassen] [--simd=...]
+//          [--strassen-cutoff=N]
+//          [--type=int16|int32|int64|float|double] [--acc=int32|int64|float|double]
+//          [--seed=S] [--reps=R] [--json[=ruta]] [--out-dir=DIR] [--quiet]
+//          [--sweep=N1,N2,...]
+//
+// En Windows, sin argumentos abre la ventana; con argumentos corre en la
+// consola desde la que se lanzo, sin GUI. Ver cli.h.
 
 #include <iostream>
 #include <vector>
-#include <random>
 #include <chrono>
 #include <thread>
 #include <mutex>
 #include <atomic>
 #include <iomanip>
 #include <string>
+#include <algorithm>
+#include <fstream>
+#include <future>
 
 #ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
 #include <windows.h>
 #include <psapi.h>
 #include <tlhelp32.h>
@@ -25,8 +41,23 @@
 #pragma comment(linker, "/manifestdependency:\"type='win32' name='Microsoft.Windows.Common-Controls' version='6.0.0.0' processorArchitecture='*' publicKeyToken='6595b64144ccf1df' language='*'\"")
 #endif
 
-using Matrix = std::vector<std::vector<int>>;
-static constexpr int SEED = 42;
+#include "platform.h"
+#include "element.h"
+#include "matrix.h"
+#include "counter_rng.h"
+#include "matrix_file.h"
+#include "out_of_core.h"
+#include "gemm.h"
+#include "strassen.h"
+#include "sparse.h"
+#include "batched.h"
+#include "verify.h"
+#include "metrics.h"
+#include "matmul.h"
+#include "cli.h"
+#include "report_json.h"
+
+#ifdef _WIN32
 
 // ===================== Infraestructura GUI =====================
 
@@ -36,6 +67,7 @@ static constexpr int SEED = 42;
 #define IDC_RUN   104
 #define IDC_CLR   105
 #define IDC_OUT   106
+#define IDC_NAIVE 107
 #define IDT_TMR   1
 #define WM_DONE   (WM_USER + 1)
 
@@ -45,8 +77,12 @@ static HWND  g_hRun  = NULL;
 static HWND  g_hRows = NULL;
 static HWND  g_hCols = NULL;
 static HWND  g_hColB = NULL;
+static HWND  g_hNaive = NULL;
 static HFONT g_fMono = NULL;
 static HFONT g_fUI   = NULL;
+// Calculo en curso: WM_DONE recoge su codigo y WM_DESTROY espera a que acabe
+// (antes era un hilo suelto sin forma de saber como termino).
+static std::future<int> g_run;
 
 static std::mutex  g_mx;
 static std::string g_ob;
@@ -82,59 +118,35 @@ static void FlushGui() {
 
 static int GetEditInt(HWND h) { char b[32]; GetWindowTextA(h, b, 32); return atoi(b); }
 
+#endif
+
 // ===================== Funciones comunes =====================
 
-Matrix generate_matrix(int rows, int cols, std::mt19937& rng) {
-    std::uniform_int_distribution<int> dist(0, 9);
-    Matrix m(rows, std::vector<int>(cols));
-    for (int i = 0; i < rows; ++i)
-        for (int j = 0; j < cols; ++j)
-            m[i][j] = dist(rng);
+// Valores enteros 0..9 para cualquier T: mismo resultado exacto en todos
+// los tipos. El generador es por contador (counter_rng.h), asi que las
+// matrices son las mismas que genera MMP en paralelo con la misma semilla.
+template <class T>
+MatrixT<T> generate_matrix(int rows, int cols, unsigned seed, std::uint32_t stream, double density = 1.0) {
+    MatrixT<T> m = MatrixT<T>::uninitialized(rows, cols);
+    fill_random_sparse_digits(m.view(), 0, rows, seed, stream, density);
     return m;
 }
 
-void print_matrix(const Matrix& m, const std::string& name) {
+template <class T>
+void print_matrix(const MatrixT<T>& m, const std::string& name) {
+    std::ios_base::fmtflags flags = std::cout.flags();
+    std::streamsize prec = std::cout.precision();
+    std::cout << std::defaultfloat << std::setprecision(6);
     std::cout << "\nMatriz " << name << ":\n";
-    for (const auto& row : m) {
+    for (int i = 0; i < m.rows(); ++i) {
+        const T* r = m.row(i);
         std::cout << "  ";
-        for (int v : row)
-            std::cout << std::setw(4) << v << "  ";
+        for (int j = 0; j < m.cols(); ++j)
+            std::cout << std::setw(4) << r[j] << "  ";
         std::cout << "\n";
     }
-}
-
-Matrix multiply(const Matrix& A, const Matrix& B) {
-    int rows_a = (int)A.size();
-    int cols_a = (int)A[0].size();
-    int cols_b = (int)B[0].size();
-    Matrix C(rows_a, std::vector<int>(cols_b, 0));
-    for (int i = 0; i < rows_a; ++i)
-        for (int j = 0; j < cols_b; ++j)
-            for (int k = 0; k < cols_a; ++k)
-                C[i][j] += A[i][k] * B[k][j];
-    return C;
-}
-
-double get_memory_mb() {
-#ifdef _WIN32
-    PROCESS_MEMORY_COUNTERS pmc;
-    if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
-        return pmc.WorkingSetSize / (1024.0 * 1024.0);
-#endif
-    return 0.0;
-}
-
-double get_process_cpu_time() {
-#ifdef _WIN32
-    FILETIME c, e, k, u;
-    if (GetProcessTimes(GetCurrentProcess(), &c, &e, &k, &u)) {
-        ULARGE_INTEGER ki, ui;
-        ki.LowPart = k.dwLowDateTime; ki.HighPart = k.dwHighDateTime;
-        ui.LowPart = u.dwLowDateTime; ui.HighPart = u.dwHighDateTime;
-        return (ki.QuadPart + ui.QuadPart) / 10000000.0;
-    }
-#endif
-    return 0.0;
+    std::cout.flags(flags);
+    std::cout.precision(prec);
 }
 
 // ===================== FUNCIONES DE INFORMACION DEL PROCESO =====================
@@ -550,26 +562,93 @@ void mostrar_llamadas_sistema() {
 
 struct Sample { double cpu_pct; double mem_mb; };
 
-static void RunComputation(int rows_a, int cols_a, int cols_b) {
-    std::cout << std::unitbuf;
-    std::cout << "=== MULTIPLICACION DE MATRICES - SECUENCIAL (C++) ===\n\n";
-    std::cout << "Filas de A: " << rows_a << "\n";
-    std::cout << "Columnas de A (= Filas de B): " << cols_a << "\n";
-    std::cout << "Columnas de B: " << cols_b << "\n";
+static double median_of(std::vector<double> v) {
+    if (v.empty()) return 0.0;
+    std::sort(v.begin(), v.end());
+    size_t h = v.size() / 2;
+    return v.size() % 2 ? v[h] : 0.5 * (v[h - 1] + v[h]);
+}
 
-    std::cout << "\nSemilla aleatoria: " << SEED << "\n";
-    std::mt19937 rng(SEED);
+// Con --reps la multiplicacion se repite sobre las mismas A y B y se informa
+// la mediana. Si json_path no esta vacio se escribe metricas_secuencial.json.
+template <class T, class Acc>
+static int RunComputationT(const CliOptions& opt, const Dims& dims, const std::string& json_path) {
+    const GemmKernel kernel = opt.kernel;
+    const int rows_a = dims[0], cols_a = dims[1], cols_b = dims[2];
 
-    std::cout << "Generando matrices...\n";
-    Matrix A = generate_matrix(rows_a, cols_a, rng);
-    Matrix B = generate_matrix(cols_a, cols_b, rng);
+    // Con --quiet el informe va a un stream sin buffer, que descarta todo
+    std::ostream null_out(nullptr);
+    std::ostream& out = opt.quiet ? null_out : std::cout;
 
-    if (rows_a <= 10 && cols_b <= 10) {
+    std::cout << std::unitbuf;
+    out << "=== MULTIPLICACION DE MATRICES - SECUENCIAL (C++) ===\n\n";
+    out << "Filas de A: " << rows_a << "\n";
+    out << "Columnas de A (= Filas de B): " << cols_a << "\n";
+    out << "Columnas de B: " << cols_b << "\n";
+    out << "Tipo: " << elem_name<T>() << " (acumulador " << elem_name<Acc>() << ")\n";
+    out << "Kernel: " << kernel_name(kernel);
+    if (kernel != GemmKernel::Naive) out << " (" << active_microkernel<Acc>().name << ")";
+    out << "\n";
+
+    // Motor de matmul.h en el hilo que llama (sin pool). El plan fija las
+    // teselas y, con Strassen, el cutoff (medido o fijado) y los buffers,
+    // reservados antes de medir
+    MultiplyOptions mo;
+    mo.threads = 1;
+    mo.caller_runs = true;
+    mo.kernel = kernel;
+    mo.simd = opt.simd;
+    mo.product = opt.product;
+    mo.strassen_cutoff = opt.strassen_cutoff;
+    Multiplier mult(mo);
+    if (kernel == GemmKernel::Strassen && opt.strassen_cutoff <= 0) out << "Calibrando cutoff de Strassen...\n";
+    MultiplyPlan<T, Acc> plan;
+    mult.plan(plan, rows_a, cols_a, cols_b);
+    if (kernel == GemmKernel::Strassen) out << "Strassen: " << strassen_plan_summary(plan.ws.plan()) << "\n";
+    if (opt.reps > 1) out << "Repeticiones: " << opt.reps << "\n";
+
+    // A y B se generan o, con --a / --b, se proyectan desde fichero sin copiar
+    std::string file_err;
+    MatrixT<T> A, B;
+    if (opt.a_file.empty() || opt.b_file.empty()) {
+        out << "\nSemilla aleatoria: " << opt.seed << "\n";
+        out << "Generando matrices...\n";
+    }
+    if (opt.a_file.empty()) A = generate_matrix<T>(rows_a, cols_a, opt.seed, RNG_STREAM_A, opt.density);
+    else if (!load_matrix_file(opt.a_file, A, file_err)) { std::cerr << file_err << "\n"; return 1; }
+    if (opt.b_file.empty()) B = generate_matrix<T>(cols_a, cols_b, opt.seed, RNG_STREAM_B, opt.density);
+    else if (!load_matrix_file(opt.b_file, B, file_err)) { std::cerr << file_err << "\n"; return 1; }
+    if (!opt.a_file.empty()) out << "A cargada de " << opt.a_file << "\n";
+    if (!opt.b_file.empty()) out << "B cargada de " << opt.b_file << "\n";
+    if (!opt.save_inputs.empty()) {
+        if (!save_matrix_file(opt.save_inputs + "_A.mmx", A, file_err) ||
+            !save_matrix_file(opt.save_inputs + "_B.mmx", B, file_err)) {
+            std::cerr << file_err << "\n";
+            return 1;
+        }
+        out << "A y B guardadas en " << opt.save_inputs << "_A.mmx y " << opt.save_inputs << "_B.mmx\n";
+    }
+
+    // Densidad de A y B y camino del producto; los operandos dispersos se
+    // convierten una vez, fuera de las repeticiones medidas
+    mult.route(plan, A.cview(), B.cview());
+    const ProductRoute& route = plan.route;
+    const std::int64_t nnz_a = route.nnz_a, nnz_b = route.nnz_b;
+    const double sparse_elapsed = plan.route_s;
+    out << std::fixed << std::setprecision(2)
+        << "No ceros: A " << nnz_a << " (" << 100.0 * route.density_a << "%), B "
+        << nnz_b << " (" << 100.0 * route.density_b << "%)\n"
+        << "Producto: " << product_path_label(route.path)
+        << (opt.product == ProductPath::Auto && kernel != GemmKernel::Strassen ? " (auto)" : "") << "\n";
+    if (route.path != ProductPath::Dense)
+        out << std::setprecision(6) << "Conversion a CSR/CSC: " << sparse_elapsed << " s\n";
+
+    if (!opt.quiet && rows_a <= 10 && cols_b <= 10) {
         print_matrix(A, "A");
         print_matrix(B, "B");
     }
 
-    std::cout << "\nIniciando multiplicacion secuencial con monitoreo...\n\n";
+    out << "\nIniciando multiplicacion secuencial con monitoreo...\n\n";
 
     std::vector<Sample> samples;
     std::mutex smtx;
@@ -578,6 +657,7 @@ static void RunComputation(int rows_a, int cols_a, int cols_b) {
     double cpu_before = get_process_cpu_time();
     double mem_before = get_memory_mb();
 
+    // Con --quiet sigue muestreando (para el JSON) pero no imprime
     std::thread monitor([&]() {
         double prev_cpu = get_process_cpu_time();
         auto prev_wall = std::chrono::steady_clock::now();
@@ -598,79 +678,205 @@ static void RunComputation(int rows_a, int cols_a, int cols_b) {
                 samples.push_back({pct, mem});
             }
 
-            std::cout << "  [Monitor] CPU: " << std::fixed << std::setprecision(1)
-                      << std::setw(6) << pct << "%  |  Memoria RAM: "
-                      << std::setprecision(2) << std::setw(8) << mem << " MB\n"
-                      << std::flush;
+            out << "  [Monitor] CPU: " << std::fixed << std::setprecision(1)
+                << std::setw(6) << pct << "%  |  Memoria RAM: "
+                << std::setprecision(2) << std::setw(8) << mem << " MB\n"
+                << std::flush;
 
             prev_cpu = cur_cpu;
             prev_wall = now;
         }
     });
 
-    auto t0 = std::chrono::steady_clock::now();
-    Matrix C = multiply(A, B);
-    auto t1 = std::chrono::steady_clock::now();
-    double elapsed = std::chrono::duration<double>(t1 - t0).count();
+    MatrixT<Acc> C(rows_a, cols_b);
+    MultiplyMetrics mm;
+    std::vector<double> rep_times;
+    for (int rep = 0; rep < opt.reps; ++rep) {
+        auto t0 = std::chrono::steady_clock::now();
+        mm = mult.run(plan, A.cview(), B.cview(), C.view());
+        auto t1 = std::chrono::steady_clock::now();
+        rep_times.push_back(std::chrono::duration<double>(t1 - t0).count());
+        if (opt.reps > 1)
+            out << std::fixed << std::setprecision(6) << "  Repeticion " << rep + 1 << "/"
+                << opt.reps << ": " << rep_times.back() << " s\n";
+    }
+    const double elapsed = median_of(rep_times);
+    const double gops = elapsed > 0 ? 2.0 * rows_a * cols_a * cols_b / elapsed / 1e9 : 0.0;
+    const long long nnz_c = mm.nnz_c;
+    // Strassen no cuenta sus operaciones: se toman las densas
+    const double done_ops = kernel == GemmKernel::Strassen ? 2.0 * rows_a * cols_a * cols_b : mm.ops;
 
     running.store(false);
     monitor.join();
 
     double cpu_after = get_process_cpu_time();
     double mem_after = get_memory_mb();
-    double cpu_used = cpu_after - cpu_before;
+    double cpu_used = (cpu_after - cpu_before) / opt.reps;
 
-    if (rows_a <= 10 && cols_b <= 10)
+    if (!opt.quiet && rows_a <= 10 && cols_b <= 10)
         print_matrix(C, "C = A x B");
 
-    std::cout << "\nDimensiones: A(" << rows_a << "x" << cols_a << ") x B("
-              << cols_a << "x" << cols_b << ") = C(" << rows_a << "x" << cols_b << ")\n";
-    std::cout << std::fixed << std::setprecision(6)
-              << "Tiempo de ejecucion: " << elapsed << " segundos\n";
-
-    std::cout << "\n========== RESUMEN DE METRICAS ==========\n";
-    std::cout << std::setprecision(6)
-              << "  Tiempo de ejecucion:    " << elapsed << " s\n"
-              << "  Tiempo CPU consumido:   " << cpu_used << " s\n"
-              << std::setprecision(2)
-              << "  Memoria antes:          " << mem_before << " MB\n"
-              << "  Memoria despues:        " << mem_after << " MB\n";
-
-    {
-        std::lock_guard<std::mutex> lk(smtx);
-        if (!samples.empty()) {
-            double sum_cpu = 0, max_cpu = 0;
-            double sum_mem = 0, max_mem = 0, min_mem = samples[0].mem_mb;
-            for (const auto& s : samples) {
-                sum_cpu += s.cpu_pct;
-                if (s.cpu_pct > max_cpu) max_cpu = s.cpu_pct;
-                sum_mem += s.mem_mb;
-                if (s.mem_mb > max_mem) max_mem = s.mem_mb;
-                if (s.mem_mb < min_mem) min_mem = s.mem_mb;
-            }
-            std::cout << "\n  -- Muestras en tiempo real --\n"
-                      << "  Muestras recolectadas:  " << samples.size() << "\n"
-                      << std::setprecision(1)
-                      << "  CPU promedio:           " << sum_cpu / samples.size() << "%\n"
-                      << "  CPU maximo:             " << max_cpu << "%\n"
-                      << std::setprecision(2)
-                      << "  Memoria promedio:       " << sum_mem / samples.size() << " MB\n"
-                      << "  Memoria maxima:         " << max_mem << " MB\n"
-                      << "  Memoria minima:         " << min_mem << " MB\n";
-        } else {
-            std::cout << "\n  (La multiplicacion termino muy rapido para capturar\n"
-                      << "   muestras en tiempo real. Use matrices mas grandes\n"
-                      << "   como 300x300 para ver el monitoreo en vivo.)\n";
-        }
+    // Freivalds y sumas por bloques (verify.h), las mismas que da MMP
+    VerifyResult verify;
+    if (opt.verify_rounds > 0) {
+        auto v_start = std::chrono::steady_clock::now();
+        FreivaldsCheck<T, Acc> chk(A.cview(), B.cview(), C.cview(), opt.verify_rounds, opt.seed);
+        chk.project_b(0, cols_a);
+        chk.check_rows(0, rows_a);
+        verify = chk.result();
+        verify.time_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - v_start).count();
+    }
+
+    if (!opt.c_file.empty()) {
+        if (!save_matrix_file(opt.c_file, C, file_err)) { std::cerr << file_err << "\n"; return 1; }
+        out << "C guardada en " << opt.c_file << "\n";
+    }
+
+    out << "\nDimensiones: A(" << rows_a << "x" << cols_a << ") x B("
+        << cols_a << "x" << cols_b << ") = C(" << rows_a << "x" << cols_b << ")\n";
+    out << std::fixed << std::setprecision(6)
+        << "Tiempo de ejecucion: " << elapsed << " segundos";
+    if (opt.reps > 1) out << " (mediana de " << opt.reps << ")";
+    out << "\n";
+
+    out << "\n========== RESUMEN DE METRICAS ==========\n";
+    out << std::setprecision(6)
+        << "  Tiempo de ejecucion:    " << elapsed << " s\n"
+        << "  Tiempo CPU consumido:   " << cpu_used << " s\n"
+        << std::setprecision(2)
+        << "  Rendimiento:            " << gops << " GOP/s"
+        << (route.path != ProductPath::Dense ? " (equivalente denso, 2*M*K*N)" : "") << "\n"
+        << "  Producto:               " << product_path_label(route.path) << "\n"
+        << "  No ceros de A / B:      " << nnz_a << " (" << 100.0 * route.density_a << "%) / "
+        << nnz_b << " (" << 100.0 * route.density_b << "%)\n";
+    if (route.path != ProductPath::Dense)
+        out << std::setprecision(6)
+            << "  Conversion a CSR/CSC:   " << sparse_elapsed << " s\n" << std::setprecision(2);
+    if (route.path == ProductPath::SparseSparse)
+        out << "  No ceros de C:          " << nnz_c << " (" << 100.0 * nnz_c / ((double)rows_a * cols_b) << "%)\n";
+    out << "  Memoria antes:          " << mem_before << " MB\n"
+        << "  Memoria despues:        " << mem_after << " MB\n"
+        << "  Memoria pico:           " << get_peak_memory_mb() << " MB\n";
+    if (opt.verify_rounds > 0) print_verify(out, verify, 24);
+
+    SampleStats cpu_stats, mem_stats;
+    for (const auto& s : samples) {
+        cpu_stats.add(s.cpu_pct);
+        mem_stats.add(s.mem_mb);
+    }
+    if (!samples.empty()) {
+        double min_mem = samples[0].mem_mb;
+        for (const auto& s : samples)
+            if (s.mem_mb < min_mem) min_mem = s.mem_mb;
+        out << "\n  -- Muestras en tiempo real --\n"
+            << "  Muestras recolectadas:  " << samples.size() << "\n"
+            << std::setprecision(1)
+            << "  CPU promedio:           " << cpu_stats.avg() << "%\n"
+            << "  CPU maximo:             " << cpu_stats.max << "%\n"
+            << std::setprecision(2)
+            << "  Memoria promedio:       " << mem_stats.avg() << " MB\n"
+            << "  Memoria maxima:         " << mem_stats.max << " MB\n"
+            << "  Memoria minima:         " << min_mem << " MB\n";
+    } else {
+        out << "\n  (La multiplicacion termino muy rapido para capturar\n"
+            << "   muestras en tiempo real. Use matrices mas grandes\n"
+            << "   como 300x300 para ver el monitoreo en vivo.)\n";
+    }
+
+    const double efficiency = elapsed > 0 ? (cpu_used / elapsed) * 100.0 : 0.0;
+    if (elapsed > 0)
+        out << std::setprecision(1)
+            << "\n  Eficiencia CPU:         " << efficiency << "%\n"
+            << "  (Un valor cercano a 100% indica uso completo de 1 core)\n";
+    out << "==========================================\n";
+
+    // Una linea por punto en --quiet (la que se lee en un barrido)
+    if (opt.quiet) {
+        std::cout << std::fixed << std::setprecision(6)
+                  << "MMS " << dims_label(dims) << " hilos=1"
+                  << " tipo=" << elem_name<T>() << "->" << elem_name<Acc>()
+                  << " kernel=" << kernel_name(kernel);
+        if (kernel == GemmKernel::Strassen) std::cout << " cutoff=" << plan.ws.plan().cutoff;
+        if (route.path != ProductPath::Dense) std::cout << " producto=" << product_path_name(route.path);
+        std::cout << " mediana=" << elapsed << " s"
+                  << std::setprecision(2) << " GOP/s=" << gops;
+        if (opt.verify_rounds > 0)
+            std::cout << " freivalds=" << (verify.ok ? "ok" : "ERROR") << " suma=" << checksum_hex(verify.combined);
+        std::cout << "\n";
     }
 
-    if (elapsed > 0) {
-        double efficiency = (cpu_used / elapsed) * 100.0;
-        std::cout << std::setprecision(1)
-                  << "\n  Eficiencia CPU:         " << efficiency << "%\n"
-                  << "  (Un valor cercano a 100% indica uso completo de 1 core)\n";
+    // ===================== JSON de resultados =====================
+    if (!json_path.empty()) {
+        std::ofstream f;
+        if (!open_json_file(json_path, f)) return 1;
+        ProcessCounters pc = read_process_counters();
+        JsonWriter w(f);
+        w.begin_object();
+        w.field("programa", "MMS.cpp");
+        w.field("tipo", "Secuencial (1 hilo, 1 core)");
+        w.field("fecha_ejecucion", current_datetime_iso());
+        json_sistema(w, read_system_info());
+
+        w.begin_object("configuracion");
+        w.field("filas_a", rows_a);
+        w.field("columnas_a", cols_a);
+        w.field("columnas_b", cols_b);
+        w.field("semilla", opt.seed);
+        if (!opt.a_file.empty()) w.field("fichero_a", opt.a_file);
+        if (!opt.b_file.empty()) w.field("fichero_b", opt.b_file);
+        if (!opt.c_file.empty()) w.field("fichero_c", opt.c_file);
+        w.field("tipo_elemento", elem_name<T>());
+        w.field("acumulador", elem_name<Acc>());
+        w.field("kernel", kernel_name(kernel));
+        if (kernel != GemmKernel::Naive) w.field("micro_kernel", plan.uk->name);
+        w.field("producto", product_path_name(route.path));
+        w.field("producto_forzado", opt.product != ProductPath::Auto);
+        if (opt.density < 1.0) w.field("densidad_generada", opt.density);
+        w.field("repeticiones", opt.reps);
+        w.end_object();
+        if (kernel == GemmKernel::Strassen) json_strassen(w, plan.ws.plan());
+        json_sparse(w, route, nnz_c, done_ops,
+                    route.path != ProductPath::Dense ? sparse_elapsed : 0.0);
+
+        w.begin_object("resultados");
+        w.field("tiempo_ejecucion_s", elapsed);
+        w.field("tiempo_cpu_consumido_s", cpu_used);
+        w.field("eficiencia_cpu_pct", efficiency);
+        w.inline_array("tiempos_s", rep_times);
+        w.field("tiempo_minimo_s", *std::min_element(rep_times.begin(), rep_times.end()));
+        w.field("gop_s", gops);
+        w.end_object();
+        if (opt.verify_rounds > 0) json_verify(w, verify);
+
+        w.begin_object("memoria");
+        w.field("ram_antes_mb", mem_before);
+        w.field("ram_despues_mb", mem_after);
+        json_memoria_contadores(w, pc);
+        w.end_object();
+
+        json_kernel(w, pc);
+        json_io(w, pc);
+        json_proceso(w, pc, true);
+
+        w.begin_object("monitoreo_tiempo_real");
+        w.begin_array("muestras");
+        for (const auto& s : samples) {
+            w.begin_object();
+            w.field("cpu_pct", s.cpu_pct);
+            w.field("memoria_mb", s.mem_mb);
+            w.end_object();
+        }
+        w.end_array();
+        w.field("cpu_promedio_pct", cpu_stats.avg());
+        w.field("cpu_maximo_pct", cpu_stats.max);
+        w.field("memoria_promedio_mb", mem_stats.avg());
+        w.field("memoria_maxima_mb", mem_stats.max);
+        w.end_object();
+        w.finish();
+        out << "\nMetricas guardadas en " << json_path << "\n";
     }
-    std::cout << "==========================================\n";
+
+    if (opt.quiet) return verify.ok ? 0 : 1;
 
 #ifdef _WIN32
     std::cout << "\n\n";
@@ -688,9 +894,271 @@ static void RunComputation(int rows_a, int cols_a, int cols_b) {
     mostrar_acceso_nucleo();
     mostrar_llamadas_sistema();
     mostrar_modulos_proceso();
+#elif defined(__linux__)
+    mostrar_recursos_proceso();
 #endif
+    return verify.ok ? 0 : 1;
 }
 
+// --out-of-core: A, B y C se quedan en disco y se multiplican por teselas
+// (out_of_core.h); aqui cada producto de teselas es un gemm de un hilo.
+template <class T, class Acc>
+static int RunOutOfCoreT(const CliOptions& opt, const Dims& dims, const std::string& json_path) {
+    const GemmKernel kernel = opt.kernel;
+    const int rows_a = dims[0], cols_a = dims[1], cols_b = dims[2];
+    std::ostream null_out(nullptr);
+    std::ostream& out = opt.quiet ? null_out : std::cout;
+
+    std::cout << std::unitbuf;
+    out << "=== MULTIPLICACION FUERA DE MEMORIA - SECUENCIAL (C++) ===\n\n";
+    out << "A: " << opt.a_file << " (" << rows_a << " x " << cols_a << ")\n";
+    out << "B: " << opt.b_file << " (" << cols_a << " x " << cols_b << ")\n";
+    out << "C: " << opt.c_file << "\n";
+    out << "Tipo: " << elem_name<T>() << " (acumulador " << elem_name<Acc>() << ")\n";
+    out << "Kernel: " << kernel_name(kernel) << "\n";
+    out << "Presupuesto de memoria: " << opt.mem_budget_mb << " MB\n";
+
+    const TileMultiply<T, Acc> multiply = [&](ConstMatrixViewT<T> a, ConstMatrixViewT<T> b, MatrixViewT<Acc> c) {
+        gemm(kernel, a, b, c);
+    };
+    OutOfCoreStats st;
+    std::string err;
+    if (!gemm_out_of_core<T, Acc>(opt.a_file, opt.b_file, opt.c_file,
+                                  (std::size_t)opt.mem_budget_mb * 1024 * 1024, multiply, st, err)) {
+        std::cerr << err << "\n";
+        return 1;
+    }
+    const double ops = 2.0 * rows_a * cols_a * cols_b;
+    out << "\n--- Resultado ---\n";
+    print_out_of_core(out, st, ops);
+    out << "C guardada en " << opt.c_file << "\n";
+
+    if (opt.quiet)
+        std::cout << std::fixed << std::setprecision(6)
+                  << "MMS " << dims_label(dims) << " hilos=1"
+                  << " tipo=" << elem_name<T>() << "->" << elem_name<Acc>()
+                  << " kernel=" << kernel_name(kernel) << " fuera_de_memoria"
+                  << " total=" << st.total_s << " s espera_es=" << st.wait_s << " s"
+                  << std::setprecision(2) << " GOP/s=" << (st.compute_s > 0 ? ops / st.compute_s / 1e9 : 0.0) << "\n";
+
+    if (!json_path.empty()) {
+        std::ofstream f;
+        if (!open_json_file(json_path, f)) return 1;
+        ProcessCounters pc = read_process_counters();
+        JsonWriter w(f);
+        w.begin_object();
+        w.field("programa", "MMS.cpp");
+        w.field("tipo", "Secuencial fuera de memoria (teselas desde disco)");
+        w.field("fecha_ejecucion", current_datetime_iso());
+        json_sistema(w, read_system_info());
+
+        w.begin_object("configuracion");
+        w.field("filas_a", rows_a);
+        w.field("columnas_a", cols_a);
+        w.field("columnas_b", cols_b);
+        w.field("fichero_a", opt.a_file);
+        w.field("fichero_b", opt.b_file);
+        w.field("fichero_c", opt.c_file);
+        w.field("tipo_elemento", elem_name<T>());
+        w.field("acumulador", elem_name<Acc>());
+        w.field("kernel", kernel_name(kernel));
+        if (kernel != GemmKernel::Naive) w.field("micro_kernel", active_microkernel<Acc>().name);
+        w.field("presupuesto_memoria_mb", opt.mem_budget_mb);
+        w.end_object();
+
+        json_out_of_core(w, st, ops);
+
+        w.begin_object("memoria");
+        w.field("ram_final_mb", get_memory_mb());
+        json_memoria_contadores(w, pc);
+        w.end_object();
+
+        json_io(w, pc);
+        json_proceso(w, pc, true);
+        w.finish();
+        out << "\nMetricas guardadas en " << json_path << "\n";
+    }
+    return 0;
+}
+
+// --batch: L productos independientes de MxKxN (batched.h), uno tras otro en
+// un hilo; la referencia de productos por segundo para MMP.
+template <class T, class Acc>
+static int RunBatchedT(const CliOptions& opt, const Dims& dims, const std::string& json_path) {
+    const int count = opt.batch;
+    const int m = dims[0], k = dims[1], n = dims[2];
+    std::ostream null_out(nullptr);
+    std::ostream& out = opt.quiet ? null_out : std::cout;
+    const SmallGemmKernel<T, Acc> kr = small_gemm_kernel<T, Acc>(m, k, n);
+    const std::string kernel_desc = kr.fixed
+        ? "desenrollado " + std::to_string(kr.size) + "x" + std::to_string(kr.size) + "x" + std::to_string(kr.size)
+        : std::string("generico");
+
+    std::cout << std::unitbuf;
+    out << "=== LOTE DE PRODUCTOS PEQUENOS - SECUENCIAL (C++) ===\n\n";
+    out << "Productos: " << count << " de " << m << "x" << k << " x " << k << "x" << n << "\n";
+    out << "Tipo: " << elem_name<T>() << " (acumulador " << elem_name<Acc>() << ")\n";
+    out << "Kernel: " << kernel_desc << "\n";
+    if (opt.reps > 1) out << "Repeticiones: " << opt.reps << "\n";
+    out << "\nSemilla aleatoria: " << opt.seed << "\n";
+    out << "Generando lotes...\n";
+
+    BatchT<T> A = BatchT<T>::uninitialized(count, m, k), B = BatchT<T>::uninitialized(count, k, n);
+    BatchT<Acc> C = BatchT<Acc>::uninitialized(count, m, n);
+    fill_random_sparse_digits(A.as_rows(), 0, count * m, opt.seed, RNG_STREAM_A, opt.density);
+    fill_random_sparse_digits(B.as_rows(), 0, count * k, opt.seed, RNG_STREAM_B, opt.density);
+    std::memset(C.data(), 0, C.size_bytes());
+
+    std::vector<double> rep_times;
+    for (int rep = 0; rep < opt.reps; ++rep) {
+        auto t0 = std::chrono::steady_clock::now();
+        gemm_batch_range(A, B, C, kr, 0, count);
+        rep_times.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count());
+        if (opt.reps > 1)
+            out << std::fixed << std::setprecision(6) << "  Repeticion " << rep + 1 << "/" << opt.reps << ": "
+                << rep_times.back() << " s\n";
+    }
+    const double elapsed = median_of(rep_times);
+    const double products_per_s = elapsed > 0 ? count / elapsed : 0.0;
+    const double gops = elapsed > 0 ? 2.0 * m * k * n * (double)count / elapsed / 1e9 : 0.0;
+
+    // Unos productos contra el triple bucle de referencia
+    bool verified = true;
+    for (int i : { 0, count / 2, count - 1 }) {
+        MatrixT<Acc> ref(m, n);
+        gemm_naive(A.matrix_view(i), B.matrix_view(i), ref.view());
+        for (int r = 0; r < m && verified; ++r)
+            verified = std::memcmp(ref.row(r), C.matrix(i) + (std::size_t)r * n, (std::size_t)n * sizeof(Acc)) == 0;
+    }
+
+    out << "\n--- Resultado ---\n" << std::fixed << std::setprecision(6)
+        << "  Tiempo del lote:        " << elapsed << " s";
+    if (opt.reps > 1) out << " (mediana de " << opt.reps << ")";
+    out << "\n" << std::setprecision(0)
+        << "  Productos por segundo:  " << products_per_s << "\n"
+        << std::setprecision(3)
+        << "  Tiempo por producto:    " << (count > 0 ? elapsed / count * 1e9 : 0.0) << " ns\n"
+        << std::setprecision(2)
+        << "  Rendimiento:            " << gops << " GOP/s\n"
+        << "  Comprobacion:           " << (verified ? "correcta" : "ERROR") << "\n";
+
+    if (opt.quiet)
+        std::cout << std::fixed << std::setprecision(6)
+                  << "MMS lote=" << count << "x" << dims_label(dims) << " hilos=1"
+                  << " tipo=" << elem_name<T>() << "->" << elem_name<Acc>()
+                  << " kernel=" << (kr.fixed ? "desenrollado" : "generico")
+                  << " mediana=" << elapsed << " s"
+                  << std::setprecision(0) << " productos/s=" << products_per_s
+                  << std::setprecision(2) << " GOP/s=" << gops << "\n";
+
+    if (!json_path.empty()) {
+        std::ofstream f;
+        if (!open_json_file(json_path, f)) return 1;
+        ProcessCounters pc = read_process_counters();
+        JsonWriter w(f);
+        w.begin_object();
+        w.field("programa", "MMS.cpp");
+        w.field("tipo", "Secuencial por lotes (productos pequenos independientes)");
+        w.field("fecha_ejecucion", current_datetime_iso());
+        json_sistema(w, read_system_info());
+
+        w.begin_object("configuracion");
+        w.field("productos", count);
+        w.field("filas_a", m);
+        w.field("columnas_a", k);
+        w.field("columnas_b", n);
+        w.field("semilla", opt.seed);
+        if (opt.density < 1.0) w.field("densidad_generada", opt.density);
+        w.field("tipo_elemento", elem_name<T>());
+        w.field("acumulador", elem_name<Acc>());
+        w.field("kernel", kernel_desc);
+        w.field("repeticiones", opt.reps);
+        w.end_object();
+
+        w.begin_object("resultados");
+        w.field("tiempo_lote_s", elapsed);
+        w.inline_array("tiempos_s", rep_times);
+        w.field("productos_por_s", products_per_s);
+        w.field("gop_s", gops);
+        w.field("comprobacion_correcta", verified);
+        w.end_object();
+
+        w.begin_object("memoria");
+        w.field("ram_final_mb", get_memory_mb());
+        json_memoria_contadores(w, pc);
+        w.end_object();
+        json_proceso(w, pc, true);
+        w.finish();
+        out << "\nMetricas guardadas en " << json_path << "\n";
+    }
+    return verified ? 0 : 1;
+}
+
+// Instancia el calculo para la pareja de tipos de opt (por defecto int32
+// con acumulador int64, que no desborda con dimensiones grandes).
+static int RunComputation(const CliOptions& opt, const Dims& dims, const std::string& json_path = "") {
+    int rc = 1;
+    dispatch_elem_types(opt.type, opt.acc, [&](auto t, auto a) {
+        using T = typename decltype(t)::type;
+        using Acc = typename decltype(a)::type;
+        if (opt.batch > 0)        rc = RunBatchedT<T, Acc>(opt, dims, json_path);
+        else if (opt.out_of_core) rc = RunOutOfCoreT<T, Acc>(opt, dims, json_path);
+        else                      rc = RunComputationT<T, Acc>(opt, dims, json_path);
+    });
+    return rc;
+}
+
+// Modo linea de comandos (Linux siempre; Windows cuando hay argumentos).
+// Sin dimensiones ni barrido las pide por consola.
+static int RunFromCommandLine(int argc, char** argv) {
+    CliOptions opt;
+    std::string bad;
+    if (!parse_cli(argc, argv, false, opt, bad)) {
+        std::cerr << "Argumento no reconocido o no soportado por esta CPU: " << bad << "\n";
+        print_usage("MMS", false);
+        return CLI_EXIT_USAGE;
+    }
+    std::string file_err;
+    if (!load_input_headers(opt, file_err)) {
+        std::cerr << "Error: " << file_err << "\n";
+        return CLI_EXIT_INPUT;
+    }
+    set_active_isa(opt.simd);
+
+    // --- Barrido de tamanos, un JSON por punto ---
+    if (opt.sweep()) {
+        ensure_dir(opt.out_dir);
+        int rc = 0;
+        for (const Dims& d : opt.sweep_sizes)
+            rc |= RunComputation(opt, d, opt.out_dir + "/metricas_secuencial_" + dims_label(d) + "_t1.json");
+        return rc;
+    }
+
+    Dims dims = opt.dims;
+    if (!opt.dims_given) {
+        std::cout << "Filas de A: " << std::flush;                    std::cin >> dims[0];
+        std::cout << "Columnas de A (= Filas de B): " << std::flush;  std::cin >> dims[1];
+        std::cout << "Columnas de B: " << std::flush;                  std::cin >> dims[2];
+        std::cout << "\n";
+        if (!std::cin || dims[0] <= 0 || dims[1] <= 0 || dims[2] <= 0) {
+            std::cerr << "Todas las dimensiones deben ser mayores a 0.\n";
+            return 1;
+        }
+    }
+    std::string json_path;
+    if (opt.json) {
+        if (opt.json_path.empty()) {
+            ensure_dir(opt.out_dir);
+            json_path = opt.out_dir + "/metricas_secuencial.json";
+        } else {
+            json_path = opt.json_path;
+        }
+    }
+    return RunComputation(opt, dims, json_path);
+}
+
+#ifdef _WIN32
+
 // ===================== Procedimiento de ventana =====================
 
 static LRESULT CALLBACK WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam) {
@@ -737,6 +1205,11 @@ static LRESULT CALLBACK WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lPara
             hWnd, (HMENU)IDC_CLR, hI, NULL);
         SendMessageA(hClr, WM_SETFONT, (WPARAM)g_fUI, TRUE);
 
+        g_hNaive = CreateWindowExA(0, "BUTTON", "Kernel ingenuo (i-j-k, sin bloques)",
+            WS_CHILD|WS_VISIBLE|BS_AUTOCHECKBOX, 330, 56, 280, 22,
+            hWnd, (HMENU)IDC_NAIVE, hI, NULL);
+        SendMessageA(g_hNaive, WM_SETFONT, (WPARAM)g_fUI, TRUE);
+
         RECT rc; GetClientRect(hWnd, &rc);
         g_hOut = CreateWindowExA(WS_EX_CLIENTEDGE, "EDIT", "",
             WS_CHILD|WS_VISIBLE|WS_VSCROLL|WS_HSCROLL|
@@ -778,12 +1251,17 @@ static LRESULT CALLBACK WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lPara
                     "Error de entrada", MB_OK|MB_ICONERROR);
                 return 0;
             }
+            GemmKernel kn = (SendMessageA(g_hNaive, BM_GETCHECK, 0, 0) == BST_CHECKED)
+                                ? GemmKernel::Naive : GemmKernel::Blocked;
             EnableWindow(g_hRun, FALSE);
             SetWindowTextA(g_hRun, "Calculando...");
-            std::thread([ra, ca, cb]() {
-                RunComputation(ra, ca, cb);
+            g_run = std::async(std::launch::async, [ra, ca, cb, kn]() {
+                CliOptions opt;
+                opt.kernel = kn;
+                int rc = RunComputation(opt, Dims{ ra, ca, cb });
                 PostMessageA(g_hWnd, WM_DONE, 0, 0);
-            }).detach();
+                return rc;
+            });
             return 0;
         }
         case IDC_CLR:
@@ -793,12 +1271,15 @@ static LRESULT CALLBACK WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lPara
         break;
 
     case WM_DONE:
+        if (g_run.valid() && g_run.get() != 0)
+            MessageBoxA(hWnd, "El calculo termino con errores (ver la salida).", "Error", MB_OK|MB_ICONERROR);
         FlushGui();
         EnableWindow(g_hRun, TRUE);
         SetWindowTextA(g_hRun, "Ejecutar");
         return 0;
 
     case WM_DESTROY:
+        if (g_run.valid()) g_run.wait();
         KillTimer(hWnd, IDT_TMR);
         if (g_fMono) { DeleteObject(g_fMono); g_fMono = NULL; }
         if (g_fUI)   { DeleteObject(g_fUI);   g_fUI = NULL; }
@@ -811,6 +1292,20 @@ static LRESULT CALLBACK WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lPara
 // ===================== Punto de entrada =====================
 
 int WINAPI WinMain(HINSTANCE hInst, HINSTANCE, LPSTR, int nShow) {
+    // Con argumentos: modo no interactivo en la consola del proceso padre
+    // (o una nueva si se lanzo sin consola), para scripts y barridos.
+    if (__argc > 1) {
+        if (!AttachConsole(ATTACH_PARENT_PROCESS)) AllocConsole();
+        FILE* f = nullptr;
+        freopen_s(&f, "CONOUT$", "w", stdout);
+        freopen_s(&f, "CONOUT$", "w", stderr);
+        freopen_s(&f, "CONIN$", "r", stdin);
+        std::cout.clear();
+        std::cerr.clear();
+        std::cin.clear();
+        return RunFromCommandLine(__argc, __argv);
+    }
+
     std::cout.rdbuf(&g_gbuf);
 
     WNDCLASSEXA wc = {};
@@ -840,3 +1335,15 @@ int WINAPI WinMain(HINSTANCE hInst, HINSTANCE, LPSTR, int nShow) {
     }
     return (int)msg.wParam;
 }
+
+#else
+
+// ===================== Punto de entrada (consola, sin Win32) =====================
+
+// Fuera de Windows no hay ventana: todo se pasa por argumentos (ver cli.h)
+// o las dimensiones se piden por consola.
+int main(int argc, char** argv) {
+    return RunFromCommandLine(argc, argv);
+}
+
+#endif
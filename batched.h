@@ -0,0 +1,141 @@
+// Lotes de productos pequenos independientes: C[i] = A[i] x B[i].
+//
+// Con matrices de 4x4 a 64x64 repartir las filas de un solo producto entre
+// hilos no compensa (microsegundos de trabajo por despertar). Aqui cada hilo
+// hace productos completos: los lotes viven en un buffer contiguo con un
+// paso fijo entre matrices (como gemmStridedBatched de BLAS) y los hilos
+// toman trozos de productos de un contador atomico.
+//
+//   BatchT<T>              count matrices rows x cols seguidas, sin relleno
+//   small_gemm_fixed<M,K,N> producto con tamanos en tiempo de compilacion: el
+//                          compilador desenrolla k y vectoriza j por completo
+//   small_gemm_kernel()    kernel para (m, k, n): fijo si el tamano esta en la
+//                          tabla (cuadradas de 2 a 64), generico si no
+//   gemm_batch_range()     productos [first, last) del lote
+//   batch_chunk()          productos por trozo del contador compartido
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+
+#include "matrix.h"
+
+// ===================== Lote contiguo =====================
+
+template <class T>
+class BatchT {
+public:
+    BatchT() = default;
+
+    // Reserva sin escribir (cada hilo toca primero los productos que genera).
+    static BatchT uninitialized(int count, int rows, int cols) {
+        BatchT b;
+        b.count_ = count;
+        b.rows_ = rows;
+        b.cols_ = cols;
+        b.buf_.reset(static_cast<T*>(aligned_malloc(std::max<std::size_t>(b.size_bytes(), 1))));
+        return b;
+    }
+
+    int count() const { return count_; }
+    int rows() const { return rows_; }
+    int cols() const { return cols_; }
+    int ld() const { return cols_; }                            // elementos por fila
+    std::size_t stride() const { return (std::size_t)rows_ * cols_; }  // entre matrices
+    std::size_t size_bytes() const { return (std::size_t)count_ * stride() * sizeof(T); }
+
+    T* data() { return buf_.get(); }
+    const T* data() const { return buf_.get(); }
+    T* matrix(int i) { return buf_.get() + (std::size_t)i * stride(); }
+    const T* matrix(int i) const { return buf_.get() + (std::size_t)i * stride(); }
+
+    // Todo el lote como una matriz (count * rows) x cols, p. ej. para generarlo
+    // con fill_random_digits por tramos de filas.
+    MatrixViewT<T> as_rows() { return { buf_.get(), count_ * rows_, cols_, cols_ }; }
+    ConstMatrixViewT<T> matrix_view(int i) const { return { matrix(i), rows_, cols_, cols_ }; }
+
+private:
+    int count_ = 0, rows_ = 0, cols_ = 0;
+    std::unique_ptr<T[], AlignedDeleter> buf_;
+};
+
+// ===================== Kernels =====================
+
+// Fila a fila: la fila i de C se acumula en un array local de N elementos
+// (registros para N pequeno) y se escribe una sola vez.
+template <int M, int K, int N, class T, class Acc>
+inline void small_gemm_fixed(const T* A, const T* B, Acc* C) {
+    for (int i = 0; i < M; ++i) {
+        Acc row[N] = {};
+        const T* a = A + i * K;
+        for (int k = 0; k < K; ++k) {
+            const Acc aik = static_cast<Acc>(a[k]);
+            const T* b = B + k * N;
+            for (int j = 0; j < N; ++j) row[j] += aik * static_cast<Acc>(b[j]);
+        }
+        for (int j = 0; j < N; ++j) C[i * N + j] = row[j];
+    }
+}
+
+// El mismo bucle con tamanos en tiempo de ejecucion (lo que no esta en la tabla).
+template <class T, class Acc>
+inline void small_gemm_generic(int m, int k, int n, const T* A, const T* B, Acc* C) {
+    for (int i = 0; i < m; ++i) {
+        Acc* c = C + (std::size_t)i * n;
+        std::fill(c, c + n, Acc(0));
+        const T* a = A + (std::size_t)i * k;
+        for (int p = 0; p < k; ++p) {
+            const Acc aip = static_cast<Acc>(a[p]);
+            const T* b = B + (std::size_t)p * n;
+            for (int j = 0; j < n; ++j) c[j] += aip * static_cast<Acc>(b[j]);
+        }
+    }
+}
+
+template <class T, class Acc>
+struct SmallGemmKernel {
+    void (*fixed)(const T*, const T*, Acc*) = nullptr;     // nulo = generico
+    int size = 0;                                           // lado del fijo
+};
+
+// Kernel para (m, k, n): desenrollado si es cuadrado de un lado de la tabla.
+template <class T, class Acc>
+inline SmallGemmKernel<T, Acc> small_gemm_kernel(int m, int k, int n) {
+    SmallGemmKernel<T, Acc> kr;
+    if (m != k || k != n) return kr;
+    switch (m) {
+#define MM_SMALL_GEMM_CASE(S) case S: kr.fixed = &small_gemm_fixed<S, S, S, T, Acc>; break;
+        MM_SMALL_GEMM_CASE(2)  MM_SMALL_GEMM_CASE(3)  MM_SMALL_GEMM_CASE(4)  MM_SMALL_GEMM_CASE(5)
+        MM_SMALL_GEMM_CASE(6)  MM_SMALL_GEMM_CASE(7)  MM_SMALL_GEMM_CASE(8)  MM_SMALL_GEMM_CASE(12)
+        MM_SMALL_GEMM_CASE(16) MM_SMALL_GEMM_CASE(24) MM_SMALL_GEMM_CASE(32) MM_SMALL_GEMM_CASE(48)
+        MM_SMALL_GEMM_CASE(64)
+#undef MM_SMALL_GEMM_CASE
+        default: return kr;
+    }
+    kr.size = m;
+    return kr;
+}
+
+// C[i] = A[i] x B[i] para i en [first, last).
+template <class T, class Acc>
+inline void gemm_batch_range(const BatchT<T>& A, const BatchT<T>& B, BatchT<Acc>& C,
+                             const SmallGemmKernel<T, Acc>& kr, int first, int last) {
+    const int m = A.rows(), k = A.cols(), n = B.cols();
+    if (kr.fixed) {
+        for (int i = first; i < last; ++i) kr.fixed(A.matrix(i), B.matrix(i), C.matrix(i));
+    } else {
+        for (int i = first; i < last; ++i) small_gemm_generic(m, k, n, A.matrix(i), B.matrix(i), C.matrix(i));
+    }
+}
+
+// Productos por trozo: unos 8 trozos por hilo para equilibrar, sin bajar de
+// ~64k multiplicaciones-suma por trozo (el contador atomico no debe dominar).
+inline int batch_chunk(int count, int workers, int m, int k, int n) {
+    const long long madds = std::max(1LL, (long long)m * k * n);
+    const long long min_chunk = std::max(1LL, 65536 / madds);
+    const long long balanced = std::max(1LL, (long long)count / (std::max(workers, 1) * 8LL));
+    return (int)std::min<long long>(std::max(min_chunk, std::min(balanced, 4096LL)), std::max(count, 1));
+}
@@ -0,0 +1,445 @@
+// Linea de comandos comun a MMS y MMP.
+//
+// Todo se puede pasar por argumentos, de modo que los programas corren sin
+// interaccion (scripts, ejecuciones nocturnas). Si no se dan dimensiones ni
+// barrido, se piden por consola como antes.
+//
+//   --dims=MxKxN | --dims=N      A(M x K) x B(K x N); N sola = cuadradas
+//   M K N                        (posicional, equivalente a --dims)
+//   --threads=T                  hilos (solo MMP; por defecto los cores logicos)
+//   --kernel=naive|blocked|strassen
+//   --strassen-cutoff=N          lado minimo de las hojas (por defecto se mide)
+//   --simd=auto|scalar|sse41|avx2|avx512
+//   --park=spin|block|hybrid     (solo MMP)
+//   --monitor=on|off             (solo MMP)
+//   --pin=compact|scatter|physical-only|cache-group
+//                                afinidad de los hilos (solo MMP; ver topology.h)
+//   --numa=replicate|interleave  B por nodo NUMA: una copia o intercalada (solo MMP)
+//   --type=int16|int32|int64|float|double   --acc=int32|int64|float|double
+//   --seed=S                     semilla de las matrices (por defecto 42)
+//   --reps=R                     repeticiones medidas (se informa la mediana)
+//   --json[=ruta]                escribe el JSON de resultados/ (por defecto
+//                                <out-dir>/metricas_{paralelo,secuencial}.json)
+//   --sweep=S1,S2,...            barrido de tamanos (cada uno N o MxKxN)
+//   --sweep-threads=T1,T2,...    barrido de hilos (solo MMP)
+//   --out-dir=DIR                carpeta de los JSON (por defecto resultados)
+//   --quiet                      sin tablas ni monitor: una linea por ejecucion
+//   --a=ruta --b=ruta            A y/o B desde ficheros .mmx (matrix_file.h); las
+//                                dimensiones y el tipo salen de los ficheros
+//   --c=ruta                     escribe C en un fichero .mmx
+//   --save-inputs=prefijo        guarda A y B en <prefijo>_A.mmx y <prefijo>_B.mmx
+//   --out-of-core                A, B y C se quedan en disco y se recorren por
+//                                teselas (out_of_core.h); necesita --a, --b y --c
+//   --mem-budget=MB              memoria para las teselas (por defecto 1024)
+//   --density=D                  fraccion de no ceros de A y B generadas (0 < D <= 1;
+//                                por defecto 1: digitos 0..9 como siempre)
+//   --product=auto|dense|sparse-dense|dense-sparse|sparse-sparse
+//                                camino del producto (sparse.h); auto lo elige con
+//                                las densidades de A y B. Sin --product, un
+//                                --kernel explicito fija el camino denso
+//   --batch=L                    lote de L productos independientes de MxKxN
+//                                (batched.h); se informa en productos/s
+//   --pipeline[=D]               A y C por paneles de filas en una tuberia
+//                                (pipeline.h): generar/cargar, multiplicar,
+//                                verificar y escribir a la vez sobre paneles
+//                                distintos, como mucho D en curso (por
+//                                defecto uno por etapa; solo MMP)
+//   --panel-rows=R               filas por panel de --pipeline
+//   --verify[=R]                 comprueba C con R rondas de Freivalds (verify.h;
+//                                por defecto 10, como mucho 64) y da sumas por
+//                                bloques de filas comparables entre MMS y MMP
+//   --jobs=J                     J multiplicaciones de MxKxN enviadas a la cola
+//                                asincrona (matmul.h): se generan A y B de una
+//                                mientras el pool multiplica otra (solo MMP)
+//   --trace=ruta                 traza de eventos por hilo en formato Chrome
+//                                trace (trace.h) para abrir en Perfetto; las
+//                                muestras del monitor van a la traza en lugar
+//                                de a la consola (solo MMP)
+//   --trace-level=coarse|fine    fases por hilo (por defecto) o ademas cada
+//                                tesela y cada robo
+//
+// En modo barrido cada punto (tamano x hilos) escribe su propio JSON en
+// <out-dir>/metricas_<programa>_<M>x<K>x<N>_t<T>.json.
+//
+// parse_cli solo mira el texto de los argumentos (y que la CPU tenga el
+// --simd pedido); no abre ficheros ni cambia el estado del proceso. Despues
+// load_input_headers lee las cabeceras de --a/--b, con su propio mensaje
+// ("Error: <fichero>: <motivo>") y su propio codigo de salida.
+
+#pragma once
+
+#include <array>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "element.h"
+#include "gemm.h"
+#include "matrix_file.h"
+#include "microkernel.h"
+#include "numa.h"
+#include "sparse.h"
+#include "topology.h"
+#include "thread_pool.h"
+#include "trace.h"
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+using Dims = std::array<int, 3>;   // filas A, columnas A (= filas B), columnas B
+
+// Codigos de salida de MMS y MMP
+constexpr int CLI_EXIT_USAGE = 1;          // argumentos no reconocidos (con la ayuda)
+constexpr int CLI_EXIT_INPUT = 2;          // --a/--b ilegibles o incompatibles
+
+struct CliOptions {
+    Dims dims = { 0, 0, 0 };
+    bool dims_given = false;
+    int threads = 0;                        // 0 = uno por core logico
+    GemmKernel kernel = GemmKernel::Blocked;
+    int strassen_cutoff = 0;                // 0 = calibrado al arrancar
+    SimdIsa simd = best_supported_isa();    // lo aplica main con set_active_isa
+    ParkPolicy park = ParkPolicy::Hybrid;
+    bool monitor_on = true;
+    PinPolicy pin = PinPolicy::Scatter;
+    NumaPolicy numa = NumaPolicy::Replicate;
+    ElemType type = ElemType::Int32;
+    ElemType acc = ElemType::Int64;
+    bool type_given = false, acc_given = false;
+    unsigned seed = 42;
+    int reps = 1;
+    bool json = false;
+    std::string json_path;                  // vacio = ruta por defecto
+    std::vector<Dims> sweep_sizes;
+    std::vector<int> sweep_threads;
+    std::string out_dir = "resultados";
+    bool quiet = false;
+    std::string a_file, b_file;             // vacio = generar
+    std::string c_file;                     // vacio = no guardar C
+    std::string save_inputs;                // prefijo para guardar A y B
+    bool out_of_core = false;
+    int mem_budget_mb = 1024;
+    double density = 1.0;
+    ProductPath product = ProductPath::Auto;
+    int batch = 0;                          // 0 = un solo producto
+    int jobs = 0;                           // 0 = sin cola asincrona
+    int verify_rounds = 0;                  // 0 = sin comprobar C
+    bool pipeline = false;
+    int pipeline_depth = 0;                 // 0 = una por etapa
+    int panel_rows = 0;                     // 0 = unos 16 paneles
+    std::string trace_path;                 // vacio = sin traza
+    TraceLevel trace_level = TraceLevel::Coarse;
+    bool trace_level_given = false;
+
+    bool sweep() const { return !sweep_sizes.empty() || !sweep_threads.empty(); }
+};
+
+// Entero decimal en [lo, INT_MAX]; fuera de rango (ERANGE o > INT_MAX) o con
+// restos tras los digitos se rechaza en lugar de truncar como atoi
+inline bool parse_int(const std::string& s, int lo, int& out) {
+    if (s.empty() || s.find_first_not_of("0123456789") != std::string::npos) return false;
+    char* end = nullptr;
+    errno = 0;
+    const long long v = std::strtoll(s.c_str(), &end, 10);
+    if (errno == ERANGE || *end != '\0' || v < lo || v > INT_MAX) return false;
+    out = (int)v;
+    return true;
+}
+
+// "300" -> 300x300x300, "200x300x400" -> {200, 300, 400}
+inline bool parse_dims(const std::string& s, Dims& d) {
+    std::vector<int> v;
+    size_t pos = 0;
+    while (pos <= s.size()) {
+        size_t x = s.find('x', pos);
+        std::string part = s.substr(pos, x == std::string::npos ? std::string::npos : x - pos);
+        int value = 0;
+        if (!parse_int(part, 1, value)) return false;
+        v.push_back(value);
+        if (x == std::string::npos) break;
+        pos = x + 1;
+    }
+    if (v.size() == 1) v = { v[0], v[0], v[0] };
+    if (v.size() != 3 || v[0] <= 0 || v[1] <= 0 || v[2] <= 0) return false;
+    d = { v[0], v[1], v[2] };
+    return true;
+}
+
+template <class F>
+inline bool parse_list(const std::string& s, F&& parse_item) {
+    size_t pos = 0;
+    while (pos <= s.size()) {
+        size_t comma = s.find(',', pos);
+        if (!parse_item(s.substr(pos, comma == std::string::npos ? std::string::npos : comma - pos)))
+            return false;
+        if (comma == std::string::npos) return true;
+        pos = comma + 1;
+    }
+    return false;
+}
+
+inline bool parse_positive(const std::string& s, int& out) {
+    return parse_int(s, 1, out);
+}
+
+// Entero sin signo de 32 bits (la semilla admite 0)
+inline bool parse_unsigned(const std::string& s, unsigned& out) {
+    if (s.empty() || s.size() > 10 || s.find_first_not_of("0123456789") != std::string::npos) return false;
+    const unsigned long long v = std::strtoull(s.c_str(), nullptr, 10);
+    if (v > 0xFFFFFFFFull) return false;
+    out = (unsigned)v;
+    return true;
+}
+
+inline void print_usage(const char* prog, bool parallel) {
+    std::cerr << "Uso: " << prog << " [M K N | --dims=MxKxN] [--kernel=naive|blocked|strassen]\n"
+              << "       [--strassen-cutoff=N] [--simd=auto|scalar|sse41|avx2|avx512]\n"
+              << "       [--type=int16|int32|int64|float|double] [--acc=int32|int64|float|double]\n"
+              << "       [--seed=S] [--reps=R] [--json[=ruta]] [--out-dir=DIR] [--quiet]\n"
+              << "       [--a=A.mmx] [--b=B.mmx] [--c=C.mmx] [--save-inputs=prefijo]\n"
+              << "       [--out-of-core] [--mem-budget=MB] [--density=D]\n"
+              << "       [--product=auto|dense|sparse-dense|dense-sparse|sparse-sparse] [--batch=L]\n"
+              << "       [--verify[=R]]\n"
+              << "       [--sweep=N1,N2,...|MxKxN,...]";
+    if (parallel)
+        std::cerr << " [--sweep-threads=T1,T2,...]\n"
+                  << "       [--threads=T] [--park=spin|block|hybrid] [--monitor=on|off]\n"
+                  << "       [--pin=compact|scatter|physical-only|cache-group] [--numa=replicate|interleave]\n"
+                  << "       [--jobs=J] [--pipeline[=D]] [--panel-rows=R]\n"
+                  << "       [--trace=ruta] [--trace-level=coarse|fine]";
+    std::cerr << "\n";
+}
+
+// Acumulador por defecto del tipo y combinacion soportada.
+inline bool check_elem_types(CliOptions& o, std::string& bad) {
+    if (!o.acc_given) o.acc = default_acc_type(o.type);
+    if (!elem_types_supported(o.type, o.acc)) {
+        bad = std::string("--type=") + elem_type_name(o.type) + " --acc=" + elem_type_name(o.acc);
+        return false;
+    }
+    return true;
+}
+
+// Devuelve false (con el argumento culpable en `bad`) si algo no se reconoce.
+// `parallel` habilita las opciones que solo tienen sentido en MMP.
+inline bool parse_cli(int argc, char** argv, bool parallel, CliOptions& o, std::string& bad) {
+    bool kernel_given = false, product_given = false;
+    std::vector<int> positional;
+    auto value = [](const std::string& arg, const char* name, std::string& v) {
+        std::string p = std::string(name) + "=";
+        if (arg.rfind(p, 0) != 0) return false;
+        v = arg.substr(p.size());
+        return true;
+    };
+    for (int a = 1; a < argc; ++a) {
+        std::string arg = argv[a], v;
+        bool ok = true;
+        if (value(arg, "--kernel", v))      ok = kernel_given = parse_kernel(v, o.kernel);
+        else if (value(arg, "--strassen-cutoff", v)) ok = parse_positive(v, o.strassen_cutoff);
+        else if (value(arg, "--simd", v))   ok = parse_isa(v, o.simd);
+        else if (value(arg, "--type", v))   ok = o.type_given = parse_elem_type(v, o.type);
+        else if (value(arg, "--acc", v))    ok = o.acc_given = parse_elem_type(v, o.acc);
+        else if (value(arg, "--dims", v))   ok = o.dims_given = parse_dims(v, o.dims);
+        else if (value(arg, "--seed", v))   ok = parse_unsigned(v, o.seed);
+        else if (value(arg, "--reps", v))   ok = parse_positive(v, o.reps);
+        else if (arg == "--json")           o.json = true;
+        else if (value(arg, "--json", v))   { o.json = true; o.json_path = v; ok = !v.empty(); }
+        else if (value(arg, "--out-dir", v)) { o.out_dir = v; ok = !v.empty(); }
+        else if (arg == "--quiet")          o.quiet = true;
+        else if (value(arg, "--a", v))      { o.a_file = v; ok = !v.empty(); }
+        else if (value(arg, "--b", v))      { o.b_file = v; ok = !v.empty(); }
+        else if (value(arg, "--c", v))      { o.c_file = v; ok = !v.empty(); }
+        else if (value(arg, "--save-inputs", v)) { o.save_inputs = v; ok = !v.empty(); }
+        else if (arg == "--out-of-core")    o.out_of_core = true;
+        else if (value(arg, "--mem-budget", v)) ok = parse_positive(v, o.mem_budget_mb);
+        else if (value(arg, "--density", v)) {
+            char* end = nullptr;
+            o.density = std::strtod(v.c_str(), &end);
+            ok = !v.empty() && *end == '\0' && o.density > 0.0 && o.density <= 1.0;
+        }
+        else if (value(arg, "--product", v)) ok = product_given = parse_product_path(v, o.product);
+        else if (value(arg, "--batch", v))  ok = parse_positive(v, o.batch);
+        else if (arg == "--verify")         o.verify_rounds = 10;
+        else if (value(arg, "--verify", v)) ok = parse_positive(v, o.verify_rounds) && o.verify_rounds <= 64;
+        else if (value(arg, "--sweep", v))
+            ok = parse_list(v, [&](const std::string& s) {
+                Dims d;
+                if (!parse_dims(s, d)) return false;
+                o.sweep_sizes.push_back(d);
+                return true;
+            });
+        else if (parallel && value(arg, "--sweep-threads", v))
+            ok = parse_list(v, [&](const std::string& s) {
+                int t;
+                if (!parse_positive(s, t)) return false;
+                o.sweep_threads.push_back(t);
+                return true;
+            });
+        else if (parallel && value(arg, "--threads", v)) ok = parse_positive(v, o.threads);
+        else if (parallel && value(arg, "--park", v))    ok = parse_park_policy(v, o.park);
+        else if (parallel && value(arg, "--pin", v))     ok = parse_pin_policy(v, o.pin);
+        else if (parallel && value(arg, "--numa", v))    ok = parse_numa_policy(v, o.numa);
+        else if (parallel && value(arg, "--jobs", v))    ok = parse_positive(v, o.jobs);
+        else if (parallel && arg == "--pipeline")        o.pipeline = true;
+        else if (parallel && value(arg, "--pipeline", v)) ok = o.pipeline = parse_positive(v, o.pipeline_depth);
+        else if (parallel && value(arg, "--panel-rows", v)) ok = parse_positive(v, o.panel_rows);
+        else if (parallel && value(arg, "--trace", v))   { o.trace_path = v; ok = !v.empty(); }
+        else if (parallel && value(arg, "--trace-level", v)) ok = o.trace_level_given = parse_trace_level(v, o.trace_level);
+        else if (parallel && arg == "--monitor=on")      o.monitor_on = true;
+        else if (parallel && arg == "--monitor=off")     o.monitor_on = false;
+        else {
+            int n;
+            ok = parse_positive(arg, n);
+            if (ok) positional.push_back(n);
+        }
+        if (!ok) { bad = arg; return false; }
+    }
+    if (!positional.empty()) {
+        if (positional.size() != 3) { bad = "(se esperan 3 dimensiones: M K N)"; return false; }
+        o.dims = { positional[0], positional[1], positional[2] };
+        o.dims_given = true;
+    }
+    // Quien elige un kernel quiere medir ese kernel (p. ej. naive para
+    // comparar): el camino disperso solo si tambien se pide con --product
+    if (kernel_given && !product_given) o.product = ProductPath::Dense;
+    // Fuera de memoria todo va y viene de ficheros: nada se genera ni se repite
+    if (o.out_of_core) {
+        if (o.a_file.empty() || o.b_file.empty() || o.c_file.empty()) { bad = "--out-of-core (necesita --a, --b y --c)"; return false; }
+        if (o.kernel == GemmKernel::Strassen) { bad = "--kernel=strassen (no se combina con --out-of-core)"; return false; }
+        if (o.reps > 1) { bad = "--reps (--out-of-core hace una sola pasada)"; return false; }
+        if (!o.save_inputs.empty()) { bad = "--save-inputs (con --out-of-core A y B ya estan en disco)"; return false; }
+        if (o.product != ProductPath::Auto && o.product != ProductPath::Dense) {
+            bad = "--product (--out-of-core solo tiene camino denso)";
+            return false;
+        }
+    }
+    // Un lote son muchos productos pequenos generados en memoria
+    if (o.batch > 0) {
+        if (!o.a_file.empty() || !o.b_file.empty() || !o.c_file.empty() || !o.save_inputs.empty()) {
+            bad = "--batch (no se combina con --a/--b/--c/--save-inputs)";
+            return false;
+        }
+        if (o.out_of_core) { bad = "--batch (no se combina con --out-of-core)"; return false; }
+        if (o.kernel == GemmKernel::Strassen) { bad = "--batch (no se combina con --kernel=strassen)"; return false; }
+        if (o.product != ProductPath::Auto && o.product != ProductPath::Dense) {
+            bad = "--product (--batch solo tiene camino denso)";
+            return false;
+        }
+    }
+    // Los trabajos de la cola generan sus propias A y B y se miden una vez
+    if (o.jobs > 0) {
+        if (!o.a_file.empty() || !o.b_file.empty() || !o.c_file.empty() || !o.save_inputs.empty()) {
+            bad = "--jobs (no se combina con --a/--b/--c/--save-inputs)";
+            return false;
+        }
+        if (o.out_of_core) { bad = "--jobs (no se combina con --out-of-core)"; return false; }
+        if (o.batch > 0) { bad = "--jobs (no se combina con --batch)"; return false; }
+        if (o.reps > 1) { bad = "--reps (cada trabajo de --jobs se hace una vez)"; return false; }
+    }
+    // Freivalds necesita A, B y C enteras en memoria
+    if (o.verify_rounds > 0 && (o.out_of_core || o.batch > 0 || o.jobs > 0)) {
+        bad = "--verify (no se combina con --out-of-core, --batch ni --jobs)";
+        return false;
+    }
+    // La traza cubre los workers de run(): una multiplicacion (con sus
+    // repeticiones) y un fichero
+    if (o.trace_level_given && o.trace_path.empty()) { bad = "--trace-level (necesita --trace)"; return false; }
+    if (!o.trace_path.empty() && (o.sweep() || o.out_of_core || o.batch > 0 || o.jobs > 0 || o.pipeline)) {
+        bad = "--trace (no se combina con --sweep, --out-of-core, --batch, --jobs ni --pipeline)";
+        return false;
+    }
+    // La tuberia recorre A y C una vez por paneles con el kernel por filas
+    if (o.panel_rows > 0 && !o.pipeline) { bad = "--panel-rows (necesita --pipeline)"; return false; }
+    if (o.pipeline) {
+        if (o.out_of_core || o.batch > 0 || o.jobs > 0) {
+            bad = "--pipeline (no se combina con --out-of-core, --batch ni --jobs)";
+            return false;
+        }
+        if (o.kernel == GemmKernel::Strassen) { bad = "--pipeline (no se combina con --kernel=strassen)"; return false; }
+        if (o.product != ProductPath::Auto && o.product != ProductPath::Dense) {
+            bad = "--product (--pipeline solo tiene camino denso)";
+            return false;
+        }
+        if (o.reps > 1) { bad = "--reps (--pipeline hace una sola pasada)"; return false; }
+        if (!o.save_inputs.empty()) { bad = "--save-inputs (no se combina con --pipeline)"; return false; }
+    }
+    // Strassen es un producto denso: no se combina con un camino disperso
+    if (o.kernel == GemmKernel::Strassen && o.product != ProductPath::Auto && o.product != ProductPath::Dense) {
+        bad = "--product (no se combina con --kernel=strassen)";
+        return false;
+    }
+    // Con ficheros de entrada las dimensiones y el tipo salen de sus cabeceras
+    // (load_input_headers); aqui solo lo que no depende de su contenido
+    const bool has_a = !o.a_file.empty(), has_b = !o.b_file.empty();
+    if (has_a || has_b) {
+        if (o.sweep()) { bad = "--sweep (no se combina con --a/--b)"; return false; }
+        if (has_a != has_b && !o.dims_given) {
+            bad = has_a ? "--dims (falta N para generar B)" : "--dims (falta M para generar A)";
+            return false;
+        }
+        return true;
+    }
+    return check_elem_types(o, bad);
+}
+
+// Tras parse_cli: toma las dimensiones y el tipo de las cabeceras de --a/--b.
+// Devuelve false con "<fichero>: <motivo>" en `err` si un fichero no se puede
+// leer o no encaja con el otro o con --type/--dims/--acc.
+inline bool load_input_headers(CliOptions& o, std::string& err) {
+    const bool has_a = !o.a_file.empty(), has_b = !o.b_file.empty();
+    if (!has_a && !has_b) return true;
+    MatrixFileHeader ha = {}, hb = {};
+    if ((has_a && !read_matrix_header(o.a_file, ha, err)) || (has_b && !read_matrix_header(o.b_file, hb, err)))
+        return false;
+    const std::string& first = has_a ? o.a_file : o.b_file;
+    const ElemType file_type = (ElemType)(has_a ? ha.elem_type : hb.elem_type);
+    if (has_a && has_b && ha.elem_type != hb.elem_type) {
+        err = o.b_file + ": contiene " + elem_type_name((ElemType)hb.elem_type) + " y A contiene " +
+              elem_type_name(file_type);
+        return false;
+    }
+    if (o.type_given && o.type != file_type) {
+        err = first + ": contiene " + elem_type_name(file_type) + " y se pidio --type=" + elem_type_name(o.type);
+        return false;
+    }
+    o.type = file_type;
+    if (has_a) { o.dims[0] = (int)ha.rows; o.dims[1] = (int)ha.cols; }
+    if (has_b) {
+        if (has_a && hb.rows != ha.cols) {
+            err = o.b_file + ": tiene " + std::to_string(hb.rows) + " filas y A " + std::to_string(ha.cols) + " columnas";
+            return false;
+        }
+        if (!has_a && o.dims_given && o.dims[1] != (int)hb.rows) {
+            err = o.b_file + ": tiene " + std::to_string(hb.rows) + " filas y --dims pide K=" + std::to_string(o.dims[1]);
+            return false;
+        }
+        o.dims[1] = (int)hb.rows;
+        o.dims[2] = (int)hb.cols;
+    }
+    o.dims_given = true;
+    std::string bad;
+    if (!check_elem_types(o, bad)) {
+        err = first + ": contiene " + elem_type_name(file_type) + ", que no se combina con --acc=" + elem_type_name(o.acc);
+        return false;
+    }
+    return true;
+}
+
+// Crea la carpeta de salida si no existe (un solo nivel, como resultados/).
+inline void ensure_dir(const std::string& dir) {
+#ifdef _WIN32
+    _mkdir(dir.c_str());
+#else
+    mkdir(dir.c_str(), 0755);
+#endif
+}
+
+inline std::string dims_label(const Dims& d) {
+    return std::to_string(d[0]) + "x" + std::to_string(d[1]) + "x" + std::to_string(d[2]);
+}
@@ -0,0 +1,90 @@
+// Generador aleatorio por contador (Philox4x32-10, Salmon et al. 2011).
+//
+// En lugar de un estado que avanza (std::mt19937), cada bloque de 4 numeros
+// es una funcion pura de (clave, contador): la clave es la semilla y el
+// contador es el indice del elemento. Asi cualquier hilo puede generar
+// cualquier fila sin haber generado las anteriores, y el contenido de la
+// matriz es identico bit a bit sea cual sea el numero de hilos o el reparto
+// de filas.
+//
+//   stream separa las matrices que comparten semilla (A = 0, B = 1).
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+
+#include "matrix.h"
+
+enum : std::uint32_t { RNG_STREAM_A = 0, RNG_STREAM_B = 1 };
+
+using PhiloxBlock = std::array<std::uint32_t, 4>;
+
+inline PhiloxBlock philox4x32_10(PhiloxBlock ctr, std::uint64_t key) {
+    const std::uint32_t M0 = 0xD2511F53u, M1 = 0xCD9E8D57u;
+    const std::uint32_t W0 = 0x9E3779B9u, W1 = 0xBB67AE85u;
+    std::uint32_t k0 = (std::uint32_t)key, k1 = (std::uint32_t)(key >> 32);
+    for (int round = 0; round < 10; ++round) {
+        const std::uint64_t p0 = (std::uint64_t)M0 * ctr[0];
+        const std::uint64_t p1 = (std::uint64_t)M1 * ctr[2];
+        ctr = { (std::uint32_t)(p1 >> 32) ^ ctr[1] ^ k0, (std::uint32_t)p1,
+                (std::uint32_t)(p0 >> 32) ^ ctr[3] ^ k1, (std::uint32_t)p0 };
+        k0 += W0;
+        k1 += W1;
+    }
+    return ctr;
+}
+
+// Entero uniforme en [0, n) a partir de 32 bits (multiplicacion, sin modulo).
+inline std::uint32_t philox_below(std::uint32_t x, std::uint32_t n) {
+    return (std::uint32_t)(((std::uint64_t)x * n) >> 32);
+}
+
+// Rellena las filas [r0, r1) de M con enteros 0..9. El valor de (i, j)
+// depende solo de (seed, stream, i * cols + j). El relleno de cada fila
+// (hasta el stride) se pone a 0, de modo que quien llama toca todas las
+// paginas de sus filas: con MatrixT::uninitialized() ese es el primer toque.
+template <class T>
+inline void fill_random_digits(MatrixViewT<T> M, int r0, int r1, std::uint64_t seed, std::uint32_t stream) {
+    for (int i = r0; i < r1; ++i) {
+        T* row = M.row(i);
+        std::uint64_t idx = (std::uint64_t)i * M.cols;
+        int j = 0;
+        while (j < M.cols) {
+            const std::uint64_t block = idx >> 2;
+            const PhiloxBlock r = philox4x32_10(
+                { (std::uint32_t)block, (std::uint32_t)(block >> 32), stream, 0u }, seed);
+            for (int lane = (int)(idx & 3); lane < 4 && j < M.cols; ++lane, ++j, ++idx)
+                row[j] = static_cast<T>(philox_below(r[lane], 10));
+        }
+        for (int p = M.cols; p < M.stride; ++p) row[p] = T(0);
+    }
+}
+
+// Como fill_random_digits pero con una fraccion `density` de no ceros: cada
+// elemento es 1..9 con probabilidad density y 0 si no. La decision sale de
+// otro bloque Philox (cuarta palabra del contador = 1), asi que tambien
+// depende solo de (seed, stream, indice). Con density >= 1 es exactamente
+// fill_random_digits.
+template <class T>
+inline void fill_random_sparse_digits(MatrixViewT<T> M, int r0, int r1, std::uint64_t seed, std::uint32_t stream,
+                                      double density) {
+    if (density >= 1.0) { fill_random_digits(M, r0, r1, seed, stream); return; }
+    const std::uint64_t keep = (std::uint64_t)(std::max(density, 0.0) * 4294967296.0);
+    for (int i = r0; i < r1; ++i) {
+        T* row = M.row(i);
+        std::uint64_t idx = (std::uint64_t)i * M.cols;
+        int j = 0;
+        while (j < M.cols) {
+            const std::uint64_t block = idx >> 2;
+            const PhiloxBlock r = philox4x32_10(
+                { (std::uint32_t)block, (std::uint32_t)(block >> 32), stream, 0u }, seed);
+            const PhiloxBlock mask = philox4x32_10(
+                { (std::uint32_t)block, (std::uint32_t)(block >> 32), stream, 1u }, seed);
+            for (int lane = (int)(idx & 3); lane < 4 && j < M.cols; ++lane, ++j, ++idx)
+                row[j] = mask[lane] < keep ? static_cast<T>(1 + philox_below(r[lane], 9)) : T(0);
+        }
+        for (int p = M.cols; p < M.stride; ++p) row[p] = T(0);
+    }
+}
@@ -0,0 +1,97 @@
+// Tipos de elemento soportados por el motor y su acumulador.
+//
+// A y B son de tipo T (entrada) y C del tipo acumulador Acc. Por defecto se
+// acumula en un tipo mas ancho cuando el de entrada desborda facilmente:
+//
+//   entrada   acumulador por defecto   alternativas
+//   int16     int32                    int64
+//   int32     int64                    int32 (mas rapido, puede desbordar)
+//   int64     int64
+//   float     float                    double
+//   double    double
+//
+// Cada pareja (T, Acc) instancia en compilacion su propio empaquetado,
+// macro-kernel y micro-kernels; dispatch_elem_types() convierte la eleccion
+// hecha en tiempo de ejecucion (linea de comandos) en esa instanciacion.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+enum class ElemType { Int16, Int32, Int64, Float, Double };
+
+inline const char* elem_type_name(ElemType t) {
+    switch (t) {
+        case ElemType::Int16:  return "int16";
+        case ElemType::Int32:  return "int32";
+        case ElemType::Int64:  return "int64";
+        case ElemType::Float:  return "float";
+        case ElemType::Double: return "double";
+    }
+    return "?";
+}
+
+inline bool parse_elem_type(const std::string& s, ElemType& out) {
+    if (s == "int16")  { out = ElemType::Int16;  return true; }
+    if (s == "int32")  { out = ElemType::Int32;  return true; }
+    if (s == "int64")  { out = ElemType::Int64;  return true; }
+    if (s == "float")  { out = ElemType::Float;  return true; }
+    if (s == "double") { out = ElemType::Double; return true; }
+    return false;
+}
+
+template <class T> struct ElemTraits;
+template <> struct ElemTraits<std::int16_t> { static constexpr ElemType id = ElemType::Int16;  using Acc = std::int32_t; };
+template <> struct ElemTraits<std::int32_t> { static constexpr ElemType id = ElemType::Int32;  using Acc = std::int64_t; };
+template <> struct ElemTraits<std::int64_t> { static constexpr ElemType id = ElemType::Int64;  using Acc = std::int64_t; };
+template <> struct ElemTraits<float>        { static constexpr ElemType id = ElemType::Float;  using Acc = float; };
+template <> struct ElemTraits<double>       { static constexpr ElemType id = ElemType::Double; using Acc = double; };
+
+template <class T>
+inline const char* elem_name() { return elem_type_name(ElemTraits<T>::id); }
+
+inline ElemType default_acc_type(ElemType in) {
+    switch (in) {
+        case ElemType::Int16: return ElemType::Int32;
+        case ElemType::Int32: return ElemType::Int64;
+        default:              return in;
+    }
+}
+
+// Etiqueta vacia para pasar un tipo como argumento a una lambda generica.
+template <class T> struct TypeTag { using type = T; };
+
+// Llama a f(TypeTag<T>{}, TypeTag<Acc>{}) con la pareja pedida. Devuelve
+// false si la combinacion no esta instanciada.
+template <class F>
+bool dispatch_elem_types(ElemType in, ElemType acc, F&& f) {
+    using i16 = std::int16_t;
+    using i32 = std::int32_t;
+    using i64 = std::int64_t;
+    switch (in) {
+        case ElemType::Int16:
+            if (acc == ElemType::Int32) { f(TypeTag<i16>{}, TypeTag<i32>{}); return true; }
+            if (acc == ElemType::Int64) { f(TypeTag<i16>{}, TypeTag<i64>{}); return true; }
+            break;
+        case ElemType::Int32:
+            if (acc == ElemType::Int64) { f(TypeTag<i32>{}, TypeTag<i64>{}); return true; }
+            if (acc == ElemType::Int32) { f(TypeTag<i32>{}, TypeTag<i32>{}); return true; }
+            break;
+        case ElemType::Int64:
+            if (acc == ElemType::Int64) { f(TypeTag<i64>{}, TypeTag<i64>{}); return true; }
+            break;
+        case ElemType::Float:
+            if (acc == ElemType::Float)  { f(TypeTag<float>{}, TypeTag<float>{}); return true; }
+            if (acc == ElemType::Double) { f(TypeTag<float>{}, TypeTag<double>{}); return true; }
+            break;
+        case ElemType::Double:
+            if (acc == ElemType::Double) { f(TypeTag<double>{}, TypeTag<double>{}); return true; }
+            break;
+    }
+    return false;
+}
+
+inline bool elem_types_supported(ElemType in, ElemType acc) {
+    return dispatch_elem_types(in, acc, [](auto, auto) {});
+}
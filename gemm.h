@@ -0,0 +1,337 @@
+// Motor de multiplicacion C = A x B compartido por MMS (secuencial) y MMP (paralelo).
+//
+// Ofrece tres kernels:
+//   - naive:    el triple bucle i-j-k original (recorre B por columnas).
+//   - blocked:  GEMM por bloques sobre i, j y k con tamanos derivados de las
+//               caches L1/L2/L3. Cada bloque de A (mc x kc) y panel de B
+//               (kc x nc) se empaqueta en micro-paneles contiguos y el
+//               micro-kernel SIMD activo (ver microkernel.h) calcula cada
+//               bloque MR x NR de C en registros.
+//   - strassen: Strassen-Winograd recursivo hasta un cutoff y blocked en las
+//               hojas; necesita plan y buffers propios (ver strassen.h).
+//
+// Ambos sobrescriben C; operan sobre vistas, asi que un hilo puede pasar solo
+// su bloque de filas de A y de C.
+//
+// Todo es plantilla sobre el tipo de entrada T (A, B) y el acumulador Acc (C):
+// el empaquetado convierte T -> Acc, de modo que el micro-kernel solo depende
+// de Acc (ver element.h para las parejas instanciadas). Las vistas de entrada
+// deben pasarse como ConstMatrixViewT<T> para que los tipos se deduzcan.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+#include "matrix.h"
+#include "microkernel.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <vector>
+#else
+#include <unistd.h>
+#endif
+
+enum class GemmKernel { Naive, Blocked, Strassen };
+
+inline const char* kernel_name(GemmKernel k) {
+    switch (k) {
+        case GemmKernel::Naive:   return "naive";
+        case GemmKernel::Blocked: return "blocked";
+        case GemmKernel::Strassen: return "strassen";
+    }
+    return "?";
+}
+
+inline bool parse_kernel(const std::string& s, GemmKernel& out) {
+    if (s == "naive")   { out = GemmKernel::Naive;   return true; }
+    if (s == "blocked") { out = GemmKernel::Blocked; return true; }
+    if (s == "strassen") { out = GemmKernel::Strassen; return true; }
+    return false;
+}
+
+// ===================== Tamanos de cache y de bloque =====================
+
+struct CacheSizes {
+    std::size_t l1 = 32 * 1024;
+    std::size_t l2 = 256 * 1024;
+    std::size_t l3 = 8 * 1024 * 1024;
+};
+
+inline CacheSizes detect_cache_sizes() {
+    CacheSizes cs;
+#ifdef _WIN32
+    DWORD len = 0;
+    GetLogicalProcessorInformation(nullptr, &len);
+    std::vector<SYSTEM_LOGICAL_PROCESSOR_INFORMATION> info(len / sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION));
+    if (!info.empty() && GetLogicalProcessorInformation(info.data(), &len)) {
+        for (const auto& e : info) {
+            if (e.Relationship != RelationCache) continue;
+            if (e.Cache.Type != CacheData && e.Cache.Type != CacheUnified) continue;
+            if (e.Cache.Level == 1) cs.l1 = e.Cache.Size;
+            if (e.Cache.Level == 2) cs.l2 = e.Cache.Size;
+            if (e.Cache.Level == 3) cs.l3 = e.Cache.Size;
+        }
+    }
+#elif defined(_SC_LEVEL1_DCACHE_SIZE)
+    long v;
+    if ((v = sysconf(_SC_LEVEL1_DCACHE_SIZE)) > 0) cs.l1 = (std::size_t)v;
+    if ((v = sysconf(_SC_LEVEL2_CACHE_SIZE)) > 0)  cs.l2 = (std::size_t)v;
+    if ((v = sysconf(_SC_LEVEL3_CACHE_SIZE)) > 0)  cs.l3 = (std::size_t)v;
+#endif
+    if (cs.l3 < cs.l2) cs.l3 = cs.l2;
+    return cs;
+}
+
+// mc x kc : bloque de A que vive en L2
+// kc x NR : micro-panel de B que vive en L1 y se reutiliza para las mc filas
+// kc x nc : panel de B que vive en L3 y se reutiliza para todos los bloques de A
+struct BlockSizes {
+    int mc = 96;
+    int kc = 256;
+    int nc = 4096;
+};
+
+template <class Acc>
+inline BlockSizes block_sizes_for(const CacheSizes& cs, const MicroKernelT<Acc>& uk) {
+    auto round_down = [](std::size_t v, int m) { return std::max<int>(m, (int)(v / m * m)); };
+    BlockSizes bs;
+    // Se usa la mitad de cada nivel para dejar sitio a C y a la otra matriz.
+    bs.kc = std::min(512, round_down(cs.l1 / 2 / (uk.nr * sizeof(Acc)), 8));
+    bs.mc = round_down(cs.l2 / 2 / (bs.kc * sizeof(Acc)), uk.mr);
+    bs.nc = round_down(cs.l3 / 2 / (bs.kc * sizeof(Acc)), uk.nr);
+    return bs;
+}
+
+template <class Acc = int>
+inline BlockSizes default_block_sizes(const MicroKernelT<Acc>& uk = active_microkernel<Acc>()) {
+    static const CacheSizes cs = detect_cache_sizes();
+    return block_sizes_for(cs, uk);
+}
+
+// ===================== Empaquetado =====================
+
+// A (mc x kc) -> micro-paneles de MR filas: para cada paso p, MR valores
+// consecutivos. Las filas que faltan en el ultimo panel se rellenan con 0.
+template <class T, class Acc>
+inline void pack_a(ConstMatrixViewT<T> A, int mr, Acc* dst) {
+    for (int ir = 0; ir < A.rows; ir += mr) {
+        const int rows = std::min(mr, A.rows - ir);
+        for (int p = 0; p < A.cols; ++p) {
+            int i = 0;
+            for (; i < rows; ++i) *dst++ = static_cast<Acc>(A(ir + i, p));
+            for (; i < mr; ++i)   *dst++ = Acc(0);
+        }
+    }
+}
+
+// B (kc x nc) -> micro-paneles de NR columnas: para cada paso p, NR valores
+// consecutivos de la fila p. Las columnas que faltan se rellenan con 0.
+template <class T, class Acc>
+inline void pack_b(ConstMatrixViewT<T> B, int nr, Acc* dst) {
+    for (int jr = 0; jr < B.cols; jr += nr) {
+        const int cols = std::min(nr, B.cols - jr);
+        for (int p = 0; p < B.rows; ++p) {
+            const T* src = B.row(p) + jr;
+            int j = 0;
+            for (; j < cols; ++j) *dst++ = static_cast<Acc>(src[j]);
+            for (; j < nr; ++j)   *dst++ = Acc(0);
+        }
+    }
+}
+
+inline std::size_t packed_size(int dim, int multiple, int kc) {
+    return (std::size_t)((dim + multiple - 1) / multiple * multiple) * kc;
+}
+
+// B completo empaquetado una sola vez, para compartirlo entre hilos. Se
+// guarda por columnas de micro-panel: la columna J (columnas J*NR .. J*NR+NR-1
+// de B) ocupa k*NR elementos contiguos, paso p a paso p. Asi el micro-panel
+// kc x NR de cualquier bloque (pc, J) empieza en panel(J) + pc*NR y se lee de
+// forma secuencial. Los elementos ya estan convertidos al tipo acumulador.
+template <class Acc>
+struct PackedBT {
+    const MicroKernelT<Acc>* uk = nullptr;
+    int k = 0;
+    int n = 0;
+    int panels = 0;     // columnas de micro-panel = ceil(n / NR)
+    std::unique_ptr<Acc[], AlignedDeleter> buf;
+
+    std::size_t panel_stride() const { return (std::size_t)k * uk->nr; }
+    const Acc* panel(int J) const { return buf.get() + (std::size_t)J * panel_stride(); }
+    Acc* panel(int J) { return buf.get() + (std::size_t)J * panel_stride(); }
+};
+
+using PackedB = PackedBT<int>;
+
+// Reserva el buffer sin escribirlo; el contenido lo rellena pack_b_panels.
+template <class Acc = int>
+inline PackedBT<Acc> make_packed_b(int k, int n, const MicroKernelT<Acc>& uk = active_microkernel<Acc>()) {
+    PackedBT<Acc> pb;
+    pb.uk = &uk;
+    pb.k = k;
+    pb.n = n;
+    pb.panels = (n + uk.nr - 1) / uk.nr;
+    pb.buf.reset(static_cast<Acc*>(aligned_malloc(
+        (std::size_t)pb.panels * pb.panel_stride() * sizeof(Acc))));
+    return pb;
+}
+
+// Bloque MC x KC de A empaquetado, uno por hilo: se reserva una vez (como la
+// PackedB compartida) y cada tesela del hilo lo reutiliza.
+template <class Acc>
+struct APackBufferT {
+    const MicroKernelT<Acc>* uk = nullptr;
+    std::unique_ptr<Acc[], AlignedDeleter> buf;
+
+    Acc* get() { return buf.get(); }
+};
+
+// Reserva sin escribir: las paginas las toca primero el hilo que lo usa.
+template <class Acc = int>
+inline APackBufferT<Acc> make_a_pack(const MicroKernelT<Acc>& uk = active_microkernel<Acc>()) {
+    const BlockSizes bs = default_block_sizes(uk);
+    APackBufferT<Acc> ap;
+    ap.uk = &uk;
+    ap.buf.reset(static_cast<Acc*>(aligned_malloc(packed_size(bs.mc, uk.mr, bs.kc) * sizeof(Acc))));
+    return ap;
+}
+
+// Empaqueta la parte `part` de `parts` (reparto por columnas de micro-panel),
+// de modo que varios hilos puedan empaquetar B a la vez sin coordinarse.
+template <class T, class Acc>
+inline void pack_b_panels(ConstMatrixViewT<T> B, PackedBT<Acc>& pb, int part, int parts) {
+    const int nr = pb.uk->nr;
+    const int j0 = (int)((long long)pb.panels * part / parts);
+    const int j1 = (int)((long long)pb.panels * (part + 1) / parts);
+    for (int J = j0; J < j1; ++J) {
+        const int col = J * nr;
+        pack_b(B.view(0, col, B.rows, std::min(nr, B.cols - col)), nr, pb.panel(J));
+    }
+}
+
+// Recorre un bloque mc x nc de C con el micro-kernel. Los micro-paneles de B
+// estan separados por b_stride elementos. Los bordes que no llenan un bloque
+// MR x NR se calculan en un buffer local y se copian.
+template <class Acc>
+inline void macro_kernel(const MicroKernelT<Acc>& uk, int mc, int nc, int kc,
+                         const Acc* a_pack, const Acc* b_pack, std::size_t b_stride,
+                         MatrixViewT<Acc> C, bool accumulate) {
+    alignas(64) Acc tmp[MICRO_MR_MAX * MICRO_NR_MAX];
+    for (int jr = 0; jr < nc; jr += uk.nr) {
+        const int nr = std::min(uk.nr, nc - jr);
+        const Acc* bp = b_pack + (std::size_t)(jr / uk.nr) * b_stride;
+        for (int ir = 0; ir < mc; ir += uk.mr) {
+            const int mr = std::min(uk.mr, mc - ir);
+            const Acc* ap = a_pack + (std::size_t)ir * kc;
+            Acc* c = C.row(ir) + jr;
+            if (mr == uk.mr && nr == uk.nr) {
+                uk.fn(kc, ap, bp, c, C.stride, accumulate);
+            } else {
+                uk.fn(kc, ap, bp, tmp, uk.nr, false);
+                for (int i = 0; i < mr; ++i)
+                    for (int j = 0; j < nr; ++j)
+                        c[(std::size_t)i * C.stride + j] =
+                            accumulate ? c[(std::size_t)i * C.stride + j] + tmp[i * uk.nr + j]
+                                       : tmp[i * uk.nr + j];
+            }
+        }
+    }
+}
+
+// ===================== Kernels =====================
+
+// Triple bucle i-j-k original; se conserva como referencia para comparar.
+template <class T, class Acc>
+inline void gemm_naive(ConstMatrixViewT<T> A, ConstMatrixViewT<T> B, MatrixViewT<Acc> C) {
+    for (int i = 0; i < A.rows; ++i) {
+        const T* a_row = A.row(i);
+        Acc* c_row = C.row(i);
+        for (int j = 0; j < B.cols; ++j) {
+            Acc sum = 0;
+            for (int k = 0; k < A.cols; ++k)
+                sum += static_cast<Acc>(a_row[k]) * static_cast<Acc>(B(k, j));
+            c_row[j] = sum;
+        }
+    }
+}
+
+template <class T, class Acc>
+inline void gemm_blocked(ConstMatrixViewT<T> A, ConstMatrixViewT<T> B, MatrixViewT<Acc> C,
+                         const MicroKernelT<Acc>& uk = active_microkernel<Acc>()) {
+    const int m = A.rows, n = B.cols, kdim = A.cols;
+    const BlockSizes bs = default_block_sizes(uk);
+
+    if (kdim == 0) {
+        for (int i = 0; i < m; ++i)
+            std::fill(C.row(i), C.row(i) + n, Acc(0));
+        return;
+    }
+
+    const int kc_max = std::min(bs.kc, kdim);
+    std::unique_ptr<Acc[], AlignedDeleter> a_pack(static_cast<Acc*>(
+        aligned_malloc(packed_size(std::min(bs.mc, m), uk.mr, kc_max) * sizeof(Acc))));
+    std::unique_ptr<Acc[], AlignedDeleter> b_pack(static_cast<Acc*>(
+        aligned_malloc(packed_size(std::min(bs.nc, n), uk.nr, kc_max) * sizeof(Acc))));
+
+    for (int jc = 0; jc < n; jc += bs.nc) {
+        const int nc = std::min(bs.nc, n - jc);
+        for (int pc = 0; pc < kdim; pc += bs.kc) {
+            const int kc = std::min(bs.kc, kdim - pc);
+            pack_b(B.view(pc, jc, kc, nc), uk.nr, b_pack.get());
+            for (int ic = 0; ic < m; ic += bs.mc) {
+                const int mc = std::min(bs.mc, m - ic);
+                pack_a(A.view(ic, pc, mc, kc), uk.mr, a_pack.get());
+                // El primer bloque de k escribe C; los siguientes acumulan.
+                macro_kernel(uk, mc, nc, kc, a_pack.get(), b_pack.get(),
+                             (std::size_t)kc * uk.nr, C.view(ic, jc, mc, nc), pc > 0);
+            }
+        }
+    }
+}
+
+// Igual que gemm_blocked pero con B ya empaquetado (p. ej. una vez en main()
+// y compartido por todos los hilos): solo se empaqueta el bloque de A, en el
+// buffer del hilo que llama (make_a_pack con el micro-kernel de B).
+// C puede ser una franja de columnas [col0, col0 + C.cols) del resultado;
+// col0 debe ser multiplo de NR.
+template <class T, class Acc>
+inline void gemm_blocked_packed(ConstMatrixViewT<T> A, const PackedBT<Acc>& B, APackBufferT<Acc>& a_pack,
+                                MatrixViewT<Acc> C, int col0 = 0) {
+    const MicroKernelT<Acc>& uk = *B.uk;
+    const int m = A.rows, n = C.cols, kdim = B.k;
+    const BlockSizes bs = default_block_sizes(uk);
+
+    if (kdim == 0) {
+        for (int i = 0; i < m; ++i)
+            std::fill(C.row(i), C.row(i) + n, Acc(0));
+        return;
+    }
+
+    for (int jc = 0; jc < n; jc += bs.nc) {
+        const int nc = std::min(bs.nc, n - jc);
+        for (int pc = 0; pc < kdim; pc += bs.kc) {
+            const int kc = std::min(bs.kc, kdim - pc);
+            const Acc* bp = B.panel((col0 + jc) / uk.nr) + (std::size_t)pc * uk.nr;
+            for (int ic = 0; ic < m; ic += bs.mc) {
+                const int mc = std::min(bs.mc, m - ic);
+                pack_a(A.view(ic, pc, mc, kc), uk.mr, a_pack.get());
+                macro_kernel(uk, mc, nc, kc, a_pack.get(), bp, B.panel_stride(),
+                             C.view(ic, jc, mc, nc), pc > 0);
+            }
+        }
+    }
+}
+
+// Strassen no pasa por aqui (necesita un StrassenWorkspace): se trata como blocked.
+template <class T, class Acc>
+inline void gemm(GemmKernel kernel, ConstMatrixViewT<T> A, ConstMatrixViewT<T> B, MatrixViewT<Acc> C) {
+    if (kernel == GemmKernel::Naive) gemm_naive(A, B, C);
+    else                             gemm_blocked(A, B, C);
+}
@@ -0,0 +1,132 @@
+// Escritor JSON minimo (sin dependencias) para resultados/metricas_*.json.
+//
+// Escribe en streaming con sangria de 2 espacios, igual que las plantillas de
+// resultados/. Las comas las gestiona el propio escritor:
+//
+//   JsonWriter w(out);
+//   w.begin_object();
+//   w.field("programa", "MMP.cpp");
+//   w.begin_object("sistema"); w.field("cores_logicos", 8); w.end_object();
+//   w.inline_array("tiempos_s", times);
+//   w.end_object();
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+class JsonWriter {
+public:
+    explicit JsonWriter(std::ostream& os) : os_(os) {}
+
+    void begin_object(const char* key = nullptr) { open(key, '{'); }
+    void end_object() { close('}'); }
+    void begin_array(const char* key = nullptr) { open(key, '['); }
+    void end_array() { close(']'); }
+
+    template <class V>
+    void field(const char* key, const V& v) {
+        prefix(key);
+        write_value(v);
+    }
+
+    // Elemento suelto dentro de un array.
+    template <class V>
+    void value(const V& v) { field(nullptr, v); }
+
+    // Array corto en una sola linea: "clave": [1, 2, 3]
+    template <class V>
+    void inline_array(const char* key, const std::vector<V>& vs) {
+        prefix(key);
+        os_ << "[";
+        for (size_t i = 0; i < vs.size(); ++i) {
+            if (i) os_ << ", ";
+            write_value(vs[i]);
+        }
+        os_ << "]";
+    }
+
+    // Cierra lo que quede abierto y termina con salto de linea.
+    void finish() {
+        while (!first_.empty()) close(closers_.back());
+        os_ << "\n";
+    }
+
+private:
+    void open(const char* key, char c) {
+        prefix(key);
+        os_ << c;
+        first_.push_back(true);
+        closers_.push_back(c == '{' ? '}' : ']');
+    }
+
+    void close(char c) {
+        bool empty = first_.back();
+        first_.pop_back();
+        closers_.pop_back();
+        if (!empty) newline();
+        os_ << c;
+    }
+
+    void prefix(const char* key) {
+        if (!first_.empty()) {
+            if (!first_.back()) os_ << ",";
+            first_.back() = false;
+            newline();
+        }
+        if (key) {
+            write_value(std::string(key));
+            os_ << ": ";
+        }
+    }
+
+    void newline() { os_ << "\n" << std::string(first_.size() * 2, ' '); }
+
+    void write_value(const std::string& s) {
+        os_ << '"';
+        for (char ch : s) {
+            switch (ch) {
+                case '"':  os_ << "\\\""; break;
+                case '\\': os_ << "\\\\"; break;
+                case '\n': os_ << "\\n"; break;
+                case '\t': os_ << "\\t"; break;
+                default:
+                    if ((unsigned char)ch < 0x20) {
+                        std::ostringstream hex;
+                        hex << "\\u" << std::hex << std::setw(4) << std::setfill('0') << (int)ch;
+                        os_ << hex.str();
+                    } else {
+                        os_ << ch;
+                    }
+            }
+        }
+        os_ << '"';
+    }
+    void write_value(const char* s) { write_value(std::string(s ? s : "")); }
+    void write_value(bool b) { os_ << (b ? "true" : "false"); }
+    void write_value(double d) {
+        if (!std::isfinite(d)) { os_ << "null"; return; }
+        std::ostringstream tmp;
+        tmp << std::setprecision(10) << d;
+        std::string t = tmp.str();
+        // 0 -> 0.0 para que el tipo sea visiblemente real, como en las plantillas
+        if (t.find_first_of(".eE") == std::string::npos) t += ".0";
+        os_ << t;
+    }
+    void write_value(float f) { write_value((double)f); }
+    void write_value(int v) { os_ << v; }
+    void write_value(long v) { os_ << v; }
+    void write_value(long long v) { os_ << v; }
+    void write_value(unsigned v) { os_ << v; }
+    void write_value(unsigned long v) { os_ << v; }
+    void write_value(unsigned long long v) { os_ << v; }
+
+    std::ostream& os_;
+    std::vector<bool> first_;
+    std::vector<char> closers_;
+};
@@ -0,0 +1,590 @@
+// Implementacion de la biblioteca de multiplicacion (ver matmul.h).
+//
+// Aqui viven el bucle de los workers (teselas con robo de trabajo o tareas de
+// Strassen), el empaquetado de B repartido entre hilos y la eleccion del
+// camino del producto. Al final se instancian las plantillas para cada
+// pareja (T, Acc) que admite dispatch_elem_types().
+
+#include "matmul.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+
+#include "platform.h"
+#include "scheduler.h"
+
+// Limites de filas segun el tramo inicial de teselas de cada hilo: el hilo w
+// genera las filas de A que luego multiplica. Las teselas van por filas, asi
+// que los limites son crecientes; un hilo sin teselas no genera nada.
+static std::vector<int> tile_row_split(const TileScheduler& layout, int rows, int workers) {
+    std::vector<int> split(workers + 1, rows);
+    for (int w = workers - 1; w >= 0; --w) {
+        Tile first, last;
+        split[w] = layout.initial_range(w, first, last) ? first.row0 : split[w + 1];
+    }
+    split[0] = 0;
+    return split;
+}
+
+static double seconds_since(std::chrono::steady_clock::time_point t0) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+// ===================== Funcion del hilo worker =====================
+
+template <class T, class Acc>
+static void worker_func(ConstMatrixViewT<T> A, ConstMatrixViewT<T> B, const PackedBT<Acc>& packed_b,
+                        APackBufferT<Acc>& a_pack, MatrixViewT<Acc> C, GemmKernel kernel,
+                        const SparseOperands<T>& sp, TileScheduler& sched, const NumaPlacement& place, ThreadMetrics& info, TraceBuffer* tb) {
+    // El hilo pertenece al pool y ya esta fijado a info.core_id
+    ThreadSnapshot snap;
+    snap.native_tid = current_thread_id();
+    snap.started = true;
+    info.live.store(snap);
+
+    int cols_a = A.cols;
+    int total = sched.total_tiles();
+
+    double prev_cpu = get_thread_cpu_time();
+    const double start_cpu = prev_cpu;
+    auto prev_wall = std::chrono::steady_clock::now();
+    auto start_wall = prev_wall;
+    SparseAccumulator<Acc> spa;         // acumulador de Gustavson de este hilo
+    const bool fine = tb && tb->fine();
+    if (tb) tb->begin(TraceKind::Compute);
+
+    // Cada tesela es una llamada al kernel; al terminarla se publican las
+    // metricas. Cuando la cola propia se vacia, next() roba de otro hilo.
+    Tile t;
+    bool stolen = false;
+    while (sched.next(info.thread_id, t, stolen)) {
+        if (fine) {
+            if (stolen) tb->instant(TraceKind::Steal, t.row0, t.col0);
+            tb->begin(TraceKind::Tile, t.row0, t.col0);
+        }
+        ConstMatrixViewT<T> a = A.view(t.row0, 0, t.rows, cols_a);
+        MatrixViewT<Acc> c = C.view(t.row0, t.col0, t.rows, t.cols);
+        double madds = (double)t.rows * t.cols * cols_a;
+        switch (sp.path) {
+            case ProductPath::SparseDense:  madds = (double)spmm_csr_dense(sp.a_csr, B, t.row0, t.col0, c); break;
+            case ProductPath::DenseSparse:  madds = (double)gemm_dense_csc(A, sp.b_csc, t.row0, t.col0, c); break;
+            case ProductPath::SparseSparse:
+                madds = (double)spgemm_csr(sp.a_csr, sp.b_csr, t.row0, t.col0, c, spa, snap.nonzeros_c);
+                break;
+            default:
+                if (kernel == GemmKernel::Naive) gemm_naive(a, B.view(0, t.col0, cols_a, t.cols), c);
+                else                             gemm_blocked_packed(a, packed_b, a_pack, c, t.col0);
+        }
+        sched.mark_done();
+        if (fine) tb->end(TraceKind::Tile);
+
+        // Trafico estimado de la tesela: sus filas de A y C estan en el nodo
+        // del hilo que las genero; B es local (replica) o intercalada. En los
+        // caminos dispersos cada multiplicacion-suma lee un valor (y su
+        // indice si el operando es disperso).
+        double ac_bytes = (double)t.rows * cols_a * sizeof(T) + (double)t.rows * t.cols * sizeof(Acc);
+        double b_bytes = (double)cols_a * t.cols * (kernel == GemmKernel::Naive ? sizeof(T) : sizeof(Acc));
+        if (sp.path != ProductPath::Dense) {
+            const double b_elem = sizeof(T) + (sp.path == ProductPath::SparseDense ? 0 : sizeof(int));
+            b_bytes = madds * b_elem;
+            if (sp.a_sparse())
+                ac_bytes = (double)(sp.a_csr.row_ptr[t.row0 + t.rows] - sp.a_csr.row_ptr[t.row0]) * (sizeof(T) + sizeof(int)) +
+                           (double)t.rows * t.cols * sizeof(Acc);
+        }
+        const bool remote = place.node_of_row(t.row0) != info.node;
+        snap.ops += 2.0 * madds;
+        if (remote) ++snap.tiles_remote;
+        snap.bytes_remote += (remote ? ac_bytes : 0.0) + b_bytes * place.b_remote_fraction;
+        snap.bytes_local += (remote ? 0.0 : ac_bytes) + b_bytes * (1.0 - place.b_remote_fraction);
+
+        auto now = std::chrono::steady_clock::now();
+        double cur_cpu = get_thread_cpu_time();
+        double dwall = std::chrono::duration<double>(now - prev_wall).count();
+        double dcpu = cur_cpu - prev_cpu;
+        double pct = (dwall > 0.001) ? (dcpu / dwall) * 100.0 : 0.0;
+
+        ++snap.tiles_executed;
+        if (stolen) ++snap.tiles_stolen;
+        snap.progress = sched.completed() * 100.0 / total;
+        snap.cpu_pct = pct;
+        snap.elapsed = std::chrono::duration<double>(now - start_wall).count();
+        info.live.store(snap);
+        info.cpu_samples.push(pct);
+
+        prev_cpu = cur_cpu;
+        prev_wall = now;
+    }
+
+    if (tb) tb->end(TraceKind::Compute);
+    snap.total_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_wall).count();
+    snap.cpu_time = get_thread_cpu_time() - start_cpu;
+    snap.progress = sched.completed() * 100.0 / total;
+    snap.done = true;
+    info.live.store(snap);
+}
+
+// Con Strassen no hay teselas: en cada fase (copias, sumas por franjas,
+// productos hoja, combinacion) los hilos toman tareas de un contador
+// compartido. Las metricas se publican igual que en worker_func y la
+// instantanea continua de una fase a la siguiente (solo la escribe este hilo).
+static void strassen_task_worker(int tasks, const std::function<void(int)>& task, std::atomic<int>& next,
+                                 std::atomic<int>& completed, int total, ThreadMetrics& info, TraceBuffer* tb) {
+    ThreadSnapshot snap = info.live.load();
+    if (!snap.started) {
+        snap.native_tid = current_thread_id();
+        snap.started = true;
+        info.live.store(snap);
+    }
+    const double base_time = snap.total_time;
+    const double base_cpu = snap.cpu_time;
+
+    double prev_cpu = get_thread_cpu_time();
+    const double start_cpu = prev_cpu;
+    auto prev_wall = std::chrono::steady_clock::now();
+    auto start_wall = prev_wall;
+    const bool fine = tb && tb->fine();
+    if (tb) tb->begin(TraceKind::Compute);
+
+    for (int i; (i = next.fetch_add(1, std::memory_order_relaxed)) < tasks;) {
+        if (fine) tb->begin(TraceKind::Task, i);
+        task(i);
+        if (fine) tb->end(TraceKind::Task);
+        const int done = completed.fetch_add(1, std::memory_order_relaxed) + 1;
+
+        auto now = std::chrono::steady_clock::now();
+        double cur_cpu = get_thread_cpu_time();
+        double dwall = std::chrono::duration<double>(now - prev_wall).count();
+        double dcpu = cur_cpu - prev_cpu;
+        double pct = (dwall > 0.001) ? (dcpu / dwall) * 100.0 : 0.0;
+
+        ++snap.tiles_executed;
+        snap.progress = done * 100.0 / total;
+        snap.cpu_pct = pct;
+        snap.elapsed = base_time + std::chrono::duration<double>(now - start_wall).count();
+        info.live.store(snap);
+        info.cpu_samples.push(pct);
+
+        prev_cpu = cur_cpu;
+        prev_wall = now;
+    }
+
+    if (tb) tb->end(TraceKind::Compute);
+    snap.total_time = base_time + std::chrono::duration<double>(std::chrono::steady_clock::now() - start_wall).count();
+    snap.cpu_time = base_cpu + (get_thread_cpu_time() - start_cpu);
+    snap.progress = completed.load(std::memory_order_relaxed) * 100.0 / total;
+    snap.done = completed.load(std::memory_order_relaxed) >= total;
+    info.live.store(snap);
+}
+
+// ===================== Multiplier =====================
+
+Multiplier::Multiplier(const MultiplyOptions& opt)
+    : opt_(opt), cpu_topo_(read_cpu_topology()), numa_topo_(read_numa_topology()) {
+    threads_ = std::max(1, opt_.threads > 0 ? opt_.threads : default_threads(cpu_topo_, opt_.pin));
+    if (opt_.caller_runs && threads_ == 1) {
+        cores_.assign(1, -1);
+    } else {
+        cores_ = pin_map(cpu_topo_, opt_.pin, threads_);
+        pool_ = std::make_unique<ThreadPool>(threads_, opt_.park, cores_);
+    }
+    worker_node_.resize(threads_);
+    for (int i = 0; i < threads_; ++i) worker_node_[i] = cores_[i] >= 0 ? numa_topo_.node_of_cpu(cores_[i]) : 0;
+}
+
+Multiplier::~Multiplier() = default;
+
+PoolStats Multiplier::pool_stats() const { return pool_ ? pool_->stats() : PoolStats(); }
+
+void Multiplier::for_each_worker(const std::function<void(int)>& job) {
+    if (pool_) pool_->run(job);
+    else       job(0);
+}
+
+template <class T, class Acc>
+void Multiplier::plan(MultiplyPlan<T, Acc>& p, int m, int k, int n) {
+    p.m = m;
+    p.k = k;
+    p.n = n;
+    p.kernel = opt_.kernel;
+    p.uk = &microkernel_for<Acc>(opt_.simd);
+    // Strassen sin niveles seria un unico producto blocked en un solo hilo:
+    // se conserva el plan (para informar del cutoff) y se multiplica por
+    // teselas en todos los hilos.
+    if (p.kernel == GemmKernel::Strassen) {
+        p.ws.prepare(make_strassen_plan<Acc>(m, k, n, opt_.strassen_cutoff, threads_, *p.uk), *p.uk);
+        if (p.ws.plan().levels == 0) p.kernel = GemmKernel::Blocked;
+    }
+    const bool strassen = (p.kernel == GemmKernel::Strassen);
+
+    // Cada hilo empieza con un tramo contiguo de teselas; los que terminan
+    // antes roban teselas pendientes de los demas. (Strassen reparte tareas
+    // propias y no usa teselas.)
+    if (p.kernel == GemmKernel::Blocked) {
+        const MicroKernelT<Acc>& uk = *p.uk;
+        BlockSizes bs = default_block_sizes(uk);
+        choose_tile_shape(m, n, threads_, uk.mr, uk.nr, bs.mc, bs.nc, p.tile_rows, p.tile_cols);
+    } else if (p.kernel == GemmKernel::Naive) {
+        choose_tile_shape(m, n, threads_, 1, 1, m, n, p.tile_rows, p.tile_cols);
+    }
+
+    p.initial_tiles.assign(threads_, 0);
+    p.row_start.assign(threads_, 0);
+    p.row_end.assign(threads_, 0);
+    if (strassen) {
+        p.units = p.ws.total_tasks();
+        p.place.split = even_row_split(m, threads_);
+    } else {
+        TileScheduler layout(m, n, p.tile_rows, p.tile_cols, threads_);
+        p.units = layout.total_tiles();
+        p.place.split = tile_row_split(layout, m, threads_);
+        // Las teselas iniciales de dos hilos vecinos pueden compartir una
+        // franja de filas; se informan las filas disjuntas de place.split
+        for (int w = 0; w < threads_; ++w) {
+            p.initial_tiles[w] = (int)layout.initial_tiles(w);
+            p.row_start[w] = p.place.split[w];
+            p.row_end[w] = p.place.split[w + 1];
+        }
+    }
+    p.place.node = worker_node_;
+    p.place.b_remote_fraction = 0.0;
+
+    p.b_replicas.clear();
+    p.replica_of.assign(threads_, 0);
+    p.replica_rank.resize(threads_);
+    for (int w = 0; w < threads_; ++w) p.replica_rank[w] = w;
+    p.replica_size.assign(1, threads_);
+    p.interleave_packed_b = false;
+    p.route = ProductRoute();
+    p.sp = SparseOperands<T>();
+}
+
+// Cada hilo cuenta los no ceros de sus filas; con el camino elegido se
+// convierten (tambien en paralelo) los operandos dispersos una sola vez para
+// todas las repeticiones. Strassen siempre es denso. Sin on_workers las
+// mismas partes se hacen una tras otra en el hilo que llama.
+template <class T, class Acc>
+void Multiplier::route(MultiplyPlan<T, Acc>& p, ConstMatrixViewT<T> A, ConstMatrixViewT<T> B, bool on_workers) {
+    auto start = std::chrono::steady_clock::now();
+    auto for_each_part = [&](const std::function<void(int)>& job) {
+        if (on_workers) for_each_worker(job);
+        else            for (int w = 0; w < threads_; ++w) job(w);
+    };
+    const int rows_a = p.m, cols_a = p.k, cols_b = p.n;
+    const std::vector<int>& a_split = p.place.split;
+    std::vector<std::int64_t> a_row_nnz(rows_a), b_row_nnz(cols_a);
+    const std::vector<int> b_rows_split = even_row_split(cols_a, threads_);
+    for_each_part([&](int w) {
+        count_row_nonzeros(A, a_split[w], a_split[w + 1], a_row_nnz);
+        count_row_nonzeros(B, b_rows_split[w], b_rows_split[w + 1], b_row_nnz);
+    });
+    std::int64_t nnz_a = 0, nnz_b = 0;
+    for (std::int64_t v : a_row_nnz) nnz_a += v;
+    for (std::int64_t v : b_row_nnz) nnz_b += v;
+    p.route = choose_product_path(rows_a, cols_a, cols_b, nnz_a, nnz_b,
+                                  p.kernel == GemmKernel::Strassen ? ProductPath::Dense : opt_.product);
+    SparseOperands<T>& sp = p.sp;
+    sp = SparseOperands<T>();
+    sp.path = p.route.path;
+    if (sp.a_sparse()) {
+        csr_prepare(sp.a_csr, rows_a, cols_a, a_row_nnz);
+        for_each_part([&](int w) { csr_fill_rows(A, sp.a_csr, a_split[w], a_split[w + 1]); });
+    }
+    if (sp.b_csr_needed()) {
+        csr_prepare(sp.b_csr, cols_a, cols_b, b_row_nnz);
+        for_each_part([&](int w) { csr_fill_rows(B, sp.b_csr, b_rows_split[w], b_rows_split[w + 1]); });
+    }
+    if (sp.b_csc_needed()) {
+        std::vector<std::int64_t> b_col_nnz(cols_b);
+        const std::vector<int> b_cols_split = even_row_split(cols_b, threads_);
+        for_each_part([&](int w) { count_col_nonzeros(B, b_cols_split[w], b_cols_split[w + 1], b_col_nnz); });
+        csc_prepare(sp.b_csc, cols_a, cols_b, b_col_nnz);
+        for_each_part([&](int w) { csc_fill_cols(B, sp.b_csc, b_cols_split[w], b_cols_split[w + 1]); });
+    }
+    p.route_s = seconds_since(start);
+}
+
+template <class T, class Acc>
+MultiplyMetrics Multiplier::run(MultiplyPlan<T, Acc>& p, ConstMatrixViewT<T> A, ConstMatrixViewT<T> B,
+                                MatrixViewT<Acc> C, const MultiplyHooks& hooks) {
+    MultiplyMetrics mm;
+    mm.threads = threads_;
+    mm.path = p.route.path;
+    mm.nnz_a = p.route.nnz_a;
+    mm.nnz_b = p.route.nnz_b;
+    mm.route_s = p.route_s;
+    mm.units = p.units;
+    if (p.kernel != GemmKernel::Naive) mm.micro_kernel = p.uk->name;
+    if (A.rows != p.m || A.cols != p.k || B.rows != p.k || B.cols != p.n || C.rows != p.m || C.cols != p.n) {
+        mm.error = "dimensiones de A, B o C distintas de las del plan";
+        return mm;
+    }
+    const bool strassen = (p.kernel == GemmKernel::Strassen);
+
+    std::vector<std::unique_ptr<ThreadMetrics>> own;
+    std::vector<std::unique_ptr<ThreadMetrics>>& metrics = hooks.live ? *hooks.live : own;
+    if (!hooks.live)
+        for (int i = 0; i < threads_; ++i) {
+            auto m = std::make_unique<ThreadMetrics>();
+            m->thread_id = i;
+            m->core_id = cores_[i];
+            m->node = worker_node_[i];
+            m->row_start = p.row_start[i];
+            m->row_end = p.row_end[i];
+            m->initial_tiles = p.initial_tiles[i];
+            own.push_back(std::move(m));
+        }
+    auto b_of = [&](int w) { return p.b_replicas.empty() ? B : p.b_replicas[p.replica_of[w]]; };
+    auto trace_of = [&](int w) { return hooks.trace ? hooks.trace->thread(w) : nullptr; };
+    TraceBuffer* caller_trace = hooks.trace ? hooks.trace->thread(hooks.trace_caller) : nullptr;
+
+    auto start = std::chrono::steady_clock::now();
+
+    // --- Empaquetar B (repartido entre los hilos) ---
+    // Todos los workers leen la misma copia de B en micro-paneles
+    // contiguos, en lugar de recorrer B con stride n cada uno.
+    // El buffer de A de cada worker se reserva una vez por plan.
+    p.packed_b.resize(p.replica_size.size());
+    p.a_pack.resize(threads_);
+    if (p.kernel == GemmKernel::Blocked && p.route.path == ProductPath::Dense) {
+        for (auto& pb : p.packed_b) pb = make_packed_b<Acc>(p.k, p.n, *p.uk);
+        if (p.a_pack[0].uk != p.packed_b[0].uk)
+            for (auto& ap : p.a_pack) ap = make_a_pack<Acc>(*p.packed_b[0].uk);
+        if (p.interleave_packed_b)
+            numa_interleave(p.packed_b[0].buf.get(),
+                            (std::size_t)p.packed_b[0].panels * p.packed_b[0].panel_stride() * sizeof(Acc),
+                            numa_topo_.nodes);
+        if (caller_trace) caller_trace->begin(TraceKind::Wait);
+        for_each_worker([&](int w) {
+            TraceBuffer* tb = trace_of(w);
+            if (tb) tb->begin(TraceKind::Pack);
+            const int r = p.replica_of[w];
+            pack_b_panels(b_of(w), p.packed_b[r], p.replica_rank[w], p.replica_size[r]);
+            if (tb) tb->end(TraceKind::Pack);
+        });
+        if (caller_trace) caller_trace->end(TraceKind::Wait);
+        mm.pack_s = seconds_since(start);
+    }
+    if (hooks.before_compute) hooks.before_compute(mm.pack_s);
+
+    // --- Multiplicar ---
+    // Con Strassen cada fase del algoritmo es un trabajo del pool y los hilos
+    // se reparten sus tareas con un contador atomico.
+    auto compute_start = std::chrono::steady_clock::now();
+    if (caller_trace) caller_trace->begin(TraceKind::Wait);
+    if (strassen) {
+        std::atomic<int> tasks_completed{0};
+        TaskRunner runner = [&](int n, const std::function<void(int)>& task) {
+            std::atomic<int> next{0};
+            for_each_worker([&](int w) {
+                strassen_task_worker(n, task, next, tasks_completed, p.units, *metrics[w], trace_of(w));
+            });
+        };
+        gemm_strassen(A, B, C, p.ws, runner);
+    } else {
+        TileScheduler sched(p.m, p.n, p.tile_rows, p.tile_cols, threads_);
+        for_each_worker([&](int w) {
+            worker_func(A, b_of(w), p.packed_b[p.replica_of[w]], p.a_pack[w], C, p.kernel, p.sp, sched, p.place, *metrics[w],
+                        trace_of(w));
+        });
+    }
+    if (caller_trace) {
+        caller_trace->end(TraceKind::Wait);
+        caller_trace->instant(TraceKind::Join);
+    }
+    if (hooks.after_compute) hooks.after_compute();
+    mm.compute_s = seconds_since(compute_start);
+    mm.total_s = seconds_since(start);
+
+    if (p.route.path == ProductPath::SparseSparse) mm.nnz_c = 0;
+    for (int i = 0; i < threads_; ++i) {
+        const ThreadSnapshot s = metrics[i]->live.load();
+        MultiplyThreadStats ts;
+        ts.core = cores_[i];
+        ts.tiles = s.tiles_executed;
+        ts.stolen = s.tiles_stolen;
+        ts.ops = s.ops;
+        ts.time_s = s.total_time;
+        mm.per_thread.push_back(ts);
+        mm.stolen += s.tiles_stolen;
+        mm.ops += s.ops;
+        if (mm.nnz_c >= 0) mm.nnz_c += s.nonzeros_c;
+    }
+    mm.gops = mm.total_s > 0 ? 2.0 * p.m * p.k * p.n / mm.total_s / 1e9 : 0.0;
+    return mm;
+}
+
+template <class T, class Acc>
+MultiplyMetrics Multiplier::multiply(ConstMatrixViewT<T> A, ConstMatrixViewT<T> B, MatrixViewT<Acc> C) {
+    if (A.cols != B.rows || C.rows != A.rows || C.cols != B.cols) {
+        MultiplyMetrics mm;
+        mm.error = "dimensiones incompatibles: A(" + std::to_string(A.rows) + "x" + std::to_string(A.cols) +
+                   ") x B(" + std::to_string(B.rows) + "x" + std::to_string(B.cols) + ") -> C(" +
+                   std::to_string(C.rows) + "x" + std::to_string(C.cols) + ")";
+        return mm;
+    }
+    MultiplyPlan<T, Acc> p;
+    plan(p, A.rows, A.cols, B.cols);
+    route(p, A, B);
+    return run(p, A, B, C);
+}
+
+template <class T, class Acc>
+MultiplyMetrics multiply(ConstMatrixViewT<T> A, ConstMatrixViewT<T> B, MatrixViewT<Acc> C,
+                         const MultiplyOptions& opt) {
+    Multiplier mult(opt);
+    return mult.multiply(A, B, C);
+}
+
+// ===================== MultiplyQueue =====================
+
+MultiplyQueue::MultiplyQueue(const MultiplyOptions& opt, int max_ready)
+    : mult_(opt), max_ready_(std::max(1, max_ready)) {
+    prepare_thread_ = std::thread(&MultiplyQueue::prepare_loop, this);
+    compute_thread_ = std::thread(&MultiplyQueue::compute_loop, this);
+}
+
+MultiplyQueue::~MultiplyQueue() {
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        stop_ = true;
+    }
+    incoming_cv_.notify_all();
+    ready_cv_.notify_all();
+    space_cv_.notify_all();
+    prepare_thread_.join();
+    compute_thread_.join();
+}
+
+void MultiplyQueue::enqueue(std::unique_ptr<Job> job) {
+    job->submitted = std::chrono::steady_clock::now();
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        incoming_.push_back(std::move(job));
+    }
+    incoming_cv_.notify_one();
+}
+
+// Por orden de llegada: prepare() + plan + route en este hilo; luego espera
+// hueco en la cola de preparados. Al parar vacia primero lo recibido.
+void MultiplyQueue::prepare_loop() {
+    for (;;) {
+        std::unique_ptr<Job> job;
+        {
+            std::unique_lock<std::mutex> lk(mtx_);
+            incoming_cv_.wait(lk, [&] { return stop_ || !incoming_.empty(); });
+            if (incoming_.empty()) break;
+            job = std::move(incoming_.front());
+            incoming_.pop_front();
+        }
+        const auto start = std::chrono::steady_clock::now();
+        job->queue_s = std::chrono::duration<double>(start - job->submitted).count();
+        try {
+            job->prepare();
+        } catch (...) {
+            job->error = std::current_exception();
+        }
+        job->prepared = std::chrono::steady_clock::now();
+        job->prepare_s = std::chrono::duration<double>(job->prepared - start).count();
+        {
+            std::unique_lock<std::mutex> lk(mtx_);
+            space_cv_.wait(lk, [&] { return (int)ready_.size() < max_ready_; });
+            ready_.push_back(std::move(job));
+        }
+        ready_cv_.notify_one();
+    }
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        ready_.push_back(nullptr);          // fin para el hilo de calculo
+    }
+    ready_cv_.notify_one();
+}
+
+void MultiplyQueue::compute_loop() {
+    for (;;) {
+        std::unique_ptr<Job> job;
+        {
+            std::unique_lock<std::mutex> lk(mtx_);
+            ready_cv_.wait(lk, [&] { return !ready_.empty(); });
+            job = std::move(ready_.front());
+            ready_.pop_front();
+        }
+        space_cv_.notify_one();
+        if (!job) break;
+        if (job->error) {
+            job->result.set_exception(job->error);
+            continue;
+        }
+        const auto start = std::chrono::steady_clock::now();
+        try {
+            MultiplyMetrics mm = job->compute();
+            const auto done = std::chrono::steady_clock::now();
+            mm.prepare_s = job->prepare_s;
+            mm.queue_s = job->queue_s + std::chrono::duration<double>(start - job->prepared).count();
+            mm.latency_s = std::chrono::duration<double>(done - job->submitted).count();
+            job->result.set_value(std::move(mm));
+        } catch (...) {
+            job->result.set_exception(std::current_exception());
+        }
+    }
+}
+
+// El plan vive en el trabajo; prepare y compute lo comparten por puntero.
+template <class T, class Acc>
+std::future<MultiplyMetrics> MultiplyQueue::submit(ConstMatrixViewT<T> A, ConstMatrixViewT<T> B,
+                                                   MatrixViewT<Acc> C, std::function<void()> prepare) {
+    auto job = std::make_unique<Job>();
+    std::future<MultiplyMetrics> fut = job->result.get_future();
+    if (A.cols != B.rows || C.rows != A.rows || C.cols != B.cols) {
+        MultiplyMetrics mm;
+        mm.error = "dimensiones incompatibles: A(" + std::to_string(A.rows) + "x" + std::to_string(A.cols) +
+                   ") x B(" + std::to_string(B.rows) + "x" + std::to_string(B.cols) + ") -> C(" +
+                   std::to_string(C.rows) + "x" + std::to_string(C.cols) + ")";
+        job->result.set_value(std::move(mm));
+        return fut;
+    }
+    auto plan = std::make_shared<MultiplyPlan<T, Acc>>();
+    Multiplier* mult = &mult_;
+    job->prepare = [=] {
+        if (prepare) prepare();
+        mult->plan(*plan, A.rows, A.cols, B.cols);
+        mult->route(*plan, A, B, false);
+    };
+    job->compute = [=] {
+        MultiplyMetrics mm = mult->run(*plan, A, B, C);
+        *plan = MultiplyPlan<T, Acc>();     // suelta CSR/CSC y B empaquetada ya
+        return mm;
+    };
+    enqueue(std::move(job));
+    return fut;
+}
+
+// ===================== Instancias =====================
+
+#define MM_MATMUL_INSTANTIATE(T, Acc)                                                                      \
+    template void Multiplier::plan<T, Acc>(MultiplyPlan<T, Acc>&, int, int, int);                         \
+    template void Multiplier::route<T, Acc>(MultiplyPlan<T, Acc>&, ConstMatrixViewT<T>, ConstMatrixViewT<T>, \
+                                            bool);                                                         \
+    template MultiplyMetrics Multiplier::run<T, Acc>(MultiplyPlan<T, Acc>&, ConstMatrixViewT<T>,            \
+                                                     ConstMatrixViewT<T>, MatrixViewT<Acc>,                 \
+                                                     const MultiplyHooks&);                                 \
+    template MultiplyMetrics Multiplier::multiply<T, Acc>(ConstMatrixViewT<T>, ConstMatrixViewT<T>,         \
+                                                          MatrixViewT<Acc>);                                \
+    template MultiplyMetrics multiply<T, Acc>(ConstMatrixViewT<T>, ConstMatrixViewT<T>, MatrixViewT<Acc>,   \
+                                              const MultiplyOptions&);                                      \
+    template std::future<MultiplyMetrics> MultiplyQueue::submit<T, Acc>(ConstMatrixViewT<T>,                \
+                                                                        ConstMatrixViewT<T>,                \
+                                                                        MatrixViewT<Acc>,                   \
+                                                                        std::function<void()>);
+
+MM_MATMUL_INSTANTIATE(std::int16_t, std::int32_t)
+MM_MATMUL_INSTANTIATE(std::int16_t, std::int64_t)
+MM_MATMUL_INSTANTIATE(std::int32_t, std::int64_t)
+MM_MATMUL_INSTANTIATE(std::int32_t, std::int32_t)
+MM_MATMUL_INSTANTIATE(std::int64_t, std::int64_t)
+MM_MATMUL_INSTANTIATE(float, float)
+MM_MATMUL_INSTANTIATE(float, double)
+MM_MATMUL_INSTANTIATE(double, double)
+
+#undef MM_MATMUL_INSTANTIATE
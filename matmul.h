@@ -0,0 +1,298 @@
+// Biblioteca de multiplicacion: el motor de MMP y MMS para usarlo desde otro
+// programa sin lanzar un ejecutable ni leer su consola.
+//
+//   multiply(A, B, C, opciones)   C = A x B en un pool creado para la llamada;
+//                                 devuelve MultiplyMetrics
+//   Multiplier                    pool persistente de hilos fijados a cores
+//                                 (topology.h) para muchas multiplicaciones
+//     plan()                      teselas, reparto inicial y plan de Strassen
+//                                 (solo dependen de las dimensiones)
+//     route()                     cuenta no ceros de A y B, elige el camino del
+//                                 producto y convierte a CSR/CSC (sparse.h)
+//     run()                       empaqueta B y multiplica con robo de teselas;
+//                                 se puede repetir con el mismo plan
+//   MultiplyHooks                 estado vivo por hilo, avisos alrededor del
+//                                 computo y traza de eventos (trace.h), para
+//                                 quien monitoriza (MMP)
+//   MultiplyQueue                 envio asincrono: submit() devuelve un
+//                                 std::future por multiplicacion; la
+//                                 preparacion de un trabajo se solapa con el
+//                                 calculo del anterior en el mismo pool
+//
+// Las plantillas se instancian en matmul.cpp para las parejas (T, Acc) de
+// element.h; el resto del programa solo ve estas declaraciones. Nada escribe
+// en consola: los errores vuelven en MultiplyMetrics::error.
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "element.h"
+#include "gemm.h"
+#include "matrix.h"
+#include "metrics.h"
+#include "microkernel.h"
+#include "numa.h"
+#include "perf_counters.h"
+#include "sparse.h"
+#include "strassen.h"
+#include "thread_pool.h"
+#include "topology.h"
+#include "trace.h"
+
+// Limites de filas [split[w], split[w+1]) en partes casi iguales.
+inline std::vector<int> even_row_split(int rows, int parts) {
+    std::vector<int> split(parts + 1);
+    for (int w = 0; w <= parts; ++w) split[w] = (int)((long long)rows * w / parts);
+    return split;
+}
+
+// ===================== Opciones y resultados =====================
+
+struct MultiplyOptions {
+    int threads = 0;                        // 0 = uno por CPU logico (por core con physical-only)
+    GemmKernel kernel = GemmKernel::Blocked;
+    PinPolicy pin = PinPolicy::Scatter;
+    ParkPolicy park = ParkPolicy::Hybrid;
+    SimdIsa simd = best_supported_isa();    // micro-kernel de este Multiplier (no el activo del proceso)
+    ProductPath product = ProductPath::Auto;
+    int strassen_cutoff = 0;                // 0 = calibrado la primera vez
+    bool caller_runs = false;               // con un hilo, trabajar en el que llama (sin pool)
+};
+
+struct MultiplyThreadStats {
+    int core = -1;
+    int tiles = 0;                          // teselas (o tareas Strassen) hechas
+    int stolen = 0;
+    double ops = 0.0;
+    double time_s = 0.0;
+};
+
+struct MultiplyMetrics {
+    std::string error;                      // vacio = correcto
+    int threads = 0;
+    std::string micro_kernel;               // vacio con naive
+    ProductPath path = ProductPath::Dense;
+    std::int64_t nnz_a = 0, nnz_b = 0;
+    long long nnz_c = -1;                   // solo con A y B dispersas
+    int units = 0;                          // teselas o tareas Strassen
+    int stolen = 0;
+    double route_s = 0.0;                   // conteo de no ceros y conversion
+    double pack_s = 0.0;
+    double compute_s = 0.0;
+    double total_s = 0.0;                   // empaquetado + multiplicacion
+    double ops = 0.0;                       // hechas (2 por multiplicacion-suma)
+    double gops = 0.0;                      // 2*M*K*N / total_s
+    std::vector<MultiplyThreadStats> per_thread;
+
+    // Solo trabajos de MultiplyQueue
+    double prepare_s = 0.0;                 // prepare() del trabajo + plan + route
+    double queue_s = 0.0;                   // esperando turno (para preparar y para el pool)
+    double latency_s = 0.0;                 // submit() -> resultado
+};
+
+// ===================== Estado vivo por hilo =====================
+
+// El worker publica una instantanea completa tras cada tesela y quien
+// monitoriza la copia sin tomar ningun lock.
+struct ThreadSnapshot {
+    unsigned long native_tid = 0;
+    int tiles_executed = 0;     // incluye las robadas
+    int tiles_stolen = 0;
+    int tiles_remote = 0;       // teselas cuyas filas de A y C estan en otro nodo
+    double bytes_local = 0.0;   // trafico estimado de A, B y C (local / remoto)
+    double bytes_remote = 0.0;
+    double ops = 0.0;           // multiplicaciones + sumas de las teselas hechas
+    long long nonzeros_c = 0;   // no ceros estructurales de C (solo A y B dispersas)
+    double progress = 0.0;      // progreso global de C (todas las teselas)
+    double cpu_pct = 0.0;
+    double elapsed = 0.0;
+    double total_time = 0.0;    // wall del hilo en la multiplicacion
+    double cpu_time = 0.0;      // CPU del hilo en la multiplicacion (clock por hilo)
+    bool started = false;
+    bool done = false;
+};
+
+// Una por hilo y alineada a linea de cache: los campos fijos se escriben
+// antes de lanzar el trabajo; el resto lo escribe solo su worker.
+struct alignas(CACHE_LINE) ThreadMetrics {
+    int thread_id = 0;
+    int core_id = 0;
+    int node = 0;               // nodo NUMA del core
+    int row_start = 0;          // filas propias [row_start, row_end): las que el hilo
+    int row_end = 0;            // toca primero (NumaPlacement::split), disjuntas
+    int initial_tiles = 0;
+    SeqlockCell<ThreadSnapshot> live;
+    SampleRing<double, 1024> cpu_samples;   // %CPU por tesela (worker -> monitor)
+    SampleStats cpu_stats;                  // lo acumula quien vacia la cola
+    PerfCounts hw;                          // contadores hardware (tras el join)
+
+    // Solo desde el consumidor de la cola (monitor, o main tras el join).
+    void drain_samples() {
+        double v;
+        while (cpu_samples.pop(v)) cpu_stats.add(v);
+    }
+};
+
+struct MultiplyHooks {
+    // Metricas por hilo ya creadas (una por worker) que run() rellena en vivo;
+    // nulo = run() usa las suyas.
+    std::vector<std::unique_ptr<ThreadMetrics>>* live = nullptr;
+    std::function<void(double pack_s)> before_compute;     // B ya empaquetada
+    std::function<void()> after_compute;                   // tras el join
+
+    // Traza (trace.h): el worker w escribe en trace->thread(w) y el hilo que
+    // llama a run() en trace->thread(trace_caller) (-1 = no registra).
+    Tracer* trace = nullptr;
+    int trace_caller = -1;
+};
+
+// ===================== Plan =====================
+
+// Todo lo que se decide una vez y sirve para todas las repeticiones.
+template <class T, class Acc>
+struct MultiplyPlan {
+    int m = 0, k = 0, n = 0;
+    GemmKernel kernel = GemmKernel::Blocked;    // Strassen sin niveles queda en Blocked
+    const MicroKernelT<Acc>* uk = nullptr;      // de MultiplyOptions::simd: teselas, paneles y hojas
+
+    // Teselas de C (no con Strassen) y tramo inicial de cada hilo
+    int tile_rows = 0, tile_cols = 0;
+    int units = 0;                          // teselas o tareas Strassen
+    std::vector<int> initial_tiles, row_start, row_end;
+    StrassenWorkspace<Acc> ws;
+
+    // Filas de A que usa primero cada hilo: quien las genera o carga deberia
+    // tocarlas primero (numa.h). node_of_row() da el nodo de cada fila.
+    NumaPlacement place;
+
+    // B por hilo: sin rellenar todos leen la B de run(). Con replicas (una por
+    // nodo NUMA) el hilo w lee b_replicas[replica_of[w]] y empaqueta la parte
+    // replica_rank[w] de replica_size[] de su replica.
+    std::vector<ConstMatrixViewT<T>> b_replicas;
+    std::vector<int> replica_of, replica_rank, replica_size;
+    bool interleave_packed_b = false;       // B empaquetada intercalada entre nodos
+
+    // Camino del producto (route())
+    ProductRoute route;
+    SparseOperands<T> sp;
+    double route_s = 0.0;
+
+    std::vector<PackedBT<Acc>> packed_b;    // una por replica, la rehace run()
+    std::vector<APackBufferT<Acc>> a_pack;  // una por worker, reservada en el primer run()
+};
+
+// ===================== Multiplicador =====================
+
+class Multiplier {
+public:
+    explicit Multiplier(const MultiplyOptions& opt = MultiplyOptions());
+    ~Multiplier();
+
+    Multiplier(const Multiplier&) = delete;
+    Multiplier& operator=(const Multiplier&) = delete;
+
+    const MultiplyOptions& options() const { return opt_; }
+    int threads() const { return threads_; }
+    const std::vector<int>& cores() const { return cores_; }
+    const std::vector<int>& worker_nodes() const { return worker_node_; }
+    const CpuTopology& cpu_topology() const { return cpu_topo_; }
+    const NumaTopology& numa_topology() const { return numa_topo_; }
+    PoolStats pool_stats() const;
+
+    // job(w) en cada worker (w = 0..threads()-1) y espera a todos; sirve para
+    // que quien llama genere o toque los datos desde los hilos que los usaran.
+    void for_each_worker(const std::function<void(int)>& job);
+
+    template <class T, class Acc>
+    void plan(MultiplyPlan<T, Acc>& p, int m, int k, int n);
+
+    // on_workers = false: todo en el hilo que llama, sin tocar el pool (asi
+    // se prepara un trabajo mientras el pool multiplica otro).
+    template <class T, class Acc>
+    void route(MultiplyPlan<T, Acc>& p, ConstMatrixViewT<T> A, ConstMatrixViewT<T> B, bool on_workers = true);
+
+    template <class T, class Acc>
+    MultiplyMetrics run(MultiplyPlan<T, Acc>& p, ConstMatrixViewT<T> A, ConstMatrixViewT<T> B,
+                        MatrixViewT<Acc> C, const MultiplyHooks& hooks = MultiplyHooks());
+
+    // plan + route + run (C debe ser A.rows x B.cols)
+    template <class T, class Acc>
+    MultiplyMetrics multiply(ConstMatrixViewT<T> A, ConstMatrixViewT<T> B, MatrixViewT<Acc> C);
+
+private:
+    MultiplyOptions opt_;
+    CpuTopology cpu_topo_;
+    NumaTopology numa_topo_;
+    int threads_ = 1;
+    std::vector<int> cores_;
+    std::vector<int> worker_node_;
+    std::unique_ptr<ThreadPool> pool_;      // nulo con caller_runs y un hilo
+};
+
+// Una multiplicacion con su propio pool.
+template <class T, class Acc>
+MultiplyMetrics multiply(ConstMatrixViewT<T> A, ConstMatrixViewT<T> B, MatrixViewT<Acc> C,
+                         const MultiplyOptions& opt = MultiplyOptions());
+
+// ===================== Envio asincrono =====================
+
+// Cola de multiplicaciones con un std::future por trabajo. Todos comparten
+// el pool de un Multiplier. Un hilo de preparacion ejecuta, por orden de
+// llegada, el prepare() del trabajo (generar o cargar A y B), plan() y
+// route() sin usar el pool; un hilo de calculo pasa los trabajos preparados
+// por run(). Asi el trabajo i+1 se prepara mientras el pool multiplica el i.
+// Como mucho max_ready trabajos preparados esperan al pool (acota la memoria
+// de sus planes y operandos dispersos).
+//
+// A, B y C deben seguir vivas hasta que el future este listo. Si prepare()
+// lanza una excepcion, el future la devuelve en get(). Con Strassen sin
+// cutoff fijado la calibracion de plan() se mide con el pool ocupado.
+class MultiplyQueue {
+public:
+    explicit MultiplyQueue(const MultiplyOptions& opt = MultiplyOptions(), int max_ready = 2);
+    ~MultiplyQueue();                       // termina todo lo enviado
+
+    MultiplyQueue(const MultiplyQueue&) = delete;
+    MultiplyQueue& operator=(const MultiplyQueue&) = delete;
+
+    int threads() const { return mult_.threads(); }
+    const std::vector<int>& cores() const { return mult_.cores(); }
+    PoolStats pool_stats() const { return mult_.pool_stats(); }
+
+    template <class T, class Acc>
+    std::future<MultiplyMetrics> submit(ConstMatrixViewT<T> A, ConstMatrixViewT<T> B, MatrixViewT<Acc> C,
+                                        std::function<void()> prepare = nullptr);
+
+private:
+    struct Job {
+        std::function<void()> prepare;      // hilo de preparacion
+        std::function<MultiplyMetrics()> compute;
+        std::promise<MultiplyMetrics> result;
+        std::exception_ptr error;
+        std::chrono::steady_clock::time_point submitted, prepared;
+        double prepare_s = 0.0, queue_s = 0.0;
+    };
+
+    void enqueue(std::unique_ptr<Job> job);
+    void prepare_loop();
+    void compute_loop();
+
+    Multiplier mult_;
+    const int max_ready_;
+    std::mutex mtx_;
+    std::condition_variable incoming_cv_, ready_cv_, space_cv_;
+    std::deque<std::unique_ptr<Job>> incoming_, ready_;
+    bool stop_ = false;
+    std::thread prepare_thread_, compute_thread_;
+};
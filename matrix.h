@@ -0,0 +1,192 @@
+// Matriz densa en orden fila-mayor con un unico buffer contiguo y alineado,
+// parametrizada por el tipo de elemento (int16/int32/int64/float/double).
+//
+// Sustituye a std::vector<std::vector<int>>: todas las filas viven en una
+// sola reserva de memoria alineada a linea de cache y separadas por un
+// "stride" (elementos por fila, con relleno) multiplo de 64 bytes, de modo
+// que cada fila empieza alineada y B(k, j) se resuelve con aritmetica de
+// punteros en lugar de una indireccion por fila.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <utility>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+static constexpr std::size_t MATRIX_ALIGN = 64;   // bytes (una linea de cache)
+
+// ===================== Memoria alineada =====================
+
+inline void* aligned_malloc(std::size_t bytes, std::size_t align = MATRIX_ALIGN) {
+    if (bytes == 0) bytes = align;
+#ifdef _WIN32
+    void* p = _aligned_malloc(bytes, align);
+#else
+    void* p = nullptr;
+    if (posix_memalign(&p, align, bytes) != 0) p = nullptr;
+#endif
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+inline void aligned_free(void* p) {
+#ifdef _WIN32
+    _aligned_free(p);
+#else
+    std::free(p);
+#endif
+}
+
+struct AlignedDeleter {
+    void operator()(void* p) const { aligned_free(p); }
+};
+
+// Buffer de una MatrixT: propio (aligned_free) o ajeno, por ejemplo un
+// fichero proyectado en memoria; en ese caso solo se suelta la referencia a
+// `owner`, que deshace la proyeccion cuando ya nadie la usa.
+struct MatrixBufferDeleter {
+    std::shared_ptr<void> owner;
+    void operator()(void* p) const { if (!owner) aligned_free(p); }
+};
+
+// ===================== Vistas (no propietarias) =====================
+
+// Vista de solo lectura sobre una submatriz: puntero al elemento (0,0),
+// dimensiones y stride de la matriz original. Copiarla es gratis.
+template <class T>
+struct ConstMatrixViewT {
+    const T* data = nullptr;
+    int rows = 0;
+    int cols = 0;
+    int stride = 0;
+
+    const T* row(int i) const { return data + (std::size_t)i * stride; }
+    T operator()(int i, int j) const { return data[(std::size_t)i * stride + j]; }
+
+    ConstMatrixViewT view(int r0, int c0, int nr, int nc) const {
+        return { row(r0) + c0, nr, nc, stride };
+    }
+};
+
+template <class T>
+struct MatrixViewT {
+    T* data = nullptr;
+    int rows = 0;
+    int cols = 0;
+    int stride = 0;
+
+    T* row(int i) const { return data + (std::size_t)i * stride; }
+    T& operator()(int i, int j) const { return data[(std::size_t)i * stride + j]; }
+
+    MatrixViewT view(int r0, int c0, int nr, int nc) const {
+        return { row(r0) + c0, nr, nc, stride };
+    }
+
+    operator ConstMatrixViewT<T>() const { return { data, rows, cols, stride }; }
+    ConstMatrixViewT<T> as_const() const { return { data, rows, cols, stride }; }
+};
+
+// ===================== Matriz propietaria =====================
+
+template <class T>
+class MatrixT {
+public:
+    using value_type = T;
+
+    MatrixT() = default;
+
+    // Reserva rows x cols inicializada a cero.
+    MatrixT(int rows, int cols)
+        : rows_(rows), cols_(cols), stride_(padded_stride(cols)) {
+        std::size_t bytes = size_bytes();
+        buf_.reset(static_cast<T*>(aligned_malloc(bytes)));
+        std::memset(buf_.get(), 0, bytes);
+    }
+
+    // Reserva sin escribir: la primera escritura decide en que nodo NUMA
+    // quedan las paginas, asi que la hace el hilo que luego usara cada fila.
+    // Quien llama debe escribir todas las filas antes de leerlas.
+    static MatrixT uninitialized(int rows, int cols) {
+        MatrixT m;
+        m.rows_ = rows;
+        m.cols_ = cols;
+        m.stride_ = padded_stride(cols);
+        m.buf_.reset(static_cast<T*>(aligned_malloc(m.size_bytes())));
+        return m;
+    }
+
+    // Matriz sobre memoria ajena con el mismo formato (fila-mayor, stride
+    // padded_stride(cols), alineada a MATRIX_ALIGN); `owner` la mantiene viva.
+    static MatrixT adopt(T* data, int rows, int cols, std::shared_ptr<void> owner) {
+        MatrixT m;
+        m.rows_ = rows;
+        m.cols_ = cols;
+        m.stride_ = padded_stride(cols);
+        m.buf_ = std::unique_ptr<T[], MatrixBufferDeleter>(data, MatrixBufferDeleter{ std::move(owner) });
+        return m;
+    }
+
+    MatrixT(const MatrixT& o) : MatrixT(o.rows_, o.cols_) {
+        if (o.buf_) std::memcpy(buf_.get(), o.buf_.get(), size_bytes());
+    }
+    MatrixT& operator=(const MatrixT& o) {
+        if (this != &o) { MatrixT t(o); swap(t); }
+        return *this;
+    }
+    MatrixT(MatrixT&&) noexcept = default;
+    MatrixT& operator=(MatrixT&&) noexcept = default;
+
+    void swap(MatrixT& o) noexcept {
+        buf_.swap(o.buf_);
+        std::swap(rows_, o.rows_);
+        std::swap(cols_, o.cols_);
+        std::swap(stride_, o.stride_);
+    }
+
+    int rows() const { return rows_; }
+    int cols() const { return cols_; }
+    int stride() const { return stride_; }
+    bool empty() const { return rows_ == 0 || cols_ == 0; }
+
+    T* data() { return buf_.get(); }
+    const T* data() const { return buf_.get(); }
+
+    T* row(int i) { return buf_.get() + (std::size_t)i * stride_; }
+    const T* row(int i) const { return buf_.get() + (std::size_t)i * stride_; }
+
+    T& operator()(int i, int j) { return row(i)[j]; }
+    T operator()(int i, int j) const { return row(i)[j]; }
+
+    MatrixViewT<T> view() { return { data(), rows_, cols_, stride_ }; }
+    ConstMatrixViewT<T> view() const { return { data(), rows_, cols_, stride_ }; }
+    MatrixViewT<T> view(int r0, int c0, int nr, int nc) { return view().view(r0, c0, nr, nc); }
+    ConstMatrixViewT<T> view(int r0, int c0, int nr, int nc) const { return view().view(r0, c0, nr, nc); }
+    ConstMatrixViewT<T> cview() const { return view(); }
+
+    // Bytes reservados (incluye el relleno al final de cada fila).
+    std::size_t size_bytes() const { return (std::size_t)rows_ * stride_ * sizeof(T); }
+
+    // Stride en elementos: cols redondeado a un multiplo de MATRIX_ALIGN bytes.
+    static int padded_stride(int cols) {
+        const int per_line = (int)(MATRIX_ALIGN / sizeof(T));
+        return (cols + per_line - 1) / per_line * per_line;
+    }
+
+private:
+    std::unique_ptr<T[], MatrixBufferDeleter> buf_;
+    int rows_ = 0;
+    int cols_ = 0;
+    int stride_ = 0;
+};
+
+// Nombres historicos: la matriz int32 que usaban MMS y MMP.
+using Matrix = MatrixT<int>;
+using MatrixView = MatrixViewT<int>;
+using ConstMatrixView = ConstMatrixViewT<int>;
@@ -0,0 +1,309 @@
+// Formato binario de matrices (.mmx) leido y escrito con mmap.
+//
+//   bytes 0..63     cabecera (MatrixFileHeader)
+//   bytes 64..4095  ceros
+//   bytes 4096..    filas de `stride` elementos, como en MatrixT (fila-mayor,
+//                   cada fila alineada a 64 bytes, relleno a cero)
+//
+// Los datos empiezan en una frontera de pagina y tienen exactamente el
+// formato de MatrixT, asi que al cargar no se analiza ni se copia nada: la
+// matriz apunta a la proyeccion del fichero y el kernel lee directamente de
+// la cache de paginas. C se escribe igual: se crea el fichero con su tamano
+// final, se proyecta y el calculo escribe en el.
+//
+// La suma de comprobacion es FNV-1a de 64 bits sobre palabras de 8 bytes de
+// toda la zona de datos (relleno incluido). Todos los campos son little
+// endian (x86, ARM habitual); no se convierte el orden de bytes.
+
+#pragma once
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include "element.h"
+#include "matrix.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static constexpr char MATRIX_FILE_MAGIC[8] = { 'M', 'M', 'X', 'M', 'A', 'T', '0', '1' };
+static constexpr std::uint64_t MATRIX_FILE_DATA_OFFSET = 4096;
+
+enum : std::uint32_t { MATRIX_LAYOUT_ROW_MAJOR = 0 };
+
+struct MatrixFileHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t elem_type;        // ElemType
+    std::uint32_t layout;           // MATRIX_LAYOUT_ROW_MAJOR
+    std::uint32_t alignment;        // bytes de alineacion de cada fila
+    std::uint64_t rows;
+    std::uint64_t cols;
+    std::uint64_t stride;           // elementos por fila, con relleno
+    std::uint64_t data_offset;
+    std::uint64_t checksum;
+};
+static_assert(sizeof(MatrixFileHeader) == 64, "la cabecera ocupa 64 bytes");
+
+static constexpr std::uint64_t MATRIX_CHECKSUM_SEED = 0xcbf29ce484222325ULL;
+
+// Se puede calcular por trozos pasando la suma del trozo anterior como `h`
+// (todos los trozos salvo el ultimo con un numero de bytes multiplo de 8).
+inline std::uint64_t matrix_checksum(const void* data, std::size_t bytes, std::uint64_t h = MATRIX_CHECKSUM_SEED) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    std::size_t i = 0;
+    for (; i + 8 <= bytes; i += 8) {
+        std::uint64_t w;
+        std::memcpy(&w, p + i, 8);
+        h = (h ^ w) * 0x100000001b3ULL;
+    }
+    for (; i < bytes; ++i) h = (h ^ p[i]) * 0x100000001b3ULL;
+    return h;
+}
+
+// ===================== Fichero proyectado =====================
+
+class MappedFile {
+public:
+    ~MappedFile() {
+#ifdef _WIN32
+        if (base_) UnmapViewOfFile(base_);
+        if (mapping_) CloseHandle(mapping_);
+        if (file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+#else
+        if (base_) munmap(base_, size_);
+        if (fd_ >= 0) close(fd_);
+#endif
+    }
+
+    // Proyecta un fichero existente entero (solo lectura).
+    static std::shared_ptr<MappedFile> open_read(const std::string& path, std::string& err) {
+        return map(path, 0, false, err);
+    }
+
+    // Crea (o trunca) un fichero de `bytes` bytes y lo proyecta para escribir.
+    static std::shared_ptr<MappedFile> create(const std::string& path, std::size_t bytes, std::string& err) {
+        return map(path, bytes, true, err);
+    }
+
+    unsigned char* data() const { return static_cast<unsigned char*>(base_); }
+    std::size_t size() const { return size_; }
+
+    // Fuerza la escritura a disco de lo modificado.
+    bool flush() const {
+#ifdef _WIN32
+        return FlushViewOfFile(base_, 0) && FlushFileBuffers(file_);
+#else
+        return msync(base_, size_, MS_SYNC) == 0;
+#endif
+    }
+
+    // Vuelca solo [offset, offset + bytes) (en Linux desde el inicio de su
+    // pagina), p. ej. cada panel de C en cuanto esta terminado.
+    bool flush_range(std::size_t offset, std::size_t bytes) const {
+        if (bytes == 0) return true;
+#ifdef _WIN32
+        return FlushViewOfFile(data() + offset, bytes) != 0;
+#else
+        const std::size_t page = (std::size_t)sysconf(_SC_PAGESIZE);
+        const std::size_t start = offset / page * page;
+        return msync(data() + start, offset + bytes - start, MS_SYNC) == 0;
+#endif
+    }
+
+private:
+    MappedFile() = default;
+
+    static std::shared_ptr<MappedFile> map(const std::string& path, std::size_t bytes, bool write, std::string& err) {
+        std::shared_ptr<MappedFile> f(new MappedFile());
+#ifdef _WIN32
+        f->file_ = CreateFileA(path.c_str(), write ? (GENERIC_READ | GENERIC_WRITE) : GENERIC_READ,
+                               FILE_SHARE_READ, nullptr, write ? CREATE_ALWAYS : OPEN_EXISTING,
+                               FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (f->file_ == INVALID_HANDLE_VALUE) { err = "no se pudo abrir " + path; return nullptr; }
+        LARGE_INTEGER sz;
+        if (write) {
+            sz.QuadPart = (LONGLONG)bytes;
+        } else if (!GetFileSizeEx(f->file_, &sz)) {
+            err = "no se pudo leer el tamano de " + path;
+            return nullptr;
+        }
+        f->size_ = (std::size_t)sz.QuadPart;
+        if (f->size_ == 0) { err = path + " esta vacio"; return nullptr; }
+        f->mapping_ = CreateFileMappingA(f->file_, nullptr, write ? PAGE_READWRITE : PAGE_READONLY,
+                                         sz.HighPart, sz.LowPart, nullptr);
+        if (!f->mapping_) { err = "CreateFileMapping fallo para " + path; return nullptr; }
+        f->base_ = MapViewOfFile(f->mapping_, write ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, 0);
+        if (!f->base_) { err = "MapViewOfFile fallo para " + path; return nullptr; }
+#else
+        f->fd_ = ::open(path.c_str(), write ? (O_RDWR | O_CREAT | O_TRUNC) : O_RDONLY, 0644);
+        if (f->fd_ < 0) { err = "no se pudo abrir " + path + ": " + std::strerror(errno); return nullptr; }
+        if (write) {
+            if (ftruncate(f->fd_, (off_t)bytes) != 0) {
+                err = "no se pudo reservar " + path + ": " + std::strerror(errno);
+                return nullptr;
+            }
+            f->size_ = bytes;
+        } else {
+            struct stat st;
+            if (fstat(f->fd_, &st) != 0) { err = "no se pudo leer el tamano de " + path; return nullptr; }
+            f->size_ = (std::size_t)st.st_size;
+        }
+        if (f->size_ == 0) { err = path + " esta vacio"; return nullptr; }
+        void* p = mmap(nullptr, f->size_, write ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, f->fd_, 0);
+        if (p == MAP_FAILED) { err = "mmap fallo para " + path + ": " + std::strerror(errno); return nullptr; }
+        f->base_ = p;
+#endif
+        return f;
+    }
+
+    void* base_ = nullptr;
+    std::size_t size_ = 0;
+#ifdef _WIN32
+    HANDLE file_ = INVALID_HANDLE_VALUE;
+    HANDLE mapping_ = nullptr;
+#else
+    int fd_ = -1;
+#endif
+};
+
+// ===================== Lectura =====================
+
+// Comprueba una cabecera leida de un fichero de `file_size` bytes.
+inline bool validate_matrix_header(const MatrixFileHeader& h, std::uint64_t file_size, const std::string& path,
+                                   std::string& err) {
+    if (std::memcmp(h.magic, MATRIX_FILE_MAGIC, 8) != 0) { err = path + ": no es un fichero .mmx"; return false; }
+    if (h.version != 1) { err = path + ": version " + std::to_string(h.version) + " no soportada"; return false; }
+    if (h.layout != MATRIX_LAYOUT_ROW_MAJOR) { err = path + ": solo se admite orden fila-mayor"; return false; }
+    if (h.elem_type > (std::uint32_t)ElemType::Double) { err = path + ": tipo de elemento desconocido"; return false; }
+    const ElemType t = (ElemType)h.elem_type;
+    const std::uint64_t elem = (t == ElemType::Int16) ? 2 : (t == ElemType::Int32 || t == ElemType::Float) ? 4 : 8;
+    // El stride va de cols al de MatrixT (cols redondeado a MATRIX_ALIGN
+    // bytes): una cabecera manipulada no puede pedir filas enormes.
+    const std::uint64_t per_line = MATRIX_ALIGN / elem;
+    if (h.rows == 0 || h.cols == 0 || h.rows > 0x7fffffff || h.cols > 0x7fffffff || h.stride < h.cols ||
+        h.stride > (h.cols + per_line - 1) / per_line * per_line) {
+        err = path + ": dimensiones invalidas";
+        return false;
+    }
+    // Con division: rows * stride * elem puede desbordar 64 bits
+    if (h.data_offset % 4096 != 0 || file_size < h.data_offset ||
+        h.rows > (file_size - h.data_offset) / (h.stride * elem)) {
+        err = path + ": datos incompletos";
+        return false;
+    }
+    return true;
+}
+
+// Comprueba la cabecera de un fichero ya proyectado.
+inline bool check_matrix_header(const MappedFile& f, const std::string& path, MatrixFileHeader& h, std::string& err) {
+    if (f.size() < sizeof(h)) { err = path + ": fichero demasiado corto"; return false; }
+    std::memcpy(&h, f.data(), sizeof(h));
+    return validate_matrix_header(h, f.size(), path, err);
+}
+
+// Lee solo la cabecera (para decidir el tipo antes de instanciar).
+inline bool read_matrix_header(const std::string& path, MatrixFileHeader& h, std::string& err) {
+    auto f = MappedFile::open_read(path, err);
+    return f && check_matrix_header(*f, path, h, err);
+}
+
+// Proyecta un .mmx como MatrixT<T> sin copiar. Falla si el tipo no es T o el
+// stride no es el de MatrixT<T>; con `verify` comprueba la suma.
+template <class T>
+inline bool load_matrix_file(const std::string& path, MatrixT<T>& out, std::string& err, bool verify = true) {
+    auto f = MappedFile::open_read(path, err);
+    MatrixFileHeader h;
+    if (!f || !check_matrix_header(*f, path, h, err)) return false;
+    if ((ElemType)h.elem_type != ElemTraits<T>::id) {
+        err = path + ": contiene " + elem_type_name((ElemType)h.elem_type) + " y se esperaba " + elem_name<T>();
+        return false;
+    }
+    if (h.stride != (std::uint64_t)MatrixT<T>::padded_stride((int)h.cols)) {
+        err = path + ": stride " + std::to_string(h.stride) + " distinto del de MatrixT";
+        return false;
+    }
+    T* data = reinterpret_cast<T*>(f->data() + h.data_offset);
+    const std::size_t bytes = (std::size_t)h.rows * h.stride * sizeof(T);
+    if (verify && matrix_checksum(data, bytes) != h.checksum) {
+        err = path + ": la suma de comprobacion no coincide";
+        return false;
+    }
+    out = MatrixT<T>::adopt(data, (int)h.rows, (int)h.cols, f);
+    return true;
+}
+
+// ===================== Escritura =====================
+
+// Cabecera de una matriz rows x cols de T con el stride de MatrixT (la suma
+// queda a cero hasta que se conocen los datos).
+template <class T>
+inline MatrixFileHeader make_matrix_header(int rows, int cols) {
+    MatrixFileHeader h;
+    std::memset(&h, 0, sizeof(h));
+    std::memcpy(h.magic, MATRIX_FILE_MAGIC, 8);
+    h.version = 1;
+    h.elem_type = (std::uint32_t)ElemTraits<T>::id;
+    h.layout = MATRIX_LAYOUT_ROW_MAJOR;
+    h.alignment = (std::uint32_t)MATRIX_ALIGN;
+    h.rows = (std::uint64_t)rows;
+    h.cols = (std::uint64_t)cols;
+    h.stride = (std::uint64_t)MatrixT<T>::padded_stride(cols);
+    h.data_offset = MATRIX_FILE_DATA_OFFSET;
+    return h;
+}
+
+// Fichero de salida proyectado: `matrix` escribe directamente en el fichero
+// y finish() completa la cabecera con la suma y lo vuelca a disco.
+template <class T>
+struct MatrixFileOut {
+    MatrixT<T> matrix;
+    std::shared_ptr<MappedFile> file;
+
+    bool finish(std::string& err) { return finish(err, matrix_checksum(matrix.data(), matrix.size_bytes())); }
+
+    // Con la suma ya calculada (p. ej. por paneles mientras se escribia C).
+    bool finish(std::string& err, std::uint64_t checksum) {
+        MatrixFileHeader h;
+        std::memcpy(&h, file->data(), sizeof(h));
+        h.checksum = checksum;
+        std::memcpy(file->data(), &h, sizeof(h));
+        if (!file->flush()) { err = "no se pudo volcar el fichero a disco"; return false; }
+        return true;
+    }
+};
+
+// Crea el fichero con la cabecera y los datos sin escribir (las paginas las
+// toca primero quien calcula cada fila, como con MatrixT::uninitialized).
+template <class T>
+inline bool create_matrix_file(const std::string& path, int rows, int cols, MatrixFileOut<T>& out, std::string& err) {
+    const int stride = MatrixT<T>::padded_stride(cols);
+    const std::size_t bytes = (std::size_t)MATRIX_FILE_DATA_OFFSET + (std::size_t)rows * stride * sizeof(T);
+    out.file = MappedFile::create(path, bytes, err);
+    if (!out.file) return false;
+    const MatrixFileHeader h = make_matrix_header<T>(rows, cols);
+    std::memcpy(out.file->data(), &h, sizeof(h));
+    out.matrix = MatrixT<T>::adopt(reinterpret_cast<T*>(out.file->data() + MATRIX_FILE_DATA_OFFSET), rows, cols, out.file);
+    return true;
+}
+
+// Guarda una matriz ya calculada (una copia al fichero proyectado).
+template <class T>
+inline bool save_matrix_file(const std::string& path, const MatrixT<T>& m, std::string& err) {
+    MatrixFileOut<T> out;
+    if (!create_matrix_file(path, m.rows(), m.cols(), out, err)) return false;
+    std::memcpy(out.matrix.data(), m.data(), m.size_bytes());
+    return out.finish(err);
+}
@@ -0,0 +1,117 @@
+// Publicacion de metricas por hilo sin locks entre workers y monitor.
+//
+//   SeqlockCell<T>   un escritor publica una instantanea completa de T y los
+//                    lectores la copian sin bloquearlo; si la leen a medias
+//                    (contador impar o cambiado) reintentan. T debe ser
+//                    trivialmente copiable.
+//   SampleRing<T,N>  cola circular de un productor y un consumidor con
+//                    capacidad fija reservada al crearla. push() nunca espera:
+//                    si el consumidor va atrasado la muestra se descarta y se
+//                    cuenta en dropped().
+//
+// Ambas estructuras ocupan sus propias lineas de cache para que los contadores
+// de un hilo no invaliden la linea de otro (false sharing).
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+static constexpr size_t CACHE_LINE = 64;
+
+// ===================== Seqlock =====================
+
+template <class T>
+class alignas(CACHE_LINE) SeqlockCell {
+    static_assert(std::is_trivially_copyable<T>::value, "SeqlockCell requiere un tipo trivialmente copiable");
+    static constexpr size_t WORDS = (sizeof(T) + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t);
+
+public:
+    // Solo un hilo escribe (el worker dueno de la celda).
+    void store(const T& v) {
+        std::uint64_t tmp[WORDS] = {};
+        std::memcpy(tmp, &v, sizeof(T));
+        const std::uint64_t s = seq_.load(std::memory_order_relaxed);
+        seq_.store(s + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < WORDS; ++i)
+            words_[i].store(tmp[i], std::memory_order_relaxed);
+        seq_.store(s + 2, std::memory_order_release);
+    }
+
+    // Cualquier hilo puede leer; nunca bloquea al escritor.
+    T load() const {
+        std::uint64_t tmp[WORDS];
+        for (;;) {
+            const std::uint64_t s1 = seq_.load(std::memory_order_acquire);
+            if (s1 & 1) continue;
+            for (size_t i = 0; i < WORDS; ++i)
+                tmp[i] = words_[i].load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (seq_.load(std::memory_order_relaxed) == s1) break;
+        }
+        T v;
+        std::memcpy(&v, tmp, sizeof(T));
+        return v;
+    }
+
+private:
+    std::atomic<std::uint64_t> seq_{0};
+    std::array<std::atomic<std::uint64_t>, WORDS> words_{};
+};
+
+// ===================== Cola SPSC de muestras =====================
+
+template <class T, size_t N>
+class SampleRing {
+    static_assert((N & (N - 1)) == 0, "la capacidad debe ser potencia de 2");
+
+public:
+    // Productor: devuelve false (y cuenta la perdida) si la cola esta llena.
+    bool push(const T& v) {
+        const size_t h = head_.load(std::memory_order_relaxed);
+        if (h - tail_.load(std::memory_order_acquire) == N) {
+            dropped_.store(dropped_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return false;
+        }
+        buf_[h & (N - 1)] = v;
+        head_.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumidor: saca una muestra si la hay.
+    bool pop(T& v) {
+        const size_t t = tail_.load(std::memory_order_relaxed);
+        if (t == head_.load(std::memory_order_acquire)) return false;
+        v = buf_[t & (N - 1)];
+        tail_.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    std::uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+    static constexpr size_t capacity() { return N; }
+
+private:
+    alignas(CACHE_LINE) std::atomic<size_t> head_{0};     // escrito por el productor
+    std::atomic<std::uint64_t> dropped_{0};
+    alignas(CACHE_LINE) std::atomic<size_t> tail_{0};     // escrito por el consumidor
+    alignas(CACHE_LINE) std::array<T, N> buf_{};
+};
+
+// Resumen incremental de muestras (lo mantiene el consumidor de la cola).
+struct SampleStats {
+    std::uint64_t count = 0;
+    double sum = 0.0;
+    double max = 0.0;
+
+    void add(double v) {
+        ++count;
+        sum += v;
+        if (v > max) max = v;
+    }
+    double avg() const { return count ? sum / count : 0.0; }
+};
@@ -0,0 +1,608 @@
+// Micro-kernels con bloqueo en registros y seleccion en tiempo de ejecucion.
+//
+// Un micro-kernel calcula un bloque MR x NR de C a partir de un micro-panel de
+// A empaquetado (kc pasos de MR elementos) y uno de B (kc pasos de NR
+// elementos), manteniendo todo el bloque de C en registros durante el bucle k:
+//
+//   C[0..MR)[0..NR) (+)= sum_p  a[p*MR + i] * b[p*NR + j]
+//
+// a, b y c son del tipo acumulador (el empaquetado ya convirtio A y B), asi
+// que hay una familia de micro-kernels por tipo acumulador:
+//
+//            int32                 int64                   float / double
+//   scalar   4x4                   4x4                     4x4
+//   sse41    4x8  mullo_epi32      (scalar)                (scalar)
+//   avx2     6x16 mullo_epi32      4x8  mul_epu32 x3       6x16 / 6x8   fmadd
+//   avx512   6x32 mullo_epi32      6x16 mullo_epi64 (DQ)   6x32 / 6x16  fmadd
+//
+// scalar es una plantilla (MR, NR fijos en compilacion) valida para cualquier
+// tipo; las SIMD mantienen 8-12 acumuladores en registros.
+//
+// Las variantes SIMD se compilan con atributos de "target" por funcion, de
+// modo que el mismo ejecutable corre en cualquier x86-64 y elige al arrancar
+// (cpuid + xgetbv) la mejor que soporten la CPU y el sistema operativo.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define MM_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+#if defined(MM_X86) && (defined(__GNUC__) || defined(__clang__))
+#define MM_TARGET(isa) __attribute__((target(isa)))
+#else
+#define MM_TARGET(isa)
+#endif
+
+enum class SimdIsa { Scalar, Sse41, Avx2, Avx512 };
+
+template <class Acc>
+using MicroKernelFnT = void (*)(int kc, const Acc* a, const Acc* b,
+                                Acc* c, std::ptrdiff_t ldc, bool accumulate);
+
+template <class Acc>
+struct MicroKernelT {
+    SimdIsa isa;
+    const char* name;
+    int mr;
+    int nr;
+    MicroKernelFnT<Acc> fn;
+};
+
+using MicroKernelFn = MicroKernelFnT<int>;
+using MicroKernel = MicroKernelT<int>;
+
+static constexpr int MICRO_MR_MAX = 6;
+static constexpr int MICRO_NR_MAX = 32;
+
+// ===================== Deteccion de la CPU =====================
+
+struct CpuFeatures {
+    bool sse41 = false;
+    bool avx2 = false;      // AVX2 + FMA3
+    bool avx512f = false;
+    bool avx512dq = false;  // mullo_epi64
+};
+
+#ifdef MM_X86
+inline void cpuid_query(int leaf, int sub, unsigned r[4]) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    int v[4];
+    __cpuidex(v, leaf, sub);
+    for (int i = 0; i < 4; ++i) r[i] = (unsigned)v[i];
+#else
+    __cpuid_count(leaf, sub, r[0], r[1], r[2], r[3]);
+#endif
+}
+
+inline unsigned long long xgetbv0() {
+#if defined(_MSC_VER) && !defined(__clang__)
+    return _xgetbv(0);
+#else
+    unsigned eax, edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return ((unsigned long long)edx << 32) | eax;
+#endif
+}
+#endif
+
+inline CpuFeatures detect_cpu_features() {
+    CpuFeatures f;
+#ifdef MM_X86
+    unsigned r[4];
+    cpuid_query(0, 0, r);
+    unsigned max_leaf = r[0];
+    if (max_leaf < 1) return f;
+
+    cpuid_query(1, 0, r);
+    f.sse41 = (r[2] >> 19) & 1;
+    bool osxsave = (r[2] >> 27) & 1;
+    bool avx = (r[2] >> 28) & 1;
+    bool fma = (r[2] >> 12) & 1;
+
+    // El SO debe guardar los registros extendidos (XCR0) para poder usarlos.
+    unsigned long long xcr0 = osxsave ? xgetbv0() : 0;
+    bool os_ymm = (xcr0 & 0x6) == 0x6;
+    bool os_zmm = (xcr0 & 0xE6) == 0xE6;
+
+    if (max_leaf >= 7) {
+        cpuid_query(7, 0, r);
+        f.avx2 = avx && fma && os_ymm && ((r[1] >> 5) & 1);
+        f.avx512f = os_zmm && ((r[1] >> 16) & 1);
+        f.avx512dq = f.avx512f && ((r[1] >> 17) & 1);
+    }
+#endif
+    return f;
+}
+
+inline const CpuFeatures& cpu_features() {
+    static const CpuFeatures f = detect_cpu_features();
+    return f;
+}
+
+// ===================== Micro-kernel escalar (fallback) =====================
+
+template <class Acc, int MR, int NR>
+inline void ukr_generic(int kc, const Acc* a, const Acc* b,
+                        Acc* c, std::ptrdiff_t ldc, bool accumulate) {
+    Acc t[MR][NR] = {};
+    for (int p = 0; p < kc; ++p, a += MR, b += NR)
+        for (int i = 0; i < MR; ++i)
+            for (int j = 0; j < NR; ++j)
+                t[i][j] += a[i] * b[j];
+    for (int i = 0; i < MR; ++i)
+        for (int j = 0; j < NR; ++j)
+            c[i * ldc + j] = accumulate ? c[i * ldc + j] + t[i][j] : t[i][j];
+}
+
+#ifdef MM_X86
+
+// ===================== SSE4.1: 4 x 8 =====================
+
+MM_TARGET("sse4.1")
+inline void ukr_sse41_4x8(int kc, const int* a, const int* b,
+                          int* c, std::ptrdiff_t ldc, bool accumulate) {
+    __m128i c00 = _mm_setzero_si128(), c01 = _mm_setzero_si128();
+    __m128i c10 = _mm_setzero_si128(), c11 = _mm_setzero_si128();
+    __m128i c20 = _mm_setzero_si128(), c21 = _mm_setzero_si128();
+    __m128i c30 = _mm_setzero_si128(), c31 = _mm_setzero_si128();
+
+    for (int p = 0; p < kc; ++p, a += 4, b += 8) {
+        __m128i b0 = _mm_load_si128((const __m128i*)b);
+        __m128i b1 = _mm_load_si128((const __m128i*)(b + 4));
+        __m128i av;
+        av = _mm_set1_epi32(a[0]);
+        c00 = _mm_add_epi32(c00, _mm_mullo_epi32(av, b0)); c01 = _mm_add_epi32(c01, _mm_mullo_epi32(av, b1));
+        av = _mm_set1_epi32(a[1]);
+        c10 = _mm_add_epi32(c10, _mm_mullo_epi32(av, b0)); c11 = _mm_add_epi32(c11, _mm_mullo_epi32(av, b1));
+        av = _mm_set1_epi32(a[2]);
+        c20 = _mm_add_epi32(c20, _mm_mullo_epi32(av, b0)); c21 = _mm_add_epi32(c21, _mm_mullo_epi32(av, b1));
+        av = _mm_set1_epi32(a[3]);
+        c30 = _mm_add_epi32(c30, _mm_mullo_epi32(av, b0)); c31 = _mm_add_epi32(c31, _mm_mullo_epi32(av, b1));
+    }
+
+#define MM_STORE_SSE(row, v0, v1)                                                        \
+    {                                                                                    \
+        __m128i* d = (__m128i*)(c + (row) * ldc);                                        \
+        if (accumulate) {                                                                \
+            v0 = _mm_add_epi32(v0, _mm_loadu_si128(d));                                  \
+            v1 = _mm_add_epi32(v1, _mm_loadu_si128(d + 1));                              \
+        }                                                                                \
+        _mm_storeu_si128(d, v0);                                                         \
+        _mm_storeu_si128(d + 1, v1);                                                     \
+    }
+    MM_STORE_SSE(0, c00, c01)
+    MM_STORE_SSE(1, c10, c11)
+    MM_STORE_SSE(2, c20, c21)
+    MM_STORE_SSE(3, c30, c31)
+#undef MM_STORE_SSE
+}
+
+// ===================== AVX2: 6 x 16 =====================
+
+MM_TARGET("avx2")
+inline void ukr_avx2_6x16(int kc, const int* a, const int* b,
+                          int* c, std::ptrdiff_t ldc, bool accumulate) {
+    __m256i c00 = _mm256_setzero_si256(), c01 = _mm256_setzero_si256();
+    __m256i c10 = _mm256_setzero_si256(), c11 = _mm256_setzero_si256();
+    __m256i c20 = _mm256_setzero_si256(), c21 = _mm256_setzero_si256();
+    __m256i c30 = _mm256_setzero_si256(), c31 = _mm256_setzero_si256();
+    __m256i c40 = _mm256_setzero_si256(), c41 = _mm256_setzero_si256();
+    __m256i c50 = _mm256_setzero_si256(), c51 = _mm256_setzero_si256();
+
+    for (int p = 0; p < kc; ++p, a += 6, b += 16) {
+        __m256i b0 = _mm256_load_si256((const __m256i*)b);
+        __m256i b1 = _mm256_load_si256((const __m256i*)(b + 8));
+        __m256i av;
+        av = _mm256_set1_epi32(a[0]);
+        c00 = _mm256_add_epi32(c00, _mm256_mullo_epi32(av, b0)); c01 = _mm256_add_epi32(c01, _mm256_mullo_epi32(av, b1));
+        av = _mm256_set1_epi32(a[1]);
+        c10 = _mm256_add_epi32(c10, _mm256_mullo_epi32(av, b0)); c11 = _mm256_add_epi32(c11, _mm256_mullo_epi32(av, b1));
+        av = _mm256_set1_epi32(a[2]);
+        c20 = _mm256_add_epi32(c20, _mm256_mullo_epi32(av, b0)); c21 = _mm256_add_epi32(c21, _mm256_mullo_epi32(av, b1));
+        av = _mm256_set1_epi32(a[3]);
+        c30 = _mm256_add_epi32(c30, _mm256_mullo_epi32(av, b0)); c31 = _mm256_add_epi32(c31, _mm256_mullo_epi32(av, b1));
+        av = _mm256_set1_epi32(a[4]);
+        c40 = _mm256_add_epi32(c40, _mm256_mullo_epi32(av, b0)); c41 = _mm256_add_epi32(c41, _mm256_mullo_epi32(av, b1));
+        av = _mm256_set1_epi32(a[5]);
+        c50 = _mm256_add_epi32(c50, _mm256_mullo_epi32(av, b0)); c51 = _mm256_add_epi32(c51, _mm256_mullo_epi32(av, b1));
+    }
+
+#define MM_STORE_AVX2(row, v0, v1)                                                       \
+    {                                                                                    \
+        __m256i* d = (__m256i*)(c + (row) * ldc);                                        \
+        if (accumulate) {                                                                \
+            v0 = _mm256_add_epi32(v0, _mm256_loadu_si256(d));                            \
+            v1 = _mm256_add_epi32(v1, _mm256_loadu_si256(d + 1));                        \
+        }                                                                                \
+        _mm256_storeu_si256(d, v0);                                                      \
+        _mm256_storeu_si256(d + 1, v1);                                                  \
+    }
+    MM_STORE_AVX2(0, c00, c01)
+    MM_STORE_AVX2(1, c10, c11)
+    MM_STORE_AVX2(2, c20, c21)
+    MM_STORE_AVX2(3, c30, c31)
+    MM_STORE_AVX2(4, c40, c41)
+    MM_STORE_AVX2(5, c50, c51)
+#undef MM_STORE_AVX2
+}
+
+// ===================== AVX-512: 6 x 32 =====================
+
+MM_TARGET("avx512f")
+inline void ukr_avx512_6x32(int kc, const int* a, const int* b,
+                            int* c, std::ptrdiff_t ldc, bool accumulate) {
+    __m512i c00 = _mm512_setzero_si512(), c01 = _mm512_setzero_si512();
+    __m512i c10 = _mm512_setzero_si512(), c11 = _mm512_setzero_si512();
+    __m512i c20 = _mm512_setzero_si512(), c21 = _mm512_setzero_si512();
+    __m512i c30 = _mm512_setzero_si512(), c31 = _mm512_setzero_si512();
+    __m512i c40 = _mm512_setzero_si512(), c41 = _mm512_setzero_si512();
+    __m512i c50 = _mm512_setzero_si512(), c51 = _mm512_setzero_si512();
+
+    for (int p = 0; p < kc; ++p, a += 6, b += 32) {
+        __m512i b0 = _mm512_load_si512((const void*)b);
+        __m512i b1 = _mm512_load_si512((const void*)(b + 16));
+        __m512i av;
+        av = _mm512_set1_epi32(a[0]);
+        c00 = _mm512_add_epi32(c00, _mm512_mullo_epi32(av, b0)); c01 = _mm512_add_epi32(c01, _mm512_mullo_epi32(av, b1));
+        av = _mm512_set1_epi32(a[1]);
+        c10 = _mm512_add_epi32(c10, _mm512_mullo_epi32(av, b0)); c11 = _mm512_add_epi32(c11, _mm512_mullo_epi32(av, b1));
+        av = _mm512_set1_epi32(a[2]);
+        c20 = _mm512_add_epi32(c20, _mm512_mullo_epi32(av, b0)); c21 = _mm512_add_epi32(c21, _mm512_mullo_epi32(av, b1));
+        av = _mm512_set1_epi32(a[3]);
+        c30 = _mm512_add_epi32(c30, _mm512_mullo_epi32(av, b0)); c31 = _mm512_add_epi32(c31, _mm512_mullo_epi32(av, b1));
+        av = _mm512_set1_epi32(a[4]);
+        c40 = _mm512_add_epi32(c40, _mm512_mullo_epi32(av, b0)); c41 = _mm512_add_epi32(c41, _mm512_mullo_epi32(av, b1));
+        av = _mm512_set1_epi32(a[5]);
+        c50 = _mm512_add_epi32(c50, _mm512_mullo_epi32(av, b0)); c51 = _mm512_add_epi32(c51, _mm512_mullo_epi32(av, b1));
+    }
+
+#define MM_STORE_AVX512(row, v0, v1)                                                     \
+    {                                                                                    \
+        int* d = c + (row) * ldc;                                                        \
+        if (accumulate) {                                                                \
+            v0 = _mm512_add_epi32(v0, _mm512_loadu_si512((const void*)d));               \
+            v1 = _mm512_add_epi32(v1, _mm512_loadu_si512((const void*)(d + 16)));        \
+        }                                                                                \
+        _mm512_storeu_si512((void*)d, v0);                                               \
+        _mm512_storeu_si512((void*)(d + 16), v1);                                        \
+    }
+    MM_STORE_AVX512(0, c00, c01)
+    MM_STORE_AVX512(1, c10, c11)
+    MM_STORE_AVX512(2, c20, c21)
+    MM_STORE_AVX512(3, c30, c31)
+    MM_STORE_AVX512(4, c40, c41)
+    MM_STORE_AVX512(5, c50, c51)
+#undef MM_STORE_AVX512
+}
+
+// ===================== AVX2: float 6 x 16, double 6 x 8 =====================
+
+#define MM_FMA_ROWS6(SET1, FMA)                                                          \
+    av = SET1(a[0]); c00 = FMA(av, b0, c00); c01 = FMA(av, b1, c01);                     \
+    av = SET1(a[1]); c10 = FMA(av, b0, c10); c11 = FMA(av, b1, c11);                     \
+    av = SET1(a[2]); c20 = FMA(av, b0, c20); c21 = FMA(av, b1, c21);                     \
+    av = SET1(a[3]); c30 = FMA(av, b0, c30); c31 = FMA(av, b1, c31);                     \
+    av = SET1(a[4]); c40 = FMA(av, b0, c40); c41 = FMA(av, b1, c41);                     \
+    av = SET1(a[5]); c50 = FMA(av, b0, c50); c51 = FMA(av, b1, c51);
+
+#define MM_STORE_ROW(T, row, v0, v1, W, ADD, LOADU, STOREU)                              \
+    {                                                                                    \
+        T* d = c + (row) * ldc;                                                          \
+        if (accumulate) {                                                                \
+            v0 = ADD(v0, LOADU(d));                                                      \
+            v1 = ADD(v1, LOADU(d + (W)));                                                \
+        }                                                                                \
+        STOREU(d, v0);                                                                   \
+        STOREU(d + (W), v1);                                                             \
+    }
+
+MM_TARGET("avx2,fma")
+inline void ukr_avx2_f32_6x16(int kc, const float* a, const float* b,
+                              float* c, std::ptrdiff_t ldc, bool accumulate) {
+    __m256 c00 = _mm256_setzero_ps(), c01 = _mm256_setzero_ps();
+    __m256 c10 = _mm256_setzero_ps(), c11 = _mm256_setzero_ps();
+    __m256 c20 = _mm256_setzero_ps(), c21 = _mm256_setzero_ps();
+    __m256 c30 = _mm256_setzero_ps(), c31 = _mm256_setzero_ps();
+    __m256 c40 = _mm256_setzero_ps(), c41 = _mm256_setzero_ps();
+    __m256 c50 = _mm256_setzero_ps(), c51 = _mm256_setzero_ps();
+
+    for (int p = 0; p < kc; ++p, a += 6, b += 16) {
+        __m256 b0 = _mm256_load_ps(b);
+        __m256 b1 = _mm256_load_ps(b + 8);
+        __m256 av;
+        MM_FMA_ROWS6(_mm256_set1_ps, _mm256_fmadd_ps)
+    }
+
+    MM_STORE_ROW(float, 0, c00, c01, 8, _mm256_add_ps, _mm256_loadu_ps, _mm256_storeu_ps)
+    MM_STORE_ROW(float, 1, c10, c11, 8, _mm256_add_ps, _mm256_loadu_ps, _mm256_storeu_ps)
+    MM_STORE_ROW(float, 2, c20, c21, 8, _mm256_add_ps, _mm256_loadu_ps, _mm256_storeu_ps)
+    MM_STORE_ROW(float, 3, c30, c31, 8, _mm256_add_ps, _mm256_loadu_ps, _mm256_storeu_ps)
+    MM_STORE_ROW(float, 4, c40, c41, 8, _mm256_add_ps, _mm256_loadu_ps, _mm256_storeu_ps)
+    MM_STORE_ROW(float, 5, c50, c51, 8, _mm256_add_ps, _mm256_loadu_ps, _mm256_storeu_ps)
+}
+
+MM_TARGET("avx2,fma")
+inline void ukr_avx2_f64_6x8(int kc, const double* a, const double* b,
+                             double* c, std::ptrdiff_t ldc, bool accumulate) {
+    __m256d c00 = _mm256_setzero_pd(), c01 = _mm256_setzero_pd();
+    __m256d c10 = _mm256_setzero_pd(), c11 = _mm256_setzero_pd();
+    __m256d c20 = _mm256_setzero_pd(), c21 = _mm256_setzero_pd();
+    __m256d c30 = _mm256_setzero_pd(), c31 = _mm256_setzero_pd();
+    __m256d c40 = _mm256_setzero_pd(), c41 = _mm256_setzero_pd();
+    __m256d c50 = _mm256_setzero_pd(), c51 = _mm256_setzero_pd();
+
+    for (int p = 0; p < kc; ++p, a += 6, b += 8) {
+        __m256d b0 = _mm256_load_pd(b);
+        __m256d b1 = _mm256_load_pd(b + 4);
+        __m256d av;
+        MM_FMA_ROWS6(_mm256_set1_pd, _mm256_fmadd_pd)
+    }
+
+    MM_STORE_ROW(double, 0, c00, c01, 4, _mm256_add_pd, _mm256_loadu_pd, _mm256_storeu_pd)
+    MM_STORE_ROW(double, 1, c10, c11, 4, _mm256_add_pd, _mm256_loadu_pd, _mm256_storeu_pd)
+    MM_STORE_ROW(double, 2, c20, c21, 4, _mm256_add_pd, _mm256_loadu_pd, _mm256_storeu_pd)
+    MM_STORE_ROW(double, 3, c30, c31, 4, _mm256_add_pd, _mm256_loadu_pd, _mm256_storeu_pd)
+    MM_STORE_ROW(double, 4, c40, c41, 4, _mm256_add_pd, _mm256_loadu_pd, _mm256_storeu_pd)
+    MM_STORE_ROW(double, 5, c50, c51, 4, _mm256_add_pd, _mm256_loadu_pd, _mm256_storeu_pd)
+}
+
+// ===================== AVX2: int64 4 x 8 =====================
+
+// AVX2 no tiene multiplicacion de 64 bits: se compone con tres productos
+// 32x32->64 (lo*lo + (lo*hi + hi*lo) << 32), exacto modulo 2^64.
+MM_TARGET("avx2")
+inline __m256i mm256_mullo_epi64_emul(__m256i x, __m256i y) {
+    __m256i lo = _mm256_mul_epu32(x, y);
+    __m256i cross = _mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(x, 32), y),
+                                     _mm256_mul_epu32(x, _mm256_srli_epi64(y, 32)));
+    return _mm256_add_epi64(lo, _mm256_slli_epi64(cross, 32));
+}
+
+MM_TARGET("avx2")
+inline void ukr_avx2_i64_4x8(int kc, const std::int64_t* a, const std::int64_t* b,
+                             std::int64_t* c, std::ptrdiff_t ldc, bool accumulate) {
+    __m256i c00 = _mm256_setzero_si256(), c01 = _mm256_setzero_si256();
+    __m256i c10 = _mm256_setzero_si256(), c11 = _mm256_setzero_si256();
+    __m256i c20 = _mm256_setzero_si256(), c21 = _mm256_setzero_si256();
+    __m256i c30 = _mm256_setzero_si256(), c31 = _mm256_setzero_si256();
+
+    for (int p = 0; p < kc; ++p, a += 4, b += 8) {
+        __m256i b0 = _mm256_load_si256((const __m256i*)b);
+        __m256i b1 = _mm256_load_si256((const __m256i*)(b + 4));
+        __m256i av;
+        av = _mm256_set1_epi64x(a[0]);
+        c00 = _mm256_add_epi64(c00, mm256_mullo_epi64_emul(av, b0)); c01 = _mm256_add_epi64(c01, mm256_mullo_epi64_emul(av, b1));
+        av = _mm256_set1_epi64x(a[1]);
+        c10 = _mm256_add_epi64(c10, mm256_mullo_epi64_emul(av, b0)); c11 = _mm256_add_epi64(c11, mm256_mullo_epi64_emul(av, b1));
+        av = _mm256_set1_epi64x(a[2]);
+        c20 = _mm256_add_epi64(c20, mm256_mullo_epi64_emul(av, b0)); c21 = _mm256_add_epi64(c21, mm256_mullo_epi64_emul(av, b1));
+        av = _mm256_set1_epi64x(a[3]);
+        c30 = _mm256_add_epi64(c30, mm256_mullo_epi64_emul(av, b0)); c31 = _mm256_add_epi64(c31, mm256_mullo_epi64_emul(av, b1));
+    }
+
+#define MM_LOADU_I256(p) _mm256_loadu_si256((const __m256i*)(p))
+#define MM_STOREU_I256(p, v) _mm256_storeu_si256((__m256i*)(p), v)
+    MM_STORE_ROW(std::int64_t, 0, c00, c01, 4, _mm256_add_epi64, MM_LOADU_I256, MM_STOREU_I256)
+    MM_STORE_ROW(std::int64_t, 1, c10, c11, 4, _mm256_add_epi64, MM_LOADU_I256, MM_STOREU_I256)
+    MM_STORE_ROW(std::int64_t, 2, c20, c21, 4, _mm256_add_epi64, MM_LOADU_I256, MM_STOREU_I256)
+    MM_STORE_ROW(std::int64_t, 3, c30, c31, 4, _mm256_add_epi64, MM_LOADU_I256, MM_STOREU_I256)
+#undef MM_LOADU_I256
+#undef MM_STOREU_I256
+}
+
+// ===================== AVX-512: float 6 x 32, double 6 x 16, int64 6 x 16 =====================
+
+MM_TARGET("avx512f")
+inline void ukr_avx512_f32_6x32(int kc, const float* a, const float* b,
+                                float* c, std::ptrdiff_t ldc, bool accumulate) {
+    __m512 c00 = _mm512_setzero_ps(), c01 = _mm512_setzero_ps();
+    __m512 c10 = _mm512_setzero_ps(), c11 = _mm512_setzero_ps();
+    __m512 c20 = _mm512_setzero_ps(), c21 = _mm512_setzero_ps();
+    __m512 c30 = _mm512_setzero_ps(), c31 = _mm512_setzero_ps();
+    __m512 c40 = _mm512_setzero_ps(), c41 = _mm512_setzero_ps();
+    __m512 c50 = _mm512_setzero_ps(), c51 = _mm512_setzero_ps();
+
+    for (int p = 0; p < kc; ++p, a += 6, b += 32) {
+        __m512 b0 = _mm512_load_ps(b);
+        __m512 b1 = _mm512_load_ps(b + 16);
+        __m512 av;
+        MM_FMA_ROWS6(_mm512_set1_ps, _mm512_fmadd_ps)
+    }
+
+    MM_STORE_ROW(float, 0, c00, c01, 16, _mm512_add_ps, _mm512_loadu_ps, _mm512_storeu_ps)
+    MM_STORE_ROW(float, 1, c10, c11, 16, _mm512_add_ps, _mm512_loadu_ps, _mm512_storeu_ps)
+    MM_STORE_ROW(float, 2, c20, c21, 16, _mm512_add_ps, _mm512_loadu_ps, _mm512_storeu_ps)
+    MM_STORE_ROW(float, 3, c30, c31, 16, _mm512_add_ps, _mm512_loadu_ps, _mm512_storeu_ps)
+    MM_STORE_ROW(float, 4, c40, c41, 16, _mm512_add_ps, _mm512_loadu_ps, _mm512_storeu_ps)
+    MM_STORE_ROW(float, 5, c50, c51, 16, _mm512_add_ps, _mm512_loadu_ps, _mm512_storeu_ps)
+}
+
+MM_TARGET("avx512f")
+inline void ukr_avx512_f64_6x16(int kc, const double* a, const double* b,
+                                double* c, std::ptrdiff_t ldc, bool accumulate) {
+    __m512d c00 = _mm512_setzero_pd(), c01 = _mm512_setzero_pd();
+    __m512d c10 = _mm512_setzero_pd(), c11 = _mm512_setzero_pd();
+    __m512d c20 = _mm512_setzero_pd(), c21 = _mm512_setzero_pd();
+    __m512d c30 = _mm512_setzero_pd(), c31 = _mm512_setzero_pd();
+    __m512d c40 = _mm512_setzero_pd(), c41 = _mm512_setzero_pd();
+    __m512d c50 = _mm512_setzero_pd(), c51 = _mm512_setzero_pd();
+
+    for (int p = 0; p < kc; ++p, a += 6, b += 16) {
+        __m512d b0 = _mm512_load_pd(b);
+        __m512d b1 = _mm512_load_pd(b + 8);
+        __m512d av;
+        MM_FMA_ROWS6(_mm512_set1_pd, _mm512_fmadd_pd)
+    }
+
+    MM_STORE_ROW(double, 0, c00, c01, 8, _mm512_add_pd, _mm512_loadu_pd, _mm512_storeu_pd)
+    MM_STORE_ROW(double, 1, c10, c11, 8, _mm512_add_pd, _mm512_loadu_pd, _mm512_storeu_pd)
+    MM_STORE_ROW(double, 2, c20, c21, 8, _mm512_add_pd, _mm512_loadu_pd, _mm512_storeu_pd)
+    MM_STORE_ROW(double, 3, c30, c31, 8, _mm512_add_pd, _mm512_loadu_pd, _mm512_storeu_pd)
+    MM_STORE_ROW(double, 4, c40, c41, 8, _mm512_add_pd, _mm512_loadu_pd, _mm512_storeu_pd)
+    MM_STORE_ROW(double, 5, c50, c51, 8, _mm512_add_pd, _mm512_loadu_pd, _mm512_storeu_pd)
+}
+
+MM_TARGET("avx512f,avx512dq")
+inline void ukr_avx512_i64_6x16(int kc, const std::int64_t* a, const std::int64_t* b,
+                                std::int64_t* c, std::ptrdiff_t ldc, bool accumulate) {
+    __m512i c00 = _mm512_setzero_si512(), c01 = _mm512_setzero_si512();
+    __m512i c10 = _mm512_setzero_si512(), c11 = _mm512_setzero_si512();
+    __m512i c20 = _mm512_setzero_si512(), c21 = _mm512_setzero_si512();
+    __m512i c30 = _mm512_setzero_si512(), c31 = _mm512_setzero_si512();
+    __m512i c40 = _mm512_setzero_si512(), c41 = _mm512_setzero_si512();
+    __m512i c50 = _mm512_setzero_si512(), c51 = _mm512_setzero_si512();
+
+    for (int p = 0; p < kc; ++p, a += 6, b += 16) {
+        __m512i b0 = _mm512_load_si512((const void*)b);
+        __m512i b1 = _mm512_load_si512((const void*)(b + 8));
+        __m512i av;
+#define MM_MADD_I64(x, y, acc) _mm512_add_epi64(acc, _mm512_mullo_epi64(x, y))
+        MM_FMA_ROWS6(_mm512_set1_epi64, MM_MADD_I64)
+#undef MM_MADD_I64
+    }
+
+#define MM_LOADU_I512(p) _mm512_loadu_si512((const void*)(p))
+#define MM_STOREU_I512(p, v) _mm512_storeu_si512((void*)(p), v)
+    MM_STORE_ROW(std::int64_t, 0, c00, c01, 8, _mm512_add_epi64, MM_LOADU_I512, MM_STOREU_I512)
+    MM_STORE_ROW(std::int64_t, 1, c10, c11, 8, _mm512_add_epi64, MM_LOADU_I512, MM_STOREU_I512)
+    MM_STORE_ROW(std::int64_t, 2, c20, c21, 8, _mm512_add_epi64, MM_LOADU_I512, MM_STOREU_I512)
+    MM_STORE_ROW(std::int64_t, 3, c30, c31, 8, _mm512_add_epi64, MM_LOADU_I512, MM_STOREU_I512)
+    MM_STORE_ROW(std::int64_t, 4, c40, c41, 8, _mm512_add_epi64, MM_LOADU_I512, MM_STOREU_I512)
+    MM_STORE_ROW(std::int64_t, 5, c50, c51, 8, _mm512_add_epi64, MM_LOADU_I512, MM_STOREU_I512)
+#undef MM_LOADU_I512
+#undef MM_STOREU_I512
+}
+
+#undef MM_FMA_ROWS6
+#undef MM_STORE_ROW
+
+#endif  // MM_X86
+
+// ===================== Seleccion =====================
+
+// Micro-kernel de la familia Acc para el nivel `isa`; si la familia no tiene
+// variante en ese nivel se usa la mejor de un nivel inferior.
+template <class Acc>
+const MicroKernelT<Acc>& microkernel_for(SimdIsa isa);
+
+template <>
+inline const MicroKernelT<int>& microkernel_for<int>(SimdIsa isa) {
+    static const MicroKernelT<int> scalar = { SimdIsa::Scalar, "scalar 4x4", 4, 4, ukr_generic<int, 4, 4> };
+#ifdef MM_X86
+    static const MicroKernelT<int> sse41  = { SimdIsa::Sse41,  "sse4.1 4x8", 4, 8, ukr_sse41_4x8 };
+    static const MicroKernelT<int> avx2   = { SimdIsa::Avx2,   "avx2 6x16", 6, 16, ukr_avx2_6x16 };
+    static const MicroKernelT<int> avx512 = { SimdIsa::Avx512, "avx512 6x32", 6, 32, ukr_avx512_6x32 };
+    switch (isa) {
+        case SimdIsa::Sse41:  return sse41;
+        case SimdIsa::Avx2:   return avx2;
+        case SimdIsa::Avx512: return avx512;
+        default: break;
+    }
+#else
+    (void)isa;
+#endif
+    return scalar;
+}
+
+template <>
+inline const MicroKernelT<std::int64_t>& microkernel_for<std::int64_t>(SimdIsa isa) {
+    static const MicroKernelT<std::int64_t> scalar = { SimdIsa::Scalar, "scalar 4x4", 4, 4, ukr_generic<std::int64_t, 4, 4> };
+#ifdef MM_X86
+    static const MicroKernelT<std::int64_t> avx2   = { SimdIsa::Avx2,   "avx2 4x8", 4, 8, ukr_avx2_i64_4x8 };
+    static const MicroKernelT<std::int64_t> avx512 = { SimdIsa::Avx512, "avx512dq 6x16", 6, 16, ukr_avx512_i64_6x16 };
+    if (isa == SimdIsa::Avx512 && !cpu_features().avx512dq) isa = SimdIsa::Avx2;
+    switch (isa) {
+        case SimdIsa::Avx2:   return avx2;
+        case SimdIsa::Avx512: return avx512;
+        default: break;
+    }
+#else
+    (void)isa;
+#endif
+    return scalar;
+}
+
+template <>
+inline const MicroKernelT<float>& microkernel_for<float>(SimdIsa isa) {
+    static const MicroKernelT<float> scalar = { SimdIsa::Scalar, "scalar 4x4", 4, 4, ukr_generic<float, 4, 4> };
+#ifdef MM_X86
+    static const MicroKernelT<float> avx2   = { SimdIsa::Avx2,   "avx2 6x16 fma", 6, 16, ukr_avx2_f32_6x16 };
+    static const MicroKernelT<float> avx512 = { SimdIsa::Avx512, "avx512 6x32 fma", 6, 32, ukr_avx512_f32_6x32 };
+    switch (isa) {
+        case SimdIsa::Avx2:   return avx2;
+        case SimdIsa::Avx512: return avx512;
+        default: break;
+    }
+#else
+    (void)isa;
+#endif
+    return scalar;
+}
+
+template <>
+inline const MicroKernelT<double>& microkernel_for<double>(SimdIsa isa) {
+    static const MicroKernelT<double> scalar = { SimdIsa::Scalar, "scalar 4x4", 4, 4, ukr_generic<double, 4, 4> };
+#ifdef MM_X86
+    static const MicroKernelT<double> avx2   = { SimdIsa::Avx2,   "avx2 6x8 fma", 6, 8, ukr_avx2_f64_6x8 };
+    static const MicroKernelT<double> avx512 = { SimdIsa::Avx512, "avx512 6x16 fma", 6, 16, ukr_avx512_f64_6x16 };
+    switch (isa) {
+        case SimdIsa::Avx2:   return avx2;
+        case SimdIsa::Avx512: return avx512;
+        default: break;
+    }
+#else
+    (void)isa;
+#endif
+    return scalar;
+}
+
+inline bool isa_supported(SimdIsa isa) {
+    const CpuFeatures& f = cpu_features();
+    switch (isa) {
+        case SimdIsa::Scalar: return true;
+        case SimdIsa::Sse41:  return f.sse41;
+        case SimdIsa::Avx2:   return f.avx2;
+        case SimdIsa::Avx512: return f.avx512f;
+    }
+    return false;
+}
+
+inline SimdIsa best_supported_isa() {
+    if (isa_supported(SimdIsa::Avx512)) return SimdIsa::Avx512;
+    if (isa_supported(SimdIsa::Avx2))   return SimdIsa::Avx2;
+    if (isa_supported(SimdIsa::Sse41))  return SimdIsa::Sse41;
+    return SimdIsa::Scalar;
+}
+
+// "auto" elige la mejor variante soportada; pedir una no soportada falla.
+inline bool parse_isa(const std::string& s, SimdIsa& out) {
+    if (s == "auto")   { out = best_supported_isa(); return true; }
+    if (s == "scalar") { out = SimdIsa::Scalar; return true; }
+    if (s == "sse41")  { out = SimdIsa::Sse41;  return isa_supported(out); }
+    if (s == "avx2")   { out = SimdIsa::Avx2;   return isa_supported(out); }
+    if (s == "avx512") { out = SimdIsa::Avx512; return isa_supported(out); }
+    return false;
+}
+
+// Micro-kernel activo del proceso: se decide una vez al arrancar y puede
+// forzarse (p. ej. desde la linea de comandos) antes de multiplicar.
+inline SimdIsa& active_isa_slot() {
+    static SimdIsa isa = best_supported_isa();
+    return isa;
+}
+
+inline void set_active_isa(SimdIsa isa) { active_isa_slot() = isa; }
+
+template <class Acc = int>
+inline const MicroKernelT<Acc>& active_microkernel() { return microkernel_for<Acc>(active_isa_slot()); }
@@ -0,0 +1,188 @@
+// Colocacion NUMA de A, B y C (maquinas con varios sockets).
+//
+// Linux coloca cada pagina en el nodo del hilo que la escribe primero
+// ("first touch"), asi que basta con que cada worker escriba primero las
+// filas de A y C que luego usa. B la leen todos los hilos: se replica una
+// copia por nodo o se intercala pagina a pagina entre nodos (mbind con
+// MPOL_INTERLEAVE).
+//
+//   read_numa_topology()      nodos y nodo de cada core logico
+//   numa_interleave(p, n)     reparte las paginas de [p, p+n) entre nodos
+//   numa_pages_per_node(p, n) en que nodo esta cada pagina (move_pages)
+//
+// Se usan las llamadas al sistema directamente (sin libnuma, que no hace
+// falta enlazar). Con un solo nodo, o fuera de Linux, todo degrada a una
+// copia de B sin mbind; en Windows el nodo de cada core sale de
+// GetNumaProcessorNode y el primer toque funciona igual.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "topology.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__linux__)
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+enum class NumaPolicy { Replicate, Interleave };
+
+inline const char* numa_policy_name(NumaPolicy p) {
+    return p == NumaPolicy::Replicate ? "replicate" : "interleave";
+}
+
+inline bool parse_numa_policy(const std::string& s, NumaPolicy& out) {
+    if (s == "replicate")  { out = NumaPolicy::Replicate;  return true; }
+    if (s == "interleave") { out = NumaPolicy::Interleave; return true; }
+    return false;
+}
+
+// ===================== Topologia =====================
+
+struct NumaTopology {
+    int nodes = 1;
+    std::vector<int> cpu_node;      // nodo de cada core logico (indice = cpu)
+
+    int node_of_cpu(int cpu) const {
+        return (cpu >= 0 && cpu < (int)cpu_node.size()) ? cpu_node[cpu] : 0;
+    }
+};
+
+inline NumaTopology read_numa_topology() {
+    NumaTopology t;
+#ifdef __linux__
+    int max_node = -1;
+    for (int n = 0; n < 1024; ++n) {
+        std::ifstream f("/sys/devices/system/node/node" + std::to_string(n) + "/cpulist");
+        if (!f) {
+            if (n > max_node + 64) break;       // los nodos pueden no ser consecutivos
+            continue;
+        }
+        std::string line;
+        std::getline(f, line);
+        for (int c : parse_cpu_list(line)) {
+            if (c >= (int)t.cpu_node.size()) t.cpu_node.resize(c + 1, 0);
+            t.cpu_node[c] = n;
+        }
+        max_node = n;
+    }
+    t.nodes = std::max(1, max_node + 1);
+#elif defined(_WIN32)
+    ULONG highest = 0;
+    if (GetNumaHighestNodeNumber(&highest)) t.nodes = (int)highest + 1;
+    // CPU = grupo * 64 + numero, como en topology.h
+    const WORD groups = GetActiveProcessorGroupCount();
+    for (WORD g = 0; g < groups; ++g) {
+        const DWORD n = GetActiveProcessorCount(g);
+        for (DWORD b = 0; b < n && b < 64; ++b) {
+            PROCESSOR_NUMBER pn = {};
+            pn.Group = g;
+            pn.Number = (BYTE)b;
+            USHORT node = 0;
+            const int id = g * 64 + (int)b;
+            if (id >= (int)t.cpu_node.size()) t.cpu_node.resize(id + 1, 0);
+            if (GetNumaProcessorNodeEx(&pn, &node) && node != 0xFFFF) t.cpu_node[id] = node;
+        }
+    }
+#endif
+    return t;
+}
+
+// ===================== Politica de memoria =====================
+
+#ifdef __linux__
+inline std::size_t numa_page_size() {
+    static const std::size_t page = (std::size_t)sysconf(_SC_PAGESIZE);
+    return page;
+}
+
+// Nodos que el kernel puede tener (/sys/devices/system/node/possible, como
+// numa_max_possible_node() + 1 de libnuma); define el ancho de las mascaras
+// de mbind. Al menos `nodes` si no se puede leer.
+inline int numa_possible_nodes(int nodes) {
+    std::ifstream f("/sys/devices/system/node/possible");
+    std::string line;
+    int n = nodes;
+    if (f && std::getline(f, line))
+        for (int node : parse_cpu_list(line)) n = std::max(n, node + 1);
+    return n;
+}
+#endif
+
+// Intercala entre los `nodes` primeros nodos las paginas completas de
+// [p, p+bytes). Debe llamarse antes del primer toque. Devuelve false si no
+// se aplico (un nodo, otro sistema o el kernel lo rechazo).
+inline bool numa_interleave(void* p, std::size_t bytes, int nodes) {
+#if defined(__linux__) && defined(SYS_mbind)
+    if (nodes <= 1) return false;
+    const std::size_t page = numa_page_size();
+    std::uintptr_t b = ((std::uintptr_t)p + page - 1) / page * page;
+    std::uintptr_t e = ((std::uintptr_t)p + bytes) / page * page;
+    if (e <= b) return false;
+    // La mascara cubre todos los nodos posibles; el kernel lee maxnode - 1
+    // bits, asi que se pasa uno mas (como hace libnuma)
+    const int bits = numa_possible_nodes(nodes) + 1;
+    const int word_bits = (int)(8 * sizeof(unsigned long));
+    std::vector<unsigned long> mask((bits + word_bits - 1) / word_bits, 0UL);
+    for (int n = 0; n < nodes; ++n) mask[n / word_bits] |= 1UL << (n % word_bits);
+    const int MPOL_INTERLEAVE_ = 3;
+    return syscall(SYS_mbind, (void*)b, e - b, MPOL_INTERLEAVE_, mask.data(), (unsigned long)bits, 0U) == 0;
+#else
+    (void)p; (void)bytes; (void)nodes;
+    return false;
+#endif
+}
+
+// Paginas de [p, p+bytes) por nodo (indice = nodo), consultadas con
+// move_pages sin moverlas. Las paginas aun no tocadas no cuentan. Vacio si no
+// se puede consultar.
+inline std::vector<std::size_t> numa_pages_per_node(const void* p, std::size_t bytes, int nodes) {
+    std::vector<std::size_t> count;
+#if defined(__linux__) && defined(SYS_move_pages)
+    const std::size_t page = numa_page_size();
+    std::uintptr_t b = (std::uintptr_t)p / page * page;
+    std::uintptr_t e = (std::uintptr_t)p + bytes;
+    std::vector<void*> pages;
+    for (std::uintptr_t a = b; a < e; a += page) pages.push_back((void*)a);
+    if (pages.empty()) return count;
+    std::vector<int> status(pages.size(), -1);
+    if (syscall(SYS_move_pages, 0, (unsigned long)pages.size(), pages.data(), nullptr, status.data(), 0) != 0)
+        return count;
+    count.assign(std::max(1, nodes), 0);
+    for (int s : status)
+        if (s >= 0 && s < (int)count.size()) ++count[s];
+#else
+    (void)p; (void)bytes; (void)nodes;
+#endif
+    return count;
+}
+
+// ===================== Reparto de filas =====================
+
+// Donde quedo cada tramo de filas de A y C tras el primer toque: el hilo w
+// escribio las filas [split[w], split[w+1]) desde el nodo node[w]. B es
+// local si esta replicada; intercalada, una fraccion b_remote_fraction de
+// sus paginas esta en otro nodo.
+struct NumaPlacement {
+    std::vector<int> split;
+    std::vector<int> node;
+    double b_remote_fraction = 0.0;
+
+    int node_of_row(int r) const {
+        auto it = std::upper_bound(split.begin(), split.end(), r);
+        int w = (int)(it - split.begin()) - 1;
+        return node.empty() ? 0 : node[std::min(std::max(w, 0), (int)node.size() - 1)];
+    }
+};
@@ -0,0 +1,493 @@
+// Multiplicacion fuera de memoria (out-of-core) sobre ficheros .mmx.
+//
+// Para matrices que no caben en RAM: A, B y C se quedan en disco y en
+// memoria solo viven unas pocas teselas. C se recorre por bloques mb x nb y
+// cada bloque acumula los productos de los bloques de K:
+//
+//   for i (bloques de filas), for j (bloques de columnas), for k:
+//       C(i,j) += A(i,k) * B(k,j)
+//
+// Las teselas se leen con lecturas posicionales (pread / ReadFile) en un
+// hilo de E/S propio: mientras se multiplica el paso s ya se esta leyendo el
+// paso s+1 en el otro juego de buffers (doble buffer). Cada bloque de C
+// terminado se escribe tambien desde ese hilo mientras el calculo sigue con
+// el siguiente bloque en el otro buffer de C.
+//
+// No se usa mmap (matrix_file.h): con la proyeccion es el kernel quien decide
+// que paginas quedan en memoria y el presupuesto no se podria cumplir.
+//
+// Memoria con teselas cuadradas de lado t (ver plan_out_of_core):
+//   2 x (A(i,k) + B(k,j)) en T               doble buffer de lectura
+//   2 x C(i,j) + producto parcial en Acc     doble buffer de escritura
+//   B(k,j) empaquetada en Acc                espacio del kernel
+//
+// La suma de comprobacion de C no se puede calcular al vuelo (los bloques no
+// se terminan en el orden del fichero), asi que al final se relee C de forma
+// secuencial. Las sumas de A y B no se comprueban: costaria leerlas una vez
+// mas enteras.
+
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <future>
+#include <iomanip>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "element.h"
+#include "matrix.h"
+#include "matrix_file.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// ===================== Fichero con E/S posicional =====================
+
+class RawFile {
+public:
+    RawFile() = default;
+    ~RawFile() { close(); }
+    RawFile(const RawFile&) = delete;
+    RawFile& operator=(const RawFile&) = delete;
+
+    // Abre un fichero existente para leer o crea (trunca) uno para escribir.
+    bool open(const std::string& path, bool write, std::string& err) {
+        close();
+#ifdef _WIN32
+        h_ = CreateFileA(path.c_str(), write ? (GENERIC_READ | GENERIC_WRITE) : GENERIC_READ, FILE_SHARE_READ,
+                         nullptr, write ? CREATE_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (h_ == INVALID_HANDLE_VALUE) { err = "no se pudo abrir " + path; return false; }
+#else
+        fd_ = ::open(path.c_str(), write ? (O_RDWR | O_CREAT | O_TRUNC) : O_RDONLY, 0644);
+        if (fd_ < 0) { err = "no se pudo abrir " + path + ": " + std::strerror(errno); return false; }
+#endif
+        return true;
+    }
+
+    std::uint64_t size() const {
+#ifdef _WIN32
+        LARGE_INTEGER sz;
+        return GetFileSizeEx(h_, &sz) ? (std::uint64_t)sz.QuadPart : 0;
+#else
+        struct stat st;
+        return fstat(fd_, &st) == 0 ? (std::uint64_t)st.st_size : 0;
+#endif
+    }
+
+    bool resize(std::uint64_t bytes) {
+#ifdef _WIN32
+        LARGE_INTEGER pos;
+        pos.QuadPart = (LONGLONG)bytes;
+        return SetFilePointerEx(h_, pos, nullptr, FILE_BEGIN) && SetEndOfFile(h_);
+#else
+        return ftruncate(fd_, (off_t)bytes) == 0;
+#endif
+    }
+
+    // Lee / escribe exactamente `bytes` en la posicion `off` (sin mover ningun
+    // puntero compartido: se puede usar desde cualquier hilo).
+    bool read_at(void* dst, std::size_t bytes, std::uint64_t off) const {
+        unsigned char* p = static_cast<unsigned char*>(dst);
+        while (bytes > 0) {
+#ifdef _WIN32
+            OVERLAPPED ov = {};
+            ov.Offset = (DWORD)off;
+            ov.OffsetHigh = (DWORD)(off >> 32);
+            DWORD got = 0;
+            const DWORD want = (DWORD)std::min<std::size_t>(bytes, 1u << 30);
+            if (!ReadFile(h_, p, want, &got, &ov) || got == 0) return false;
+#else
+            const ssize_t got = ::pread(fd_, p, bytes, (off_t)off);
+            if (got < 0 && errno == EINTR) continue;
+            if (got <= 0) return false;
+#endif
+            p += got;
+            off += (std::uint64_t)got;
+            bytes -= (std::size_t)got;
+        }
+        return true;
+    }
+
+    bool write_at(const void* src, std::size_t bytes, std::uint64_t off) const {
+        const unsigned char* p = static_cast<const unsigned char*>(src);
+        while (bytes > 0) {
+#ifdef _WIN32
+            OVERLAPPED ov = {};
+            ov.Offset = (DWORD)off;
+            ov.OffsetHigh = (DWORD)(off >> 32);
+            DWORD put = 0;
+            const DWORD want = (DWORD)std::min<std::size_t>(bytes, 1u << 30);
+            if (!WriteFile(h_, p, want, &put, &ov) || put == 0) return false;
+#else
+            const ssize_t put = ::pwrite(fd_, p, bytes, (off_t)off);
+            if (put < 0 && errno == EINTR) continue;
+            if (put <= 0) return false;
+#endif
+            p += put;
+            off += (std::uint64_t)put;
+            bytes -= (std::size_t)put;
+        }
+        return true;
+    }
+
+    bool sync() const {
+#ifdef _WIN32
+        return FlushFileBuffers(h_) != 0;
+#else
+        return fsync(fd_) == 0;
+#endif
+    }
+
+    void close() {
+#ifdef _WIN32
+        if (h_ != INVALID_HANDLE_VALUE) { CloseHandle(h_); h_ = INVALID_HANDLE_VALUE; }
+#else
+        if (fd_ >= 0) { ::close(fd_); fd_ = -1; }
+#endif
+    }
+
+private:
+#ifdef _WIN32
+    HANDLE h_ = INVALID_HANDLE_VALUE;
+#else
+    int fd_ = -1;
+#endif
+};
+
+// ===================== Hilo de E/S =====================
+
+// Un hilo que ejecuta en orden los trabajos que se le encargan; submit()
+// devuelve un future con el resultado (false = error de E/S).
+class IoThread {
+public:
+    IoThread() : thread_([this] { loop(); }) {}
+    ~IoThread() {
+        {
+            std::lock_guard<std::mutex> lk(mx_);
+            stop_ = true;
+        }
+        cv_.notify_one();
+        thread_.join();
+    }
+    IoThread(const IoThread&) = delete;
+    IoThread& operator=(const IoThread&) = delete;
+
+    std::future<bool> submit(std::function<bool()> job) {
+        std::packaged_task<bool()> task(std::move(job));
+        std::future<bool> f = task.get_future();
+        {
+            std::lock_guard<std::mutex> lk(mx_);
+            queue_.push_back(std::move(task));
+        }
+        cv_.notify_one();
+        return f;
+    }
+
+private:
+    void loop() {
+        for (;;) {
+            std::packaged_task<bool()> task;
+            {
+                std::unique_lock<std::mutex> lk(mx_);
+                cv_.wait(lk, [&] { return stop_ || !queue_.empty(); });
+                if (queue_.empty()) return;
+                task = std::move(queue_.front());
+                queue_.pop_front();
+            }
+            task();
+        }
+    }
+
+    std::mutex mx_;
+    std::condition_variable cv_;
+    std::deque<std::packaged_task<bool()>> queue_;
+    bool stop_ = false;
+    std::thread thread_;        // el ultimo: arranca con lo demas ya construido
+};
+
+// ===================== Plan y estadisticas =====================
+
+struct OutOfCorePlan {
+    int mb = 0, nb = 0, kb = 0;         // tesela de C (mb x nb) y profundidad kb
+    std::size_t buffer_bytes = 0;       // memoria que ocupan las teselas
+};
+
+struct OutOfCoreStats {
+    OutOfCorePlan plan;
+    long long steps = 0;                // productos de teselas A(i,k) * B(k,j)
+    long long c_tiles = 0;
+    std::uint64_t bytes_read = 0;
+    std::uint64_t bytes_written = 0;
+    double read_s = 0.0;                // hilo de E/S leyendo A y B
+    double write_s = 0.0;               // hilo de E/S escribiendo C
+    double wait_s = 0.0;                // calculo parado esperando a la E/S
+    double compute_s = 0.0;             // productos de teselas y acumulacion
+    double checksum_s = 0.0;            // relectura final de C
+    double total_s = 0.0;
+};
+
+// Lado de tesela que cabe en `budget` bytes: t^2 * (4 sizeof(T) + 4 sizeof(Acc))
+// (ver la cuenta de la cabecera), multiplo de 16 y recortado a cada dimension.
+// Devuelve false si el presupuesto no da ni para teselas de 16.
+template <class T, class Acc>
+inline bool plan_out_of_core(int m, int k, int n, std::size_t budget, OutOfCorePlan& plan) {
+    const double per_elem = 4.0 * sizeof(T) + 4.0 * sizeof(Acc);
+    int t = (int)std::min(std::sqrt((double)budget / per_elem), 1e9) / 16 * 16;
+    if (t < 16) return false;
+    plan.mb = std::min(t, m);
+    plan.nb = std::min(t, n);
+    plan.kb = std::min(t, k);
+    const std::size_t a_tile = (std::size_t)plan.mb * MatrixT<T>::padded_stride(plan.kb) * sizeof(T);
+    const std::size_t b_tile = (std::size_t)plan.kb * MatrixT<T>::padded_stride(plan.nb) * sizeof(T);
+    const std::size_t c_tile = (std::size_t)plan.mb * MatrixT<Acc>::padded_stride(plan.nb) * sizeof(Acc);
+    const std::size_t b_pack = (std::size_t)plan.kb * MatrixT<Acc>::padded_stride(plan.nb) * sizeof(Acc);
+    plan.buffer_bytes = 2 * (a_tile + b_tile) + 3 * c_tile + b_pack;
+    return true;
+}
+
+// Producto de una tesela: C = A * B (sobrescribe C), como gemm().
+template <class T, class Acc>
+using TileMultiply = std::function<void(ConstMatrixViewT<T>, ConstMatrixViewT<T>, MatrixViewT<Acc>)>;
+
+// ===================== Motor =====================
+
+namespace ooc_detail {
+
+inline double seconds_since(std::chrono::steady_clock::time_point t0) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+// Cabecera de un .mmx abierto con RawFile, comprobada y del tipo T.
+template <class T>
+inline bool read_header(const RawFile& f, const std::string& path, MatrixFileHeader& h, std::string& err) {
+    if (!f.read_at(&h, sizeof(h), 0)) { err = path + ": fichero demasiado corto"; return false; }
+    if (!validate_matrix_header(h, f.size(), path, err)) return false;
+    if ((ElemType)h.elem_type != ElemTraits<T>::id) {
+        err = path + ": contiene " + elem_type_name((ElemType)h.elem_type) + " y se esperaba " + elem_name<T>();
+        return false;
+    }
+    return true;
+}
+
+// Filas [r0, r0 + v.rows) y columnas [c0, c0 + v.cols) del fichero a la
+// vista. Si la tesela ocupa filas enteras con el mismo stride, una sola
+// lectura; si no, una por fila.
+template <class T>
+inline bool read_tile(const RawFile& f, const MatrixFileHeader& h, int r0, int c0, MatrixViewT<T> v) {
+    const std::uint64_t off = h.data_offset + ((std::uint64_t)r0 * h.stride + (std::uint64_t)c0) * sizeof(T);
+    if (c0 == 0 && (std::uint64_t)v.cols == h.cols && (std::uint64_t)v.stride == h.stride)
+        return f.read_at(v.data, (std::size_t)v.rows * v.stride * sizeof(T), off);
+    for (int r = 0; r < v.rows; ++r)
+        if (!f.read_at(v.row(r), (std::size_t)v.cols * sizeof(T), off + (std::uint64_t)r * h.stride * sizeof(T)))
+            return false;
+    return true;
+}
+
+template <class T>
+inline bool write_tile(const RawFile& f, const MatrixFileHeader& h, int r0, int c0, ConstMatrixViewT<T> v) {
+    const std::uint64_t off = h.data_offset + ((std::uint64_t)r0 * h.stride + (std::uint64_t)c0) * sizeof(T);
+    if (c0 == 0 && (std::uint64_t)v.cols == h.cols && (std::uint64_t)v.stride == h.stride)
+        return f.write_at(v.data, (std::size_t)v.rows * v.stride * sizeof(T), off);
+    for (int r = 0; r < v.rows; ++r)
+        if (!f.write_at(v.row(r), (std::size_t)v.cols * sizeof(T), off + (std::uint64_t)r * h.stride * sizeof(T)))
+            return false;
+    return true;
+}
+
+} // namespace ooc_detail
+
+// C = A * B con A, B y C en ficheros .mmx (C se crea). `multiply` calcula
+// cada producto de teselas (secuencial o repartido en un pool). Devuelve
+// false con el motivo en `err`.
+template <class T, class Acc>
+inline bool gemm_out_of_core(const std::string& a_path, const std::string& b_path, const std::string& c_path,
+                             std::size_t budget, const TileMultiply<T, Acc>& multiply, OutOfCoreStats& st,
+                             std::string& err) {
+    using clock = std::chrono::steady_clock;
+    using ooc_detail::seconds_since;
+    const auto t_start = clock::now();
+    st = OutOfCoreStats();
+
+    RawFile fa, fb, fc;
+    MatrixFileHeader ha, hb;
+    if (!fa.open(a_path, false, err) || !ooc_detail::read_header<T>(fa, a_path, ha, err)) return false;
+    if (!fb.open(b_path, false, err) || !ooc_detail::read_header<T>(fb, b_path, hb, err)) return false;
+    if (ha.cols != hb.rows) { err = "columnas de A distintas de filas de B"; return false; }
+    const int m = (int)ha.rows, k = (int)ha.cols, n = (int)hb.cols;
+
+    OutOfCorePlan& plan = st.plan;
+    if (!plan_out_of_core<T, Acc>(m, k, n, budget, plan)) {
+        err = "presupuesto de memoria demasiado pequeno (minimo " +
+              std::to_string((16 * 16 * (4 * sizeof(T) + 4 * sizeof(Acc)) + 1023) / 1024) + " KB)";
+        return false;
+    }
+
+    // C: cabecera sin suma y datos a cero (fichero disperso); el relleno de
+    // cada fila no se escribe nunca y queda a cero, como en MatrixT.
+    MatrixFileHeader hc = make_matrix_header<Acc>(m, n);
+    const std::uint64_t c_data_bytes = hc.rows * hc.stride * sizeof(Acc);
+    if (!fc.open(c_path, true, err)) return false;
+    if (!fc.resize(hc.data_offset + c_data_bytes) || !fc.write_at(&hc, sizeof(hc), 0)) {
+        err = "no se pudo reservar " + c_path;
+        return false;
+    }
+
+    MatrixT<T> a_buf[2] = { MatrixT<T>::uninitialized(plan.mb, plan.kb), MatrixT<T>::uninitialized(plan.mb, plan.kb) };
+    MatrixT<T> b_buf[2] = { MatrixT<T>::uninitialized(plan.kb, plan.nb), MatrixT<T>::uninitialized(plan.kb, plan.nb) };
+    MatrixT<Acc> c_buf[2] = { MatrixT<Acc>::uninitialized(plan.mb, plan.nb), MatrixT<Acc>::uninitialized(plan.mb, plan.nb) };
+    MatrixT<Acc> partial = MatrixT<Acc>::uninitialized(plan.mb, plan.nb);
+
+    const int ti = (m + plan.mb - 1) / plan.mb, tj = (n + plan.nb - 1) / plan.nb, tk = (k + plan.kb - 1) / plan.kb;
+    const long long steps = (long long)ti * tj * tk;
+
+    // Paso s -> bloques (i, j, k) en el orden del bucle de la cabecera
+    struct Step { int i0, j0, k0, mi, nj, kk; };
+    auto step_at = [&](long long s) {
+        const int kb_i = (int)(s % tk), jb = (int)(s / tk % tj), ib = (int)(s / tk / tj);
+        Step p;
+        p.i0 = ib * plan.mb; p.j0 = jb * plan.nb; p.k0 = kb_i * plan.kb;
+        p.mi = std::min(plan.mb, m - p.i0);
+        p.nj = std::min(plan.nb, n - p.j0);
+        p.kk = std::min(plan.kb, k - p.k0);
+        return p;
+    };
+
+    IoThread io;
+    auto submit_read = [&](long long s) {
+        const Step p = step_at(s);
+        const int b = (int)(s & 1);
+        return io.submit([&, p, b] {
+            const auto t0 = clock::now();
+            const bool ok = ooc_detail::read_tile<T>(fa, ha, p.i0, p.k0, a_buf[b].view(0, 0, p.mi, p.kk)) &&
+                            ooc_detail::read_tile<T>(fb, hb, p.k0, p.j0, b_buf[b].view(0, 0, p.kk, p.nj));
+            st.read_s += seconds_since(t0);
+            st.bytes_read += ((std::uint64_t)p.mi * p.kk + (std::uint64_t)p.kk * p.nj) * sizeof(T);
+            return ok;
+        });
+    };
+
+    std::future<bool> pending_read = submit_read(0);
+    std::future<bool> pending_write[2];
+    int cb = 0;                         // buffer de C del bloque en curso
+    for (long long s = 0; s < steps; ++s) {
+        const Step p = step_at(s);
+        const int b = (int)(s & 1);
+
+        auto t_wait = clock::now();
+        const bool read_ok = pending_read.get();
+        // Buffer de C libre (su escritura anterior terminada) al empezar bloque
+        bool write_ok = true;
+        if (p.k0 == 0 && pending_write[cb].valid()) write_ok = pending_write[cb].get();
+        st.wait_s += seconds_since(t_wait);
+        if (!read_ok) { err = "error de lectura de " + a_path + " o " + b_path; return false; }
+        if (!write_ok) { err = "error de escritura en " + c_path; return false; }
+
+        if (s + 1 < steps) pending_read = submit_read(s + 1);
+
+        const auto t_comp = clock::now();
+        ConstMatrixViewT<T> av = a_buf[b].view(0, 0, p.mi, p.kk);
+        ConstMatrixViewT<T> bv = b_buf[b].view(0, 0, p.kk, p.nj);
+        MatrixViewT<Acc> cv = c_buf[cb].view(0, 0, p.mi, p.nj);
+        if (p.k0 == 0) {
+            multiply(av, bv, cv);
+        } else {
+            MatrixViewT<Acc> pv = partial.view(0, 0, p.mi, p.nj);
+            multiply(av, bv, pv);
+            for (int r = 0; r < p.mi; ++r) {
+                Acc* c = cv.row(r);
+                const Acc* q = pv.row(r);
+                for (int j = 0; j < p.nj; ++j) c[j] += q[j];
+            }
+        }
+        st.compute_s += seconds_since(t_comp);
+
+        if (p.k0 + p.kk == k) {         // bloque de C terminado
+            const int w = cb;
+            pending_write[w] = io.submit([&, p, w] {
+                const auto t0 = clock::now();
+                const bool ok = ooc_detail::write_tile<Acc>(fc, hc, p.i0, p.j0, c_buf[w].view(0, 0, p.mi, p.nj));
+                st.write_s += seconds_since(t0);
+                st.bytes_written += (std::uint64_t)p.mi * p.nj * sizeof(Acc);
+                return ok;
+            });
+            ++st.c_tiles;
+            cb ^= 1;
+        }
+    }
+    st.steps = steps;
+
+    const auto t_wait = clock::now();
+    bool write_ok = true;
+    for (auto& f : pending_write)
+        if (f.valid()) write_ok = f.get() && write_ok;
+    st.wait_s += seconds_since(t_wait);
+    if (!write_ok) { err = "error de escritura en " + c_path; return false; }
+
+    // Suma de comprobacion: relectura secuencial de C por trozos del tamano
+    // del mayor buffer (cabe en el presupuesto) y cabecera definitiva.
+    const auto t_sum = clock::now();
+    const std::size_t chunk = c_buf[0].size_bytes() / 8 * 8;
+    std::uint64_t sum = MATRIX_CHECKSUM_SEED;
+    unsigned char* tmp = reinterpret_cast<unsigned char*>(c_buf[0].data());
+    for (std::uint64_t off = 0; off < c_data_bytes; off += chunk) {
+        const std::size_t len = (std::size_t)std::min<std::uint64_t>(chunk, c_data_bytes - off);
+        if (!fc.read_at(tmp, len, hc.data_offset + off)) { err = "error releyendo " + c_path; return false; }
+        sum = matrix_checksum(tmp, len, sum);
+    }
+    hc.checksum = sum;
+    if (!fc.write_at(&hc, sizeof(hc), 0) || !fc.sync()) { err = "no se pudo volcar " + c_path + " a disco"; return false; }
+    st.checksum_s = seconds_since(t_sum);
+    st.total_s = seconds_since(t_start);
+    return true;
+}
+
+// ===================== Informe =====================
+
+// Fraccion del bucle de teselas en la que el calculo estuvo parado esperando
+// al disco: cerca de 0 la E/S queda oculta tras el calculo; cerca de 1 manda
+// el disco.
+inline double out_of_core_wait_fraction(const OutOfCoreStats& st) {
+    const double loop = st.wait_s + st.compute_s;
+    return loop > 0 ? st.wait_s / loop : 0.0;
+}
+
+inline void print_out_of_core(std::ostream& out, const OutOfCoreStats& st, double ops) {
+    const double mb = 1024.0 * 1024.0;
+    auto rate = [&](std::uint64_t bytes, double s) { return s > 0 ? bytes / mb / s : 0.0; };
+    out << std::fixed << std::setprecision(3)
+        << "  Tesela (mb x nb x kb):   " << st.plan.mb << " x " << st.plan.nb << " x " << st.plan.kb << "\n"
+        << "  Buffers de teselas:      " << std::setprecision(1) << st.plan.buffer_bytes / mb << " MB\n"
+        << "  Productos de teselas:    " << st.steps << " (" << st.c_tiles << " bloques de C)\n"
+        << "  Leido de A y B:          " << st.bytes_read / mb << " MB en " << std::setprecision(3)
+        << st.read_s << " s (" << std::setprecision(1) << rate(st.bytes_read, st.read_s) << " MB/s)\n"
+        << "  Escrito en C:            " << st.bytes_written / mb << " MB en " << std::setprecision(3)
+        << st.write_s << " s (" << std::setprecision(1) << rate(st.bytes_written, st.write_s) << " MB/s)\n"
+        << std::setprecision(3)
+        << "  Calculo:                 " << st.compute_s << " s";
+    if (ops > 0 && st.compute_s > 0) out << " (" << std::setprecision(2) << ops / st.compute_s / 1e9 << " GOP/s)";
+    out << "\n" << std::setprecision(3)
+        << "  Espera de E/S:           " << st.wait_s << " s (" << std::setprecision(1)
+        << 100.0 * out_of_core_wait_fraction(st) << "% del bucle)\n" << std::setprecision(3)
+        << "  Suma de C (relectura):   " << st.checksum_s << " s\n"
+        << "  Total:                   " << st.total_s << " s\n"
+        << "  Limitado por:            " << (st.wait_s > st.compute_s ? "disco" : "calculo") << "\n";
+}
@@ -0,0 +1,160 @@
+// Contadores hardware por hilo con perf_event_open (Linux).
+//
+// Cada worker abre sus propios contadores (pid = 0, cpu = -1: siguen al hilo
+// en cualquier core) para ciclos, instrucciones, fallos de L1D, fallos de
+// ultimo nivel de cache, fallos de dTLB y fallos de prediccion de saltos.
+// Se abren desactivados; quien mide los pone a cero, los activa y los lee
+// desde cualquier hilo con ioctl/read sobre los descriptores.
+//
+// Solo se cuenta modo usuario (exclude_kernel), que es lo que permite
+// perf_event_paranoid <= 2 sin privilegios. Si el kernel multiplexa los
+// contadores se escala por tiempo_activo / tiempo_contando. Cuando un evento
+// no existe (maquina virtual, paranoid = 3, otro sistema) queda como no
+// disponible y el informe lo muestra como "n/d" en lugar de fallar.
+
+#pragma once
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+enum PerfEvent { PERF_CYCLES, PERF_INSTRUCTIONS, PERF_L1D_MISSES, PERF_LLC_MISSES,
+                 PERF_DTLB_MISSES, PERF_BRANCH_MISSES, PERF_EVENT_COUNT };
+
+inline const char* perf_event_label(int e) {
+    static const char* names[PERF_EVENT_COUNT] = { "ciclos", "instrucciones", "fallos_l1d",
+                                                   "fallos_llc", "fallos_dtlb", "fallos_saltos" };
+    return (e >= 0 && e < PERF_EVENT_COUNT) ? names[e] : "?";
+}
+
+// Lectura de los contadores; valid[e] = false si ese evento no se pudo abrir
+// o no llego a contar.
+struct PerfCounts {
+    double value[PERF_EVENT_COUNT] = {};
+    bool valid[PERF_EVENT_COUNT] = {};
+
+    bool any() const {
+        for (bool v : valid) if (v) return true;
+        return false;
+    }
+    double ipc() const {
+        return valid[PERF_CYCLES] && valid[PERF_INSTRUCTIONS] && value[PERF_CYCLES] > 0
+            ? value[PERF_INSTRUCTIONS] / value[PERF_CYCLES] : -1.0;
+    }
+    // Fallos de un evento por cada 1000 operaciones (multiplicaciones + sumas)
+    double per_kop(int e, double ops) const {
+        return valid[e] && ops > 0 ? value[e] * 1000.0 / ops : -1.0;
+    }
+
+    PerfCounts& operator+=(const PerfCounts& o) {
+        for (int e = 0; e < PERF_EVENT_COUNT; ++e) {
+            if (!o.valid[e]) continue;
+            value[e] += o.value[e];
+            valid[e] = true;
+        }
+        return *this;
+    }
+};
+
+class PerfCounters {
+public:
+    PerfCounters() { for (int& fd : fd_) fd = -1; }
+    ~PerfCounters() { close_all(); }
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    // Abre los contadores del hilo que llama. Devuelve false si no se pudo
+    // abrir ninguno (el motivo queda en error()).
+    bool open_for_current_thread() {
+        close_all();
+#ifdef __linux__
+        const std::uint64_t cache_miss = ((std::uint64_t)PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                         ((std::uint64_t)PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        const struct { std::uint32_t type; std::uint64_t config; } ev[PERF_EVENT_COUNT] = {
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+            { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | cache_miss },
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+            { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | cache_miss },
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+        };
+        int opened = 0, first_errno = 0;
+        for (int e = 0; e < PERF_EVENT_COUNT; ++e) {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = ev[e].type;
+            attr.config = ev[e].config;
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            fd_[e] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+            if (fd_[e] >= 0) ++opened;
+            else if (!first_errno) first_errno = errno;
+        }
+        if (opened == 0) {
+            error_ = std::string("perf_event_open: ") + std::strerror(first_errno);
+            if (first_errno == EACCES || first_errno == EPERM)
+                error_ += " (ver /proc/sys/kernel/perf_event_paranoid)";
+        }
+        return opened > 0;
+#else
+        error_ = "perf_event_open solo existe en Linux";
+        return false;
+#endif
+    }
+
+    bool is_open() const {
+        for (int fd : fd_) if (fd >= 0) return true;
+        return false;
+    }
+    const std::string& error() const { return error_; }
+
+    // A cero y contando / parados. Se pueden llamar desde otro hilo.
+    void start() {
+#ifdef __linux__
+        for (int fd : fd_)
+            if (fd >= 0) { ioctl(fd, PERF_EVENT_IOC_RESET, 0); ioctl(fd, PERF_EVENT_IOC_ENABLE, 0); }
+#endif
+    }
+    void stop() {
+#ifdef __linux__
+        for (int fd : fd_)
+            if (fd >= 0) ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+#endif
+    }
+
+    PerfCounts read() const {
+        PerfCounts c;
+#ifdef __linux__
+        for (int e = 0; e < PERF_EVENT_COUNT; ++e) {
+            if (fd_[e] < 0) continue;
+            std::uint64_t v[3] = {};    // valor, tiempo activo, tiempo contando
+            if (::read(fd_[e], v, sizeof(v)) != (ssize_t)sizeof(v) || v[2] == 0) continue;
+            c.value[e] = (double)v[0] * ((double)v[1] / (double)v[2]);
+            c.valid[e] = true;
+        }
+#endif
+        return c;
+    }
+
+private:
+    void close_all() {
+#ifdef __linux__
+        for (int& fd : fd_)
+            if (fd >= 0) { ::close(fd); fd = -1; }
+#endif
+    }
+
+    int fd_[PERF_EVENT_COUNT];
+    std::string error_;
+};
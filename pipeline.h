@@ -0,0 +1,144 @@
+// Tuberia por paneles de filas: cada fase trabaja sobre un panel distinto.
+//
+//   generar/cargar A (panel k+1) -> multiplicar (panel k) -> verificar y
+//   escribir C (panel k-1)
+//
+// Cada etapa es un hilo que recorre los paneles 0..P-1 en orden; el panel p
+// entra en la etapa s cuando la etapa s-1 lo ha terminado. Como mucho
+// `depth` paneles estan dentro de la tuberia a la vez: la primera etapa no
+// empieza el panel p hasta que la ultima ha soltado el p - depth. (La etapa
+// de multiplicar reparte su panel entre los hilos del pool; las demas son un
+// hilo cada una.)
+//
+// Por etapa se mide el tiempo trabajando, esperando al panel de la etapa
+// anterior y, en la primera, esperando hueco por el limite de profundidad.
+// Ocupacion = trabajando / tiempo total de la tuberia: la etapa mas ocupada
+// es el cuello de botella y las demas esperan a su ritmo.
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <iomanip>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct PipelineStageStats {
+    std::string name;
+    int panels = 0;
+    double busy_s = 0.0;                // trabajando
+    double wait_in_s = 0.0;             // esperando a la etapa anterior
+    double wait_out_s = 0.0;            // esperando hueco (solo la primera)
+};
+
+class PanelPipeline {
+public:
+    PanelPipeline(int panels, int depth) : panels_(panels), depth_(std::max(1, depth)) {}
+
+    // work(p) hace la etapa sobre el panel p; las etapas van en el orden en
+    // que se anaden.
+    void add_stage(const std::string& name, std::function<void(int)> work) {
+        PipelineStageStats st;
+        st.name = name;
+        stats_.push_back(st);
+        work_.push_back(std::move(work));
+    }
+
+    // Ejecuta todas las etapas y devuelve el tiempo total. Si una etapa lanza
+    // una excepcion las demas se detienen y se relanza aqui.
+    double run() {
+        const int stages = (int)work_.size();
+        done_.assign(stages, 0);
+        failed_ = false;
+        error_ = nullptr;
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> threads;
+        for (int s = 0; s < stages; ++s) threads.emplace_back([this, s] { stage_loop(s); });
+        for (std::thread& t : threads) t.join();
+        total_s_ = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (error_) std::rethrow_exception(error_);
+        return total_s_;
+    }
+
+    int panels() const { return panels_; }
+    int depth() const { return depth_; }
+    double total_s() const { return total_s_; }
+    const std::vector<PipelineStageStats>& stats() const { return stats_; }
+
+    double occupancy(int s) const { return total_s_ > 0 ? stats_[s].busy_s / total_s_ : 0.0; }
+
+    // Etapa con mas tiempo trabajando (-1 sin etapas).
+    int bottleneck() const {
+        int best = -1;
+        for (int s = 0; s < (int)stats_.size(); ++s)
+            if (best < 0 || stats_[s].busy_s > stats_[best].busy_s) best = s;
+        return best;
+    }
+
+private:
+    void stage_loop(int s) {
+        PipelineStageStats& st = stats_[s];
+        const int last = (int)work_.size() - 1;
+        for (int p = 0; p < panels_; ++p) {
+            auto t0 = std::chrono::steady_clock::now();
+            {
+                std::unique_lock<std::mutex> lk(mtx_);
+                cv_.wait(lk, [&] {
+                    if (failed_) return true;
+                    if (s > 0 && done_[s - 1] <= p) return false;
+                    return s > 0 || done_[last] > p - depth_;
+                });
+                if (failed_) return;
+            }
+            auto t1 = std::chrono::steady_clock::now();
+            (s == 0 ? st.wait_out_s : st.wait_in_s) += std::chrono::duration<double>(t1 - t0).count();
+            try {
+                work_[s](p);
+            } catch (...) {
+                std::lock_guard<std::mutex> lk(mtx_);
+                if (!failed_) error_ = std::current_exception();
+                failed_ = true;
+                cv_.notify_all();
+                return;
+            }
+            st.busy_s += std::chrono::duration<double>(std::chrono::steady_clock::now() - t1).count();
+            ++st.panels;
+            {
+                std::lock_guard<std::mutex> lk(mtx_);
+                done_[s] = p + 1;
+            }
+            cv_.notify_all();
+        }
+    }
+
+    int panels_, depth_;
+    std::vector<std::function<void(int)>> work_;
+    std::vector<PipelineStageStats> stats_;
+    std::vector<int> done_;                 // paneles terminados por etapa
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    bool failed_ = false;
+    std::exception_ptr error_;
+    double total_s_ = 0.0;
+};
+
+// ===================== Informe =====================
+
+inline void print_pipeline(std::ostream& out, const PanelPipeline& pl) {
+    out << "  Etapa          Paneles  Trabajando (s)  Esperando (s)  Sin hueco (s)  Ocupacion\n";
+    for (int s = 0; s < (int)pl.stats().size(); ++s) {
+        const PipelineStageStats& st = pl.stats()[s];
+        out << "  " << std::left << std::setw(13) << st.name << std::right << "  " << std::setw(7) << st.panels
+            << std::fixed << std::setprecision(6) << "  " << std::setw(14) << st.busy_s
+            << "  " << std::setw(13) << st.wait_in_s << "  " << std::setw(13) << st.wait_out_s
+            << "  " << std::setw(8) << std::setprecision(1) << 100.0 * pl.occupancy(s) << "%\n";
+    }
+    if (pl.bottleneck() >= 0)
+        out << "  Cuello de botella: " << pl.stats()[pl.bottleneck()].name << "\n";
+}
@@ -0,0 +1,506 @@
+// Instrumentacion del proceso y de los hilos, con backend Windows y Linux.
+//
+// Misma superficie en ambos sistemas:
+//   get_memory_mb()          RAM residente actual (Working Set / RSS)
+//   get_peak_memory_mb()     pico de RAM residente (Peak Working Set / VmHWM)
+//   get_thread_cpu_time()    CPU consumida por el hilo que llama (s)
+//   get_process_cpu_time()   CPU consumida por todo el proceso (s)
+//   pin_current_thread(c)    fija el hilo que llama al CPU logico c (tambien > 64)
+//   current_thread_id()      TID del sistema operativo
+//   current_cpu()            core en el que corre ahora el hilo
+//   read_process_counters()  tiempos kernel/usuario, memoria, I/O, handles...
+//   read_system_info()       SO, modelo de CPU, cores logicos y RAM total
+//   cpu_max_mhz()            frecuencia maxima del CPU (0 = desconocida)
+//   current_datetime_iso()   fecha y hora local "AAAA-MM-DDTHH:MM:SS"
+//
+// Windows usa psapi/GetThreadTimes/SetThreadGroupAffinity; Linux usa
+// /proc/self/statm y /proc/self/status, clock_gettime con relojes de CPU,
+// pthread_setaffinity_np y gettid. En otros sistemas devuelven 0 / false.
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <set>
+#include <string>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#elif defined(__linux__)
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/utsname.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#define MM_PLATFORM_X86 1
+#endif
+
+// ===================== Memoria =====================
+
+#ifdef __linux__
+// Lee el valor numerico de un campo "Clave:   N [kB]" de /proc/self/status.
+inline long linux_status_value(const char* key) {
+    FILE* f = std::fopen("/proc/self/status", "r");
+    if (!f) return 0;
+    char line[256];
+    long v = 0;
+    size_t klen = std::strlen(key);
+    while (std::fgets(line, sizeof(line), f)) {
+        if (std::strncmp(line, key, klen) == 0 && line[klen] == ':') {
+            std::sscanf(line + klen + 1, "%ld", &v);
+            break;
+        }
+    }
+    std::fclose(f);
+    return v;
+}
+#endif
+
+inline double get_memory_mb() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+        return pmc.WorkingSetSize / (1024.0 * 1024.0);
+#elif defined(__linux__)
+    // statm: tamano total y paginas residentes
+    FILE* f = std::fopen("/proc/self/statm", "r");
+    if (f) {
+        long size = 0, resident = 0;
+        int n = std::fscanf(f, "%ld %ld", &size, &resident);
+        std::fclose(f);
+        if (n == 2)
+            return resident * (double)sysconf(_SC_PAGESIZE) / (1024.0 * 1024.0);
+    }
+#endif
+    return 0.0;
+}
+
+inline double get_peak_memory_mb() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+        return pmc.PeakWorkingSetSize / (1024.0 * 1024.0);
+#elif defined(__linux__)
+    return linux_status_value("VmHWM") / 1024.0;
+#endif
+    return 0.0;
+}
+
+// ===================== Tiempo de CPU =====================
+
+inline double get_thread_cpu_time() {
+#ifdef _WIN32
+    FILETIME c, e, k, u;
+    if (GetThreadTimes(GetCurrentThread(), &c, &e, &k, &u)) {
+        ULARGE_INTEGER ki, ui;
+        ki.LowPart = k.dwLowDateTime; ki.HighPart = k.dwHighDateTime;
+        ui.LowPart = u.dwLowDateTime; ui.HighPart = u.dwHighDateTime;
+        return (ki.QuadPart + ui.QuadPart) / 10000000.0;
+    }
+#elif defined(__linux__)
+    timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0)
+        return ts.tv_sec + ts.tv_nsec * 1e-9;
+#endif
+    return 0.0;
+}
+
+inline double get_process_cpu_time() {
+#ifdef _WIN32
+    FILETIME c, e, k, u;
+    if (GetProcessTimes(GetCurrentProcess(), &c, &e, &k, &u)) {
+        ULARGE_INTEGER ki, ui;
+        ki.LowPart = k.dwLowDateTime; ki.HighPart = k.dwHighDateTime;
+        ui.LowPart = u.dwLowDateTime; ui.HighPart = u.dwHighDateTime;
+        return (ki.QuadPart + ui.QuadPart) / 10000000.0;
+    }
+#elif defined(__linux__)
+    timespec ts;
+    if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts) == 0)
+        return ts.tv_sec + ts.tv_nsec * 1e-9;
+#endif
+    return 0.0;
+}
+
+// ===================== Hilos y afinidad =====================
+
+inline bool pin_current_thread(int core) {
+    if (core < 0) return false;
+#ifdef _WIN32
+    // Con mas de 64 CPUs Windows los agrupa de 64 en 64: core = grupo * 64 + bit
+    GROUP_AFFINITY ga = {};
+    ga.Group = (WORD)(core / 64);
+    ga.Mask = (KAFFINITY)1 << (core % 64);
+    return SetThreadGroupAffinity(GetCurrentThread(), &ga, nullptr) != 0;
+#elif defined(__linux__)
+    // Mascara dinamica: admite CPUs por encima de CPU_SETSIZE (1024)
+    cpu_set_t* set = CPU_ALLOC(core + 1);
+    if (!set) return false;
+    const size_t sz = CPU_ALLOC_SIZE(core + 1);
+    CPU_ZERO_S(sz, set);
+    CPU_SET_S(core, sz, set);
+    const bool ok = pthread_setaffinity_np(pthread_self(), sz, set) == 0;
+    CPU_FREE(set);
+    return ok;
+#else
+    return false;
+#endif
+}
+
+inline unsigned long current_thread_id() {
+#ifdef _WIN32
+    return GetCurrentThreadId();
+#elif defined(__linux__)
+    return (unsigned long)syscall(SYS_gettid);
+#else
+    return 0;
+#endif
+}
+
+inline int current_cpu() {
+#ifdef _WIN32
+    PROCESSOR_NUMBER pn;
+    GetCurrentProcessorNumberEx(&pn);
+    return pn.Group * 64 + pn.Number;
+#elif defined(__linux__)
+    return sched_getcpu();
+#else
+    return -1;
+#endif
+}
+
+// ===================== Contadores del proceso y del sistema =====================
+
+// Instantanea de los contadores que se vuelcan en resultados/metricas_*.json.
+// Lo que un sistema no ofrece queda a 0 (p. ej. ciclos de CPU en Linux).
+struct ProcessCounters {
+    double kernel_s = 0.0;
+    double user_s = 0.0;
+    std::uint64_t page_faults = 0;
+    std::uint64_t working_set_kb = 0;
+    std::uint64_t peak_working_set_kb = 0;
+    std::uint64_t private_kb = 0;
+    std::uint64_t io_read_ops = 0;
+    std::uint64_t io_write_ops = 0;
+    std::uint64_t io_other_ops = 0;
+    std::uint64_t io_read_kb = 0;
+    std::uint64_t io_write_kb = 0;
+    std::uint64_t cycles = 0;
+    unsigned long pid = 0;
+    unsigned long tid = 0;
+    int core = -1;
+    std::string priority;
+    int modules = 0;
+    int handles = 0;
+
+    double kernel_pct() const {
+        double t = kernel_s + user_s;
+        return t > 0 ? kernel_s / t * 100.0 : 0.0;
+    }
+    double ghz() const {
+        double t = kernel_s + user_s;
+        return (cycles && t > 0.001) ? cycles / t / 1e9 : 0.0;
+    }
+};
+
+#ifdef __linux__
+// Lee "clave: valor" de un fichero tipo /proc/self/io.
+inline std::uint64_t linux_kv_file_value(const char* path, const char* key) {
+    FILE* f = std::fopen(path, "r");
+    if (!f) return 0;
+    char line[256];
+    unsigned long long v = 0;
+    size_t klen = std::strlen(key);
+    while (std::fgets(line, sizeof(line), f)) {
+        if (std::strncmp(line, key, klen) == 0 && line[klen] == ':') {
+            std::sscanf(line + klen + 1, "%llu", &v);
+            break;
+        }
+    }
+    std::fclose(f);
+    return v;
+}
+#endif
+
+inline ProcessCounters read_process_counters() {
+    ProcessCounters pc;
+    pc.tid = current_thread_id();
+    pc.core = current_cpu();
+#ifdef _WIN32
+    HANDLE proc = GetCurrentProcess();
+    pc.pid = GetCurrentProcessId();
+    FILETIME c, e, k, u;
+    if (GetProcessTimes(proc, &c, &e, &k, &u)) {
+        ULARGE_INTEGER ki, ui;
+        ki.LowPart = k.dwLowDateTime; ki.HighPart = k.dwHighDateTime;
+        ui.LowPart = u.dwLowDateTime; ui.HighPart = u.dwHighDateTime;
+        pc.kernel_s = ki.QuadPart / 10000000.0;
+        pc.user_s = ui.QuadPart / 10000000.0;
+    }
+    PROCESS_MEMORY_COUNTERS_EX pmc;
+    if (GetProcessMemoryInfo(proc, (PROCESS_MEMORY_COUNTERS*)&pmc, sizeof(pmc))) {
+        pc.page_faults = pmc.PageFaultCount;
+        pc.working_set_kb = pmc.WorkingSetSize / 1024;
+        pc.peak_working_set_kb = pmc.PeakWorkingSetSize / 1024;
+        pc.private_kb = pmc.PrivateUsage / 1024;
+    }
+    IO_COUNTERS io;
+    if (GetProcessIoCounters(proc, &io)) {
+        pc.io_read_ops = io.ReadOperationCount;
+        pc.io_write_ops = io.WriteOperationCount;
+        pc.io_other_ops = io.OtherOperationCount;
+        pc.io_read_kb = io.ReadTransferCount / 1024;
+        pc.io_write_kb = io.WriteTransferCount / 1024;
+    }
+    // QueryProcessCycleTime solo existe desde Vista: se resuelve en ejecucion
+    typedef BOOL (WINAPI *QueryProcessCycleTimeFunc)(HANDLE, PULONG64);
+    if (HMODULE k32 = GetModuleHandleA("kernel32.dll")) {
+        auto query = (QueryProcessCycleTimeFunc)GetProcAddress(k32, "QueryProcessCycleTime");
+        ULONG64 cycles = 0;
+        if (query && query(proc, &cycles)) pc.cycles = cycles;
+    }
+    switch (GetPriorityClass(proc)) {
+        case IDLE_PRIORITY_CLASS:         pc.priority = "IDLE"; break;
+        case BELOW_NORMAL_PRIORITY_CLASS: pc.priority = "BELOW_NORMAL"; break;
+        case NORMAL_PRIORITY_CLASS:       pc.priority = "NORMAL"; break;
+        case ABOVE_NORMAL_PRIORITY_CLASS: pc.priority = "ABOVE_NORMAL"; break;
+        case HIGH_PRIORITY_CLASS:         pc.priority = "HIGH"; break;
+        case REALTIME_PRIORITY_CLASS:     pc.priority = "REALTIME"; break;
+        default:                          pc.priority = "?";
+    }
+    HMODULE mods[1024];
+    DWORD needed = 0;
+    if (EnumProcessModules(proc, mods, sizeof(mods), &needed))
+        pc.modules = (int)(needed / sizeof(HMODULE));
+    DWORD handles = 0;
+    if (GetProcessHandleCount(proc, &handles)) pc.handles = (int)handles;
+#elif defined(__linux__)
+    pc.pid = (unsigned long)getpid();
+    rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) == 0) {
+        pc.user_s = ru.ru_utime.tv_sec + ru.ru_utime.tv_usec * 1e-6;
+        pc.kernel_s = ru.ru_stime.tv_sec + ru.ru_stime.tv_usec * 1e-6;
+        pc.page_faults = (std::uint64_t)(ru.ru_minflt + ru.ru_majflt);
+    }
+    pc.working_set_kb = (std::uint64_t)linux_status_value("VmRSS");
+    pc.peak_working_set_kb = (std::uint64_t)linux_status_value("VmHWM");
+    pc.private_kb = (std::uint64_t)linux_status_value("RssAnon");
+    // /proc/self/io: syscalls de lectura/escritura y bytes de almacenamiento
+    pc.io_read_ops = linux_kv_file_value("/proc/self/io", "syscr");
+    pc.io_write_ops = linux_kv_file_value("/proc/self/io", "syscw");
+    pc.io_read_kb = linux_kv_file_value("/proc/self/io", "rchar") / 1024;
+    pc.io_write_kb = linux_kv_file_value("/proc/self/io", "wchar") / 1024;
+    pc.priority = "nice " + std::to_string(getpriority(PRIO_PROCESS, 0));
+    // Modulos: bibliotecas compartidas distintas mapeadas en el proceso
+    if (FILE* f = std::fopen("/proc/self/maps", "r")) {
+        std::set<std::string> libs;
+        char line[512];
+        while (std::fgets(line, sizeof(line), f)) {
+            const char* path = std::strchr(line, '/');
+            if (path && std::strstr(path, ".so")) libs.insert(path);
+        }
+        std::fclose(f);
+        pc.modules = (int)libs.size();
+    }
+    // Handles: descriptores de fichero abiertos
+    if (DIR* d = opendir("/proc/self/fd")) {
+        while (dirent* de = readdir(d))
+            if (de->d_name[0] != '.') ++pc.handles;
+        closedir(d);
+        --pc.handles;   // el propio opendir
+    }
+#endif
+    return pc;
+}
+
+struct SystemInfo {
+    std::string os;
+    std::string cpu;
+    int logical_cores = 0;
+    std::uint64_t ram_total_mb = 0;
+};
+
+inline std::string cpu_brand_string() {
+    std::string brand;
+#ifdef MM_PLATFORM_X86
+    unsigned r[4];
+    auto query = [&](unsigned leaf) {
+#if defined(_MSC_VER) && !defined(__clang__)
+        int v[4];
+        __cpuid(v, (int)leaf);
+        for (int i = 0; i < 4; ++i) r[i] = (unsigned)v[i];
+#else
+        __cpuid(leaf, r[0], r[1], r[2], r[3]);
+#endif
+    };
+    query(0x80000000u);
+    if (r[0] >= 0x80000004u) {
+        char buf[49] = {};
+        for (unsigned leaf = 0; leaf < 3; ++leaf) {
+            query(0x80000002u + leaf);
+            std::memcpy(buf + leaf * 16, r, 16);
+        }
+        brand = buf;
+    }
+#endif
+#ifdef __linux__
+    if (brand.empty()) {
+        if (FILE* f = std::fopen("/proc/cpuinfo", "r")) {
+            char line[256];
+            while (std::fgets(line, sizeof(line), f)) {
+                const char* colon = std::strchr(line, ':');
+                if (colon && std::strncmp(line, "model name", 10) == 0) {
+                    brand = colon + 1;
+                    break;
+                }
+            }
+            std::fclose(f);
+        }
+    }
+#endif
+    size_t b = brand.find_first_not_of(" \t");
+    size_t e = brand.find_last_not_of(" \t\n");
+    return b == std::string::npos ? std::string() : brand.substr(b, e - b + 1);
+}
+
+// Frecuencia maxima del CPU 0 en MHz (0 = desconocida). En Linux la de
+// cpufreq y, sin ella (maquinas virtuales), la mayor "cpu MHz" de
+// /proc/cpuinfo; en Windows la nominal del registro.
+inline double cpu_max_mhz() {
+    double mhz = 0.0;
+#ifdef _WIN32
+    DWORD v = 0, size = sizeof(v);
+    if (RegGetValueA(HKEY_LOCAL_MACHINE, "HARDWARE\\DESCRIPTION\\System\\CentralProcessor\\0", "~MHz",
+                     RRF_RT_REG_DWORD, nullptr, &v, &size) == ERROR_SUCCESS)
+        mhz = (double)v;
+#elif defined(__linux__)
+    if (FILE* f = std::fopen("/sys/devices/system/cpu/cpu0/cpufreq/cpuinfo_max_freq", "r")) {
+        long khz = 0;
+        if (std::fscanf(f, "%ld", &khz) == 1) mhz = khz / 1000.0;
+        std::fclose(f);
+    }
+    if (mhz <= 0.0) {
+        if (FILE* f = std::fopen("/proc/cpuinfo", "r")) {
+            char line[256];
+            while (std::fgets(line, sizeof(line), f)) {
+                const char* colon = std::strchr(line, ':');
+                if (colon && std::strncmp(line, "cpu MHz", 7) == 0) mhz = std::max(mhz, std::atof(colon + 1));
+            }
+            std::fclose(f);
+        }
+    }
+#endif
+    return mhz;
+}
+
+inline SystemInfo read_system_info() {
+    SystemInfo si;
+    si.cpu = cpu_brand_string();
+#ifdef _WIN32
+    si.os = "Windows";
+    SYSTEM_INFO sys;
+    GetSystemInfo(&sys);
+    si.logical_cores = (int)sys.dwNumberOfProcessors;
+    MEMORYSTATUSEX mem;
+    mem.dwLength = sizeof(mem);
+    if (GlobalMemoryStatusEx(&mem)) si.ram_total_mb = mem.ullTotalPhys / (1024 * 1024);
+#elif defined(__linux__)
+    utsname un;
+    si.os = (uname(&un) == 0) ? std::string(un.sysname) + " " + un.release : "Linux";
+    si.logical_cores = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    si.ram_total_mb = (std::uint64_t)sysconf(_SC_PHYS_PAGES) * (std::uint64_t)sysconf(_SC_PAGESIZE) / (1024 * 1024);
+#endif
+    return si;
+}
+
+inline std::string current_datetime_iso() {
+    std::time_t t = std::time(nullptr);
+    std::tm tm{};
+#ifdef _WIN32
+    localtime_s(&tm, &t);
+#else
+    localtime_r(&t, &tm);
+#endif
+    char buf[32];
+    std::strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S", &tm);
+    return buf;
+}
+
+// ===================== Resumen del proceso (Linux) =====================
+
+#ifdef __linux__
+// Equivalente compacto de las secciones Win32 de MMS/MMP: tiempo en modo
+// kernel/usuario, memoria, cambios de contexto y afinidad del proceso.
+inline void mostrar_recursos_proceso() {
+    std::cout << "\n========== RECURSOS DEL PROCESO (Linux) ==========\n";
+
+    rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) == 0) {
+        double user = ru.ru_utime.tv_sec + ru.ru_utime.tv_usec * 1e-6;
+        double sys = ru.ru_stime.tv_sec + ru.ru_stime.tv_usec * 1e-6;
+        double total = user + sys;
+        std::cout << std::fixed << std::setprecision(6);
+        std::cout << "  Tiempo en MODO KERNEL:      " << std::setw(12) << sys << " s\n";
+        std::cout << "  Tiempo en MODO USUARIO:     " << std::setw(12) << user << " s\n";
+        std::cout << "  Tiempo TOTAL de CPU:        " << std::setw(12) << total << " s\n";
+        if (total > 0) {
+            std::cout << std::setprecision(1);
+            std::cout << "  Porcentaje en Kernel:       " << std::setw(12) << sys / total * 100.0 << " %\n";
+            std::cout << "  Porcentaje en Usuario:      " << std::setw(12) << user / total * 100.0 << " %\n";
+        }
+        std::cout << "  Fallos de pagina (menores): " << std::setw(12) << ru.ru_minflt << "\n";
+        std::cout << "  Fallos de pagina (mayores): " << std::setw(12) << ru.ru_majflt << "\n";
+        std::cout << "  Cambios de contexto vol.:   " << std::setw(12) << ru.ru_nvcsw << "\n";
+        std::cout << "  Cambios de contexto invol.: " << std::setw(12) << ru.ru_nivcsw << "\n";
+    }
+
+    std::cout << std::setprecision(2);
+    std::cout << "  RAM residente (RSS):        " << std::setw(12) << get_memory_mb() << " MB\n";
+    std::cout << "  Pico de RAM (VmHWM):        " << std::setw(12) << get_peak_memory_mb() << " MB\n";
+    std::cout << "  Hilos del proceso:          " << std::setw(12) << linux_status_value("Threads") << "\n";
+
+    // Mascara dinamica con los CPUs configurados (puede haber mas de CPU_SETSIZE)
+    const int max_cpus = std::max(1, (int)sysconf(_SC_NPROCESSORS_CONF));
+    cpu_set_t* set = CPU_ALLOC(max_cpus);
+    const size_t set_size = CPU_ALLOC_SIZE(max_cpus);
+    if (set) CPU_ZERO_S(set_size, set);
+    if (set && sched_getaffinity(0, set_size, set) == 0) {
+        std::cout << "  Nucleos disponibles:        ";
+        bool first = true;
+        for (int i = 0; i < max_cpus; ++i) {
+            if (!CPU_ISSET_S(i, set_size, set)) continue;
+            if (!first) std::cout << ", ";
+            std::cout << i;
+            first = false;
+        }
+        std::cout << "\n  Total nucleos asignados:    " << std::setw(12) << CPU_COUNT_S(set_size, set) << "\n";
+    }
+    if (set) CPU_FREE(set);
+    std::cout << "  PID del proceso:            " << std::setw(12) << getpid() << "\n";
+    std::cout << "  TID del hilo actual:        " << std::setw(12) << current_thread_id() << "\n";
+    std::cout << "  Nucleo actual:              " << std::setw(12) << current_cpu() << "\n";
+
+    std::cout << "==================================================\n";
+}
+#endif
@@ -0,0 +1,198 @@
+// Bloques comunes de resultados/metricas_{secuencial,paralelo}.json.
+//
+// Cada programa abre su objeto raiz y sus secciones propias ("resultados",
+// "hilos", "monitoreo_tiempo_real"); aqui estan las secciones que comparten
+// el mismo esquema en ambos: sistema, contadores de memoria, kernel, io y
+// proceso.
+
+#pragma once
+
+#include <fstream>
+#include <string>
+
+#include "json_writer.h"
+#include "out_of_core.h"
+#include "pipeline.h"
+#include "perf_counters.h"
+#include "sparse.h"
+#include "platform.h"
+#include "strassen.h"
+#include "trace.h"
+#include "verify.h"
+
+inline void json_sistema(JsonWriter& w, const SystemInfo& si) {
+    w.begin_object("sistema");
+    w.field("os", si.os);
+    w.field("procesador", si.cpu);
+    w.field("cores_logicos", si.logical_cores);
+    w.field("ram_total_mb", si.ram_total_mb);
+    w.end_object();
+}
+
+// Campos de memoria del proceso (dentro de un objeto "memoria" ya abierto).
+inline void json_memoria_contadores(JsonWriter& w, const ProcessCounters& pc) {
+    w.field("working_set_kb", pc.working_set_kb);
+    w.field("peak_working_set_kb", pc.peak_working_set_kb);
+    w.field("private_bytes_kb", pc.private_kb);
+    w.field("page_faults", pc.page_faults);
+}
+
+inline void json_kernel(JsonWriter& w, const ProcessCounters& pc) {
+    w.begin_object("kernel");
+    w.field("tiempo_modo_kernel_s", pc.kernel_s);
+    w.field("tiempo_modo_usuario_s", pc.user_s);
+    w.field("porcentaje_kernel", pc.kernel_pct());
+    w.field("ciclos_cpu_totales", pc.cycles);
+    w.field("frecuencia_estimada_ghz", pc.ghz());
+    w.end_object();
+}
+
+inline void json_io(JsonWriter& w, const ProcessCounters& pc) {
+    w.begin_object("io");
+    w.field("operaciones_lectura", pc.io_read_ops);
+    w.field("operaciones_escritura", pc.io_write_ops);
+    w.field("otras_operaciones", pc.io_other_ops);
+    w.field("bytes_leidos_kb", pc.io_read_kb);
+    w.field("bytes_escritos_kb", pc.io_write_kb);
+    w.end_object();
+}
+
+// Seccion "proceso"; core_ejecucion solo la lleva el secuencial.
+inline void json_proceso(JsonWriter& w, const ProcessCounters& pc, bool with_core) {
+    w.begin_object("proceso");
+    w.field("pid", pc.pid);
+    w.field("tid_principal", pc.tid);
+    if (with_core) w.field("core_ejecucion", pc.core);
+    w.field("prioridad", pc.priority);
+    w.field("modulos_cargados", pc.modules);
+    w.field("handles_abiertos", pc.handles);
+    w.end_object();
+}
+
+// Plan de --kernel=strassen (cutoff elegido y niveles).
+inline void json_strassen(JsonWriter& w, const StrassenPlan& p) {
+    w.begin_object("strassen");
+    w.field("cutoff", p.cutoff);
+    w.field("lado_cruce", p.crossover());
+    w.field("cutoff_medido", p.measured);
+    w.field("calibracion_s", p.calibration_s);
+    w.field("niveles", p.levels);
+    w.field("niveles_paralelos", p.par_levels);
+    w.field("franjas_por_producto", p.leaf_splits);
+    w.field("productos_hoja", p.leaf_tasks());
+    w.inline_array("dimensiones_con_relleno", std::vector<int>{ p.mp, p.kp, p.np });
+    w.end_object();
+}
+
+// Contadores hardware (perf_counters.h): valores crudos de los eventos
+// disponibles, IPC y, si se conocen las operaciones, GOP/s y fallos por
+// cada 1000 operaciones. Sin contadores no se escribe nada.
+inline void json_perf(JsonWriter& w, const char* key, const PerfCounts& c, double ops, double seconds) {
+    if (!c.any()) return;
+    w.begin_object(key);
+    for (int e = 0; e < PERF_EVENT_COUNT; ++e)
+        if (c.valid[e]) w.field(perf_event_label(e), c.value[e]);
+    if (c.ipc() >= 0) w.field("ipc", c.ipc());
+    if (ops > 0) {
+        if (seconds > 0) w.field("gop_s", ops / seconds / 1e9);
+        w.begin_object("fallos_por_1k_ops");
+        for (int e = PERF_L1D_MISSES; e < PERF_EVENT_COUNT; ++e)
+            if (c.valid[e]) w.field(perf_event_label(e), c.per_kop(e, ops));
+        w.end_object();
+    }
+    w.end_object();
+}
+
+// Abre el fichero de salida; avisa por stderr si no se puede escribir.
+// nnz_c < 0: no se conoce (solo se cuenta con A y B dispersas).
+inline void json_sparse(JsonWriter& w, const ProductRoute& r, long long nnz_c, double ops, double conversion_s) {
+    w.begin_object("disperso");
+    w.field("camino", product_path_name(r.path));
+    w.field("no_ceros_a", (long long)r.nnz_a);
+    w.field("no_ceros_b", (long long)r.nnz_b);
+    w.field("densidad_a", r.density_a);
+    w.field("densidad_b", r.density_b);
+    if (nnz_c >= 0) w.field("no_ceros_c", nnz_c);
+    w.field("multiplicaciones_suma_estimadas", r.madds);
+    w.field("operaciones_realizadas", ops);
+    w.field("tiempo_conversion_s", conversion_s);
+    w.end_object();
+}
+
+inline void json_out_of_core(JsonWriter& w, const OutOfCoreStats& st, double ops) {
+    w.begin_object("fuera_de_memoria");
+    w.inline_array("tesela", std::vector<int>{ st.plan.mb, st.plan.nb, st.plan.kb });
+    w.field("buffers_mb", st.plan.buffer_bytes / (1024.0 * 1024.0));
+    w.field("productos_teselas", st.steps);
+    w.field("bloques_c", st.c_tiles);
+    w.field("bytes_leidos", st.bytes_read);
+    w.field("bytes_escritos", st.bytes_written);
+    w.field("tiempo_lectura_s", st.read_s);
+    w.field("tiempo_escritura_s", st.write_s);
+    w.field("tiempo_calculo_s", st.compute_s);
+    w.field("tiempo_espera_es_s", st.wait_s);
+    w.field("fraccion_espera_es", out_of_core_wait_fraction(st));
+    w.field("tiempo_suma_c_s", st.checksum_s);
+    w.field("tiempo_total_s", st.total_s);
+    w.field("gops_calculo", st.compute_s > 0 ? ops / st.compute_s / 1e9 : 0.0);
+    w.field("limitado_por", st.wait_s > st.compute_s ? "disco" : "calculo");
+    w.end_object();
+}
+
+inline void json_pipeline(JsonWriter& w, const PanelPipeline& pl) {
+    w.begin_object("tuberia");
+    w.field("paneles", pl.panels());
+    w.field("profundidad", pl.depth());
+    w.field("tiempo_total_s", pl.total_s());
+    w.begin_array("etapas");
+    for (int s = 0; s < (int)pl.stats().size(); ++s) {
+        const PipelineStageStats& st = pl.stats()[s];
+        w.begin_object();
+        w.field("nombre", st.name);
+        w.field("paneles", st.panels);
+        w.field("trabajando_s", st.busy_s);
+        w.field("esperando_entrada_s", st.wait_in_s);
+        w.field("esperando_hueco_s", st.wait_out_s);
+        w.field("ocupacion", pl.occupancy(s));
+        w.end_object();
+    }
+    w.end_array();
+    if (pl.bottleneck() >= 0) w.field("cuello_de_botella", pl.stats()[pl.bottleneck()].name);
+    w.end_object();
+}
+
+inline void json_verify(JsonWriter& w, const VerifyResult& v) {
+    w.begin_object("verificacion");
+    w.field("metodo", "Freivalds");
+    w.field("rondas", v.rounds);
+    w.field("correcta", v.ok);
+    w.field("filas_erroneas", v.bad_rows);
+    if (!v.ok) w.field("primera_fila_erronea", v.first_bad_row);
+    w.field("cota_probabilidad_error_no_detectado", v.failure_bound);
+    w.field("tiempo_s", v.time_s);
+    w.field("filas_por_bloque", v.block_rows);
+    w.field("suma_bloques", checksum_hex(v.combined));
+    std::vector<std::string> sums;
+    for (std::uint64_t h : v.block_sums) sums.push_back(checksum_hex(h));
+    w.inline_array("sumas_por_bloque", sums);
+    w.end_object();
+}
+
+inline void json_trace(JsonWriter& w, const Tracer& tr, const std::string& path) {
+    w.begin_object("traza");
+    w.field("fichero", path);
+    w.field("nivel", trace_level_name(tr.level()));
+    w.field("hilos", tr.threads());
+    w.field("eventos", (long long)tr.events());
+    w.field("eventos_descartados", (long long)tr.dropped());
+    w.end_object();
+}
+
+inline bool open_json_file(const std::string& path, std::ofstream& out) {
+    out.open(path, std::ios::out | std::ios::trunc);
+    if (!out) {
+        std::cerr << "No se pudo escribir " << path << "\n";
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,128 @@
+// Planificador dinamico de teselas con robo de trabajo (work stealing).
+//
+// C se divide en teselas rectangulares (bloques de filas x columnas). Al
+// inicio cada hilo recibe un tramo contiguo de teselas en su cola local; el
+// dueno las consume por el frente (en orden, para aprovechar la cache) y,
+// cuando su cola se vacia, roba teselas del final de la cola de otro hilo.
+// Asi un core lento o expropiado por otro proceso no retiene el join: el
+// resto de hilos se lleva su trabajo pendiente.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+struct Tile {
+    int row0 = 0;
+    int rows = 0;
+    int col0 = 0;
+    int cols = 0;
+};
+
+class TileScheduler {
+public:
+    // tile_rows / tile_cols: tamano maximo de cada tesela (las del borde
+    // pueden ser menores).
+    TileScheduler(int m, int n, int tile_rows, int tile_cols, int workers)
+        : tile_rows_(tile_rows), tile_cols_(tile_cols) {
+        std::vector<Tile> all;
+        for (int i = 0; i < m; i += tile_rows)
+            for (int j = 0; j < n; j += tile_cols)
+                all.push_back({ i, std::min(tile_rows, m - i), j, std::min(tile_cols, n - j) });
+        total_ = (int)all.size();
+
+        for (int w = 0; w < workers; ++w) {
+            auto q = std::make_unique<Queue>();
+            size_t b = all.size() * w / workers;
+            size_t e = all.size() * (w + 1) / workers;
+            q->tiles.assign(all.begin() + b, all.begin() + e);
+            initial_.push_back(q->tiles.size());
+            queues_.push_back(std::move(q));
+        }
+    }
+
+    int workers() const { return (int)queues_.size(); }
+    int total_tiles() const { return total_; }
+    int tile_rows() const { return tile_rows_; }
+    int tile_cols() const { return tile_cols_; }
+    int completed() const { return completed_.load(std::memory_order_relaxed); }
+
+    // Teselas asignadas inicialmente a un hilo y su primera/ultima tesela
+    // (para la tabla de distribucion).
+    size_t initial_tiles(int w) const { return initial_[w]; }
+    bool initial_range(int w, Tile& first, Tile& last) const {
+        std::lock_guard<std::mutex> lk(queues_[w]->mtx);
+        if (queues_[w]->tiles.empty()) return false;
+        first = queues_[w]->tiles.front();
+        last = queues_[w]->tiles.back();
+        return true;
+    }
+
+    // Siguiente tesela para el hilo `w`: primero de su cola y, si esta vacia,
+    // robada del final de la cola de otro hilo. Devuelve false cuando no
+    // queda trabajo en ninguna cola.
+    bool next(int w, Tile& t, bool& stolen) {
+        {
+            Queue& own = *queues_[w];
+            std::lock_guard<std::mutex> lk(own.mtx);
+            if (!own.tiles.empty()) {
+                t = own.tiles.front();
+                own.tiles.pop_front();
+                stolen = false;
+                return true;
+            }
+        }
+        // Se empieza por el vecino para repartir los robos entre victimas.
+        const int nw = workers();
+        for (int d = 1; d < nw; ++d) {
+            Queue& victim = *queues_[(w + d) % nw];
+            std::lock_guard<std::mutex> lk(victim.mtx);
+            if (!victim.tiles.empty()) {
+                t = victim.tiles.back();
+                victim.tiles.pop_back();
+                stolen = true;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void mark_done() { completed_.fetch_add(1, std::memory_order_relaxed); }
+
+private:
+    // Cada cola en su propia linea de cache para que los locks de hilos
+    // distintos no compartan linea.
+    struct alignas(64) Queue {
+        mutable std::mutex mtx;
+        std::deque<Tile> tiles;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<size_t> initial_;
+    std::atomic<int> completed_{0};
+    int total_ = 0;
+    int tile_rows_ = 0;
+    int tile_cols_ = 0;
+};
+
+// Forma de tesela: se buscan ~8 teselas por hilo para que haya margen de
+// robo, con filas multiplo de MR (y como mucho mc) y columnas multiplo de NR
+// (y como mucho nc), de modo que cada tesela sea una llamada entera al kernel.
+inline void choose_tile_shape(int m, int n, int workers, int mr, int nr, int mc, int nc,
+                              int& tile_rows, int& tile_cols) {
+    auto ceil_div = [](int a, int b) { return (a + b - 1) / b; };
+    auto round_up = [&](int v, int q) { return ceil_div(v, q) * q; };
+    const int target = std::max(1, workers * 8);
+
+    int max_rows = std::max(mr, mc / mr * mr);
+    tile_rows = std::min(max_rows, std::max(mr, round_up(ceil_div(m, target), mr)));
+    int row_tiles = ceil_div(m, tile_rows);
+
+    int col_tiles = std::max(1, ceil_div(target, row_tiles));
+    int max_cols = std::max(nr, nc / nr * nr);
+    tile_cols = std::min(max_cols, std::max(nr, round_up(ceil_div(n, col_tiles), nr)));
+}
@@ -0,0 +1,366 @@
+// Matrices dispersas (CSR y CSC) y productos que solo recorren los no ceros.
+//
+//   CsrMatrixT   filas comprimidas: row_ptr[i]..row_ptr[i+1] son los no ceros
+//                de la fila i (columna y valor), columnas en orden creciente
+//   CscMatrixT   lo mismo por columnas (row_ptr -> col_ptr, col_idx -> row_idx)
+//
+// Productos (C sigue siendo densa, como en el resto del programa; cada
+// funcion calcula una tesela de C, igual que los kernels de gemm.h, y
+// devuelve cuantas multiplicaciones-suma hizo):
+//
+//   spmm_csr_dense     A dispersa (CSR) x B densa: cada no cero a(i,k) suma
+//                      a(i,k) * fila k de B a la fila i de C
+//   gemm_dense_csc     A densa x B dispersa (CSC): C(i,j) = producto de la
+//                      fila i de A con los no ceros de la columna j de B
+//   spgemm_csr         A y B dispersas (CSR), Gustavson por filas: la fila i
+//                      de C se acumula en un acumulador disperso del hilo
+//                      (valores + lista de columnas tocadas) y se vuelca a C
+//
+// choose_product_path decide el camino con las densidades de A y B: estima
+// las multiplicaciones-suma de cada camino y las pondera con lo que cuesta
+// cada una frente al kernel denso por bloques (acceso indirecto, sin SIMD).
+//
+// La conversion desde densa se hace en dos pasadas (contar no ceros por fila
+// o columna, suma prefija y rellenar) para que varios hilos conviertan tramos
+// disjuntos a la vez sin coordinarse, como pack_b_panels.
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "matrix.h"
+
+// ===================== Representacion =====================
+
+template <class T>
+struct CsrMatrixT {
+    int rows = 0;
+    int cols = 0;
+    std::vector<std::int64_t> row_ptr;      // rows + 1
+    std::vector<int> col_idx;
+    std::vector<T> vals;
+
+    std::int64_t nnz() const { return row_ptr.empty() ? 0 : row_ptr.back(); }
+    std::size_t size_bytes() const {
+        return row_ptr.size() * sizeof(std::int64_t) + col_idx.size() * sizeof(int) + vals.size() * sizeof(T);
+    }
+};
+
+template <class T>
+struct CscMatrixT {
+    int rows = 0;
+    int cols = 0;
+    std::vector<std::int64_t> col_ptr;      // cols + 1
+    std::vector<int> row_idx;
+    std::vector<T> vals;
+
+    std::int64_t nnz() const { return col_ptr.empty() ? 0 : col_ptr.back(); }
+    std::size_t size_bytes() const {
+        return col_ptr.size() * sizeof(std::int64_t) + row_idx.size() * sizeof(int) + vals.size() * sizeof(T);
+    }
+};
+
+// ===================== Conversion desde densa =====================
+
+// No ceros de cada fila [r0, r1) -> counts[i].
+template <class T>
+inline void count_row_nonzeros(ConstMatrixViewT<T> M, int r0, int r1, std::vector<std::int64_t>& counts) {
+    for (int i = r0; i < r1; ++i) {
+        const T* row = M.row(i);
+        std::int64_t n = 0;
+        for (int j = 0; j < M.cols; ++j) n += (row[j] != T(0));
+        counts[i] = n;
+    }
+}
+
+// No ceros de cada columna [c0, c1) -> counts[j] (recorre todas las filas).
+template <class T>
+inline void count_col_nonzeros(ConstMatrixViewT<T> M, int c0, int c1, std::vector<std::int64_t>& counts) {
+    std::fill(counts.begin() + c0, counts.begin() + c1, 0);
+    for (int i = 0; i < M.rows; ++i) {
+        const T* row = M.row(i);
+        for (int j = c0; j < c1; ++j) counts[j] += (row[j] != T(0));
+    }
+}
+
+// Suma prefija de los recuentos y reserva de indices y valores (un hilo).
+template <class T>
+inline void csr_prepare(CsrMatrixT<T>& S, int rows, int cols, const std::vector<std::int64_t>& row_counts) {
+    S.rows = rows;
+    S.cols = cols;
+    S.row_ptr.assign(rows + 1, 0);
+    for (int i = 0; i < rows; ++i) S.row_ptr[i + 1] = S.row_ptr[i] + row_counts[i];
+    S.col_idx.resize((std::size_t)S.nnz());
+    S.vals.resize((std::size_t)S.nnz());
+}
+
+template <class T>
+inline void csc_prepare(CscMatrixT<T>& S, int rows, int cols, const std::vector<std::int64_t>& col_counts) {
+    S.rows = rows;
+    S.cols = cols;
+    S.col_ptr.assign(cols + 1, 0);
+    for (int j = 0; j < cols; ++j) S.col_ptr[j + 1] = S.col_ptr[j] + col_counts[j];
+    S.row_idx.resize((std::size_t)S.nnz());
+    S.vals.resize((std::size_t)S.nnz());
+}
+
+// Rellena las filas [r0, r1) (tras csr_prepare).
+template <class T>
+inline void csr_fill_rows(ConstMatrixViewT<T> M, CsrMatrixT<T>& S, int r0, int r1) {
+    for (int i = r0; i < r1; ++i) {
+        const T* row = M.row(i);
+        std::int64_t p = S.row_ptr[i];
+        for (int j = 0; j < M.cols; ++j) {
+            if (row[j] == T(0)) continue;
+            S.col_idx[(std::size_t)p] = j;
+            S.vals[(std::size_t)p] = row[j];
+            ++p;
+        }
+    }
+}
+
+// Rellena las columnas [c0, c1) (tras csc_prepare); filas en orden creciente.
+template <class T>
+inline void csc_fill_cols(ConstMatrixViewT<T> M, CscMatrixT<T>& S, int c0, int c1) {
+    std::vector<std::int64_t> next(S.col_ptr.begin() + c0, S.col_ptr.begin() + c1);
+    for (int i = 0; i < M.rows; ++i) {
+        const T* row = M.row(i);
+        for (int j = c0; j < c1; ++j) {
+            if (row[j] == T(0)) continue;
+            std::int64_t& p = next[j - c0];
+            S.row_idx[(std::size_t)p] = i;
+            S.vals[(std::size_t)p] = row[j];
+            ++p;
+        }
+    }
+}
+
+// Conversion completa en un hilo.
+template <class T>
+inline CsrMatrixT<T> csr_from_dense(ConstMatrixViewT<T> M) {
+    std::vector<std::int64_t> counts(M.rows);
+    count_row_nonzeros(M, 0, M.rows, counts);
+    CsrMatrixT<T> S;
+    csr_prepare(S, M.rows, M.cols, counts);
+    csr_fill_rows(M, S, 0, M.rows);
+    return S;
+}
+
+template <class T>
+inline CscMatrixT<T> csc_from_dense(ConstMatrixViewT<T> M) {
+    std::vector<std::int64_t> counts(M.cols);
+    count_col_nonzeros(M, 0, M.cols, counts);
+    CscMatrixT<T> S;
+    csc_prepare(S, M.rows, M.cols, counts);
+    csc_fill_cols(M, S, 0, M.cols);
+    return S;
+}
+
+// ===================== Productos =====================
+
+// La tesela C empieza en (row0, col0) del resultado.
+
+template <class T, class Acc>
+inline long long spmm_csr_dense(const CsrMatrixT<T>& A, ConstMatrixViewT<T> B, int row0, int col0,
+                                MatrixViewT<Acc> C) {
+    long long madds = 0;
+    for (int i = 0; i < C.rows; ++i) {
+        Acc* c = C.row(i);
+        std::fill(c, c + C.cols, Acc(0));
+        const std::int64_t p1 = A.row_ptr[row0 + i + 1];
+        for (std::int64_t p = A.row_ptr[row0 + i]; p < p1; ++p) {
+            const Acc a = static_cast<Acc>(A.vals[(std::size_t)p]);
+            const T* b = B.row(A.col_idx[(std::size_t)p]) + col0;
+            for (int j = 0; j < C.cols; ++j) c[j] += a * static_cast<Acc>(b[j]);
+        }
+        madds += (A.row_ptr[row0 + i + 1] - A.row_ptr[row0 + i]) * (long long)C.cols;
+    }
+    return madds;
+}
+
+template <class T, class Acc>
+inline long long gemm_dense_csc(ConstMatrixViewT<T> A, const CscMatrixT<T>& B, int row0, int col0,
+                                MatrixViewT<Acc> C) {
+    for (int i = 0; i < C.rows; ++i) {
+        const T* a = A.row(row0 + i);
+        Acc* c = C.row(i);
+        for (int j = 0; j < C.cols; ++j) {
+            Acc sum = 0;
+            const std::int64_t p1 = B.col_ptr[col0 + j + 1];
+            for (std::int64_t p = B.col_ptr[col0 + j]; p < p1; ++p)
+                sum += static_cast<Acc>(a[B.row_idx[(std::size_t)p]]) * static_cast<Acc>(B.vals[(std::size_t)p]);
+            c[j] = sum;
+        }
+    }
+    return (long long)C.rows * (B.col_ptr[col0 + C.cols] - B.col_ptr[col0]);
+}
+
+// Acumulador disperso de una fila (uno por hilo): valores densos de las
+// columnas de la tesela, marca de "ya tocada en esta fila" por generacion
+// (no hay que limpiarlo entre filas) y lista de columnas tocadas.
+template <class Acc>
+struct SparseAccumulator {
+    std::vector<Acc> val;
+    std::vector<std::uint32_t> mark;
+    std::vector<int> touched;
+    std::uint32_t gen = 0;
+
+    void begin_row(int cols) {
+        if ((int)val.size() < cols) {
+            val.resize(cols);
+            mark.assign(cols, 0);
+            touched.reserve(cols);
+        }
+        if (++gen == 0) {               // vuelta del contador: limpiar marcas
+            std::fill(mark.begin(), mark.end(), 0);
+            gen = 1;
+        }
+        touched.clear();
+    }
+    void add(int j, Acc v) {
+        if (mark[j] != gen) {
+            mark[j] = gen;
+            val[j] = v;
+            touched.push_back(j);
+        } else {
+            val[j] += v;
+        }
+    }
+};
+
+// Gustavson: fila i de C = suma de a(i,k) * fila k de B. Con una tesela que
+// no cubre todas las columnas, cada fila de B se recorta a [col0, col0 +
+// C.cols) con busqueda binaria (las columnas estan ordenadas). nnz_c suma los
+// no ceros estructurales de las filas calculadas.
+template <class T, class Acc>
+inline long long spgemm_csr(const CsrMatrixT<T>& A, const CsrMatrixT<T>& B, int row0, int col0,
+                            MatrixViewT<Acc> C, SparseAccumulator<Acc>& spa, long long& nnz_c) {
+    const bool full_width = (col0 == 0 && C.cols == B.cols);
+    const int col1 = col0 + C.cols;
+    long long madds = 0;
+    for (int i = 0; i < C.rows; ++i) {
+        spa.begin_row(C.cols);
+        const std::int64_t p1 = A.row_ptr[row0 + i + 1];
+        for (std::int64_t p = A.row_ptr[row0 + i]; p < p1; ++p) {
+            const int k = A.col_idx[(std::size_t)p];
+            const Acc a = static_cast<Acc>(A.vals[(std::size_t)p]);
+            const int* idx = B.col_idx.data();
+            std::int64_t q = B.row_ptr[k], q1 = B.row_ptr[k + 1];
+            if (!full_width) {
+                q = std::lower_bound(idx + q, idx + q1, col0) - idx;
+                q1 = std::lower_bound(idx + q, idx + q1, col1) - idx;
+            }
+            madds += q1 - q;
+            for (; q < q1; ++q)
+                spa.add(idx[q] - col0, a * static_cast<Acc>(B.vals[(std::size_t)q]));
+        }
+        Acc* c = C.row(i);
+        std::fill(c, c + C.cols, Acc(0));
+        for (int j : spa.touched) c[j] = spa.val[j];
+        nnz_c += (long long)spa.touched.size();
+    }
+    return madds;
+}
+
+// ===================== Eleccion del camino =====================
+
+enum class ProductPath { Auto, Dense, SparseDense, DenseSparse, SparseSparse };
+
+inline const char* product_path_name(ProductPath p) {
+    switch (p) {
+        case ProductPath::Auto:         return "auto";
+        case ProductPath::Dense:        return "dense";
+        case ProductPath::SparseDense:  return "sparse-dense";
+        case ProductPath::DenseSparse:  return "dense-sparse";
+        case ProductPath::SparseSparse: return "sparse-sparse";
+    }
+    return "?";
+}
+
+inline const char* product_path_label(ProductPath p) {
+    switch (p) {
+        case ProductPath::Dense:        return "denso";
+        case ProductPath::SparseDense:  return "A dispersa (CSR) x B densa";
+        case ProductPath::DenseSparse:  return "A densa x B dispersa (CSC)";
+        case ProductPath::SparseSparse: return "A y B dispersas (CSR, Gustavson)";
+        default:                        return "auto";
+    }
+}
+
+inline bool parse_product_path(const std::string& s, ProductPath& out) {
+    for (ProductPath p : { ProductPath::Auto, ProductPath::Dense, ProductPath::SparseDense,
+                           ProductPath::DenseSparse, ProductPath::SparseSparse })
+        if (s == product_path_name(p)) { out = p; return true; }
+    return false;
+}
+
+// Coste de una multiplicacion-suma de cada camino disperso relativo al kernel
+// denso por bloques (medido en x86 con AVX-512 e int32 -> int64): el denso
+// vectoriza y reutiliza B en cache; los dispersos leen por indice.
+static constexpr double SPARSE_DENSE_COST = 4.0;
+static constexpr double DENSE_SPARSE_COST = 6.0;
+static constexpr double SPARSE_SPARSE_COST = 16.0;
+
+struct ProductRoute {
+    ProductPath path = ProductPath::Dense;
+    std::int64_t nnz_a = 0;
+    std::int64_t nnz_b = 0;
+    double density_a = 1.0;
+    double density_b = 1.0;
+    double madds = 0.0;                 // estimadas para el camino elegido
+};
+
+// Multiplicaciones-suma estimadas de cada camino suponiendo los no ceros
+// repartidos uniformemente (A y B dispersas: nnz_a * nnz_b / k).
+inline double product_path_madds(ProductPath p, int m, int k, int n, std::int64_t nnz_a, std::int64_t nnz_b) {
+    switch (p) {
+        case ProductPath::SparseDense:  return (double)nnz_a * n;
+        case ProductPath::DenseSparse:  return (double)m * nnz_b;
+        case ProductPath::SparseSparse: return (double)nnz_a * (double)nnz_b / std::max(k, 1);
+        default:                        return (double)m * k * n;
+    }
+}
+
+// `forced` distinto de Auto se respeta; si no, el camino de menor coste
+// ponderado. El denso pesa siempre como el kernel por bloques, tambien con
+// naive: el umbral de dispersion no depende del kernel elegido.
+inline ProductRoute choose_product_path(int m, int k, int n, std::int64_t nnz_a, std::int64_t nnz_b,
+                                        ProductPath forced) {
+    ProductRoute r;
+    r.nnz_a = nnz_a;
+    r.nnz_b = nnz_b;
+    r.density_a = (double)nnz_a / ((double)m * k);
+    r.density_b = (double)nnz_b / ((double)k * n);
+    r.path = forced;
+    if (forced == ProductPath::Auto) {
+        const struct { ProductPath p; double cost; } options[] = {
+            { ProductPath::Dense,        1.0 },
+            { ProductPath::SparseDense,  SPARSE_DENSE_COST },
+            { ProductPath::DenseSparse,  DENSE_SPARSE_COST },
+            { ProductPath::SparseSparse, SPARSE_SPARSE_COST },
+        };
+        double best = -1.0;
+        for (const auto& o : options) {
+            const double c = o.cost * product_path_madds(o.p, m, k, n, nnz_a, nnz_b);
+            if (best < 0 || c < best) { best = c; r.path = o.p; }
+        }
+    }
+    r.madds = product_path_madds(r.path, m, k, n, nnz_a, nnz_b);
+    return r;
+}
+
+// Operandos ya convertidos para el camino elegido (solo los que usa).
+template <class T>
+struct SparseOperands {
+    ProductPath path = ProductPath::Dense;
+    CsrMatrixT<T> a_csr;                // SparseDense, SparseSparse
+    CsrMatrixT<T> b_csr;                // SparseSparse
+    CscMatrixT<T> b_csc;                // DenseSparse
+
+    bool a_sparse() const { return path == ProductPath::SparseDense || path == ProductPath::SparseSparse; }
+    bool b_csr_needed() const { return path == ProductPath::SparseSparse; }
+    bool b_csc_needed() const { return path == ProductPath::DenseSparse; }
+};
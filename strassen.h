@@ -0,0 +1,611 @@
+// Multiplicacion Strassen-Winograd recursiva: 7 productos y 15 sumas de
+// cuadrantes por nivel en lugar de 8 productos.
+//
+// Cada nivel parte A, B y C en cuadrantes. La recursion baja mientras los
+// bloques sigan teniendo al menos `cutoff` de lado y entonces multiplica con
+// gemm_blocked. El cutoff se mide una vez por tipo de acumulador
+// y micro-kernel (strassen_calibration<Acc>) comparando un producto blocked de lado 2n con
+// los 7 productos y 15 sumas de lado n que lo sustituyen, con lados de como
+// mucho STRASSEN_CALIBRATION_MAX; --strassen-cutoff lo fija sin medir.
+//
+// Todos los niveles siguen el esquema de Boyer, Dumas, Pernet y Zhou, que
+// solo necesita dos temporales por nivel, reutilizados en sus 7 productos.
+// En los primeros par_levels niveles las sumas se reparten por franjas de
+// filas entre los hilos de un TaskRunner (en MMP, el pool); el ultimo de
+// ellos calcula a la vez sus 7 productos, cada uno partido en leaf_splits
+// franjas de filas, y cada tarea sigue la recursion en secuencial. Asi el
+// espacio de trabajo es de unos N^2 mas las copias de A y B, en lugar de
+// reservar operandos y productos para cada nodo de los niveles paralelos.
+// Todos los buffers se reservan en StrassenWorkspace::prepare() y se
+// reutilizan en cada llamada con el mismo plan.
+//
+// A y B se copian al tipo Acc (las sumas de bloques desbordarian antes en T)
+// con relleno de ceros hasta multiplos de 2^levels.
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "gemm.h"
+
+// ===================== Plan =====================
+
+struct StrassenPlan {
+    int m = 0, k = 0, n = 0;        // dimensiones pedidas
+    int mp = 0, kp = 0, np = 0;     // con relleno (multiplos de 2^levels)
+    int cutoff = 0;                 // lado minimo de una hoja (se hace con blocked)
+    int levels = 0;                 // niveles de recursion (0 = blocked directo)
+    int par_levels = 0;             // niveles con las sumas repartidas entre hilos
+    int leaf_splits = 1;            // franjas de filas de cada producto del ultimo
+    bool measured = false;          // cutoff calibrado en esta ejecucion
+    double calibration_s = 0.0;
+
+    int crossover() const { return 2 * cutoff; }   // primer lado que recurre
+    // Tareas de producto que se ejecutan a la vez (una sola sin niveles paralelos)
+    int leaf_tasks() const { return par_levels > 0 ? 7 * leaf_splits : 1; }
+};
+
+// threads: hilos que ejecutaran las tareas (1 = todo secuencial).
+inline StrassenPlan plan_strassen(int m, int k, int n, int cutoff, int threads) {
+    StrassenPlan p;
+    p.m = m; p.k = k; p.n = n;
+    p.cutoff = std::max(cutoff, 16);
+    const int shortest = std::min(m, std::min(k, n));
+    while (p.levels < 10 && (shortest >> (p.levels + 1)) >= p.cutoff) ++p.levels;
+
+    // Con varios hilos, sumas repartidas en uno o dos niveles (con dos, el
+    // primero ya tiene sus temporales a un cuarto de tamano) y los 7
+    // productos del ultimo partidos en franjas, potencia de 2, hasta tener al
+    // menos una tarea por hilo; cada franja conserva `cutoff` filas.
+    if (threads > 1 && p.levels > 0) {
+        p.par_levels = std::min(p.levels, 2);
+        while (7 * p.leaf_splits < threads && (m >> p.par_levels) / (2 * p.leaf_splits) >= p.cutoff)
+            p.leaf_splits *= 2;
+    }
+
+    // Las franjas de los productos hoja tambien se parten 2^(levels -
+    // par_levels) veces: M es multiplo de 2^levels * leaf_splits.
+    const int q = 1 << p.levels;
+    auto round_up = [](int v, int r) { return (v + r - 1) / r * r; };
+    p.mp = round_up(m, q * p.leaf_splits); p.kp = round_up(k, q); p.np = round_up(n, q);
+    return p;
+}
+
+inline std::string strassen_plan_summary(const StrassenPlan& p) {
+    std::string s = "cutoff " + std::to_string(p.cutoff) + " (Strassen desde lado " +
+                    std::to_string(p.crossover()) + (p.measured ? ", medido" : ", fijado") + "), " +
+                    std::to_string(p.levels) + " niveles";
+    if (p.levels > 0) {
+        s += ", " + std::to_string(p.par_levels) + " en paralelo (" + std::to_string(p.leaf_tasks()) + " productos a la vez)";
+        if (p.mp != p.m || p.kp != p.k || p.np != p.n)
+            s += ", relleno a " + std::to_string(p.mp) + "x" + std::to_string(p.kp) + "x" + std::to_string(p.np);
+    } else {
+        s += " (por debajo del cruce: blocked por teselas en todos los hilos)";
+    }
+    return s;
+}
+
+// ===================== Sumas de bloques =====================
+
+// Operaciones elemento a elemento sobre vistas del mismo tamano. Z puede ser
+// la misma vista que X o Y.
+template <class VX, class VY, class VZ>
+inline void block_add(const VX& X, const VY& Y, const VZ& Z) {
+    for (int i = 0; i < Z.rows; ++i) {
+        const auto* x = X.row(i);
+        const auto* y = Y.row(i);
+        auto* z = Z.row(i);
+        for (int j = 0; j < Z.cols; ++j) z[j] = x[j] + y[j];
+    }
+}
+
+template <class VX, class VY, class VZ>
+inline void block_sub(const VX& X, const VY& Y, const VZ& Z) {
+    for (int i = 0; i < Z.rows; ++i) {
+        const auto* x = X.row(i);
+        const auto* y = Y.row(i);
+        auto* z = Z.row(i);
+        for (int j = 0; j < Z.cols; ++j) z[j] = x[j] - y[j];
+    }
+}
+
+// Cuadrante (qi, qj) de una vista de dimensiones pares.
+template <class V>
+inline V quadrant(const V& v, int qi, int qj) {
+    const int h = v.rows / 2, w = v.cols / 2;
+    return v.view(qi * h, qj * w, h, w);
+}
+
+// ===================== Calibracion del cutoff =====================
+
+struct StrassenCalibration {
+    int cutoff = 0;
+    double seconds = 0.0;
+};
+
+// Lado maximo medido: un producto de 2 GOP en un hilo al arrancar, en lugar
+// de los 17 de lado 2048. Si Strassen no gana antes, el cutoff se queda en
+// este lado (Strassen desde el doble).
+static constexpr int STRASSEN_CALIBRATION_MAX = 1024;
+
+// Un nivel con hojas de lado n cambia un producto de lado 2n por 7 de lado n
+// mas 15 sumas de lado n. Se miden los tres sobre lados potencia de 2 y el
+// cutoff es el primer n en que el nivel sale mas barato (la eficiencia de
+// blocked crece con el tamano, asi que no basta con suponer 8 productos).
+template <class Acc>
+inline StrassenCalibration measure_strassen_cutoff(const MicroKernelT<Acc>& uk) {
+    using clock = std::chrono::steady_clock;
+    auto secs = [](clock::time_point a, clock::time_point b) {
+        return std::chrono::duration<double>(b - a).count();
+    };
+    const auto start = clock::now();
+    StrassenCalibration cal;
+    cal.cutoff = STRASSEN_CALIBRATION_MAX;
+    double prev_mul = 0.0, prev_add = 0.0;
+    for (int n = 64; n <= STRASSEN_CALIBRATION_MAX; n *= 2) {
+        MatrixT<Acc> a(n, n), b(n, n), c(n, n);
+        for (int i = 0; i < n; ++i)
+            for (int j = 0; j < n; ++j) {
+                a(i, j) = static_cast<Acc>((i + j) % 7);
+                b(i, j) = static_cast<Acc>((i * 3 + j) % 5);
+            }
+        double t_mul = 1e30, t_add = 1e30;
+        const int reps = n <= 256 ? 3 : 1;
+        for (int r = 0; r < reps; ++r) {
+            auto t0 = clock::now();
+            gemm_blocked(a.cview(), b.cview(), c.view(), uk);
+            t_mul = std::min(t_mul, secs(t0, clock::now()));
+        }
+        for (int r = 0; r < 3; ++r) {
+            auto t0 = clock::now();
+            block_add(a.cview(), b.cview(), c.view());
+            t_add = std::min(t_add, secs(t0, clock::now()));
+        }
+        if (prev_mul > 0.0 && 7.0 * prev_mul + 15.0 * prev_add < t_mul) {
+            cal.cutoff = n / 2;
+            break;
+        }
+        prev_mul = t_mul;
+        prev_add = t_add;
+    }
+    cal.seconds = secs(start, clock::now());
+    return cal;
+}
+
+// Se mide una sola vez por proceso, tipo de acumulador y micro-kernel (dos
+// Multiplier con distinto --simd no comparten cutoff).
+template <class Acc>
+inline const StrassenCalibration& strassen_calibration(const MicroKernelT<Acc>& uk) {
+    static std::mutex mx;
+    static std::map<SimdIsa, StrassenCalibration> cache;
+    std::lock_guard<std::mutex> lock(mx);
+    auto it = cache.find(uk.isa);
+    if (it == cache.end()) it = cache.emplace(uk.isa, measure_strassen_cutoff<Acc>(uk)).first;
+    return it->second;
+}
+
+// cutoff <= 0: el calibrado con uk. threads: hilos que ejecutaran las tareas.
+template <class Acc>
+inline StrassenPlan make_strassen_plan(int m, int k, int n, int cutoff, int threads,
+                                       const MicroKernelT<Acc>& uk = active_microkernel<Acc>()) {
+    if (cutoff > 0) return plan_strassen(m, k, n, cutoff, threads);
+    const StrassenCalibration& cal = strassen_calibration<Acc>(uk);
+    StrassenPlan p = plan_strassen(m, k, n, cal.cutoff, threads);
+    p.measured = true;
+    p.calibration_s = cal.seconds;
+    return p;
+}
+
+// ===================== Recursion secuencial =====================
+
+// Dos temporales por nivel de recursion secuencial.
+template <class Acc>
+struct StrassenScratch {
+    std::vector<MatrixT<Acc>> x;    // (m/2) x max(k/2, n/2): S y luego P1
+    std::vector<MatrixT<Acc>> y;    // (k/2) x (n/2): T
+};
+
+// C = A x B con `levels` niveles de Winograd (dimensiones divisibles por
+// 2^levels). Orden de operaciones de Boyer et al.: los productos se escriben
+// directamente en los cuadrantes de C y solo X e Y son temporales.
+template <class Acc>
+inline void winograd_seq(ConstMatrixViewT<Acc> A, ConstMatrixViewT<Acc> B, MatrixViewT<Acc> C,
+                         int levels, StrassenScratch<Acc>& s, const MicroKernelT<Acc>& uk, int lvl = 0) {
+    if (levels == 0) {
+        gemm_blocked(A, B, C, uk);
+        return;
+    }
+    const int m2 = A.rows / 2, k2 = A.cols / 2, n2 = B.cols / 2;
+    const auto A11 = quadrant(A, 0, 0), A12 = quadrant(A, 0, 1), A21 = quadrant(A, 1, 0), A22 = quadrant(A, 1, 1);
+    const auto B11 = quadrant(B, 0, 0), B12 = quadrant(B, 0, 1), B21 = quadrant(B, 1, 0), B22 = quadrant(B, 1, 1);
+    const auto C11 = quadrant(C, 0, 0), C12 = quadrant(C, 0, 1), C21 = quadrant(C, 1, 0), C22 = quadrant(C, 1, 1);
+    const MatrixViewT<Acc> Xs = s.x[lvl].view(0, 0, m2, k2);
+    const MatrixViewT<Acc> Xp = s.x[lvl].view(0, 0, m2, n2);
+    const MatrixViewT<Acc> Y = s.y[lvl].view(0, 0, k2, n2);
+    auto rec = [&](ConstMatrixViewT<Acc> a, ConstMatrixViewT<Acc> b, MatrixViewT<Acc> c) {
+        winograd_seq(a, b, c, levels - 1, s, uk, lvl + 1);
+    };
+
+    block_sub(A11, A21, Xs);        // S3
+    block_sub(B22, B12, Y);         // T3
+    rec(Xs, Y, C21);                // P7
+    block_add(A21, A22, Xs);        // S1
+    block_sub(B12, B11, Y);         // T1
+    rec(Xs, Y, C22);                // P5
+    block_sub(Xs, A11, Xs);         // S2 = S1 - A11
+    block_sub(B22, Y, Y);           // T2 = B22 - T1
+    rec(Xs, Y, C12);                // P6
+    block_sub(A12, Xs, Xs);         // S4 = A12 - S2
+    rec(Xs, B22, C11);              // P3
+    rec(A11, B11, Xp);              // P1
+    block_add(Xp, C12, C12);        // U2 = P1 + P6
+    block_add(C12, C21, C21);       // U3 = U2 + P7
+    block_add(C12, C22, C12);       // U4 = U2 + P5
+    block_add(C21, C22, C22);       // C22 = U3 + P5
+    block_add(C12, C11, C12);       // C12 = U4 + P3
+    block_sub(Y, B21, Y);           // T4 = T2 - B21
+    rec(A22, Y, C11);               // P4
+    block_sub(C21, C11, C21);       // C21 = U3 - P4
+    rec(A12, B21, C11);             // P2
+    block_add(Xp, C11, C11);        // C11 = P1 + P2
+}
+
+// ===================== Niveles en paralelo =====================
+
+// Ejecuta task(i) para i = 0..n-1 (en cualquier orden, quiza en paralelo) y
+// vuelve cuando han terminado todas.
+using TaskRunner = std::function<void(int, const std::function<void(int)>&)>;
+
+inline void run_tasks_inline(int n, const std::function<void(int)>& task) {
+    for (int i = 0; i < n; ++i) task(i);
+}
+
+// El ultimo nivel paralelo: sus 7 productos se calculan a la vez, asi que
+// necesita los 8 operandos S1..S4 y T1..T4. P2..P5 se escriben en los
+// cuadrantes de c; P1, P6 y P7 necesitan buffer propio hasta la combinacion
+// final. Hay uno solo por plan: los productos del nivel anterior (Boyer) se
+// hacen uno tras otro y lo reutilizan.
+template <class Acc>
+struct WinogradNode {
+    ConstMatrixViewT<Acc> a, b;
+    MatrixViewT<Acc> c;
+    MatrixT<Acc> s[4];      // S1..S4   (m/2 x k/2)
+    MatrixT<Acc> t[4];      // T1..T4   (k/2 x n/2)
+    MatrixT<Acc> p1, p6, p7;
+
+    // Operandos y destino del producto i (0..6 = P1..P7).
+    ConstMatrixViewT<Acc> operand_a(int i) const {
+        switch (i) {
+            case 0: return quadrant(a, 0, 0);
+            case 1: return quadrant(a, 0, 1);
+            case 2: return s[3].cview();
+            case 3: return quadrant(a, 1, 1);
+            case 4: return s[0].cview();
+            case 5: return s[1].cview();
+            default: return s[2].cview();
+        }
+    }
+    ConstMatrixViewT<Acc> operand_b(int i) const {
+        switch (i) {
+            case 0: return quadrant(b, 0, 0);
+            case 1: return quadrant(b, 1, 0);
+            case 2: return quadrant(b, 1, 1);
+            case 3: return t[3].cview();
+            case 4: return t[0].cview();
+            case 5: return t[1].cview();
+            default: return t[2].cview();
+        }
+    }
+    MatrixViewT<Acc> product(int i) {
+        switch (i) {
+            case 0: return p1.view();
+            case 1: return quadrant(c, 0, 0);
+            case 2: return quadrant(c, 0, 1);
+            case 3: return quadrant(c, 1, 0);
+            case 4: return quadrant(c, 1, 1);
+            case 5: return p6.view();
+            default: return p7.view();
+        }
+    }
+};
+
+static constexpr int STRASSEN_BAND_ROWS = 64;   // filas por tarea de suma
+
+template <class Acc>
+class StrassenWorkspace {
+public:
+    const StrassenPlan& plan() const { return plan_; }
+
+    // Reserva todos los buffers del plan. Si el plan no cambia (mismas
+    // dimensiones y niveles) conserva los existentes. uk: micro-kernel de
+    // las hojas (el mismo con el que se calibro el cutoff).
+    void prepare(const StrassenPlan& p, const MicroKernelT<Acc>& uk = active_microkernel<Acc>()) {
+        uk_ = &uk;
+        if (ready_ && same_shape(p)) { plan_ = p; return; }
+        plan_ = p;
+        ready_ = true;
+        boyer_ = StrassenScratch<Acc>();
+        node_ = WinogradNode<Acc>();
+        scratch_.clear();
+        a_ = MatrixT<Acc>();
+        b_ = MatrixT<Acc>();
+        c_ = MatrixT<Acc>();
+        if (p.levels == 0) return;
+
+        a_ = MatrixT<Acc>(p.mp, p.kp);
+        b_ = MatrixT<Acc>(p.kp, p.np);
+        if (padded()) c_ = MatrixT<Acc>(p.mp, p.np);
+
+        // Niveles paralelos con el esquema de Boyer: dos temporales cada uno
+        for (int l = 0; l + 1 < p.par_levels; ++l) {
+            const int m2 = (p.mp >> l) / 2, k2 = (p.kp >> l) / 2, n2 = (p.np >> l) / 2;
+            boyer_.x.emplace_back(m2, std::max(k2, n2));
+            boyer_.y.emplace_back(k2, n2);
+        }
+        if (p.par_levels > 0) {
+            const int l = p.par_levels - 1;
+            const int m2 = (p.mp >> l) / 2, k2 = (p.kp >> l) / 2, n2 = (p.np >> l) / 2;
+            for (int j = 0; j < 4; ++j) {
+                node_.s[j] = MatrixT<Acc>(m2, k2);
+                node_.t[j] = MatrixT<Acc>(k2, n2);
+            }
+            node_.p1 = MatrixT<Acc>(m2, n2);
+            node_.p6 = MatrixT<Acc>(m2, n2);
+            node_.p7 = MatrixT<Acc>(m2, n2);
+        }
+
+        // Una recursion secuencial por tarea de producto (sobre su franja)
+        const int seq = p.levels - p.par_levels;
+        const int mb = (p.mp >> p.par_levels) / p.leaf_splits;
+        const int kb = p.kp >> p.par_levels, nb = p.np >> p.par_levels;
+        scratch_.resize(p.leaf_tasks());
+        for (auto& s : scratch_) {
+            for (int l = 0; l < seq; ++l) {
+                const int m2 = (mb >> l) / 2, k2 = (kb >> l) / 2, n2 = (nb >> l) / 2;
+                s.x.emplace_back(m2, std::max(k2, n2));
+                s.y.emplace_back(k2, n2);
+            }
+        }
+    }
+
+    // Tareas que lanzara una llamada (para informar de progreso).
+    int total_tasks() const {
+        const StrassenPlan& p = plan_;
+        if (p.levels == 0) return 1;
+        int total = bands(p.m) + bands(p.k) + (padded() ? bands(p.m) : 0);
+        if (p.par_levels == 0) return total + 1;
+        // Boyer: 11 sumas de m/2 filas y 4 de k/2 por llamada, 7^l llamadas
+        int calls = 1;
+        for (int l = 0; l + 1 < p.par_levels; ++l) {
+            total += calls * (11 * bands((p.mp >> l) / 2) + 4 * bands((p.kp >> l) / 2));
+            calls *= 7;
+        }
+        // Ultimo nivel: S, T y combinacion por franjas y las tareas de producto
+        const int l = p.par_levels - 1;
+        const int m2 = (p.mp >> l) / 2, k2 = (p.kp >> l) / 2;
+        return total + calls * (2 * bands(m2) + bands(k2) + p.leaf_tasks());
+    }
+
+    template <class T>
+    void multiply(ConstMatrixViewT<T> A, ConstMatrixViewT<T> B, MatrixViewT<Acc> C, const TaskRunner& run) {
+        const StrassenPlan& p = plan_;
+        if (p.levels == 0) {
+            run(1, [&](int) { gemm_blocked(A, B, C, *uk_); });
+            return;
+        }
+
+        // --- Copia a Acc con relleno (el relleno ya es 0 desde prepare) ---
+        const int ba = bands(p.m), bb = bands(p.k);
+        run(ba + bb, [&](int i) {
+            if (i < ba) copy_band(A, a_.view(), i);
+            else        copy_band(B, b_.view(), i - ba);
+        });
+
+        MatrixViewT<Acc> dst = padded() ? c_.view() : C;
+        if (p.par_levels == 0)
+            run(1, [&](int) { winograd_seq(a_.cview(), b_.cview(), dst, p.levels, scratch_[0], *uk_); });
+        else
+            winograd_par(a_.cview(), b_.cview(), dst, 0, run);
+
+        // --- Copia de salida sin el relleno ---
+        if (padded()) {
+            run(bands(p.m), [&](int i) {
+                const int r0 = i * STRASSEN_BAND_ROWS, r1 = std::min(p.m, r0 + STRASSEN_BAND_ROWS);
+                for (int r = r0; r < r1; ++r)
+                    std::copy(c_.row(r), c_.row(r) + p.n, C.row(r));
+            });
+        }
+    }
+
+private:
+    static int bands(int rows) { return std::max(1, (rows + STRASSEN_BAND_ROWS - 1) / STRASSEN_BAND_ROWS); }
+    static void band_range(int rows, int band, int& r0, int& r1) {
+        r0 = std::min(rows, band * STRASSEN_BAND_ROWS);
+        r1 = std::min(rows, r0 + STRASSEN_BAND_ROWS);
+    }
+
+    bool padded() const { return plan_.mp != plan_.m || plan_.np != plan_.n || plan_.kp != plan_.k; }
+    bool same_shape(const StrassenPlan& p) const {
+        return p.mp == plan_.mp && p.kp == plan_.kp && p.np == plan_.np && p.m == plan_.m &&
+               p.k == plan_.k && p.n == plan_.n && p.levels == plan_.levels &&
+               p.par_levels == plan_.par_levels && p.leaf_splits == plan_.leaf_splits;
+    }
+
+    template <class T>
+    static void copy_band(ConstMatrixViewT<T> src, MatrixViewT<Acc> dst, int band) {
+        int r0, r1;
+        band_range(src.rows, band, r0, r1);
+        for (int r = r0; r < r1; ++r) {
+            const T* s = src.row(r);
+            Acc* d = dst.row(r);
+            for (int j = 0; j < src.cols; ++j) d[j] = static_cast<Acc>(s[j]);
+        }
+    }
+
+    // Z = X + Y o X - Y repartido por franjas de filas
+    template <class VX, class VY>
+    static void par_add(const TaskRunner& run, const VX& X, const VY& Y, MatrixViewT<Acc> Z, bool sub = false) {
+        run(bands(Z.rows), [&](int i) {
+            int r0, r1;
+            band_range(Z.rows, i, r0, r1);
+            const int nr = r1 - r0;
+            if (sub) block_sub(X.view(r0, 0, nr, Z.cols), Y.view(r0, 0, nr, Z.cols), Z.view(r0, 0, nr, Z.cols));
+            else     block_add(X.view(r0, 0, nr, Z.cols), Y.view(r0, 0, nr, Z.cols), Z.view(r0, 0, nr, Z.cols));
+        });
+    }
+    template <class VX, class VY>
+    static void par_sub(const TaskRunner& run, const VX& X, const VY& Y, MatrixViewT<Acc> Z) {
+        par_add(run, X, Y, Z, true);
+    }
+
+    // Nivel paralelo `lvl`: el mismo orden de operaciones que winograd_seq,
+    // con las sumas repartidas entre hilos y los temporales del nivel; el
+    // ultimo nivel paralelo calcula sus 7 productos a la vez (winograd_node).
+    void winograd_par(ConstMatrixViewT<Acc> A, ConstMatrixViewT<Acc> B, MatrixViewT<Acc> C, int lvl,
+                      const TaskRunner& run) {
+        if (lvl == plan_.par_levels - 1) {
+            winograd_node(A, B, C, run);
+            return;
+        }
+        const int m2 = A.rows / 2, k2 = A.cols / 2, n2 = B.cols / 2;
+        const auto A11 = quadrant(A, 0, 0), A12 = quadrant(A, 0, 1), A21 = quadrant(A, 1, 0), A22 = quadrant(A, 1, 1);
+        const auto B11 = quadrant(B, 0, 0), B12 = quadrant(B, 0, 1), B21 = quadrant(B, 1, 0), B22 = quadrant(B, 1, 1);
+        const auto C11 = quadrant(C, 0, 0), C12 = quadrant(C, 0, 1), C21 = quadrant(C, 1, 0), C22 = quadrant(C, 1, 1);
+        const MatrixViewT<Acc> Xs = boyer_.x[lvl].view(0, 0, m2, k2);
+        const MatrixViewT<Acc> Xp = boyer_.x[lvl].view(0, 0, m2, n2);
+        const MatrixViewT<Acc> Y = boyer_.y[lvl].view(0, 0, k2, n2);
+        auto rec = [&](ConstMatrixViewT<Acc> a, ConstMatrixViewT<Acc> b, MatrixViewT<Acc> c) {
+            winograd_par(a, b, c, lvl + 1, run);
+        };
+
+        par_sub(run, A11, A21, Xs);         // S3
+        par_sub(run, B22, B12, Y);          // T3
+        rec(Xs, Y, C21);            // P7
+        par_add(run, A21, A22, Xs);         // S1
+        par_sub(run, B12, B11, Y);          // T1
+        rec(Xs, Y, C22);            // P5
+        par_sub(run, Xs, A11, Xs);          // S2 = S1 - A11
+        par_sub(run, B22, Y, Y);            // T2 = B22 - T1
+        rec(Xs, Y, C12);            // P6
+        par_sub(run, A12, Xs, Xs);          // S4 = A12 - S2
+        rec(Xs, B22, C11);              // P3
+        rec(A11, B11, Xp);                  // P1
+        par_add(run, Xp, C12, C12);         // U2 = P1 + P6
+        par_add(run, C12, C21, C21);        // U3 = U2 + P7
+        par_add(run, C12, C22, C12);        // U4 = U2 + P5
+        par_add(run, C21, C22, C22);        // C22 = U3 + P5
+        par_add(run, C12, C11, C12);        // C12 = U4 + P3
+        par_sub(run, Y, B21, Y);            // T4 = T2 - B21
+        rec(A22, Y, C11);               // P4
+        par_sub(run, C21, C11, C21);        // C21 = U3 - P4
+        rec(A12, B21, C11);                 // P2
+        par_add(run, Xp, C11, C11);         // C11 = P1 + P2
+    }
+
+    // Ultimo nivel paralelo: S y T por franjas, los 7 productos partidos en
+    // leaf_splits franjas de filas (cada tarea con su recursion secuencial) y
+    // la combinacion por franjas.
+    void winograd_node(ConstMatrixViewT<Acc> A, ConstMatrixViewT<Acc> B, MatrixViewT<Acc> C, const TaskRunner& run) {
+        WinogradNode<Acc>& nd = node_;
+        nd.a = A;
+        nd.b = B;
+        nd.c = C;
+        const int bs = bands(nd.s[0].rows()), bt = bands(nd.t[0].rows());
+        run(bs + bt, [&](int i) {
+            if (i < bs) s_band(nd, i);
+            else        t_band(nd, i - bs);
+        });
+
+        const int splits = plan_.leaf_splits;
+        const int rows = nd.s[0].rows() / splits;
+        const int seq = plan_.levels - plan_.par_levels;
+        run(7 * splits, [&](int i) {
+            const int j = i / splits, r0 = (i % splits) * rows;
+            const ConstMatrixViewT<Acc> a = nd.operand_a(j);
+            const MatrixViewT<Acc> c = nd.product(j);
+            winograd_seq(a.view(r0, 0, rows, a.cols), nd.operand_b(j), c.view(r0, 0, rows, c.cols), seq, scratch_[i], *uk_);
+        });
+
+        const int bc = bands(nd.p1.rows());
+        run(bc, [&](int i) { combine_band(nd, i); });
+    }
+
+    // S1 = A21 + A22, S2 = S1 - A11, S3 = A11 - A21, S4 = A12 - S2
+    static void s_band(WinogradNode<Acc>& nd, int band) {
+        int r0, r1;
+        band_range(nd.s[0].rows(), band, r0, r1);
+        const auto A11 = quadrant(nd.a, 0, 0), A12 = quadrant(nd.a, 0, 1);
+        const auto A21 = quadrant(nd.a, 1, 0), A22 = quadrant(nd.a, 1, 1);
+        for (int r = r0; r < r1; ++r) {
+            const Acc *a11 = A11.row(r), *a12 = A12.row(r), *a21 = A21.row(r), *a22 = A22.row(r);
+            Acc *s1 = nd.s[0].row(r), *s2 = nd.s[1].row(r), *s3 = nd.s[2].row(r), *s4 = nd.s[3].row(r);
+            for (int j = 0; j < A11.cols; ++j) {
+                s1[j] = a21[j] + a22[j];
+                s2[j] = s1[j] - a11[j];
+                s3[j] = a11[j] - a21[j];
+                s4[j] = a12[j] - s2[j];
+            }
+        }
+    }
+
+    // T1 = B12 - B11, T2 = B22 - T1, T3 = B22 - B12, T4 = T2 - B21
+    static void t_band(WinogradNode<Acc>& nd, int band) {
+        int r0, r1;
+        band_range(nd.t[0].rows(), band, r0, r1);
+        const auto B11 = quadrant(nd.b, 0, 0), B12 = quadrant(nd.b, 0, 1);
+        const auto B21 = quadrant(nd.b, 1, 0), B22 = quadrant(nd.b, 1, 1);
+        for (int r = r0; r < r1; ++r) {
+            const Acc *b11 = B11.row(r), *b12 = B12.row(r), *b21 = B21.row(r), *b22 = B22.row(r);
+            Acc *t1 = nd.t[0].row(r), *t2 = nd.t[1].row(r), *t3 = nd.t[2].row(r), *t4 = nd.t[3].row(r);
+            for (int j = 0; j < B11.cols; ++j) {
+                t1[j] = b12[j] - b11[j];
+                t2[j] = b22[j] - t1[j];
+                t3[j] = b22[j] - b12[j];
+                t4[j] = t2[j] - b21[j];
+            }
+        }
+    }
+
+    // Con P2..P5 ya en los cuadrantes de C y U2 = P1 + P6:
+    //   C11 = P1 + P2   C12 = U2 + P5 + P3   C21 = U2 + P7 - P4   C22 = U2 + P7 + P5
+    static void combine_band(WinogradNode<Acc>& nd, int band) {
+        int r0, r1;
+        band_range(nd.p1.rows(), band, r0, r1);
+        const auto C11 = quadrant(nd.c, 0, 0), C12 = quadrant(nd.c, 0, 1);
+        const auto C21 = quadrant(nd.c, 1, 0), C22 = quadrant(nd.c, 1, 1);
+        for (int r = r0; r < r1; ++r) {
+            const Acc *p1 = nd.p1.row(r), *p6 = nd.p6.row(r), *p7 = nd.p7.row(r);
+            Acc *c11 = C11.row(r), *c12 = C12.row(r), *c21 = C21.row(r), *c22 = C22.row(r);
+            for (int j = 0; j < C11.cols; ++j) {
+                const Acc u2 = p1[j] + p6[j];
+                const Acc p5 = c22[j];
+                c11[j] = p1[j] + c11[j];
+                c12[j] = u2 + p5 + c12[j];
+                c22[j] = u2 + p7[j] + p5;
+                c21[j] = u2 + p7[j] - c21[j];
+            }
+        }
+    }
+
+    StrassenPlan plan_;
+    bool ready_ = false;
+    const MicroKernelT<Acc>* uk_ = nullptr;
+    MatrixT<Acc> a_, b_, c_;            // copias con relleno (c_ solo si hay relleno)
+    StrassenScratch<Acc> boyer_;        // temporales de los niveles paralelos salvo el ultimo
+    WinogradNode<Acc> node_;            // ultimo nivel paralelo, reutilizado en cada llamada
+    std::vector<StrassenScratch<Acc>> scratch_; // una por tarea de producto
+};
+
+// C = A x B segun el plan preparado en ws. Sin runner, todo en el hilo que llama.
+template <class T, class Acc>
+inline void gemm_strassen(ConstMatrixViewT<T> A, ConstMatrixViewT<T> B, MatrixViewT<Acc> C,
+                          StrassenWorkspace<Acc>& ws, const TaskRunner& run = run_tasks_inline) {
+    ws.multiply(A, B, C, run);
+}
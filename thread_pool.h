@@ -0,0 +1,199 @@
+// Pool persistente de hilos fijados a cores, reutilizable entre multiplicaciones.
+//
+// Los hilos se crean una sola vez y ejecutan trabajos fork-join: run(job)
+// lanza job(id) en todos los hilos del pool y vuelve cuando todos terminan.
+// Entre trabajos los hilos quedan "aparcados" segun la politica elegida:
+//
+//   spin    esperan activamente (latencia minima, consume el core)
+//   block   duermen en una condition_variable (no consumen CPU)
+//   hybrid  giran un tiempo acotado y luego duermen (por defecto)
+//
+// Cada trabajo mide su sobrecoste de despacho: cuanto tardo el ultimo hilo
+// en empezar desde que se llamo a run() (despertar) y cuanto tardo run() en
+// volver desde que termino el ultimo hilo (join).
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "platform.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#include <immintrin.h>
+#define MM_CPU_RELAX() _mm_pause()
+#else
+#define MM_CPU_RELAX() std::this_thread::yield()
+#endif
+
+enum class ParkPolicy { Spin, Block, Hybrid };
+
+inline const char* park_policy_name(ParkPolicy p) {
+    switch (p) {
+        case ParkPolicy::Spin:   return "spin";
+        case ParkPolicy::Block:  return "block";
+        case ParkPolicy::Hybrid: return "hybrid";
+    }
+    return "?";
+}
+
+inline bool parse_park_policy(const std::string& s, ParkPolicy& out) {
+    if (s == "spin")   { out = ParkPolicy::Spin;   return true; }
+    if (s == "block")  { out = ParkPolicy::Block;  return true; }
+    if (s == "hybrid") { out = ParkPolicy::Hybrid; return true; }
+    return false;
+}
+
+struct PoolStats {
+    std::uint64_t jobs = 0;
+    double last_wake_s = 0.0;    // run() -> arranque del ultimo hilo
+    double last_join_s = 0.0;    // fin del ultimo hilo -> vuelta de run()
+    double total_wake_s = 0.0;
+    double total_join_s = 0.0;
+
+    double avg_overhead_s() const {
+        return jobs ? (total_wake_s + total_join_s) / jobs : 0.0;
+    }
+};
+
+class ThreadPool {
+public:
+    // cores[i] es el core al que se fija el hilo i (vacio = sin fijar).
+    explicit ThreadPool(int threads, ParkPolicy park = ParkPolicy::Hybrid,
+                        std::vector<int> cores = {}, int spin_iters = 20000)
+        : park_(park), spin_iters_(spin_iters), cores_(std::move(cores)),
+          slots_(new Slot[std::max(1, threads)]) {
+        for (int i = 0; i < threads; ++i)
+            threads_.emplace_back(&ThreadPool::worker_loop, this, i);
+        // Esperar a que todos hayan arrancado (y fijado su afinidad) para que
+        // el primer trabajo no pague la creacion de hilos.
+        std::unique_lock<std::mutex> lk(mtx_);
+        done_cv_.wait(lk, [&] { return ready_ == (int)threads_.size(); });
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            stop_.store(true, std::memory_order_relaxed);
+            generation_.fetch_add(1, std::memory_order_release);
+        }
+        wake_cv_.notify_all();
+        for (auto& t : threads_)
+            t.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int size() const { return (int)threads_.size(); }
+    ParkPolicy park_policy() const { return park_; }
+    const PoolStats& stats() const { return stats_; }
+    int core_of(int w) const { return w < (int)cores_.size() ? cores_[w] : -1; }
+
+    // Ejecuta job(id) en cada hilo del pool (id = 0..size()-1) y espera a
+    // que terminen todos. No es reentrante: un solo run() a la vez.
+    void run(const std::function<void(int)>& job) {
+        const int n = size();
+        if (n == 0) return;
+
+        job_ = &job;
+        pending_.store(n, std::memory_order_relaxed);
+        const std::int64_t submit = now_ns();
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            generation_.fetch_add(1, std::memory_order_release);
+        }
+        wake_cv_.notify_all();
+
+        wait_until(done_cv_, [&] { return pending_.load(std::memory_order_acquire) == 0; });
+        const std::int64_t back = now_ns();
+
+        std::int64_t last_start = submit, last_end = submit;
+        for (int i = 0; i < n; ++i) {
+            last_start = std::max(last_start, slots_[i].start_ns.load(std::memory_order_relaxed));
+            last_end = std::max(last_end, slots_[i].end_ns.load(std::memory_order_relaxed));
+        }
+        stats_.jobs++;
+        stats_.last_wake_s = (last_start - submit) * 1e-9;
+        stats_.last_join_s = (back - last_end) * 1e-9;
+        stats_.total_wake_s += stats_.last_wake_s;
+        stats_.total_join_s += stats_.last_join_s;
+        job_ = nullptr;
+    }
+
+private:
+    // Marcas de tiempo de cada hilo, cada una en su propia linea de cache.
+    struct alignas(64) Slot {
+        std::atomic<std::int64_t> start_ns{0};
+        std::atomic<std::int64_t> end_ns{0};
+    };
+
+    static std::int64_t now_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    template <class Pred>
+    void wait_until(std::condition_variable& cv, Pred ready) {
+        if (park_ != ParkPolicy::Block) {
+            for (int i = 0; park_ == ParkPolicy::Spin || i < spin_iters_; ++i) {
+                if (ready()) return;
+                MM_CPU_RELAX();
+            }
+        }
+        std::unique_lock<std::mutex> lk(mtx_);
+        cv.wait(lk, ready);
+    }
+
+    void worker_loop(int id) {
+        pin_current_thread(core_of(id));
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            ++ready_;
+        }
+        done_cv_.notify_all();
+
+        std::uint64_t seen = 0;
+        for (;;) {
+            wait_until(wake_cv_, [&] { return generation_.load(std::memory_order_acquire) != seen; });
+            seen = generation_.load(std::memory_order_acquire);
+            if (stop_.load(std::memory_order_relaxed)) return;
+
+            slots_[id].start_ns.store(now_ns(), std::memory_order_relaxed);
+            (*job_)(id);
+            slots_[id].end_ns.store(now_ns(), std::memory_order_relaxed);
+
+            if (pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                std::lock_guard<std::mutex> lk(mtx_);
+                done_cv_.notify_all();
+            }
+        }
+    }
+
+    ParkPolicy park_;
+    int spin_iters_;
+    std::vector<int> cores_;
+    std::unique_ptr<Slot[]> slots_;
+    std::vector<std::thread> threads_;
+
+    const std::function<void(int)>* job_ = nullptr;
+    std::atomic<std::uint64_t> generation_{0};
+    std::atomic<int> pending_{0};
+    std::atomic<bool> stop_{false};
+    int ready_ = 0;
+
+    std::mutex mtx_;
+    std::condition_variable wake_cv_;
+    std::condition_variable done_cv_;
+
+    PoolStats stats_;
+};
@@ -0,0 +1,312 @@
+// Topologia de CPUs (paquetes, cores fisicos, hermanos SMT y caches
+// compartidas) y politicas de afinidad para los hilos del pool.
+//
+// Linux lee /sys/devices/system/cpu/cpuN/topology y cpuN/cache/indexK, y se
+// queda con los CPUs permitidos al proceso (sched_getaffinity). Windows usa
+// GetLogicalProcessorInformationEx, con CPU = grupo * 64 + bit, de modo que
+// se pueden usar mas de 64 CPUs. En otros sistemas cada CPU logico cuenta
+// como un core fisico de un solo paquete.
+//
+// Politicas (--pin=):
+//   compact        llena cada core fisico (todos sus hermanos SMT) y luego
+//                  el siguiente del mismo paquete
+//   scatter        reparte entre paquetes y cores fisicos; los hermanos SMT
+//                  solo cuando ya hay un hilo en cada core (por defecto)
+//   physical-only  un hilo por core fisico, sin hermanos SMT: el CPU de
+//                  menor numero de cada core entre los permitidos
+//   cache-group    hilos consecutivos en el mismo grupo de cache compartida
+//                  (L3, o L2 si no hay): primero un hilo por core fisico del
+//                  grupo, luego sus hermanos, y despues el grupo siguiente
+// Con mas hilos que CPUs en el orden elegido, el reparto vuelve a empezar.
+
+#pragma once
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__linux__)
+#include <sched.h>
+#include <unistd.h>
+#endif
+
+// "0-3,8-11" -> {0, 1, 2, 3, 8, 9, 10, 11} (formato cpulist de /sys)
+inline std::vector<int> parse_cpu_list(const std::string& s) {
+    std::vector<int> cpus;
+    size_t pos = 0;
+    while (pos < s.size()) {
+        size_t comma = s.find(',', pos);
+        std::string part = s.substr(pos, comma == std::string::npos ? std::string::npos : comma - pos);
+        size_t dash = part.find('-');
+        if (!part.empty() && part.find_first_not_of("0123456789-\n") == std::string::npos) {
+            int a = std::atoi(part.c_str());
+            int b = dash == std::string::npos ? a : std::atoi(part.c_str() + dash + 1);
+            for (int c = a; c <= b; ++c) cpus.push_back(c);
+        }
+        if (comma == std::string::npos) break;
+        pos = comma + 1;
+    }
+    return cpus;
+}
+
+enum class PinPolicy { Compact, Scatter, PhysicalOnly, CacheGroup };
+
+inline const char* pin_policy_name(PinPolicy p) {
+    switch (p) {
+        case PinPolicy::Compact:      return "compact";
+        case PinPolicy::Scatter:      return "scatter";
+        case PinPolicy::PhysicalOnly: return "physical-only";
+        case PinPolicy::CacheGroup:   return "cache-group";
+    }
+    return "?";
+}
+
+inline bool parse_pin_policy(const std::string& s, PinPolicy& out) {
+    if (s == "compact")       { out = PinPolicy::Compact;      return true; }
+    if (s == "scatter")       { out = PinPolicy::Scatter;      return true; }
+    if (s == "physical-only") { out = PinPolicy::PhysicalOnly; return true; }
+    if (s == "cache-group")   { out = PinPolicy::CacheGroup;   return true; }
+    return false;
+}
+
+// ===================== Topologia =====================
+
+struct LogicalCpu {
+    int id = 0;             // numero de CPU del sistema
+    int package = 0;        // indice de paquete (socket), 0..packages-1
+    int core = 0;           // indice global de core fisico, 0..physical_cores-1
+    int smt = 0;            // posicion entre los hermanos SMT de su core
+    int cache_group = 0;    // indice del grupo de cache compartida de mayor nivel
+};
+
+struct CpuTopology {
+    std::vector<LogicalCpu> cpus;   // ordenados por id
+    int packages = 1;
+    int physical_cores = 0;
+    int cache_groups = 1;
+    int cache_level = 0;            // nivel de la cache que define los grupos (0 = ninguna)
+
+    const LogicalCpu* find(int id) const {
+        for (const auto& c : cpus)
+            if (c.id == id) return &c;
+        return nullptr;
+    }
+};
+
+// Numera de 0 en adelante, por orden de aparicion, las claves de `key`
+// (paquetes, cores o grupos de cache con identificadores arbitrarios).
+template <class Key>
+inline int dense_index(std::map<Key, int>& ids, const Key& key) {
+    auto it = ids.find(key);
+    if (it != ids.end()) return it->second;
+    int v = (int)ids.size();
+    ids.emplace(key, v);
+    return v;
+}
+
+#ifdef __linux__
+inline bool read_sys_line(const std::string& path, std::string& line) {
+    std::ifstream f(path);
+    return f && std::getline(f, line);
+}
+
+// CPUs permitidos al proceso, en orden. La mascara se dimensiona con los
+// CPUs configurados del sistema, no con el CPU_SETSIZE fijo de cpu_set_t.
+inline std::vector<int> allowed_cpus() {
+    std::vector<int> out;
+    const int max_cpus = std::max(1, (int)sysconf(_SC_NPROCESSORS_CONF));
+    cpu_set_t* set = CPU_ALLOC(max_cpus);
+    if (!set) return out;
+    const size_t sz = CPU_ALLOC_SIZE(max_cpus);
+    CPU_ZERO_S(sz, set);
+    if (sched_getaffinity(0, sz, set) == 0)
+        for (int c = 0; c < max_cpus; ++c)
+            if (CPU_ISSET_S(c, sz, set)) out.push_back(c);
+    CPU_FREE(set);
+    return out;
+}
+#endif
+
+inline CpuTopology read_cpu_topology() {
+    CpuTopology t;
+    std::map<int, int> package_ids;
+    std::map<std::pair<int, int>, int> core_ids;
+    std::map<std::pair<int, int>, int> group_ids;       // (nivel, primer CPU) -> grupo
+    std::vector<std::pair<int, int>> group_keys;        // por CPU, clave de su grupo
+#ifdef __linux__
+    const std::vector<int> allowed = allowed_cpus();
+    for (int id : allowed) {
+        const std::string base = "/sys/devices/system/cpu/cpu" + std::to_string(id);
+        std::string line;
+        LogicalCpu c;
+        c.id = id;
+        int pkg = read_sys_line(base + "/topology/physical_package_id", line) ? std::atoi(line.c_str()) : 0;
+        int core = read_sys_line(base + "/topology/core_id", line) ? std::atoi(line.c_str()) : id;
+        c.package = dense_index(package_ids, pkg);
+        c.core = dense_index(core_ids, std::make_pair(pkg, core));
+        // Posicion entre los hermanos permitidos (en linea y en la afinidad
+        // del proceso): smt 0 es el de menor numero aunque el primero de la
+        // lista no se pueda usar
+        if (read_sys_line(base + "/topology/thread_siblings_list", line)) {
+            std::vector<int> sib = parse_cpu_list(line);
+            sib.erase(std::remove_if(sib.begin(), sib.end(),
+                                     [&](int s) { return !std::binary_search(allowed.begin(), allowed.end(), s); }),
+                      sib.end());
+            c.smt = (int)(std::find(sib.begin(), sib.end(), id) - sib.begin());
+            if (c.smt >= (int)sib.size()) c.smt = 0;
+        }
+        // Cache de datos/unificada de mayor nivel y los CPUs que la comparten
+        std::pair<int, int> key(0, pkg);
+        for (int k = 0; k < 16; ++k) {
+            const std::string idx = base + "/cache/index" + std::to_string(k);
+            std::string level, type, shared;
+            if (!read_sys_line(idx + "/level", level)) break;
+            if (read_sys_line(idx + "/type", type) && type == "Instruction") continue;
+            if (!read_sys_line(idx + "/shared_cpu_list", shared)) continue;
+            std::vector<int> cpus = parse_cpu_list(shared);
+            int lv = std::atoi(level.c_str());
+            if (lv >= key.first && !cpus.empty()) key = { lv, cpus.front() };
+        }
+        group_keys.push_back(key);
+        t.cpus.push_back(c);
+    }
+#elif defined(_WIN32)
+    DWORD len = 0;
+    GetLogicalProcessorInformationEx(RelationAll, nullptr, &len);
+    std::vector<char> buf(len);
+    auto* base = reinterpret_cast<SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*>(buf.data());
+    std::map<int, LogicalCpu> by_id;
+    std::map<int, std::pair<int, int>> cache_of;
+    if (len && GetLogicalProcessorInformationEx(RelationAll, base, &len)) {
+        int pkg = 0, core = 0;
+        for (DWORD off = 0; off < len;) {
+            auto* e = reinterpret_cast<SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*>(buf.data() + off);
+            auto for_each_cpu = [](const GROUP_AFFINITY& g, auto&& f) {
+                for (int b = 0; b < 64; ++b)
+                    if (g.Mask & ((KAFFINITY)1 << b)) f(g.Group * 64 + b);
+            };
+            if (e->Relationship == RelationProcessorPackage) {
+                for (WORD g = 0; g < e->Processor.GroupCount; ++g)
+                    for_each_cpu(e->Processor.GroupMask[g], [&](int id) { by_id[id].package = pkg; });
+                ++pkg;
+            } else if (e->Relationship == RelationProcessorCore) {
+                int smt = 0;
+                for (WORD g = 0; g < e->Processor.GroupCount; ++g)
+                    for_each_cpu(e->Processor.GroupMask[g], [&](int id) {
+                        by_id[id].id = id;
+                        by_id[id].core = core;
+                        by_id[id].smt = smt++;
+                    });
+                ++core;
+            } else if (e->Relationship == RelationCache && e->Cache.Type != CacheInstruction) {
+                int first = -1;
+                for_each_cpu(e->Cache.GroupMask, [&](int id) { if (first < 0) first = id; });
+                for_each_cpu(e->Cache.GroupMask, [&](int id) {
+                    auto& k = cache_of[id];
+                    if (e->Cache.Level >= k.first) k = { e->Cache.Level, first };
+                });
+            }
+            off += e->Size;
+        }
+    }
+    for (auto& kv : by_id) {
+        LogicalCpu c = kv.second;
+        c.package = dense_index(package_ids, c.package);
+        c.core = dense_index(core_ids, std::make_pair(c.package, c.core));
+        auto it = cache_of.find(c.id);
+        group_keys.push_back(it != cache_of.end() ? it->second : std::make_pair(0, c.package));
+        t.cpus.push_back(c);
+    }
+#endif
+    if (t.cpus.empty()) {
+        unsigned n = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned i = 0; i < n; ++i) {
+            LogicalCpu c;
+            c.id = c.core = (int)i;
+            t.cpus.push_back(c);
+            group_keys.push_back({ 0, 0 });
+            dense_index(package_ids, 0);
+            core_ids[{ 0, (int)i }] = (int)i;
+        }
+    }
+    for (size_t i = 0; i < t.cpus.size(); ++i) {
+        t.cpus[i].cache_group = dense_index(group_ids, group_keys[i]);
+        t.cache_level = std::max(t.cache_level, group_keys[i].first);
+    }
+    t.packages = std::max(1, (int)package_ids.size());
+    t.physical_cores = (int)core_ids.size();
+    t.cache_groups = std::max(1, (int)group_ids.size());
+    return t;
+}
+
+// ===================== Politicas de afinidad =====================
+
+// CPU de cada uno de los `threads` hilos segun la politica.
+inline std::vector<int> pin_map(const CpuTopology& t, PinPolicy policy, int threads) {
+    // Posicion de cada core fisico dentro de su paquete y de su grupo de cache
+    std::map<int, int> rank_in_package, rank_in_group;
+    {
+        std::map<int, int> next_pkg, next_grp;
+        for (const auto& c : t.cpus) {
+            if (rank_in_package.count(c.core)) continue;
+            rank_in_package[c.core] = next_pkg[c.package]++;
+            rank_in_group[c.core] = next_grp[c.cache_group]++;
+        }
+    }
+
+    std::vector<LogicalCpu> order;
+    for (const auto& c : t.cpus)
+        if (policy != PinPolicy::PhysicalOnly || c.smt == 0) order.push_back(c);
+    auto key = [&](const LogicalCpu& c) {
+        const int rp = rank_in_package[c.core], rg = rank_in_group[c.core];
+        switch (policy) {
+            case PinPolicy::Compact:      return std::make_tuple(c.package, rp, c.smt);
+            case PinPolicy::Scatter:      return std::make_tuple(c.smt, rp, c.package);
+            case PinPolicy::PhysicalOnly: return std::make_tuple(c.package, rp, 0);
+            case PinPolicy::CacheGroup:   return std::make_tuple(c.cache_group, c.smt, rg);
+        }
+        return std::make_tuple(0, 0, 0);
+    };
+    std::stable_sort(order.begin(), order.end(),
+                     [&](const LogicalCpu& a, const LogicalCpu& b) { return key(a) < key(b); });
+
+    std::vector<int> cpus(threads, 0);
+    for (int i = 0; i < threads && !order.empty(); ++i) cpus[i] = order[i % order.size()].id;
+    return cpus;
+}
+
+// Hilos por defecto: uno por CPU logico permitido, o por core fisico con
+// physical-only.
+inline int default_threads(const CpuTopology& t, PinPolicy policy) {
+    const int n = policy == PinPolicy::PhysicalOnly ? t.physical_cores : (int)t.cpus.size();
+    return std::max(1, n);
+}
+
+// "P0 C3 T1": paquete, core fisico e hilo SMT de un CPU (vacio si no esta).
+inline std::string describe_cpu(const CpuTopology& t, int id) {
+    const LogicalCpu* c = t.find(id);
+    if (!c) return "";
+    return "P" + std::to_string(c->package) + " C" + std::to_string(c->core) + " T" + std::to_string(c->smt);
+}
+
+// "2 paquetes, 16 cores fisicos, 32 logicos, 2 grupos L3"
+inline std::string topology_summary(const CpuTopology& t) {
+    std::string s = std::to_string(t.packages) + (t.packages == 1 ? " paquete, " : " paquetes, ")
+                  + std::to_string(t.physical_cores) + (t.physical_cores == 1 ? " core fisico, " : " cores fisicos, ")
+                  + std::to_string(t.cpus.size()) + " logicos";
+    if (t.cache_level > 0)
+        s += ", " + std::to_string(t.cache_groups) + (t.cache_groups == 1 ? " grupo L" : " grupos L")
+           + std::to_string(t.cache_level);
+    return s;
+}
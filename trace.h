@@ -0,0 +1,208 @@
+// Traza de eventos por hilo con salida en formato Chrome trace (JSON), para
+// ver en Perfetto (ui.perfetto.dev) o chrome://tracing la linea de tiempo de
+// cada worker: empaquetado, multiplicacion, teselas, robos, esperas y las
+// muestras del monitor.
+//
+// Cada hilo escribe en su propio TraceBuffer: un array de eventos de 32 bytes
+// reservado antes de empezar, sin locks ni memoria dinamica al registrar.
+// Solo un hilo escribe cada buffer a la vez (el relevo entre hilos, como el
+// despachador de MMP y main, va tras un join); el contador se publica con
+// release, asi que se puede leer hasta size() en cualquier momento. Si el
+// buffer se llena los eventos siguientes se descartan y se cuentan.
+//
+// Niveles:
+//   coarse  fases por hilo (empaquetar, multiplicar, verificar), esperas,
+//           join y muestras del monitor: unos pocos eventos por hilo y
+//           repeticion, se puede dejar siempre activo
+//   fine    ademas cada tesela (o tarea Strassen) y cada robo: dos o tres
+//           eventos por tesela
+//
+// Los tiempos son ns de steady_clock desde que se crea el Tracer.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+enum class TraceLevel { Off, Coarse, Fine };
+
+inline const char* trace_level_name(TraceLevel l) {
+    switch (l) {
+        case TraceLevel::Coarse: return "coarse";
+        case TraceLevel::Fine:   return "fine";
+        default:                 return "off";
+    }
+}
+
+inline bool parse_trace_level(const std::string& s, TraceLevel& l) {
+    if (s == "coarse")    l = TraceLevel::Coarse;
+    else if (s == "fine") l = TraceLevel::Fine;
+    else return false;
+    return true;
+}
+
+enum class TraceKind : std::uint8_t {
+    Pack, Compute, Tile, Task, Steal, Wait, Join, Verify, Rep,
+    SampleProgress, SampleCpu, SampleRam
+};
+
+inline const char* trace_kind_name(TraceKind k) {
+    switch (k) {
+        case TraceKind::Pack:           return "empaquetar B";
+        case TraceKind::Compute:        return "multiplicar";
+        case TraceKind::Tile:           return "tesela";
+        case TraceKind::Task:           return "tarea";
+        case TraceKind::Steal:          return "robo";
+        case TraceKind::Wait:           return "esperar";
+        case TraceKind::Join:           return "join";
+        case TraceKind::Verify:         return "verificar";
+        case TraceKind::Rep:            return "repeticion";
+        case TraceKind::SampleProgress: return "progreso %";
+        case TraceKind::SampleCpu:      return "CPU % hilo";
+        case TraceKind::SampleRam:      return "RAM MB";
+    }
+    return "?";
+}
+
+struct TraceEvent {
+    std::uint64_t t_ns;
+    double value;               // solo contadores
+    std::int32_t a, b;          // fila y columna de la tesela, hilo de la muestra...
+    TraceKind kind;
+    char phase;                 // 'B' inicio, 'E' fin, 'i' instante, 'C' contador
+};
+
+class TraceBuffer {
+public:
+    TraceBuffer(std::string name, std::size_t capacity, bool fine, std::chrono::steady_clock::time_point t0)
+        : name_(std::move(name)), events_(new TraceEvent[capacity]), capacity_(capacity), fine_(fine), t0_(t0) {}
+
+    const std::string& name() const { return name_; }
+    bool fine() const { return fine_; }
+
+    void begin(TraceKind k, int a = 0, int b = 0) { push(k, 'B', a, b, 0.0); }
+    void end(TraceKind k) { push(k, 'E', 0, 0, 0.0); }
+    void instant(TraceKind k, int a = 0, int b = 0) { push(k, 'i', a, b, 0.0); }
+    void counter(TraceKind k, double value, int a = 0) { push(k, 'C', a, 0, value); }
+
+    std::size_t size() const { return size_.load(std::memory_order_acquire); }
+    std::uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+    const TraceEvent& operator[](std::size_t i) const { return events_[i]; }
+
+private:
+    void push(TraceKind k, char ph, int a, int b, double value) {
+        const std::size_t n = size_.load(std::memory_order_relaxed);
+        if (n == capacity_) {
+            dropped_.store(dropped_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return;
+        }
+        TraceEvent& e = events_[n];
+        e.t_ns = (std::uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                     std::chrono::steady_clock::now() - t0_).count();
+        e.value = value;
+        e.a = a;
+        e.b = b;
+        e.kind = k;
+        e.phase = ph;
+        size_.store(n + 1, std::memory_order_release);
+    }
+
+    std::string name_;
+    std::unique_ptr<TraceEvent[]> events_;
+    std::size_t capacity_;
+    bool fine_;
+    std::chrono::steady_clock::time_point t0_;
+    std::atomic<std::size_t> size_{ 0 };
+    std::atomic<std::uint64_t> dropped_{ 0 };
+};
+
+class Tracer {
+public:
+    // capacity = eventos por hilo
+    Tracer(TraceLevel level, std::size_t capacity)
+        : level_(level), capacity_(std::max<std::size_t>(capacity, 16)), t0_(std::chrono::steady_clock::now()) {}
+
+    TraceLevel level() const { return level_; }
+
+    // Antes de que empiece a escribir ningun hilo; devuelve el indice del
+    // buffer. capacity = 0: la del Tracer.
+    int add_thread(const std::string& name, std::size_t capacity = 0) {
+        threads_.push_back(std::make_unique<TraceBuffer>(name, capacity ? capacity : capacity_,
+                                                         level_ == TraceLevel::Fine, t0_));
+        return (int)threads_.size() - 1;
+    }
+
+    int threads() const { return (int)threads_.size(); }
+    TraceBuffer* thread(int i) { return i >= 0 && i < threads() ? threads_[i].get() : nullptr; }
+
+    std::size_t events() const {
+        std::size_t n = 0;
+        for (const auto& t : threads_) n += t->size();
+        return n;
+    }
+    std::uint64_t dropped() const {
+        std::uint64_t n = 0;
+        for (const auto& t : threads_) n += t->dropped();
+        return n;
+    }
+
+    // Un evento por linea: {"traceEvents": [...], "displayTimeUnit": "ns"}.
+    // El tid de cada hilo es su indice (se ordenan asi en Perfetto).
+    bool write_chrome_json(const std::string& path, std::string& err) const {
+        std::ofstream out(path, std::ios::out | std::ios::trunc);
+        if (!out) { err = "no se pudo escribir"; return false; }
+        out << "{\"traceEvents\": [\n";
+        out << "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"args\": {\"name\": \"MMP\"}}";
+        char buf[64];
+        for (int t = 0; t < threads(); ++t) {
+            out << ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << t
+                << ", \"args\": {\"name\": \"" << threads_[t]->name() << "\"}}"
+                << ",\n{\"name\": \"thread_sort_index\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << t
+                << ", \"args\": {\"sort_index\": " << t << "}}";
+            const TraceBuffer& tb = *threads_[t];
+            const std::size_t n = tb.size();
+            for (std::size_t i = 0; i < n; ++i) {
+                const TraceEvent& e = tb[i];
+                std::snprintf(buf, sizeof(buf), "%llu.%03u", (unsigned long long)(e.t_ns / 1000),
+                              (unsigned)(e.t_ns % 1000));
+                out << ",\n{\"name\": \"" << trace_kind_name(e.kind);
+                if (e.kind == TraceKind::SampleCpu) out << " " << e.a;
+                out << "\", \"ph\": \"" << e.phase << "\", \"ts\": " << buf << ", \"pid\": 1, \"tid\": " << t;
+                switch (e.phase) {
+                    case 'B':
+                        if (e.kind == TraceKind::Tile)
+                            out << ", \"args\": {\"fila\": " << e.a << ", \"columna\": " << e.b << "}";
+                        else if (e.kind == TraceKind::Task || e.kind == TraceKind::Rep)
+                            out << ", \"args\": {\"n\": " << e.a << "}";
+                        break;
+                    case 'i':
+                        out << ", \"s\": \"t\"";
+                        if (e.kind == TraceKind::Steal)
+                            out << ", \"args\": {\"fila\": " << e.a << ", \"columna\": " << e.b << "}";
+                        break;
+                    case 'C':
+                        out << ", \"args\": {\"valor\": " << e.value << "}";
+                        break;
+                }
+                out << "}";
+            }
+        }
+        out << "\n], \"displayTimeUnit\": \"ns\"}\n";
+        out.flush();
+        if (!out) { err = "error al escribir"; return false; }
+        return true;
+    }
+
+private:
+    TraceLevel level_;
+    std::size_t capacity_;
+    std::chrono::steady_clock::time_point t0_;
+    std::vector<std::unique_ptr<TraceBuffer>> threads_;
+};
@@ -0,0 +1,225 @@
+// Comprobacion de C = A x B sin repetir el producto (Freivalds).
+//
+// Con un vector aleatorio r de ceros y unos, si C es correcta A(Br) = Cr.
+// Si alguna fila de C esta mal, esa fila pasa una ronda con probabilidad
+// <= 1/2 (fijados los demas r_j, solo uno de los dos valores del r_j de un
+// elemento erroneo puede anular la diferencia), asi que con R rondas
+// independientes una C erronea se acepta con probabilidad <= 2^-R. Cada
+// ronda cuesta O(K*N + M*K + M*N) en lugar de O(M*K*N).
+//
+// Con acumulador entero las cuentas son modulo 2^64 (uint64_t, sin
+// desbordamientos indefinidos): la C exacta cabe en Acc, asi que la
+// igualdad modulo 2^64 es la igualdad exacta. Con coma flotante se admite
+// una diferencia relativa de unos pocos epsilon por cada termino de K
+// frente a |A|(|B|r) + |C|r.
+//
+// Ademas se calcula una suma por bloque de VERIFY_BLOCK_ROWS filas de C
+// (FNV-1a de matrix_file.h encadenada fila a fila sobre las columnas, sin
+// el relleno): no depende de hilos, teselas ni stride, de modo que la salida
+// de MMS y la de MMP se comparan por sus sumas sin guardar ninguna de las dos
+// (exacto con tipos enteros; con coma flotante el orden de las sumas cambia
+// los ultimos bits).
+//
+// Uso en paralelo: project_b() sobre un reparto de las filas de B y despues
+// check_rows() sobre un reparto de las filas de C alineado a bloques
+// (row_split); un bloque partido entre llamadas debe recorrerse en orden y
+// sin concurrencia (como hacen los paneles de la tuberia).
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <limits>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "counter_rng.h"
+#include "matrix.h"
+#include "matrix_file.h"
+
+static constexpr int VERIFY_BLOCK_ROWS = 256;
+static constexpr int VERIFY_MAX_ROUNDS = 64;         // bits de r por columna (dos palabras de un bloque Philox)
+static constexpr std::uint32_t RNG_STREAM_VERIFY = 2;   // ver RNG_STREAM_A / _B
+
+struct VerifyResult {
+    int rounds = 0;
+    bool ok = true;
+    long long bad_rows = 0;                 // filas que fallaron alguna ronda
+    int first_bad_row = -1;
+    double failure_bound = 1.0;             // P(aceptar una C erronea) <= 2^-rounds
+    int block_rows = VERIFY_BLOCK_ROWS;
+    std::vector<std::uint64_t> block_sums;
+    std::uint64_t combined = 0;             // FNV-1a de las sumas de bloque
+    double time_s = 0.0;                    // lo rellena quien mide
+};
+
+template <class T, class Acc>
+class FreivaldsCheck {
+public:
+    // Entero: aritmetica modular exacta; coma flotante: double con tolerancia.
+    using V = typename std::conditional<std::is_integral<Acc>::value, std::uint64_t, double>::type;
+
+    FreivaldsCheck(ConstMatrixViewT<T> A, ConstMatrixViewT<T> B, ConstMatrixViewT<Acc> C, int rounds,
+                   std::uint64_t seed)
+        : A_(A), B_(B), C_(C), rounds_(std::min(std::max(1, rounds), VERIFY_MAX_ROUNDS)),
+          r_((std::size_t)B.cols * rounds_), br_((std::size_t)B.rows * rounds_),
+          br_abs_(std::is_integral<Acc>::value ? 0 : (std::size_t)B.rows * rounds_),
+          sums_((C.rows + VERIFY_BLOCK_ROWS - 1) / VERIFY_BLOCK_ROWS, MATRIX_CHECKSUM_SEED) {
+        // r(j, t) = bit de Philox de (seed, RNG_STREAM_VERIFY, j): el mismo
+        // vector en MMS y MMP para la misma semilla
+        for (int j = 0; j < B.cols; ++j) {
+            const PhiloxBlock x = philox4x32_10({ (std::uint32_t)j, 0u, RNG_STREAM_VERIFY, 0u }, seed);
+            for (int t = 0; t < rounds_; ++t) r_[(std::size_t)j * rounds_ + t] = (V)((x[t / 32 % 4] >> (t % 32)) & 1u);
+        }
+    }
+
+    int rounds() const { return rounds_; }
+    int blocks() const { return (int)sums_.size(); }
+
+    // Filas de B por hilo (project_b) y de C por hilo alineadas a bloques (check_rows).
+    std::vector<int> b_split(int parts) const {
+        std::vector<int> s(parts + 1);
+        for (int w = 0; w <= parts; ++w) s[w] = (int)((long long)B_.rows * w / parts);
+        return s;
+    }
+    std::vector<int> row_split(int parts) const {
+        std::vector<int> s(parts + 1);
+        for (int w = 0; w <= parts; ++w)
+            s[w] = std::min(C_.rows, (int)((long long)blocks() * w / parts) * VERIFY_BLOCK_ROWS);
+        return s;
+    }
+
+    // (Br)[p] y, con coma flotante, (|B|r)[p] para las filas [p0, p1) de B.
+    void project_b(int p0, int p1) {
+        const int R = rounds_;
+        for (int p = p0; p < p1; ++p) {
+            V* out = &br_[(std::size_t)p * R];
+            std::fill(out, out + R, V(0));
+            const T* b = B_.row(p);
+            for (int j = 0; j < B_.cols; ++j) {
+                const V bj = (V)b[j];
+                const V* rj = &r_[(std::size_t)j * R];
+                for (int t = 0; t < R; ++t) out[t] += bj * rj[t];
+            }
+            if (!std::is_integral<Acc>::value) {
+                V* oa = &br_abs_[(std::size_t)p * R];
+                std::fill(oa, oa + R, V(0));
+                for (int j = 0; j < B_.cols; ++j) {
+                    const V bj = abs_v((V)b[j]);
+                    const V* rj = &r_[(std::size_t)j * R];
+                    for (int t = 0; t < R; ++t) oa[t] += bj * rj[t];
+                }
+            }
+        }
+    }
+
+    // A(Br) contra Cr en las filas [r0, r1) de C y sus sumas por bloque.
+    void check_rows(int r0, int r1) {
+        const int R = rounds_;
+        std::vector<V> y(R), z(R), ya(R), za(R);
+        long long bad = 0;
+        int first_bad = -1;
+        for (int i = r0; i < r1; ++i) {
+            std::fill(y.begin(), y.end(), V(0));
+            std::fill(z.begin(), z.end(), V(0));
+            const T* a = A_.row(i);
+            for (int p = 0; p < A_.cols; ++p) {
+                const V ap = (V)a[p];
+                const V* bp = &br_[(std::size_t)p * R];
+                for (int t = 0; t < R; ++t) y[t] += ap * bp[t];
+            }
+            const Acc* c = C_.row(i);
+            for (int j = 0; j < C_.cols; ++j) {
+                const V cj = (V)c[j];
+                const V* rj = &r_[(std::size_t)j * R];
+                for (int t = 0; t < R; ++t) z[t] += cj * rj[t];
+            }
+            bool row_ok = true;
+            if (std::is_integral<Acc>::value) {
+                for (int t = 0; t < R; ++t) row_ok &= (y[t] == z[t]);
+            } else {
+                std::fill(ya.begin(), ya.end(), V(0));
+                std::fill(za.begin(), za.end(), V(0));
+                for (int p = 0; p < A_.cols; ++p) {
+                    const V ap = abs_v((V)a[p]);
+                    const V* bp = &br_abs_[(std::size_t)p * R];
+                    for (int t = 0; t < R; ++t) ya[t] += ap * bp[t];
+                }
+                for (int j = 0; j < C_.cols; ++j) {
+                    const V cj = abs_v((V)c[j]);
+                    const V* rj = &r_[(std::size_t)j * R];
+                    for (int t = 0; t < R; ++t) za[t] += cj * rj[t];
+                }
+                const double tol = 4.0 * (A_.cols + 2) * (double)std::numeric_limits<Acc>::epsilon();
+                for (int t = 0; t < R; ++t) row_ok &= abs_v(y[t] - z[t]) <= tol * (ya[t] + za[t]);
+            }
+            if (!row_ok) {
+                ++bad;
+                if (first_bad < 0) first_bad = i;
+            }
+            std::uint64_t& h = sums_[i / VERIFY_BLOCK_ROWS];
+            h = matrix_checksum(c, (std::size_t)C_.cols * sizeof(Acc), h);
+        }
+        if (bad > 0) {
+            bad_rows_.fetch_add(bad, std::memory_order_relaxed);
+            int prev = first_bad_.load(std::memory_order_relaxed);
+            while ((prev < 0 || first_bad < prev) &&
+                   !first_bad_.compare_exchange_weak(prev, first_bad, std::memory_order_relaxed)) {}
+        }
+    }
+
+    VerifyResult result() const {
+        VerifyResult res;
+        res.rounds = rounds_;
+        res.bad_rows = bad_rows_.load();
+        res.first_bad_row = first_bad_.load();
+        res.ok = res.bad_rows == 0;
+        res.failure_bound = std::ldexp(1.0, -rounds_);
+        res.block_sums = sums_;
+        res.combined = matrix_checksum(sums_.data(), sums_.size() * sizeof(std::uint64_t));
+        return res;
+    }
+
+private:
+    static V abs_v(V v) { return v > V(0) ? v : V(0) - v; }
+
+    ConstMatrixViewT<T> A_, B_;
+    ConstMatrixViewT<Acc> C_;
+    int rounds_;
+    std::vector<V> r_, br_, br_abs_;        // r: N x R; Br, |B|r: K x R
+    std::vector<std::uint64_t> sums_;
+    std::atomic<long long> bad_rows_{ 0 };
+    std::atomic<int> first_bad_{ -1 };
+};
+
+// Suma como texto fijo de 16 cifras hexadecimales (igual en MMS y MMP).
+inline std::string checksum_hex(std::uint64_t h) {
+    char buf[17];
+    std::snprintf(buf, sizeof(buf), "%016llx", (unsigned long long)h);
+    return buf;
+}
+
+// ===================== Informe =====================
+
+// `label_width`: ancho de la columna de etiquetas del resumen en que se
+// imprime, para que los valores queden alineados con el resto de lineas.
+inline void print_verify(std::ostream& out, const VerifyResult& v, int label_width) {
+    const std::string label = "Freivalds (" + std::to_string(v.rounds) + " rondas):";
+    out << "  " << std::left << std::setw(label_width) << label << std::right;
+    if (v.ok)
+        out << "correcta (P(error no detectado) <= " << std::scientific << std::setprecision(1)
+            << v.failure_bound << std::fixed << ")";
+    else
+        out << "ERROR en " << v.bad_rows << " filas (primera: " << v.first_bad_row << ")";
+    out << " en " << std::setprecision(6) << v.time_s << " s\n"
+        << "  " << std::left << std::setw(label_width) << "Suma de C por bloques:" << std::right
+        << checksum_hex(v.combined) << " (" << v.block_sums.size()
+        << " bloques de " << v.block_rows << " filas)\n";
+}